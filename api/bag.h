@@ -81,6 +81,7 @@ typedef int HDF_hid_t;
 #define BAG_DEFAULT_COMPRESSION     1
 #define BAG_OPT_SURFACE_LIMIT       14      /* The maximum number of optional surfaces in a single BAG */
 #define BAG_SURFACE_CORRECTOR_LIMIT 10      /* The maximum number of datum correctors per bagVerticalCorrector */
+#define BAG_REGION_MAX_LAYERS       32      /* The maximum number of layers of one bagReadRegionLayers call */
 #define REF_SYS_MAX_LENGTH          2048    /* The maximum length of the reference system definition string */
 
 
@@ -162,8 +163,82 @@ typedef struct t_bagTrackingItem
                      /* describes the modifications                            */
 } bagTrackingItem;
 
+/* The kinds of tracking list query, see bagTrackingQuery */
+enum BAG_TRACK_QUERY
+{
+    BAG_TRACK_BY_NODE    = 0, /* items of the node at row, col                       */
+    BAG_TRACK_BY_SERIES  = 1, /* items of the list_series                            */
+    BAG_TRACK_BY_CODE    = 2, /* items of the track_code                             */
+    BAG_TRACK_BY_SUBNODE = 3, /* items of row, col, sub_row, sub_col; VarRes only    */
+    BAG_TRACK_ALL        = 4  /* every item                                          */
+};
+
+/* One query of a tracking list, see bagReadTrackingListInto() and bagScanTrackingList() */
+typedef struct t_bagTrackingQuery
+{
+    u8  by;          /* one of BAG_TRACK_QUERY                                  */
+    u32 row;         /* node, for BAG_TRACK_BY_NODE and BAG_TRACK_BY_SUBNODE    */
+    u32 col;
+    u32 sub_row;     /* refined node, for BAG_TRACK_BY_SUBNODE                  */
+    u32 sub_col;
+    u8  track_code;  /* for BAG_TRACK_BY_CODE                                   */
+    u16 list_series; /* for BAG_TRACK_BY_SERIES                                 */
+} bagTrackingQuery;
+
+/* Receives the items found by bagScanTrackingList(), a block at a time;
+ * any return but BAG_SUCCESS ends the scan */
+typedef bagError (*bagTrackingItemFunc) (const bagTrackingItem *items, u32 count, void *user);
+
+/* Stages reported to a bagSortProgressFunc */
+enum BAG_SORT_STAGE
+{
+    BAG_SORT_RUNS  = 0, /* sorting the list a memory load at a time             */
+    BAG_SORT_MERGE = 1  /* merging the sorted runs; done restarts at each pass  */
+};
+
+/* Receives the progress of bagSortTrackingListEx(): done of total items */
+typedef void (*bagSortProgressFunc) (u32 stage, u32 done, u32 total, void *user);
+
 typedef struct _t_bagHandle *bagHandle;
 
+typedef struct _t_bagTileIterator *bagTileIterator;
+
+typedef struct _t_bagPrefetcher *bagPrefetcher;
+
+typedef struct _t_bagTrackingAppender *bagTrackingAppender;
+
+typedef struct _t_bagBulkWriter *bagBulkWriter;
+
+/* A window of a surface, inclusive of both ends as with bagReadRegion() */
+typedef struct t_bagWindow
+{
+    u32  start_row;
+    u32  start_col;
+    u32  end_row;
+    u32  end_col;
+} bagWindow;
+
+/* One window delivered by bagPrefetchNext() */
+typedef struct t_bagPrefetchBuffer
+{
+    u32        index;      /* position of the window in the plan                          */
+    bagWindow  window;     /* the window itself                                           */
+    u32        nrows;      /* rows in the window                                          */
+    u32        ncols;      /* cols in the window, also the row stride of each buffer      */
+    void     **data;       /* one buffer per layer, in the order the layers were given    */
+} bagPrefetchBuffer;
+
+/* One chunk-aligned tile of the mandatory surfaces, see bagTileIteratorNext() */
+typedef struct t_bagTile
+{
+    u32  row;          /* row offset of the first node of the tile within the surfaces */
+    u32  col;          /* col offset of the first node of the tile within the surfaces */
+    u32  nrows;        /* number of rows in this tile, smaller along the grid edges    */
+    u32  ncols;        /* number of cols in this tile, also the row stride of the data */
+    f32 *elevation;    /* nrows * ncols elevation values, owned by the iterator        */
+    f32 *uncertainty;  /* nrows * ncols uncertainty values, owned by the iterator      */
+} bagTile;
+
 typedef struct _t_bag_definition
 {
     u32    nrows;                                     /* number of rows of data contained in the arrays               */
@@ -192,6 +267,42 @@ typedef struct _t_bag_data_opt
 	HDF_hid_t    datatype;						  /* HDF5 datatype identifier									  */
 } bagDataOpt;
 
+/* Compression codecs of the surface datasets, see bagFilterSpec */
+enum BAG_CODECS
+{
+    BAG_CODEC_DEFLATE   = 0, /* zlib deflate, always available */
+    BAG_CODEC_ZSTD      = 1, /* Zstandard, when the HDF5 filter plugin is registered */
+    BAG_CODEC_LZ4       = 2  /* LZ4, when the HDF5 filter plugin is registered */
+};
+
+/* Expected access pattern of a surface, used to plan its chunk shape, see bagPlanChunks */
+enum BAG_ACCESS_HINTS
+{
+    BAG_ACCESS_TILES    = 0, /* Windows of the surface; square chunks */
+    BAG_ACCESS_ROWS     = 1, /* Sweeps of whole rows; full width chunks */
+    BAG_ACCESS_NODES    = 2  /* Scattered single nodes; small chunks */
+};
+
+/* How a node of an overview level summarizes the 2x2 nodes below it */
+enum BAG_OVERVIEW_AGGREGATORS
+{
+    BAG_OVERVIEW_SHOALEST        = 0, /* The node of greatest elevation */
+    BAG_OVERVIEW_MEAN            = 1, /* The mean elevation and mean uncertainty */
+    BAG_OVERVIEW_MAX_UNCERTAINTY = 2  /* The node of greatest uncertainty */
+};
+
+#define BAG_OVERVIEW_MAX_LEVELS 16      /* Most overview levels of a BAG */
+#define BAG_OVERVIEW_AUTO       0xFF    /* Levels until the coarsest is at most 256 nodes a side */
+
+/* Filters applied to the surface datasets when compressionLevel is not 0 */
+typedef struct _t_bag_filter_spec
+{
+    u8       shuffle;                                 /* Non-zero to byte-shuffle values before compressing           */
+    u8       codec;                                   /* One of BAG_CODECS; deflate is used if it is not registered   */
+    u8       scaleOffsetDigits;                       /* Non-zero to keep this many decimal digits of f32 surfaces    */
+                                                      /* with the lossy HDF5 scale-offset filter                      */
+} bagFilterSpec;
+
 typedef struct _t_bag_data
 {
     bagDef   def;                                     /* Geospatial definitions                                       */
@@ -208,8 +319,51 @@ typedef struct _t_bag_data
     bagTrackingItem *tracking_list;                   /* Tracking list array                                          */
     u8       compressionLevel;                        /* The requested compression level for surface datasets         */
     u32      chunkSize;                               /* The chunk size for disk I/O access of surface datasets       */
+    bagFilterSpec filter;                             /* Filters used with compressionLevel, zero for plain deflate   */
+    u8       accessHint;                              /* One of BAG_ACCESS_HINTS, used when chunkSize is 0            */
+    u32      chunkBytes;                              /* Target bytes per chunk when planned, 0 for the default       */
+    u8       overviewLevels;                          /* Overview levels made at creation, 0 for none, or BAG_OVERVIEW_AUTO */
+    u8       overviewAggregator;                      /* One of BAG_OVERVIEW_AGGREGATORS                              */
+    u8       chunkIndex;                              /* Non-zero to index the chunks of the surfaces at creation     */
+    u8       sparse;                                  /* Non-zero to allocate chunks only as they are first written   */
 } bagData;
 
+/* Layout of the new file written by bagRepack */
+typedef struct _t_bag_repack_options
+{
+    u8       compressionLevel;                        /* Deflate level 0-9 of the new file, 0 for no compression      */
+    bagFilterSpec filter;                             /* Filters used with compressionLevel, as in bagData            */
+    u8       accessHint;                              /* One of BAG_ACCESS_HINTS, used when chunkSize is 0            */
+    u32      chunkSize;                               /* Square chunk of the surfaces, 0 to plan it                   */
+    u32      chunkBytes;                              /* Target bytes per planned chunk, 0 for the default            */
+    u8      *secKey;                                  /* Secret key to re-sign with, NULL to leave the copy unsigned  */
+} bagRepackOptions;
+
+#define BAG_STATS_BINS  64      /* Bins of the histograms kept by bagComputeLayerStats */
+
+/* Summary of one f32 field of a layer, see bagComputeLayerStats */
+typedef struct _t_bag_layer_stats
+{
+    f64      count;                                   /* Nodes holding a value                                        */
+    f64      null_count;                              /* Nodes holding the null value or NaN                          */
+    f64      mean;                                    /* Mean of the values                                           */
+    f64      variance;                                /* Population variance of the values                            */
+    f64      histogram_min;                           /* Low edge of the first bin                                    */
+    f64      histogram_max;                           /* High edge of the last bin                                    */
+    f64      histogram[BAG_STATS_BINS];               /* Values per bin, all bins of equal width                      */
+} bagLayerStats;
+
+#define BAG_CHUNK_COUNT_UNKNOWN 0xFFFFFFFF  /* Count of a chunk written since bagUpdateSurface was last called */
+
+/* One chunk of a surface found by bagQueryChunkIndex */
+typedef struct _t_bag_chunk_info
+{
+    u32      start_row, start_col;                    /* First node of the chunk                                      */
+    u32      end_row, end_col;                        /* Last node of the chunk                                       */
+    f32      min, max;                                /* Range of the non-null values of the chunk                    */
+    u32      count;                                   /* Non-null nodes of the chunk, or BAG_CHUNK_COUNT_UNKNOWN      */
+} bagChunkInfo;
+
 typedef struct _t_bag_vorigin
 {
     f64    nodeSpacingX; /* node spacing in x dimension in units defined by coord system */ 
@@ -286,6 +440,9 @@ typedef struct _t_bag_varResTrackingList
                         /* describes the modifications                           */
 } bagVarResTrackingItem;
 
+/* Receives the items found by bagScanVarResTrackingList(), a block at a time */
+typedef bagError (*bagVarResTrackingItemFunc) (const bagVarResTrackingItem *items, u32 count, void *user);
+
 /* The type of Uncertainty encoded in this BAG. */
 enum BAG_UNCERT_TYPES
 {
@@ -349,6 +506,28 @@ enum BAG_OPEN_MODE {
 /* Bit flag definitions for file open access ID */
 #define BAG_ACCESS_DEFAULT           0
 
+/* HDF raw data chunk cache settings for one dataset, see bagFileOpenEx().
+ * A zero field keeps the HDF default, so a zeroed layer keeps all of them.
+ * Since a zero w0 means the default, a policy of 0.0 is asked for with
+ * BAG_CHUNK_CACHE_W0_NONE. */
+#define BAG_CHUNK_CACHE_W0_NONE     (-1.0)
+
+typedef struct _t_bagChunkCacheOptions
+{
+    u32  nslots;       /* slots in the chunk hash table, ideally a prime ~100x the chunks cached */
+    u32  nbytes;       /* bytes of uncompressed chunks to keep for the dataset, zero for default */
+    f64  w0;           /* preemption policy 0.0 - 1.0, zero for default, see BAG_CHUNK_CACHE_W0_NONE */
+} bagChunkCacheOptions;
+
+/* Extended open options, see bagFileOpenEx().  A zeroed struct means all defaults. */
+typedef struct _t_bagOpenOptions
+{
+    bagChunkCacheOptions chunkCache[BAG_OPT_SURFACE_LIMIT]; /* indexed by BAG_SURFACE_PARAMS           */
+    u32                  pageBufferSize;                    /* bytes of HDF page buffer, zero disables */
+    u32                  pageBufferUsed;                    /* out: pageBufferSize if the file took it,
+                                                               zero if it was opened without a page buffer */
+} bagOpenOptions;
+
 /* Function prototypes */
 
 /* bag_hdf.c */  
@@ -363,6 +542,25 @@ BAG_EXTERNAL bagError bagFileOpen(bagHandle *bagHandle, s32 accessMode, const u8
  *     
  */
 
+/* bag_hdf.c */  
+BAG_EXTERNAL bagError bagFileOpenEx(bagHandle *bagHandle, s32 accessMode, const u8 *fileName,
+                                    bagOpenOptions *options); 
+/* Description:
+ *     Same as bagFileOpen, with tuning of the HDF caches.  The chunk cache of
+ *     each surface, mandatory or optional, is sized from options->chunkCache[type]
+ *     when that dataset is opened, so e.g. the refinement layer can be given a
+ *     different cache than the 2D grids.  A non-zero pageBufferSize enables HDF
+ *     page buffering on HDF 1.10.1 and later, for files written with the paged
+ *     file space strategy; other files are opened without it, keeping every
+ *     other setting, and options->pageBufferUsed is set to zero to tell so.
+ *
+ * Arguments:
+ *     options - may be NULL, which is identical to bagFileOpen
+ * 
+ * Return value:
+ *     On success, BAG_SUCCESS.  On failure, a code from BAG_ERRORS.
+ */
+
 /* bag_hdf.c */                             
 BAG_EXTERNAL bagError bagFileCreate(const u8 *file_name, bagData *data, bagHandle *bag_handle);
 
@@ -452,6 +650,26 @@ BAG_EXTERNAL bagError bagReadNodePos (bagHandle bag, u32 row, u32 col, s32 type,
  *    based on the coordinate system of the bag.
  */
 
+BAG_EXTERNAL bagError bagReadNodes  (bagHandle bagHandle, u32 nnodes, const u32 *rows, const u32 *cols,
+                                     s32 type, void *data, Bool *valid);
+BAG_EXTERNAL bagError bagWriteNodes (bagHandle bagHandle, u32 nnodes, const u32 *rows, const u32 *cols,
+                                     s32 type, const void *data);
+/* Description:
+ *     Read or write nnodes arbitrary nodes of one surface in as few HDF calls
+ *     as possible.  Node i is at rows[i], cols[i] and is element i of data,
+ *     which holds f32 or the layer's compound struct.  Nodes are grouped by
+ *     HDF chunk internally; the caller's order is kept in data.
+ *
+ * Arguments:
+ *     valid - optional (NULL to ignore).  When given to bagReadNodes, nodes
+ *             outside the surface are skipped instead of failing the call,
+ *             and valid[i] is True only for nodes that were read and are not
+ *             null (nulls are only detected on single valued f32 layers).
+ *
+ * Return value:
+ *     On success, BAG_SUCCESS.  On failure, a code from BAG_ERRORS.
+ */
+
 
  
 /* TBD */
@@ -577,6 +795,245 @@ BAG_EXTERNAL bagError bagReadRegionPos (bagHandle bag, u32 start_row, u32 start_
  *    Same as bagReadRegion, but also populates x and y with the positions.
  */
 
+BAG_EXTERNAL bagError bagReadRegionInto (bagHandle bagHandle, u32 start_row, u32 start_col, 
+                                   u32 end_row, u32 end_col, s32 type, void *data, u32 row_stride);
+BAG_EXTERNAL bagError bagWriteRegionFrom (bagHandle bagHandle, u32 start_row, u32 start_col, 
+                                    u32 end_row, u32 end_col, s32 type, const void *data, u32 row_stride);
+/* Description:
+ *     Same as bagReadRegion/bagWriteRegion, but the values are transferred directly
+ *     to or from the caller's contiguous buffer instead of the bagData arrays, so
+ *     no memory is allocated per call.  Works for every surface type; compound
+ *     optional layers use their struct (e.g. bagOptNodeGroup) as the element.
+ *
+ * Arguments:
+ *     data       - at least row_stride * (end_row - start_row + 1) elements
+ *     row_stride - elements between the starts of consecutive rows in data,
+ *                  0 for packed rows (end_col - start_col + 1)
+ *
+ * Return value:
+ *     On success, BAG_SUCCESS.  On failure, a code from BAG_ERRORS.
+ */
+
+BAG_EXTERNAL bagError bagReadRegionLayers (bagHandle bagHandle, u32 start_row, u32 start_col, 
+                                     u32 end_row, u32 end_col, u32 nlayers, const s32 *types,
+                                     void **data, u32 row_stride);
+/* Description:
+ *     Reads the same region of several surfaces, e.g. Elevation, Uncertainty,
+ *     Nominal_Elevation and Node_Group, in a single call.  data[i] receives
+ *     layer types[i], exactly as bagReadRegionInto would fill it.  Every layer
+ *     must cover the region; they are all checked before any is read.  At most
+ *     BAG_REGION_MAX_LAYERS layers are read by one call.
+ *
+ * Return value:
+ *     On success, BAG_SUCCESS.  On failure, a code from BAG_ERRORS.
+ */
+
+BAG_EXTERNAL bagError bagGetMemspaceCacheStats (bagHandle bagHandle, u32 *hits, u32 *misses);
+/* Description:
+ *     Node, row and region I/O keep a small LRU cache of HDF memspaces per
+ *     handle, keyed by surface and shape.  This reports how many accesses
+ *     found their memspace in the cache and how many had to create one.
+ *
+ * Return value:
+ *     On success, BAG_SUCCESS.  On failure, a code from BAG_ERRORS.
+ */
+
+/* bag_chunks.c */
+BAG_EXTERNAL bagError bagReadRegionParallel (bagHandle hnd, u32 start_row, u32 start_col, u32 end_row, u32 end_col,
+                                             s32 type, void *data, u32 row_stride, u32 nthreads);
+/* Description:
+ *     Same as bagReadRegionInto, but the compressed chunks covering the region
+ *     are fetched raw and decompressed by nthreads workers (0 uses one per
+ *     processor) before being copied into data.  bagReadDataset reads whole
+ *     surfaces this way.  Layers that are not chunked, or use filters other
+ *     than deflate and shuffle, are read through H5Dread as before.
+ *
+ * Return value:
+ *     On success, BAG_SUCCESS.  On failure, a code from BAG_ERRORS.
+ */
+
+BAG_EXTERNAL bagError bagBulkWriterOpen  (bagHandle hnd, s32 type, u32 nthreads, bagBulkWriter *bw);
+BAG_EXTERNAL bagError bagBulkWriteRows   (bagBulkWriter bw, u32 nrows, const void *data, u32 row_stride);
+BAG_EXTERNAL bagError bagBulkWriterClose (bagBulkWriter bw);
+/* Description:
+ *     Fast sequential writing of a whole surface.  Rows are given in order,
+ *     from row 0, to bagBulkWriteRows (row_stride 0 for packed rows).  Each
+ *     completed row of chunks is compressed by nthreads workers (0 uses one
+ *     per processor) and stored with direct chunk writes, producing the same
+ *     filters and layout as bagWriteRow.  bagBulkWriterClose writes any rows
+ *     still gathered.  Layers that cannot be encoded this way are written
+ *     through H5Dwrite in large bands instead.
+ *
+ * Return value:
+ *     On success, BAG_SUCCESS.  On failure, a code from BAG_ERRORS.
+ */
+
+/* bag_repack.c */
+BAG_EXTERNAL bagError bagRepack (const u8 *srcName, const u8 *dstName, const bagRepackOptions *opts);
+/* Description:
+ *     Copies the BAG srcName into the new file dstName: every group,
+ *     dataset, attribute and the XML metadata, with the surfaces, the
+ *     tracking lists and the other datasets rechunked and compressed as
+ *     opts asks.  Values are streamed in bands of chunks, so memory use
+ *     does not grow with the size of the BAG.  A signature of srcName
+ *     would not verify against the new bytes, so it is not copied: given
+ *     opts->secKey, dstName is signed again with the same signature ID,
+ *     otherwise dstName is left unsigned.  dstName must not exist.
+ *
+ * Return value:
+ *     On success, BAG_SUCCESS.  BAG_CRYPTO_SIGNATURE_DROPPED when srcName
+ *     is signed and opts->secKey is NULL; dstName is then complete but
+ *     unsigned.  On failure, a code from BAG_ERRORS.
+ */
+
+/* bag_overview.c */
+BAG_EXTERNAL bagError bagBuildOverviews      (bagHandle hnd, u32 levels, u8 aggregator);
+BAG_EXTERNAL bagError bagSelectOverviewLevel (bagHandle hnd, f64 resolution, u32 *level);
+BAG_EXTERNAL bagError bagReadOverviewRegion  (bagHandle hnd, s32 type, u32 level, u32 start_row, u32 start_col,
+                                              u32 end_row, u32 end_col, f32 *data, u32 *nrows, u32 *ncols);
+/* Description:
+ *     Overview level k holds Elevation and Uncertainty reduced 2^k times in
+ *     each direction, each node summarizing 2x2 nodes of the level below
+ *     with one of BAG_OVERVIEW_AGGREGATORS.  A BAG created with
+ *     overviewLevels set in its bagData gets an empty pyramid, which
+ *     bagUpdateSurface brings up to date over the rows written since it was
+ *     last called.  bagBuildOverviews makes (or, with levels 0, removes) the
+ *     pyramid of an existing BAG in one pass over its surfaces; overviewLevels
+ *     and overviewAggregator of bagGetDataPointer describe the pyramid.
+ *
+ *     bagSelectOverviewLevel gives the coarsest level whose node spacing is
+ *     no larger than resolution, 0 meaning the surface itself.
+ *     bagReadOverviewRegion reads, from that level, the nodes covering the
+ *     region given in full resolution rows and columns: data must hold
+ *     ((end_row >> level) - (start_row >> level) + 1) *
+ *     ((end_col >> level) - (start_col >> level) + 1) values.
+ *
+ * Return value:
+ *     On success, BAG_SUCCESS.  On failure, a code from BAG_ERRORS.
+ */
+
+/* bag_chunk_index.c */
+BAG_EXTERNAL bagError bagBuildChunkIndex (bagHandle hnd);
+BAG_EXTERNAL bagError bagQueryChunkIndex (bagHandle hnd, s32 type, f32 min_value, f32 max_value,
+                                          bagChunkInfo *chunks, u32 max_chunks, u32 *nfound);
+/* Description:
+ *     The chunk index of Elevation and Uncertainty holds, for each chunk of
+ *     the surface (each band of rows of a contiguous surface), the number of
+ *     non-null nodes and their range.  While it is present, region reads
+ *     fill the chunks known to be empty with the null value instead of
+ *     reading them, and bagUpdateSurface takes the surface range from the
+ *     index.  A BAG created with chunkIndex set in its bagData starts with
+ *     an index of empty chunks; bagBuildChunkIndex indexes an existing BAG
+ *     in one pass over its surfaces.  Writes make the chunks they touch
+ *     unknown until bagUpdateSurface rescans them.
+ *
+ *     bagQueryChunkIndex lists, in row major order, the chunks of type that
+ *     hold a value in [min_value, max_value], from the index alone; chunks
+ *     of unknown count are always listed.  nfound receives the number of
+ *     chunks found, of which the first max_chunks are stored in chunks.
+ *
+ * Return value:
+ *     On success, BAG_SUCCESS.  On failure, a code from BAG_ERRORS;
+ *     bagQueryChunkIndex returns BAG_HDF_DATASET_OPEN_FAILURE for a surface
+ *     that has no index.
+ */
+
+/* bag_stats.c */
+BAG_EXTERNAL bagError bagComputeLayerStats (bagHandle hnd, s32 type);
+BAG_EXTERNAL bagError bagReadLayerStats    (bagHandle hnd, s32 type, const char *field, bagLayerStats *stats);
+/* Description:
+ *     bagComputeLayerStats reads the layer type once and stores, as
+ *     attributes of its dataset, a bagLayerStats for each f32 field: the
+ *     elevation or uncertainty of the mandatory surfaces, the value of the
+ *     optional f32 surfaces, hyp_strength of the node groups, shoal_elevation
+ *     and stddev of the elevation solution group, and depth and depth_uncrt
+ *     of the VarRes refinements.  The histogram covers the values found,
+ *     its range widened by doubling as the pass goes.  Optional layers must
+ *     first be opened with bagGetOptDatasetInfo.
+ *
+ *     bagReadLayerStats returns the stored summary of one field, named as
+ *     above, or of the first field of the layer when field is NULL, without
+ *     reading the layer itself.
+ *
+ * Return value:
+ *     On success, BAG_SUCCESS.  On failure, a code from BAG_ERRORS;
+ *     bagReadLayerStats returns BAG_HDF_ATTRIBUTE_OPEN_FAILURE for a layer
+ *     that has not been summarized.
+ */
+
+/* bag_mmap.c */
+BAG_EXTERNAL bagError bagMapSurface   (bagHandle hnd, s32 type, const f32 **data, u32 *row_stride);
+BAG_EXTERNAL bagError bagUnmapSurface (bagHandle hnd, s32 type);
+/* Description:
+ *     For a BAG opened read-only whose f32 surface is stored uncompressed and
+ *     contiguously (compressionLevel 0), bagMapSurface maps the layer and
+ *     returns a zero-copy, read-only view of the whole grid, row major with
+ *     row_stride values per row.  The view stays valid until bagUnmapSurface
+ *     for that layer or bagFileClose.
+ *
+ * Return value:
+ *     On success, BAG_SUCCESS.  BAG_HDF_DATASET_NOT_MAPPABLE when the layer or
+ *     access mode does not allow mapping, in which case the caller should fall
+ *     back to bagReadRegionInto.  Otherwise a code from BAG_ERRORS.
+ */
+
+/* bag_prefetch.c */
+BAG_EXTERNAL bagError bagPrefetchOpen  (bagHandle hnd, const bagWindow *plan, u32 nwindows,
+                                        const s32 *types, u32 nlayers, u32 depth, bagPrefetcher *pf);
+BAG_EXTERNAL bagError bagPrefetchNext  (bagPrefetcher pf, bagPrefetchBuffer *buf, Bool *done);
+BAG_EXTERNAL bagError bagPrefetchClose (bagPrefetcher pf);
+/* Description:
+ *     Asynchronous streaming reader.  bagPrefetchOpen starts a background
+ *     thread reading the windows of plan (use one-row windows for row
+ *     streaming) for every layer in types, keeping up to depth windows ready
+ *     ahead of the caller.  bagPrefetchNext returns them in plan order; each
+ *     buffer stays valid until the next call to bagPrefetchNext or
+ *     bagPrefetchClose.  No other I/O may be done on the handle while a
+ *     reader is open; the caller may read through a view of it instead.
+ *
+ * Return value:
+ *     On success, BAG_SUCCESS.  On failure, a code from BAG_ERRORS; a read
+ *     error on the background thread is returned by the bagPrefetchNext call
+ *     that would have handed out the failed window.
+ */
+
+/* bag_tiles.c */
+BAG_EXTERNAL bagError bagTileIteratorOpen  (bagHandle hnd, bagTileIterator *iter);
+BAG_EXTERNAL bagError bagTileIteratorNext  (bagTileIterator iter, bagTile *tile, Bool *done);
+BAG_EXTERNAL bagError bagTileIteratorClose (bagTileIterator iter);
+/* Description:
+ *     Walk the Elevation and Uncertainty surfaces in tiles that match the HDF
+ *     chunks of the Elevation dataset, in the order the chunks are stored.
+ *     A full scan with this iterator decompresses every chunk exactly once,
+ *     whereas arbitrary bagReadRegion windows can inflate a chunk many times.
+ *     Contiguous (uncompressed) surfaces are walked in bands of whole rows.
+ *
+ * Arguments:
+ *     iter - allocated by bagTileIteratorOpen, released by bagTileIteratorClose
+ *     tile - row/col offsets, extents and data of the tile just read.  The data
+ *            pointers are owned by the iterator and only valid until the next call.
+ *     done - set to True, with no tile read, once every tile has been visited
+ *
+ * Return value:
+ *     On success, BAG_SUCCESS.  On failure, a code from BAG_ERRORS.
+ */
+
+/* bag_views.c */
+BAG_EXTERNAL bagError bagReaderViewOpen  (bagHandle parent, bagHandle *view);
+BAG_EXTERNAL bagError bagReaderViewClose (bagHandle view);
+/* Description:
+ *     Concurrent reading.  bagReaderViewOpen makes a cheap second handle onto
+ *     an open BAG that shares the parent's HDF file and datasets but has its
+ *     own dataspaces, memspace cache, read arrays and mappings.  Give every
+ *     reading thread its own view; the library serializes its HDF calls with
+ *     an internal lock, so views may be used from different threads at the
+ *     same time.  A view has no metadata and must be closed, with
+ *     bagReaderViewClose, before its parent is closed with bagFileClose.
+ *
+ * Return value:
+ *     On success, BAG_SUCCESS.  On failure, a code from BAG_ERRORS.
+ */
+
 /****************************************************************************************/
 BAG_EXTERNAL bagError bagWriteXMLStream (bagHandle bagHandle);
 /*! \brief bagWriteXMLStream stores the string at \a bagDef's metadata field into the Metadata dataset
@@ -770,6 +1227,19 @@ BAG_EXTERNAL bagError bagAllocArray (bagHandle hnd, u32 start_row, u32 start_col
 BAG_EXTERNAL bagError bagFreeArray (bagHandle hnd, s32 type);
 
 BAG_EXTERNAL bagError bagUpdateSurface (bagHandle hnd, u32 type);
+BAG_EXTERNAL bagError bagInvalidateSurfaceStats (bagHandle hnd, s32 type);
+/* Description:
+ *     The write calls keep a running min and max of the non-null values
+ *     written to Elevation and Uncertainty of a BAG made by bagFileCreate,
+ *     so bagUpdateSurface only has to store them.  Overwriting values only
+ *     ever widens that range: after overwriting nodes that may have held the
+ *     minimum or maximum, call bagInvalidateSurfaceStats, and the next
+ *     bagUpdateSurface rescans the surface.  A BAG opened with bagFileOpen
+ *     is always rescanned the first time.
+ *
+ * Return value:
+ *     On success, BAG_SUCCESS.  On failure, a code from BAG_ERRORS.
+ */
 BAG_EXTERNAL bagError bagUpdateOptSurface (bagHandle hnd, u32 type);
 BAG_EXTERNAL bagError bagReadMinMaxNodeGroup (bagHandle hnd,
                                         bagOptNodeGroup *minGroup, bagOptNodeGroup *maxGroup);
@@ -872,6 +1342,38 @@ BAG_EXTERNAL bagError bagReadVarResTracklingListSeries(bagHandle, u16 index, bag
 BAG_EXTERNAL bagError bagReadTrackingListIndex (bagHandle bagHandle, u16 index, bagTrackingItem *item);
 BAG_EXTERNAL bagError bagReadVarResTrackingListIndex(bagHandle bagHandle, u16 index, bagVarResTrackingItem *item);
 
+/* Routine:     bagReadTrackingListInto
+ * Purpose:     Read the tracking list items matching a query into an array
+ *              supplied by the caller; nothing is allocated.
+ * Inputs:      bagHandle    Handle for the Bag file
+ *              *query       kind and key of the items, see bagTrackingQuery
+ *              *arena       caller's array of capacity items
+ *              capacity     number of items arena holds
+ *              *length      set to the number of matching items
+ * Outputs:     bagError     Will be set if there is an error accessing the
+ *                           bagHandle or its tracking_list dataset
+ * Comment:     When length exceeds capacity, only the first capacity items
+ *              are stored; the caller may size the arena and call again.
+ */
+BAG_EXTERNAL bagError bagReadTrackingListInto (bagHandle bagHandle, const bagTrackingQuery *query, bagTrackingItem *arena, u32 capacity, u32 *length);
+BAG_EXTERNAL bagError bagReadVarResTrackingListInto (bagHandle bagHandle, const bagTrackingQuery *query, bagVarResTrackingItem *arena, u32 capacity, u32 *length);
+
+/* Routine:     bagScanTrackingList
+ * Purpose:     Stream the tracking list items matching a query to a callback,
+ *              a block at a time, in list order, without gathering them.
+ * Inputs:      bagHandle    Handle for the Bag file
+ *              *query       kind and key of the items, see bagTrackingQuery;
+ *                           BAG_TRACK_ALL streams the whole list
+ *              func         called with each block of matches; the items are
+ *                           valid only during the call
+ *              *user        passed to func
+ * Outputs:     bagError     Will be set if there is an error accessing the
+ *                           bagHandle or its tracking_list dataset, or to
+ *                           what func returned if it ended the scan
+ */
+BAG_EXTERNAL bagError bagScanTrackingList (bagHandle bagHandle, const bagTrackingQuery *query, bagTrackingItemFunc func, void *user);
+BAG_EXTERNAL bagError bagScanVarResTrackingList (bagHandle bagHandle, const bagTrackingQuery *query, bagVarResTrackingItemFunc func, void *user);
+
 /* Routine:     bagWriteTrackingListItem
  * Purpose:     Write a single bagTrackingItem into the tracking_list dataset.
  * Inputs:      bagHandle    Handle for the Bag file
@@ -883,6 +1385,37 @@ BAG_EXTERNAL bagError bagReadVarResTrackingListIndex(bagHandle bagHandle, u16 in
 BAG_EXTERNAL bagError bagWriteTrackingListItem(bagHandle bagHandle, bagTrackingItem *item);
 BAG_EXTERNAL bagError bagWriteVarResTrackingListItem(bagHandle bagHandle, bagVarResTrackingItem *item);
 
+/* Routine:     bagWriteTrackingListItems
+ * Purpose:     Append n bagTrackingItems to the tracking_list dataset with
+ *              one extend, one write and one update of its length.
+ * Inputs:      bagHandle    Handle for the Bag file
+ *              *items       array of n tracking list items
+ *              n            number of items
+ * Outputs:     bagError     Will be set if there is an error accessing the
+ *                           bagHandle, or if items is NULL
+ */
+BAG_EXTERNAL bagError bagWriteTrackingListItems(bagHandle bagHandle, const bagTrackingItem *items, u32 n);
+BAG_EXTERNAL bagError bagWriteVarResTrackingListItems(bagHandle bagHandle, const bagVarResTrackingItem *items, u32 n);
+
+/* Routine:     bagTrackingAppenderOpen
+ * Purpose:     Buffered append to a tracking list.  Items added are written
+ *              a batch at a time, see bagWriteTrackingListItems; Flush writes
+ *              what is buffered, Close flushes and releases the appender.
+ * Inputs:      bagHandle    Handle for the Bag file, opened for write
+ *              batch        items per batch, 0 for the default
+ *              *appender    set to the new appender
+ * Outputs:     bagError     Will be set if there is an error accessing the
+ *                           bagHandle or its tracking_list dataset
+ * Comment:     Buffered items are not in the list until flushed.  An appender
+ *              opened for one list takes only the items of that list.
+ */
+BAG_EXTERNAL bagError bagTrackingAppenderOpen (bagHandle bagHandle, u32 batch, bagTrackingAppender *appender);
+BAG_EXTERNAL bagError bagVarResTrackingAppenderOpen (bagHandle bagHandle, u32 batch, bagTrackingAppender *appender);
+BAG_EXTERNAL bagError bagTrackingAppenderAdd (bagTrackingAppender appender, const bagTrackingItem *item);
+BAG_EXTERNAL bagError bagVarResTrackingAppenderAdd (bagTrackingAppender appender, const bagVarResTrackingItem *item);
+BAG_EXTERNAL bagError bagTrackingAppenderFlush (bagTrackingAppender appender);
+BAG_EXTERNAL bagError bagTrackingAppenderClose (bagTrackingAppender appender);
+
 
 /****************************************************************************************
  * Routine:     bagSortTrackingList
@@ -924,6 +1457,53 @@ BAG_EXTERNAL bagError bagSortVarResTrackingListBySeries(bagHandle bagHandle);
 BAG_EXTERNAL bagError bagSortTrackingListByCode (bagHandle bagHandle);
 BAG_EXTERNAL bagError bagSortVarResTrackingListByCode(bagHandle bagHandle);
 
+/****************************************************************************************
+ * Routine:     bagSortTrackingListEx
+ * Purpose:     Sort the tracking list in place within a memory bound.  A list
+ *              larger than the bound is sorted in runs spilled to a new
+ *              temporary file, next to the Bag or else in the temporary
+ *              directory, then merged back into the list.  The sort is
+ *              stable.  The By* routines above call this with the defaults.
+ * Inputs:      bagHandle    Handle for the Bag file, opened for write
+ *              by           BAG_TRACK_BY_NODE, BAG_TRACK_BY_SERIES or
+ *                           BAG_TRACK_BY_CODE; BAG_TRACK_BY_SUBNODE too for
+ *                           the variable resolution list
+ *              max_bytes    memory the sort may use, 0 for 64 MiB; it bounds
+ *                           the rebuild of the list's index, if it has one,
+ *                           as well
+ *              progress     called as the sort advances, or NULL
+ *              *user        passed to progress
+ * Outputs:     bagError     Will be set if there is an error accessing the
+ *                           bagHandle or its tracking_list dataset;
+ *                           BAG_HDF_SORT_NEEDS_RECOVERY if the list was only
+ *                           partly written back.  Its items are then kept in
+ *                           the temporary file, and the next sort of the list
+ *                           copies them back before sorting.
+ *
+ ****************************************************************************************/
+BAG_EXTERNAL bagError bagSortTrackingListEx (bagHandle bagHandle, u8 by, u32 max_bytes, bagSortProgressFunc progress, void *user);
+BAG_EXTERNAL bagError bagSortVarResTrackingListEx (bagHandle bagHandle, u8 by, u32 max_bytes, bagSortProgressFunc progress, void *user);
+
+/****************************************************************************************
+ * Routine:     bagBuildTrackingListIndex
+ * Purpose:     Index the tracking list by node, code and series so that
+ *              bagReadTrackingListNode, ...Code and ...Series read only the
+ *              matching items.  The variable resolution list is also indexed
+ *              by sub-node.
+ * Inputs:      bagHandle    Handle for the Bag file, opened for write
+ * Outputs:     bagError     Will be set if there is an error accessing the
+ *                           bagHandle or its tracking_list dataset
+ * Comment:     The index is stored in the file next to the list.  Items
+ *              written after it was built are still found, by a scan of
+ *              those items only; the sort routines rebuild an existing index.
+ *              The build uses at most 64 MiB, about 40 bytes per item; the
+ *              index of a longer list is sorted through a temporary file,
+ *              as bagSortTrackingListEx sorts a list.
+ *
+ ****************************************************************************************/
+BAG_EXTERNAL bagError bagBuildTrackingListIndex (bagHandle bagHandle);
+BAG_EXTERNAL bagError bagBuildVarResTrackingListIndex(bagHandle bagHandle);
+
 /* Description:
  *     This function provides a short text description for the last error that 
  *     occurred on the BAG specified by bagHandle. Memory for the text string 
@@ -0,0 +1,740 @@
+/*! \file bag_chunk_index.c
+ * \brief This module contains the per-chunk index of the mandatory surfaces.
+ ********************************************************************
+ *
+ * Module Name : bag_chunk_index.c
+ *
+ * Author/Date : ONSWG, October 2026
+ *
+ * Description :
+ *               The chunk index of Elevation or Uncertainty keeps, for every
+ *               HDF chunk of the surface (every band of rows when the surface
+ *               is contiguous), the number of non-null nodes and their range.
+ *               It is stored next to the surface as a small 2D dataset of
+ *               bagChunkStats, one per chunk, and held in memory while the
+ *               BAG is open.
+ *
+ *               Region reads fill chunks known to be empty with the null
+ *               value instead of reading them, the min/max rescan of
+ *               bagUpdateMinMax is answered from the index alone, and
+ *               bagQueryChunkIndex finds the chunks holding values in a range
+ *               without touching the surface.
+ *
+ *               A write makes the chunks of the rows it touches unknown,
+ *               which are never skipped, and marks the stored index invalid;
+ *               bagUpdateSurface recomputes the unknown chunks and stores the
+ *               index again.
+ *
+ *               The stored index carries a stamp of the storage of its surface
+ *               as it was indexed: the storage size, and the address and size
+ *               of every chunk it holds empty.  Software that writes the
+ *               surface without knowing of the index changes the stamp, and
+ *               the index is then ignored at open.  An empty chunk whose
+ *               rewriting would not show in the stamp, one already written in
+ *               an unfiltered surface, is opened unknown rather than trusted.
+ *
+ * Restrictions/Limitations :
+ *               An index stored invalid, by a writer that did not call
+ *               bagUpdateSurface before closing, or whose stamp does not
+ *               match, is ignored at open until bagBuildChunkIndex is called.
+ *               The ranges of chunks holding values are not checked: after
+ *               an unfiltered surface is rewritten in place by other
+ *               software, bagBuildChunkIndex must be called for them to be
+ *               right.  Reader views do not use the index.
+ *
+ * Change Descriptions :
+ * who  when      what
+ * ---  ----      ----
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ ********************************************************************/
+
+#include "bag_private.h"
+#include "crc32.h"
+
+#define CHUNK_INDEX_TILE_ROWS_NAME  "tile_rows"
+#define CHUNK_INDEX_TILE_COLS_NAME  "tile_cols"
+#define CHUNK_INDEX_VALID_NAME      "valid"
+#define CHUNK_INDEX_STAMP_NAME      "storage_stamp"
+
+/*! \brief bagChunkIndexPath gives the path of the index of \a type */
+static const char *bagChunkIndexPath (s32 type)
+{
+    return (type == Uncertainty) ? UNCERTAINTY_CHUNK_INDEX_PATH : ELEVATION_CHUNK_INDEX_PATH;
+}
+
+/*! \brief bagChunkIndexNull gives the null value of \a type */
+static f32 bagChunkIndexNull (s32 type)
+{
+    return (type == Uncertainty) ? BAG_NULL_UNCERTAINTY : BAG_NULL_ELEVATION;
+}
+
+/*! \brief bagChunkIndexType builds the HDF compound type of a bagChunkStats */
+static hid_t bagChunkIndexType (void)
+{
+    hid_t datatype_id;
+
+    if ((datatype_id = H5Tcreate (H5T_COMPOUND, sizeof (bagChunkStats))) < 0)
+        return -1;
+    if (H5Tinsert (datatype_id, "min", HOFFSET (bagChunkStats, min), H5T_NATIVE_FLOAT) < 0 ||
+        H5Tinsert (datatype_id, "max", HOFFSET (bagChunkStats, max), H5T_NATIVE_FLOAT) < 0 ||
+        H5Tinsert (datatype_id, "count", HOFFSET (bagChunkStats, count), H5T_NATIVE_UINT) < 0)
+    {
+        H5Tclose (datatype_id);
+        return -1;
+    }
+    return datatype_id;
+}
+
+/*! \brief bagChunkIndexSetValid stores whether the index on disk matches the surface */
+static bagError bagChunkIndexSetValid (bagHandle hnd, s32 type, u32 valid)
+{
+    hid_t    dataset_id;
+    bagError err;
+
+    if ((dataset_id = H5Dopen (hnd->file_id, bagChunkIndexPath (type))) < 0)
+        return BAG_HDF_DATASET_OPEN_FAILURE;
+    err = bagWriteAttribute (hnd, dataset_id, (u8 *) CHUNK_INDEX_VALID_NAME, &valid);
+    H5Dclose (dataset_id);
+
+    return err;
+}
+
+/****************************************************************************************/
+/*! \brief bagChunkIndexStamp digests the storage of the surface \a type as \a idx sees it
+ *
+ *  The storage size of the surface, then the address and size of each chunk the index
+ *  holds empty, unallocated chunks included.  With \a settle, the empty chunks whose
+ *  rewriting would change neither, chunks already written to an unfiltered surface, are
+ *  made unknown once they are digested.
+ *
+ ****************************************************************************************/
+static bagError bagChunkIndexStamp (bagHandle hnd, s32 type, bagChunkIndex *idx, Bool settle, u32 *stamp)
+{
+    hid_t     dataset_id, datatype_id, filespace_id, plist_id;
+    hsize_t   storage, offset[RANK], size;
+    haddr_t   addr;
+    unsigned  filter_mask;
+    bagError  err;
+    u32       srow, scol, tr, tc, n = 0;
+    hsize_t  *digest;
+    Bool      chunked, filtered;
+    size_t    i, ntiles = (size_t) idx->nrows * idx->ncols;
+
+    if ((err = bagGetSurfaceIds (hnd, type, &dataset_id, &datatype_id, &filespace_id, &srow, &scol)) != BAG_SUCCESS)
+        return err;
+    if ((plist_id = H5Dget_create_plist (dataset_id)) < 0)
+        return BAG_HDF_INTERNAL_ERROR;
+    chunked  = (H5Pget_layout (plist_id) == H5D_CHUNKED) ? True : False;
+    filtered = (H5Pget_nfilters (plist_id) > 0) ? True : False;
+    H5Pclose (plist_id);
+
+    if ((digest = malloc ((2 * ntiles + 1) * sizeof (hsize_t))) == NULL)
+        return BAG_MEMORY_ALLOCATION_FAILED;
+    storage = H5Dget_storage_size (dataset_id);
+    digest[n++] = storage;
+
+    for (tr = 0, i = 0; tr < idx->nrows; tr++)
+    {
+        for (tc = 0; tc < idx->ncols; tc++, i++)
+        {
+            if (idx->tiles[i].count != 0)
+                continue;
+
+            /*! a contiguous surface is allocated whole, at its first write */
+            addr = (storage > 0) ? 0 : HADDR_UNDEF;
+            size = 0;
+#if H5_VERSION_GE(1,10,5)
+            if (chunked)
+            {
+                offset[0] = (hsize_t) tr * idx->tile_rows;
+                offset[1] = (hsize_t) tc * idx->tile_cols;
+                if (H5Dget_chunk_info_by_coord (dataset_id, offset, &filter_mask, &addr, &size) < 0)
+                {
+                    free (digest);
+                    return BAG_HDF_INTERNAL_ERROR;
+                }
+            }
+#endif
+            digest[n++] = (hsize_t) addr;
+            digest[n++] = size;
+
+            if (settle && addr != HADDR_UNDEF && !filtered)
+            {
+                idx->tiles[i].count = BAG_CHUNK_COUNT_UNKNOWN;
+                idx->stale = True;
+            }
+        }
+    }
+
+    *stamp = crc32_calc_buffer ((const char *) digest, (u32) (n * sizeof (hsize_t)));
+    free (digest);
+    return BAG_SUCCESS;
+}
+
+/*! \brief bagChunkIndexStore writes the whole in-memory index of \a type and marks it valid */
+static bagError bagChunkIndexStore (bagHandle hnd, s32 type)
+{
+    bagChunkIndex *idx = hnd->chunk_index[type];
+    hid_t          dataset_id, datatype_id, dataspace_id;
+    hsize_t        dims[RANK], cur[RANK];
+    herr_t         status;
+    bagError       err;
+    u32            valid = 1, stamp;
+
+    /*! the stamp is of the storage as the file holds it, once the cached chunks are written */
+    if (H5Fflush (hnd->file_id, H5F_SCOPE_LOCAL) < 0)
+        return BAG_HDF_INTERNAL_ERROR;
+    if ((err = bagChunkIndexStamp (hnd, type, idx, False, &stamp)) != BAG_SUCCESS)
+        return err;
+
+    dims[0] = idx->nrows;
+    dims[1] = idx->ncols;
+
+    if ((datatype_id = bagChunkIndexType ()) < 0)
+        return BAG_HDF_TYPE_NOT_FOUND;
+
+    /*! an index of another shape, from other chunks, is replaced */
+    dataset_id = -1;
+    if (H5Lexists (hnd->file_id, bagChunkIndexPath (type), H5P_DEFAULT) > 0)
+    {
+        dataset_id = H5Dopen (hnd->file_id, bagChunkIndexPath (type));
+        if (dataset_id >= 0)
+        {
+            dataspace_id = H5Dget_space (dataset_id);
+            H5Sget_simple_extent_dims (dataspace_id, cur, NULL);
+            H5Sclose (dataspace_id);
+            if (cur[0] != dims[0] || cur[1] != dims[1])
+            {
+                H5Dclose (dataset_id);
+                dataset_id = -1;
+                H5Ldelete (hnd->file_id, bagChunkIndexPath (type), H5P_DEFAULT);
+            }
+        }
+    }
+
+    if (dataset_id < 0)
+    {
+        if ((dataspace_id = H5Screate_simple (RANK, dims, NULL)) < 0)
+        {
+            H5Tclose (datatype_id);
+            return BAG_HDF_CREATE_DATASPACE_FAILURE;
+        }
+        dataset_id = H5Dcreate (hnd->file_id, bagChunkIndexPath (type), datatype_id, dataspace_id, H5P_DEFAULT);
+        H5Sclose (dataspace_id);
+        if (dataset_id < 0)
+        {
+            H5Tclose (datatype_id);
+            return BAG_HDF_CREATE_DATASET_FAILURE;
+        }
+        if ((err = bagCreateAttribute (hnd, dataset_id, (u8 *) CHUNK_INDEX_TILE_ROWS_NAME, 0, BAG_ATTR_U32)) != BAG_SUCCESS ||
+            (err = bagCreateAttribute (hnd, dataset_id, (u8 *) CHUNK_INDEX_TILE_COLS_NAME, 0, BAG_ATTR_U32)) != BAG_SUCCESS ||
+            (err = bagCreateAttribute (hnd, dataset_id, (u8 *) CHUNK_INDEX_VALID_NAME, 0, BAG_ATTR_U32)) != BAG_SUCCESS)
+        {
+            H5Dclose (dataset_id);
+            H5Tclose (datatype_id);
+            return err;
+        }
+    }
+
+    status = H5Dwrite (dataset_id, datatype_id, H5S_ALL, H5S_ALL, H5P_DEFAULT, idx->tiles);
+    H5Tclose (datatype_id);
+    if (status < 0)
+    {
+        H5Dclose (dataset_id);
+        return BAG_HDF_INTERNAL_ERROR;
+    }
+
+    /*! an index stored before stamps were kept gets one */
+    err = BAG_SUCCESS;
+    if (H5Aexists (dataset_id, CHUNK_INDEX_STAMP_NAME) <= 0)
+        err = bagCreateAttribute (hnd, dataset_id, (u8 *) CHUNK_INDEX_STAMP_NAME, 0, BAG_ATTR_U32);
+
+    if (err == BAG_SUCCESS &&
+        (err = bagWriteAttribute (hnd, dataset_id, (u8 *) CHUNK_INDEX_TILE_ROWS_NAME, &idx->tile_rows)) == BAG_SUCCESS &&
+        (err = bagWriteAttribute (hnd, dataset_id, (u8 *) CHUNK_INDEX_TILE_COLS_NAME, &idx->tile_cols)) == BAG_SUCCESS &&
+        (err = bagWriteAttribute (hnd, dataset_id, (u8 *) CHUNK_INDEX_STAMP_NAME, &stamp)) == BAG_SUCCESS)
+        err = bagWriteAttribute (hnd, dataset_id, (u8 *) CHUNK_INDEX_VALID_NAME, &valid);
+    H5Dclose (dataset_id);
+
+    if (err == BAG_SUCCESS)
+    {
+        idx->stale  = False;
+        idx->stored = True;
+    }
+    return err;
+}
+
+/*! \brief bagChunkIndexAlloc makes an in-memory index of \a type with every chunk unknown */
+static bagError bagChunkIndexAlloc (bagHandle hnd, s32 type, bagChunkIndex **index)
+{
+    bagChunkIndex *idx;
+    hsize_t        tile[RANK];
+    bagError       err;
+    size_t         i, n;
+
+    if ((err = bagGetSurfaceChunkDims (hnd, type, tile, NULL)) != BAG_SUCCESS)
+        return err;
+
+    if ((idx = calloc (1, sizeof (bagChunkIndex))) == NULL)
+        return BAG_MEMORY_ALLOCATION_FAILED;
+    idx->tile_rows = (u32) tile[0];
+    idx->tile_cols = (u32) tile[1];
+    idx->nrows     = (hnd->bag.def.nrows + idx->tile_rows - 1) / idx->tile_rows;
+    idx->ncols     = (hnd->bag.def.ncols + idx->tile_cols - 1) / idx->tile_cols;
+
+    n = (size_t) idx->nrows * idx->ncols;
+    if ((idx->tiles = malloc (n * sizeof (bagChunkStats))) == NULL)
+    {
+        free (idx);
+        return BAG_MEMORY_ALLOCATION_FAILED;
+    }
+    for (i = 0; i < n; i++)
+    {
+        idx->tiles[i].min   = idx->tiles[i].max = bagChunkIndexNull (type);
+        idx->tiles[i].count = BAG_CHUNK_COUNT_UNKNOWN;
+    }
+    idx->stale = True;
+
+    *index = idx;
+    return BAG_SUCCESS;
+}
+
+/*! \brief bagChunkIndexScanRow recomputes the chunks of one row of chunks from the surface */
+static bagError bagChunkIndexScanRow (bagHandle hnd, s32 type, u32 tr, f32 *band, bagReduction *red)
+{
+    bagChunkIndex *idx = hnd->chunk_index[type];
+    bagChunkStats *ts;
+    bagError       err;
+    u32            r, tc, r0, r1, c0, ncols = hnd->bag.def.ncols;
+    f32            null_val = bagChunkIndexNull (type);
+
+    r0 = tr * idx->tile_rows;
+    r1 = (r0 + idx->tile_rows - 1 < hnd->bag.def.nrows) ? r0 + idx->tile_rows - 1 : hnd->bag.def.nrows - 1;
+
+    /*! chunks still known to be empty are filled with nulls rather than read */
+    if ((err = bagAlignRegionBuffer (hnd, r0, 0, r1, ncols - 1, type, READ_BAG, band, ncols, H5P_DEFAULT)) != BAG_SUCCESS)
+        return err;
+
+    for (tc = 0; tc < idx->ncols; tc++)
+        bagReduceInit (&red[tc]);
+    for (r = 0; r <= r1 - r0; r++)
+    {
+        for (tc = 0, c0 = 0; tc < idx->ncols; tc++, c0 += idx->tile_cols)
+            bagReduceF32 (&red[tc], band + (size_t) r * ncols + c0,
+                          (c0 + idx->tile_cols <= ncols) ? idx->tile_cols : ncols - c0, 1, null_val);
+    }
+
+    for (tc = 0; tc < idx->ncols; tc++)
+    {
+        ts = &idx->tiles[(size_t) tr * idx->ncols + tc];
+        ts->count = (u32) red[tc].count;
+        ts->min   = (red[tc].count > 0) ? red[tc].min : null_val;
+        ts->max   = (red[tc].count > 0) ? red[tc].max : null_val;
+    }
+
+    return BAG_SUCCESS;
+}
+
+/*! \brief bagChunkIndexScan recomputes every row of chunks holding an unknown chunk */
+static bagError bagChunkIndexScan (bagHandle hnd, s32 type)
+{
+    bagChunkIndex *idx = hnd->chunk_index[type];
+    bagReduction  *red;
+    bagError       err = BAG_SUCCESS;
+    f32           *band;
+    u32            tr, tc;
+
+    band = malloc ((size_t) idx->tile_rows * hnd->bag.def.ncols * sizeof (f32));
+    red  = malloc ((size_t) idx->ncols * sizeof (bagReduction));
+    if (band == NULL || red == NULL)
+    {
+        free (band);
+        free (red);
+        return BAG_MEMORY_ALLOCATION_FAILED;
+    }
+
+    for (tr = 0; tr < idx->nrows && err == BAG_SUCCESS; tr++)
+    {
+        for (tc = 0; tc < idx->ncols; tc++)
+            if (idx->tiles[(size_t) tr * idx->ncols + tc].count == BAG_CHUNK_COUNT_UNKNOWN)
+                break;
+        if (tc < idx->ncols)
+            err = bagChunkIndexScanRow (hnd, type, tr, band, red);
+    }
+
+    free (band);
+    free (red);
+    return err;
+}
+
+/****************************************************************************************/
+/*! \brief  bagFreeChunkIndex releases the in-memory indexes of \a hnd
+ ****************************************************************************************/
+void bagFreeChunkIndex (bagHandle hnd)
+{
+    s32 type;
+
+    for (type = Elevation; type <= Uncertainty; type++)
+    {
+        if (hnd->chunk_index[type] != NULL)
+        {
+            free (hnd->chunk_index[type]->tiles);
+            free (hnd->chunk_index[type]);
+            hnd->chunk_index[type] = NULL;
+        }
+    }
+}
+
+/****************************************************************************************/
+/*! \brief  bagOpenChunkIndex loads the stored indexes that are valid and match their stamps;
+ *          called by \a bagFileOpen
+ ****************************************************************************************/
+bagError bagOpenChunkIndex (bagHandle hnd)
+{
+    bagChunkIndex *idx;
+    hid_t          dataset_id, datatype_id;
+    u32            tile_rows = 0, tile_cols = 0, valid = 0, stamp = 0, now;
+    s32            type;
+    herr_t         status;
+
+    for (type = Elevation; type <= Uncertainty; type++)
+    {
+        hnd->chunk_index[type] = NULL;
+        if (H5Lexists (hnd->file_id, bagChunkIndexPath (type), H5P_DEFAULT) <= 0)
+            continue;
+        if ((dataset_id = H5Dopen (hnd->file_id, bagChunkIndexPath (type))) < 0)
+            continue;
+
+        if (bagReadAttribute (hnd, dataset_id, (u8 *) CHUNK_INDEX_VALID_NAME, &valid) != BAG_SUCCESS ||
+            bagReadAttribute (hnd, dataset_id, (u8 *) CHUNK_INDEX_TILE_ROWS_NAME, &tile_rows) != BAG_SUCCESS ||
+            bagReadAttribute (hnd, dataset_id, (u8 *) CHUNK_INDEX_TILE_COLS_NAME, &tile_cols) != BAG_SUCCESS ||
+            H5Aexists (dataset_id, CHUNK_INDEX_STAMP_NAME) <= 0 ||
+            bagReadAttribute (hnd, dataset_id, (u8 *) CHUNK_INDEX_STAMP_NAME, &stamp) != BAG_SUCCESS ||
+            !valid || bagChunkIndexAlloc (hnd, type, &idx) != BAG_SUCCESS)
+        {
+            H5Dclose (dataset_id);
+            continue;
+        }
+
+        /*! an index made for other chunks than the surface has now cannot be used */
+        status = -1;
+        if (idx->tile_rows == tile_rows && idx->tile_cols == tile_cols && (datatype_id = bagChunkIndexType ()) >= 0)
+        {
+            status = H5Dread (dataset_id, datatype_id, H5S_ALL, H5S_ALL, H5P_DEFAULT, idx->tiles);
+            H5Tclose (datatype_id);
+        }
+        H5Dclose (dataset_id);
+
+        /*! a surface written since by software that does not keep the index no longer matches its stamp */
+        idx->stale = False;
+        if (status < 0 || bagChunkIndexStamp (hnd, type, idx, True, &now) != BAG_SUCCESS || now != stamp)
+        {
+            free (idx->tiles);
+            free (idx);
+            continue;
+        }
+        idx->stored = True;
+        hnd->chunk_index[type] = idx;
+    }
+
+    return BAG_SUCCESS;
+}
+
+/****************************************************************************************/
+/*! \brief  bagCreateChunkIndex makes the indexes of a new BAG, whose chunks are all empty
+ *
+ *  Called with the HDF lock held by \a bagFileCreate.
+ *
+ ****************************************************************************************/
+bagError bagCreateChunkIndex (bagHandle hnd)
+{
+    bagChunkIndex *idx;
+    bagError       err;
+    size_t         i;
+    s32            type;
+
+    for (type = Elevation; type <= Uncertainty; type++)
+    {
+        if ((err = bagChunkIndexAlloc (hnd, type, &idx)) != BAG_SUCCESS)
+            return err;
+        for (i = 0; i < (size_t) idx->nrows * idx->ncols; i++)
+            idx->tiles[i].count = 0;
+        hnd->chunk_index[type] = idx;
+        if ((err = bagChunkIndexStore (hnd, type)) != BAG_SUCCESS)
+            return err;
+    }
+
+    return BAG_SUCCESS;
+}
+
+/****************************************************************************************/
+/*! \brief  bagMarkChunkIndex makes the chunks over base rows [first_row, last_row] unknown
+ *
+ *  The stored index is marked invalid the first time, so that it is not trusted should
+ *  the BAG be closed before \a bagUpdateSurface.  Called with the HDF lock held.
+ *
+ ****************************************************************************************/
+void bagMarkChunkIndex (bagHandle hnd, s32 type, u32 first_row, u32 last_row)
+{
+    bagChunkIndex *idx;
+    u32            tr, tc;
+
+    if ((type != Elevation && type != Uncertainty) || (idx = hnd->chunk_index[type]) == NULL)
+        return;
+
+    if (idx->stored)
+    {
+        bagChunkIndexSetValid (hnd, type, 0);
+        idx->stored = False;
+    }
+    idx->stale = True;
+    for (tr = first_row / idx->tile_rows; tr <= last_row / idx->tile_rows && tr < idx->nrows; tr++)
+        for (tc = 0; tc < idx->ncols; tc++)
+            idx->tiles[(size_t) tr * idx->ncols + tc].count = BAG_CHUNK_COUNT_UNKNOWN;
+}
+
+/****************************************************************************************/
+/*! \brief  bagRefreshChunkIndex recomputes the unknown chunks and stores the index again
+ *
+ *  Called with the HDF lock held, by \a bagUpdateSurface.
+ *
+ ****************************************************************************************/
+bagError bagRefreshChunkIndex (bagHandle hnd, s32 type)
+{
+    bagError err;
+
+    if ((type != Elevation && type != Uncertainty) || hnd->chunk_index[type] == NULL || !hnd->chunk_index[type]->stale)
+        return BAG_SUCCESS;
+
+    if ((err = bagChunkIndexScan (hnd, type)) != BAG_SUCCESS)
+        return err;
+    return bagChunkIndexStore (hnd, type);
+}
+
+/****************************************************************************************/
+/*! \brief  bagChunkIndexRange gives the range of a surface from its index alone
+ *
+ *  \return True when the index is complete, with \a min and \a max set, or left at the
+ *          null value for a surface holding only nulls; False when the surface must be
+ *          read.
+ *
+ ****************************************************************************************/
+Bool bagChunkIndexRange (bagHandle hnd, s32 type, f32 *min, f32 *max)
+{
+    bagChunkIndex *idx;
+    bagChunkStats *ts;
+    size_t         i;
+    Bool           any = False;
+
+    if ((type != Elevation && type != Uncertainty) || (idx = hnd->chunk_index[type]) == NULL || idx->stale)
+        return False;
+
+    *min = *max = bagChunkIndexNull (type);
+    for (i = 0; i < (size_t) idx->nrows * idx->ncols; i++)
+    {
+        ts = &idx->tiles[i];
+        if (ts->count == 0)
+            continue;
+        if (!any || ts->min < *min)
+            *min = ts->min;
+        if (!any || ts->max > *max)
+            *max = ts->max;
+        any = True;
+    }
+    return True;
+}
+
+/****************************************************************************************/
+/*! \brief  bagReadSparseRegion reads a region of a surface, skipping chunks known to be empty
+ *
+ *  When the region meets no empty chunk, nothing is done and \a *done is False; the
+ *  caller reads the region itself.  Otherwise the empty chunks are filled with the null
+ *  value, each run of other chunks along a row of chunks is read in one piece, and
+ *  \a *done is True.  Called with the HDF lock held.
+ *
+ ****************************************************************************************/
+bagError bagReadSparseRegion (bagHandle hnd, s32 type, u32 start_row, u32 start_col, u32 end_row, u32 end_col,
+                              f32 *data, u32 row_stride, Bool *done)
+{
+    bagChunkIndex *idx;
+    bagError       err;
+    u32            tr, tc, tc0, r, c, r0, r1, c0, c1, empties = 0;
+    f32            null_val = bagChunkIndexNull (type), *row;
+
+    *done = False;
+    if ((type != Elevation && type != Uncertainty) || (idx = hnd->chunk_index[type]) == NULL)
+        return BAG_SUCCESS;
+
+    for (tr = start_row / idx->tile_rows; tr <= end_row / idx->tile_rows; tr++)
+        for (tc = start_col / idx->tile_cols; tc <= end_col / idx->tile_cols; tc++)
+            if (idx->tiles[(size_t) tr * idx->ncols + tc].count == 0)
+                empties++;
+    if (empties == 0)
+        return BAG_SUCCESS;
+
+    for (tr = start_row / idx->tile_rows; tr <= end_row / idx->tile_rows; tr++)
+    {
+        r0 = (tr * idx->tile_rows > start_row) ? tr * idx->tile_rows : start_row;
+        r1 = ((tr + 1) * idx->tile_rows - 1 < end_row) ? (tr + 1) * idx->tile_rows - 1 : end_row;
+
+        for (tc = start_col / idx->tile_cols; tc <= end_col / idx->tile_cols; tc = tc0)
+        {
+            Bool empty = (idx->tiles[(size_t) tr * idx->ncols + tc].count == 0) ? True : False;
+
+            /*! gather the run of chunks that are alike */
+            for (tc0 = tc + 1; tc0 <= end_col / idx->tile_cols; tc0++)
+                if ((idx->tiles[(size_t) tr * idx->ncols + tc0].count == 0) != empty)
+                    break;
+
+            c0 = (tc * idx->tile_cols > start_col) ? tc * idx->tile_cols : start_col;
+            c1 = (tc0 * idx->tile_cols - 1 < end_col) ? tc0 * idx->tile_cols - 1 : end_col;
+
+            if (empty)
+            {
+                for (r = r0; r <= r1; r++)
+                {
+                    row = data + (size_t) (r - start_row) * row_stride + (c0 - start_col);
+                    for (c = 0; c <= c1 - c0; c++)
+                        row[c] = null_val;
+                }
+            }
+            else if ((err = bagAlignRegionBuffer (hnd, r0, c0, r1, c1, type, READ_BAG,
+                                                  data + (size_t) (r0 - start_row) * row_stride + (c0 - start_col),
+                                                  row_stride, H5P_DEFAULT)) != BAG_SUCCESS)
+                return err;
+        }
+    }
+
+    *done = True;
+    return BAG_SUCCESS;
+}
+
+static bagError bagBuildChunkIndexUnlocked (bagHandle hnd)
+{
+    bagChunkIndex *idx;
+    bagError       err;
+    s32            type;
+
+    for (type = Elevation; type <= Uncertainty; type++)
+    {
+        if (hnd->chunk_index[type] != NULL)
+        {
+            free (hnd->chunk_index[type]->tiles);
+            free (hnd->chunk_index[type]);
+            hnd->chunk_index[type] = NULL;
+        }
+        if ((err = bagChunkIndexAlloc (hnd, type, &idx)) != BAG_SUCCESS)
+            return err;
+        hnd->chunk_index[type] = idx;
+        if ((err = bagChunkIndexScan (hnd, type)) != BAG_SUCCESS ||
+            (err = bagChunkIndexStore (hnd, type)) != BAG_SUCCESS)
+            return err;
+    }
+
+    return BAG_SUCCESS;
+}
+
+/****************************************************************************************/
+/*! \brief bagBuildChunkIndex indexes every chunk of Elevation and Uncertainty
+ *
+ *  \param  hnd    External reference to the private \a bagHandle object, opened for write
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ****************************************************************************************/
+bagError bagBuildChunkIndex (bagHandle hnd)
+{
+    bagError err;
+
+    if (hnd == NULL)
+        return BAG_INVALID_BAG_HANDLE;
+
+    bagLockHDF ();
+    err = bagBuildChunkIndexUnlocked (hnd);
+    bagUnlockHDF ();
+
+    return err;
+}
+
+static bagError bagQueryChunkIndexUnlocked (bagHandle hnd, s32 type, f32 min_value, f32 max_value,
+                                            bagChunkInfo *chunks, u32 max_chunks, u32 *nfound)
+{
+    bagChunkIndex *idx;
+    bagChunkStats *ts;
+    bagChunkInfo  *ci;
+    u32            tr, tc, n = 0;
+
+    if (type != Elevation && type != Uncertainty)
+        return BAG_HDF_TYPE_NOT_FOUND;
+    if (nfound == NULL || (chunks == NULL && max_chunks > 0))
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+    if ((idx = hnd->chunk_index[type]) == NULL)
+        return BAG_HDF_DATASET_OPEN_FAILURE;
+
+    for (tr = 0; tr < idx->nrows; tr++)
+    {
+        for (tc = 0; tc < idx->ncols; tc++)
+        {
+            ts = &idx->tiles[(size_t) tr * idx->ncols + tc];
+
+            /*! unknown chunks may hold anything, so they are always reported */
+            if (ts->count == 0)
+                continue;
+            if (ts->count != BAG_CHUNK_COUNT_UNKNOWN && (ts->max < min_value || ts->min > max_value))
+                continue;
+
+            if (n < max_chunks)
+            {
+                ci = &chunks[n];
+                ci->start_row = tr * idx->tile_rows;
+                ci->start_col = tc * idx->tile_cols;
+                ci->end_row   = (ci->start_row + idx->tile_rows - 1 < hnd->bag.def.nrows) ? ci->start_row + idx->tile_rows - 1 : hnd->bag.def.nrows - 1;
+                ci->end_col   = (ci->start_col + idx->tile_cols - 1 < hnd->bag.def.ncols) ? ci->start_col + idx->tile_cols - 1 : hnd->bag.def.ncols - 1;
+                ci->min       = ts->min;
+                ci->max       = ts->max;
+                ci->count     = ts->count;
+            }
+            n++;
+        }
+    }
+
+    *nfound = n;
+    return BAG_SUCCESS;
+}
+
+/****************************************************************************************/
+/*! \brief bagQueryChunkIndex finds the chunks of a surface holding values in a range
+ *
+ *  \param  hnd         External reference to the private \a bagHandle object
+ *  \param  type        Elevation or Uncertainty
+ *  \param  min_value   Low end of the range
+ *  \param  max_value   High end of the range
+ *  \param *chunks      Receives the first \a max_chunks chunks found, may be NULL when
+ *                      \a max_chunks is 0
+ *  \param  max_chunks  Room in \a chunks
+ *  \param *nfound      Receives the number of chunks found, which may exceed \a max_chunks
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS;
+ *                \a BAG_HDF_DATASET_OPEN_FAILURE when the surface has no index.
+ *
+ ****************************************************************************************/
+bagError bagQueryChunkIndex (bagHandle hnd, s32 type, f32 min_value, f32 max_value,
+                             bagChunkInfo *chunks, u32 max_chunks, u32 *nfound)
+{
+    bagError err;
+
+    if (hnd == NULL)
+        return BAG_INVALID_BAG_HANDLE;
+
+    bagLockHDF ();
+    err = bagQueryChunkIndexUnlocked (hnd, type, min_value, max_value, chunks, max_chunks, nfound);
+    bagUnlockHDF ();
+
+    return err;
+}
@@ -0,0 +1,130 @@
+/*! \file bag_chunk_plan.c
+ * \brief This module contains the choice of HDF chunk shapes for the BAG datasets.
+ ********************************************************************
+ *
+ * Module Name : bag_chunk_plan.c
+ *
+ * Author/Date : ONSWG, October 2026
+ *
+ * Description :
+ *               Every chunked dataset of a BAG gets its chunk shape from
+ *               bagPlanChunks: the dataset extents, the size of one value,
+ *               the way the data will mostly be accessed and a target
+ *               number of bytes per chunk.  Square tiles suit windowed
+ *               reads, full width bands suit row sweeps, and small tiles
+ *               keep random node access from inflating large chunks.
+ *
+ * Restrictions/Limitations :
+ *               The target is a guide; chunks are trimmed to the dataset
+ *               extents and are never smaller than one value.
+ *
+ * Change Descriptions :
+ * who  when      what
+ * ---  ----      ----
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ ********************************************************************/
+
+#include <math.h>
+
+#include "bag_private.h"
+
+/*! \brief bagClampExtent trims a chunk extent to [1, dim], dim 0 meaning unbounded */
+static hsize_t bagClampExtent (hsize_t extent, hsize_t dim)
+{
+    if (dim > 0 && extent > dim)
+        extent = dim;
+    return (extent < 1) ? 1 : extent;
+}
+
+/****************************************************************************************/
+/*! \brief bagPlanChunks chooses the chunk shape of a dataset
+ *
+ *  \param  rank          1 or \a RANK
+ *  \param *dims          Extents of the dataset; 0 for an extent that will grow, as with
+ *                        the tracking lists
+ *  \param  elem_size     Bytes of one value of the dataset
+ *  \param  hint          Expected access pattern, element of \a BAG_ACCESS_HINTS
+ *  \param  target_bytes  Desired bytes per chunk; 0 for \a BAG_DEFAULT_CHUNK_BYTES
+ *  \param *chunk         Receives \a rank chunk extents
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ********************************************************************/
+bagError bagPlanChunks (u32 rank, const hsize_t *dims, size_t elem_size, u8 hint,
+                        u32 target_bytes, hsize_t *chunk)
+{
+    hsize_t  nvalues, side;
+
+    if (dims == NULL || chunk == NULL || elem_size == 0 || (rank != 1 && rank != RANK))
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+
+    if (target_bytes == 0)
+        target_bytes = BAG_DEFAULT_CHUNK_BYTES;
+
+    /*! a random node read inflates a whole chunk for one value, so keep those small */
+    if (hint == BAG_ACCESS_NODES)
+        target_bytes /= 16;
+    else if (hint != BAG_ACCESS_TILES && hint != BAG_ACCESS_ROWS)
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+
+    nvalues = target_bytes / elem_size;
+    if (nvalues < 1)
+        nvalues = 1;
+
+    if (rank == 1)
+    {
+        /*! a growing list starts small, a short list should not pay for a full chunk */
+        if (dims[0] == 0)
+            nvalues = (nvalues / 4 > 0) ? nvalues / 4 : 1;
+        chunk[0] = bagClampExtent (nvalues, dims[0]);
+        return BAG_SUCCESS;
+    }
+
+    if (hint == BAG_ACCESS_ROWS || dims[0] == 1)
+    {
+        /*! whole rows where they fit, so a sweep touches each chunk once */
+        chunk[1] = bagClampExtent (nvalues, dims[1]);
+        chunk[0] = bagClampExtent (nvalues / chunk[1], dims[0]);
+        return BAG_SUCCESS;
+    }
+
+    /*! square tiles, widened along one axis when the other runs out */
+    side = (hsize_t) sqrt ((double) nvalues);
+    chunk[0] = bagClampExtent (side, dims[0]);
+    chunk[1] = bagClampExtent (nvalues / chunk[0], dims[1]);
+    chunk[0] = bagClampExtent (nvalues / chunk[1], dims[0]);
+
+    return BAG_SUCCESS;
+}
+
+/****************************************************************************************/
+/*! \brief bagPlanSurfaceChunks chooses the chunk shape of a 2D surface dataset being created
+ *
+ *  An explicit \a chunkSize in \a data is honoured when the surface is large enough for
+ *  it; otherwise the shape comes from \a bagPlanChunks with the \a accessHint and
+ *  \a chunkBytes of \a data.  An empty surface gets a 0 chunk, which
+ *  \a bagSetSurfaceFilters takes as a contiguous layout.
+ *
+ ****************************************************************************************/
+bagError bagPlanSurfaceChunks (const bagData *data, const hsize_t *dims, size_t elem_size, hsize_t *chunk)
+{
+    /*! an empty layer cannot be chunked; it is left contiguous */
+    if (dims[0] == 0 || dims[1] == 0)
+    {
+        chunk[0] = chunk[1] = 0;
+        return BAG_SUCCESS;
+    }
+
+    if (data->chunkSize > 0 && data->chunkSize <= dims[0] && data->chunkSize <= dims[1])
+    {
+        chunk[0] = chunk[1] = data->chunkSize;
+        return BAG_SUCCESS;
+    }
+
+    return bagPlanChunks (RANK, dims, elem_size, data->accessHint, data->chunkBytes, chunk);
+}
@@ -0,0 +1,709 @@
+/*! \file bag_chunks.c
+ * \brief This module contains the parallel raw chunk I/O of compressed surfaces.
+ ********************************************************************
+ *
+ * Module Name : bag_chunks.c
+ *
+ * Author/Date : ONSWG, October 2026
+ *
+ * Description :
+ *               H5Dread runs the filter pipeline of a chunked dataset one
+ *               chunk at a time on the calling thread, so reading a deflated
+ *               surface is bound to a single core.  Here the compressed
+ *               chunks are fetched as they are stored, with H5Dread_chunk,
+ *               and the filters are undone by a pool of workers that then
+ *               copy their part of each chunk straight into the caller's
+ *               buffer.  Only the raw reads hold the library HDF lock.
+ *
+ *               The bulk writer does the reverse: rows are gathered until a
+ *               whole row of chunks is complete, the chunks are filtered by
+ *               the workers and committed as they are with H5Dwrite_chunk.
+ *               Deflate is optional, as in the HDF pipeline: a chunk it would
+ *               not shrink is stored without it, with its bit set in the
+ *               filter mask, so readers skip the inflate.
+ *
+ * Restrictions/Limitations :
+ *               The deflate and shuffle filters are handled here.  Layers
+ *               stored with any other filter, contiguously, or in a type
+ *               whose size or byte order differs from the native one, and
+ *               HDF5 releases older than 1.10.3, are read through H5Dread
+ *               as before, and written through H5Dwrite.  Values are in the
+ *               file datatype of the layer, as for all other surface I/O.
+ *
+ * Change Descriptions :
+ * who  when      what
+ * ---  ----      ----
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ ********************************************************************/
+
+#include <string.h>
+#include <zlib.h>
+
+#include "bag_private.h"
+
+#define MAX_CHUNK_FILTERS  8   /*! \brief Longest filter pipeline handled by the raw chunk path */
+
+/*! The storage of one chunked dataset, as needed to decode its raw chunks */
+typedef struct
+{
+    hsize_t       chunk[RANK];                  /*! chunk dims */
+    size_t        type_size;                    /*! bytes per value */
+    size_t        chunk_bytes;                  /*! bytes of a decoded chunk */
+    u32           nfilters;
+    H5Z_filter_t  filter[MAX_CHUNK_FILTERS];    /*! in the order they are applied on write */
+    unsigned      level[MAX_CHUNK_FILTERS];     /*! deflate level of each deflate filter */
+    u8           *fill;                         /*! one fill value, \a type_size bytes */
+} bagChunkLayout;
+
+/*! Shared state of one parallel region read */
+typedef struct
+{
+    bagHandle       hnd;
+    hid_t           dataset_id;
+    bagChunkLayout  layout;
+    u32             start_row, start_col, end_row, end_col;
+    u32             first_chunk_row, first_chunk_col, nchunk_cols;
+    u8             *data;
+    u32             row_stride;
+    u8            **raw;          /*! per worker, compressed chunk */
+    size_t         *raw_size;     /*! per worker, allocated size of \a raw */
+    u8            **work;         /*! per worker, two decoded chunk buffers back to back */
+} bagChunkRead;
+
+/*! A bulk writer of one surface, see bagBulkWriterOpen() */
+struct _t_bagBulkWriter
+{
+    bagHandle       hnd;
+    s32             type;
+    hid_t           dataset_id;
+    bagChunkLayout  layout;
+    Bool            encodable;    /*! False when the rows go through H5Dwrite instead */
+    u32             nthreads;
+    u32             srow, scol;
+    u32             band_rows;    /*! rows in a full band, one row of chunks */
+    u32             band_start;   /*! first row of the band being gathered */
+    u32             nrows;        /*! rows gathered in the band so far */
+    u8             *band;         /*! \a band_rows rows of \a scol values */
+    u8            **chunk;        /*! per worker, assembled chunk then its shuffled copy */
+    u8            **packed;       /*! per worker, deflated chunk */
+    size_t          packed_size;
+};
+
+/****************************************************************************************/
+/*! \brief bagGetChunkLayout checks that the raw chunks of a dataset can be decoded here
+ *
+ *  \return : \li \a True when the layer is chunked, stored in the native layout of its
+ *                type, and every filter of its pipeline is known; \a *layout is then
+ *                filled in and its fill value must be freed.
+ *            \li \a False otherwise.
+ *
+ ****************************************************************************************/
+static Bool bagGetChunkLayout (hid_t dataset_id, hid_t datatype_id, bagChunkLayout *layout)
+{
+    hid_t            plist_id;
+    int              i, nfilters;
+    unsigned         flags;
+    size_t           nelmts;
+    unsigned         values[8];
+    H5D_fill_value_t fill_status;
+    hid_t            native_id;
+    htri_t           native;
+    Bool             ok = True;
+
+    memset (layout, 0, sizeof (bagChunkLayout));
+
+    /*! raw chunks hold the file's bytes, which are only memory values in the native layout */
+    if ((native_id = H5Tget_native_type (datatype_id, H5T_DIR_DEFAULT)) < 0)
+        return False;
+    native = H5Tequal (datatype_id, native_id);
+    H5Tclose (native_id);
+    if (native <= 0)
+        return False;
+
+    if ((plist_id = H5Dget_create_plist (dataset_id)) < 0)
+        return False;
+
+    if (H5Pget_layout (plist_id) != H5D_CHUNKED ||
+        H5Pget_chunk (plist_id, RANK, layout->chunk) != RANK)
+    {
+        H5Pclose (plist_id);
+        return False;
+    }
+
+    nfilters = H5Pget_nfilters (plist_id);
+    if (nfilters < 0 || nfilters > MAX_CHUNK_FILTERS)
+        ok = False;
+    for (i = 0; ok && i < nfilters; i++)
+    {
+        nelmts = sizeof (values) / sizeof (values[0]);
+        layout->filter[i] = H5Pget_filter (plist_id, (unsigned) i, &flags, &nelmts, values, 0, NULL);
+        if (layout->filter[i] == H5Z_FILTER_DEFLATE)
+            layout->level[i] = (nelmts > 0) ? values[0] : 6;
+        else if (layout->filter[i] != H5Z_FILTER_SHUFFLE)
+            ok = False;
+    }
+    layout->nfilters    = (u32) nfilters;
+    layout->type_size   = H5Tget_size (datatype_id);
+    layout->chunk_bytes = (size_t) (layout->chunk[0] * layout->chunk[1]) * layout->type_size;
+
+    /*! chunks that were never written read back as the fill value */
+    if (ok && (layout->fill = (u8 *) calloc (1, layout->type_size)) == NULL)
+        ok = False;
+    if (ok && H5Pfill_value_defined (plist_id, &fill_status) >= 0 && fill_status != H5D_FILL_VALUE_UNDEFINED)
+        H5Pget_fill_value (plist_id, datatype_id, layout->fill);
+
+    H5Pclose (plist_id);
+
+    if (!ok)
+    {
+        free (layout->fill);
+        layout->fill = NULL;
+    }
+    return ok;
+}
+
+/****************************************************************************************/
+/*! \brief bagUnshuffle undoes the HDF shuffle filter on \a nbytes bytes
+ *
+ *  The filter stores the first byte of every value, then the second byte of every
+ *  value, and so on; bytes past the last whole value are left in place.
+ *
+ ****************************************************************************************/
+static void bagUnshuffle (const u8 *src, u8 *dst, size_t nbytes, size_t type_size)
+{
+    size_t  nvalues = nbytes / type_size;
+    size_t  i, b;
+
+    for (b = 0; b < type_size; b++)
+    {
+        const u8 *in = src + b * nvalues;
+        for (i = 0; i < nvalues; i++)
+            dst[i * type_size + b] = in[i];
+    }
+    memcpy (dst + nvalues * type_size, src + nvalues * type_size, nbytes - nvalues * type_size);
+}
+
+/****************************************************************************************/
+/*! \brief bagShuffle applies the HDF shuffle filter to \a nbytes bytes, see \a bagUnshuffle
+ *
+ ****************************************************************************************/
+static void bagShuffle (const u8 *src, u8 *dst, size_t nbytes, size_t type_size)
+{
+    size_t  nvalues = nbytes / type_size;
+    size_t  i, b;
+
+    for (b = 0; b < type_size; b++)
+    {
+        u8 *out = dst + b * nvalues;
+        for (i = 0; i < nvalues; i++)
+            out[i] = src[i * type_size + b];
+    }
+    memcpy (dst + nvalues * type_size, src + nvalues * type_size, nbytes - nvalues * type_size);
+}
+
+/****************************************************************************************/
+/*! \brief bagReadChunkTask reads, decodes and places one chunk of a parallel region read
+ *
+ ****************************************************************************************/
+static bagError bagReadChunkTask (void *ctx, u32 task, u32 worker)
+{
+    bagChunkRead     *rd = (bagChunkRead *) ctx;
+    bagChunkLayout   *lo = &rd->layout;
+    hsize_t           offset[RANK], nbytes = 0;
+    uint32_t          mask = 0;
+    herr_t            status;
+    const u8         *cur;
+    u8               *out, *dst;
+    size_t            cur_len;
+    uLongf            dlen;
+    s32               i;
+    u32               r, c, row0, col0, r_lo, r_hi, c_lo, c_hi, ncols;
+    Bool              allocated;
+
+    row0 = (rd->first_chunk_row + task / rd->nchunk_cols) * (u32) lo->chunk[0];
+    col0 = (rd->first_chunk_col + task % rd->nchunk_cols) * (u32) lo->chunk[1];
+    offset[0] = row0;
+    offset[1] = col0;
+
+    /*! only the raw read goes through the HDF library */
+    bagLockHDF ();
+    allocated = (H5Dget_chunk_storage_size (rd->dataset_id, offset, &nbytes) >= 0 && nbytes > 0) ? True : False;
+    status = 0;
+    if (allocated)
+    {
+        if (nbytes > rd->raw_size[worker])
+        {
+            free (rd->raw[worker]);
+            if ((rd->raw[worker] = (u8 *) malloc ((size_t) nbytes)) == NULL)
+            {
+                rd->raw_size[worker] = 0;
+                bagUnlockHDF ();
+                return BAG_MEMORY_ALLOCATION_FAILED;
+            }
+            rd->raw_size[worker] = (size_t) nbytes;
+        }
+        status = H5Dread_chunk (rd->dataset_id, H5P_DEFAULT, offset, &mask, rd->raw[worker]);
+    }
+    bagUnlockHDF ();
+
+    if (status < 0)
+        return BAG_HDF_READ_FAILURE;
+
+    /*! undo the filters in reverse, skipping those the mask says were not applied */
+    cur     = rd->raw[worker];
+    cur_len = (size_t) nbytes;
+    for (i = (s32) lo->nfilters - 1; allocated && i >= 0; i--)
+    {
+        if (mask & (1u << i))
+            continue;
+
+        out = (cur == rd->work[worker]) ? rd->work[worker] + lo->chunk_bytes : rd->work[worker];
+        switch (lo->filter[i])
+        {
+        case H5Z_FILTER_DEFLATE:
+            dlen = (uLongf) lo->chunk_bytes;
+            if (uncompress (out, &dlen, cur, (uLong) cur_len) != Z_OK)
+                return BAG_HDF_CHUNK_DECODE_FAILURE;
+            cur_len = (size_t) dlen;
+            break;
+        case H5Z_FILTER_SHUFFLE:
+            bagUnshuffle (cur, out, cur_len, lo->type_size);
+            break;
+        default:
+            return BAG_HDF_CHUNK_DECODE_FAILURE;
+        }
+        cur = out;
+    }
+    if (allocated && cur_len < lo->chunk_bytes)
+        return BAG_HDF_CHUNK_DECODE_FAILURE;
+
+    /*! copy the part of the chunk inside the region */
+    r_lo  = (row0 > rd->start_row) ? row0 : rd->start_row;
+    r_hi  = (row0 + (u32) lo->chunk[0] - 1 < rd->end_row) ? row0 + (u32) lo->chunk[0] - 1 : rd->end_row;
+    c_lo  = (col0 > rd->start_col) ? col0 : rd->start_col;
+    c_hi  = (col0 + (u32) lo->chunk[1] - 1 < rd->end_col) ? col0 + (u32) lo->chunk[1] - 1 : rd->end_col;
+    ncols = c_hi - c_lo + 1;
+
+    for (r = r_lo; r <= r_hi; r++)
+    {
+        dst = rd->data + ((size_t) (r - rd->start_row) * rd->row_stride + (c_lo - rd->start_col)) * lo->type_size;
+        if (allocated)
+        {
+            memcpy (dst, cur + ((size_t) (r - row0) * lo->chunk[1] + (c_lo - col0)) * lo->type_size,
+                    ncols * lo->type_size);
+        }
+        else
+        {
+            for (c = 0; c < ncols; c++)
+                memcpy (dst + c * lo->type_size, lo->fill, lo->type_size);
+        }
+    }
+
+    return BAG_SUCCESS;
+}
+
+/****************************************************************************************/
+/*! \brief bagReadRegionParallel reads a region of a surface into a caller buffer,
+ *         decompressing its chunks on several threads
+ *
+ *  \param  hnd         External reference to the private \a bagHandle object
+ *  \param  start_row   Starting Row offset within the surface
+ *  \param  start_col   Starting Col offset within the surface
+ *  \param  end_row     Ending Row offset within the surface, inclusive
+ *  \param  end_col     Ending Col offset within the surface, inclusive
+ *  \param  type        Indicates which data surface type to access, element of \a BAG_SURFACE_PARAMS
+ *  \param *data        Caller buffer receiving the region, row major
+ *  \param  row_stride  Distance between rows of \a *data, in values; 0 for packed rows
+ *  \param  nthreads    Number of decompression threads; 0 for one per processor
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ********************************************************************/
+bagError bagReadRegionParallel (bagHandle hnd, u32 start_row, u32 start_col, u32 end_row, u32 end_col,
+                                s32 type, void *data, u32 row_stride, u32 nthreads)
+{
+    bagError      err;
+    bagChunkRead  rd;
+    u32           i, srow, scol, nchunks, nchunk_rows;
+    hid_t         dataset_id, datatype_id, filespace_id;
+    Bool          decodable = False;
+
+    if (hnd == NULL)
+        return BAG_INVALID_BAG_HANDLE;
+    if (data == NULL)
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+    if (row_stride == 0)
+        row_stride = end_col - start_col + 1;
+    if (nthreads == 0)
+        nthreads = bagGetNumProcessors ();
+
+    bagLockHDF ();
+    err = bagGetSurfaceIds (hnd, type, &dataset_id, &datatype_id, &filespace_id, &srow, &scol);
+#if H5_VERSION_GE(1,10,3)
+    if (err == BAG_SUCCESS && nthreads > 1)
+        decodable = bagGetChunkLayout (dataset_id, datatype_id, &rd.layout);
+#endif
+    bagUnlockHDF ();
+    if (err != BAG_SUCCESS)
+        return err;
+
+    if (end_row >= srow || end_col >= scol || start_row > end_row || start_col > end_col ||
+        row_stride < end_col - start_col + 1)
+    {
+        if (decodable)
+            free (rd.layout.fill);
+        return BAG_HDF_ACCESS_EXTENTS_ERROR;
+    }
+
+    /*! nothing to gain from threads here, let H5Dread run the pipeline */
+    if (!decodable)
+        return bagAlignRegionBuffer (hnd, start_row, start_col, end_row, end_col, type, READ_BAG,
+                                     data, row_stride, H5P_DEFAULT);
+
+    rd.hnd             = hnd;
+    rd.dataset_id      = dataset_id;
+    rd.start_row       = start_row;
+    rd.start_col       = start_col;
+    rd.end_row         = end_row;
+    rd.end_col         = end_col;
+    rd.data            = (u8 *) data;
+    rd.row_stride      = row_stride;
+    rd.first_chunk_row = start_row / (u32) rd.layout.chunk[0];
+    rd.first_chunk_col = start_col / (u32) rd.layout.chunk[1];
+    nchunk_rows        = end_row / (u32) rd.layout.chunk[0] - rd.first_chunk_row + 1;
+    rd.nchunk_cols     = end_col / (u32) rd.layout.chunk[1] - rd.first_chunk_col + 1;
+    nchunks            = nchunk_rows * rd.nchunk_cols;
+    if (nthreads > nchunks)
+        nthreads = nchunks;
+
+    rd.raw      = (u8 **) calloc (nthreads, sizeof (u8 *));
+    rd.raw_size = (size_t *) calloc (nthreads, sizeof (size_t));
+    rd.work     = (u8 **) calloc (nthreads, sizeof (u8 *));
+    err = (rd.raw == NULL || rd.raw_size == NULL || rd.work == NULL) ? BAG_MEMORY_ALLOCATION_FAILED : BAG_SUCCESS;
+    for (i = 0; err == BAG_SUCCESS && i < nthreads; i++)
+    {
+        if ((rd.work[i] = (u8 *) malloc (2 * rd.layout.chunk_bytes)) == NULL)
+            err = BAG_MEMORY_ALLOCATION_FAILED;
+    }
+
+    if (err == BAG_SUCCESS)
+        err = bagParallelFor (nthreads, nchunks, bagReadChunkTask, &rd);
+
+    for (i = 0; i < nthreads; i++)
+    {
+        if (rd.raw != NULL)
+            free (rd.raw[i]);
+        if (rd.work != NULL)
+            free (rd.work[i]);
+    }
+    free (rd.raw);
+    free (rd.raw_size);
+    free (rd.work);
+    free (rd.layout.fill);
+
+    return err;
+}
+
+/****************************************************************************************/
+/*! \brief bagWriteChunkTask assembles, encodes and commits one chunk of the gathered band
+ *
+ ****************************************************************************************/
+static bagError bagWriteChunkTask (void *ctx, u32 task, u32 worker)
+{
+    bagBulkWriter     bw = (bagBulkWriter) ctx;
+    bagChunkLayout   *lo = &bw->layout;
+    hsize_t           offset[RANK];
+    herr_t            status;
+    const u8         *cur;
+    u8               *out, *buf;
+    size_t            cur_len, ts = lo->type_size;
+    uLongf            clen;
+    uint32_t          mask = 0;
+    u32               i, r, c, col0, ncols;
+
+    col0  = task * (u32) lo->chunk[1];
+    ncols = (col0 + (u32) lo->chunk[1] <= bw->scol) ? (u32) lo->chunk[1] : bw->scol - col0;
+    buf   = bw->chunk[worker];
+
+    /*! the parts of edge chunks outside the surface hold the fill value */
+    for (r = 0; r < (u32) lo->chunk[0]; r++)
+    {
+        out = buf + (size_t) r * lo->chunk[1] * ts;
+        c = 0;
+        if (r < bw->nrows)
+        {
+            memcpy (out, bw->band + ((size_t) r * bw->scol + col0) * ts, ncols * ts);
+            c = ncols;
+        }
+        for (; c < (u32) lo->chunk[1]; c++)
+            memcpy (out + c * ts, lo->fill, ts);
+    }
+
+    /*! run the pipeline forward, skipping the optional deflate where it does not pay */
+    cur     = buf;
+    cur_len = lo->chunk_bytes;
+    for (i = 0; i < lo->nfilters; i++)
+    {
+        switch (lo->filter[i])
+        {
+        case H5Z_FILTER_SHUFFLE:
+            out = (cur == buf) ? buf + bw->packed_size : buf;
+            bagShuffle (cur, out, cur_len, ts);
+            break;
+        case H5Z_FILTER_DEFLATE:
+            out  = (cur == bw->packed[worker]) ? buf : bw->packed[worker];
+            clen = (uLongf) bw->packed_size;
+            if (compress2 (out, &clen, cur, (uLong) cur_len, (int) lo->level[i]) != Z_OK)
+                return BAG_HDF_WRITE_FAILURE;
+            if ((size_t) clen < cur_len)
+                cur_len = (size_t) clen;
+            else
+            {
+                mask |= 1u << i;
+                out   = (u8 *) cur;
+            }
+            break;
+        default:
+            return BAG_HDF_WRITE_FAILURE;
+        }
+        cur = out;
+    }
+
+    offset[0] = bw->band_start;
+    offset[1] = col0;
+
+    bagLockHDF ();
+    status = H5Dwrite_chunk (bw->dataset_id, H5P_DEFAULT, mask, offset, cur_len, cur);
+    bagUnlockHDF ();
+
+    return (status < 0) ? BAG_HDF_WRITE_FAILURE : BAG_SUCCESS;
+}
+
+/****************************************************************************************/
+/*! \brief bagFlushBand commits the rows gathered so far and starts the next band
+ *
+ *  Whole rows of chunks are encoded by the workers; anything else, a partial band
+ *  or a layer the workers cannot encode, is written through H5Dwrite.
+ *
+ ****************************************************************************************/
+static bagError bagFlushBand (bagBulkWriter bw)
+{
+    bagError  err;
+    u32       nchunks;
+    Bool      whole;
+
+    if (bw->nrows == 0)
+        return BAG_SUCCESS;
+
+    whole = (bw->nrows == bw->band_rows || bw->band_start + bw->nrows == bw->srow) ? True : False;
+    if (bw->encodable && whole)
+    {
+        nchunks = (bw->scol + (u32) bw->layout.chunk[1] - 1) / (u32) bw->layout.chunk[1];
+        err = bagParallelFor (bw->nthreads, nchunks, bagWriteChunkTask, bw);
+        if (err == BAG_SUCCESS)
+        {
+            bagLockHDF ();
+            bagFoldSurfaceStats (bw->hnd, bw->type, (const f32 *) bw->band, bw->nrows, bw->scol, bw->scol);
+            bagMarkSurfaceRows (bw->hnd, bw->type, bw->band_start, bw->band_start + bw->nrows - 1);
+            bagUnlockHDF ();
+        }
+    }
+    else
+    {
+        err = bagAlignRegionBuffer (bw->hnd, bw->band_start, 0, bw->band_start + bw->nrows - 1, bw->scol - 1,
+                                    bw->type, WRITE_BAG, bw->band, bw->scol, H5P_DEFAULT);
+    }
+
+    bw->band_start += bw->nrows;
+    bw->nrows       = 0;
+
+    return err;
+}
+
+/****************************************************************************************/
+/*! \brief bagBulkWriterOpen prepares a fast sequential writer of a whole surface
+ *
+ *  Rows are then given, from row 0 down, to \a bagBulkWriteRows.  Each time a full row
+ *  of chunks has been gathered, its chunks are compressed by \a nthreads workers and
+ *  written directly, with the same filters and layout as \a bagWriteRow would produce.
+ *
+ *  \param  hnd        External reference to the private \a bagHandle object
+ *  \param  type       Indicates which data surface type to access, element of \a BAG_SURFACE_PARAMS
+ *  \param  nthreads   Number of compression threads; 0 for one per processor
+ *  \param *bw         Will be set to the allocated \a bagBulkWriter.
+ *                     Must be released with \a bagBulkWriterClose.
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ********************************************************************/
+bagError bagBulkWriterOpen (bagHandle hnd, s32 type, u32 nthreads, bagBulkWriter *bw)
+{
+    bagError       err;
+    bagBulkWriter  w;
+    hid_t          datatype_id, filespace_id;
+    size_t         ts = 0;
+    u32            i;
+
+    if (hnd == NULL)
+        return BAG_INVALID_BAG_HANDLE;
+    if (bw == NULL)
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+
+    *bw = NULL;
+
+    if ((w = (bagBulkWriter) calloc (1, sizeof (struct _t_bagBulkWriter))) == NULL)
+        return BAG_MEMORY_ALLOCATION_FAILED;
+
+    w->hnd      = hnd;
+    w->type     = type;
+    w->nthreads = (nthreads == 0) ? bagGetNumProcessors () : nthreads;
+
+    bagLockHDF ();
+    err = bagGetSurfaceIds (hnd, type, &w->dataset_id, &datatype_id, &filespace_id, &w->srow, &w->scol);
+    if (err == BAG_SUCCESS)
+    {
+#if H5_VERSION_GE(1,10,3)
+        w->encodable = bagGetChunkLayout (w->dataset_id, datatype_id, &w->layout);
+#endif
+        ts = H5Tget_size (datatype_id);
+    }
+    bagUnlockHDF ();
+    if (err != BAG_SUCCESS)
+    {
+        free (w);
+        return err;
+    }
+    w->layout.type_size = ts;
+
+    /*! without direct chunk writes, bands of about the tile size keep H5Dwrite efficient */
+    if (w->encodable)
+        w->band_rows = (u32) w->layout.chunk[0];
+    else
+    {
+        w->band_rows = (u32) (TILE_BAND_BYTES / ((size_t) w->scol * ts));
+        if (w->band_rows < 1)
+            w->band_rows = 1;
+        w->nthreads = 1;
+    }
+    if (w->band_rows > w->srow)
+        w->band_rows = w->srow;
+
+    w->band   = (u8 *) malloc ((size_t) w->band_rows * w->scol * ts);
+    w->chunk  = (u8 **) calloc (w->nthreads, sizeof (u8 *));
+    w->packed = (u8 **) calloc (w->nthreads, sizeof (u8 *));
+    if (w->band == NULL || w->chunk == NULL || w->packed == NULL)
+    {
+        bagBulkWriterClose (w);
+        return BAG_MEMORY_ALLOCATION_FAILED;
+    }
+
+    if (w->encodable)
+    {
+        /*! every scratch buffer takes a whole chunk, or its deflated form, whichever is bigger */
+        w->packed_size = compressBound ((uLong) w->layout.chunk_bytes);
+        if (w->packed_size < w->layout.chunk_bytes)
+            w->packed_size = w->layout.chunk_bytes;
+        for (i = 0; i < w->nthreads; i++)
+        {
+            w->chunk[i]  = (u8 *) malloc (2 * w->packed_size);
+            w->packed[i] = (u8 *) malloc (w->packed_size);
+            if (w->chunk[i] == NULL || w->packed[i] == NULL)
+            {
+                bagBulkWriterClose (w);
+                return BAG_MEMORY_ALLOCATION_FAILED;
+            }
+        }
+    }
+
+    *bw = w;
+    return BAG_SUCCESS;
+}
+
+/****************************************************************************************/
+/*! \brief bagBulkWriteRows appends rows to a surface opened with \a bagBulkWriterOpen
+ *
+ *  \param  bw          Writer returned by \a bagBulkWriterOpen
+ *  \param  nrows       Number of full rows in \a *data, continuing from the last row given
+ *  \param *data        \a nrows rows of the surface, row major
+ *  \param  row_stride  Distance between rows of \a *data, in values; 0 for packed rows
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ********************************************************************/
+bagError bagBulkWriteRows (bagBulkWriter bw, u32 nrows, const void *data, u32 row_stride)
+{
+    bagError    err;
+    size_t      ts, row_bytes;
+    const u8   *src = (const u8 *) data;
+    u32         n;
+
+    if (bw == NULL || (data == NULL && nrows > 0))
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+    if (row_stride == 0)
+        row_stride = bw->scol;
+    if (row_stride < bw->scol)
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+    if (bw->band_start + bw->nrows + nrows > bw->srow)
+        return BAG_HDF_ACCESS_EXTENTS_ERROR;
+
+    ts        = bw->layout.type_size;
+    row_bytes = (size_t) bw->scol * ts;
+
+    for (n = 0; n < nrows; n++)
+    {
+        memcpy (bw->band + (size_t) bw->nrows * row_bytes, src + (size_t) n * row_stride * ts, row_bytes);
+        bw->nrows++;
+        if (bw->nrows == bw->band_rows || bw->band_start + bw->nrows == bw->srow)
+        {
+            if ((err = bagFlushBand (bw)) != BAG_SUCCESS)
+                return err;
+        }
+    }
+
+    return BAG_SUCCESS;
+}
+
+/****************************************************************************************/
+/*! \brief bagBulkWriterClose writes any rows still gathered and releases the writer
+ *
+ *  Rows that were never given keep whatever the surface held before.
+ *
+ *  \param  bw    Writer returned by \a bagBulkWriterOpen
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, the error of the last write, or a proper code from \a BAG_ERRORS.
+ *
+ ********************************************************************/
+bagError bagBulkWriterClose (bagBulkWriter bw)
+{
+    bagError  err = BAG_SUCCESS;
+    u32       i;
+
+    if (bw == NULL)
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+
+    if (bw->band != NULL)
+        err = bagFlushBand (bw);
+
+    for (i = 0; i < bw->nthreads; i++)
+    {
+        if (bw->chunk != NULL)
+            free (bw->chunk[i]);
+        if (bw->packed != NULL)
+            free (bw->packed[i]);
+    }
+    free (bw->chunk);
+    free (bw->packed);
+    free (bw->band);
+    free (bw->layout.fill);
+    free (bw);
+
+    return err;
+}
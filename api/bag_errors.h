@@ -26,6 +26,7 @@ enum BAG_ERRORS {
     BAG_INVALID_BAG_HANDLE                     =   5, /*!< bagHandle cannot be NULL */
     BAG_INVALID_FUNCTION_ARGUMENT              =   6, /*!< Inconsistency or illegal value contained in function arguments */
     BAG_INVALID_ERROR_CODE                     =   7, /*!< An undefined bagError code was encountered */
+    BAG_THREAD_FAILURE                         =   8, /*!< A worker thread or its synchronization could not be set up */
 	
     BAG_CRYPTO_SIGNATURE_OK                    = 200, /*!< Signature found, and valid */
     BAG_CRYPTO_NO_SIGNATURE_FOUND              = 201, /*!< No signature found in file */
@@ -34,6 +35,7 @@ enum BAG_ERRORS {
     BAG_CRYPTO_WRONG_KEY                       = 204, /*!< Wrong key type passed */
     BAG_CRYPTO_GENERAL_ERROR                   = 205, /*!< Something else went wrong */
     BAG_CRYPTO_INTERNAL_ERROR                  = 206, /*!< Something went wrong that the library didn't expect */
+    BAG_CRYPTO_SIGNATURE_DROPPED               = 207, /*!< Signature not carried into a modified copy; sign the copy again */
   
     BAG_METADTA_NO_HOME                        = 400, /*!< BAG_HOME directory not set. */
     BAG_METADTA_SCHEMA_FILE_MISSING            = 401, /*!< Unable to locate schema file. */
@@ -92,6 +94,10 @@ enum BAG_ERRORS {
     BAG_HDF_DATASET_OPEN_FAILURE               = 629, /*!< HDF Unable to open Dataset */
     BAG_HDF_TYPE_CREATE_FAILURE                = 630, /*!< HDF Unable to create Datatype */
     BAG_HDF_INVALID_COMPRESSION_LEVEL          = 631, /*!< HDF compression level not in acceptable range of 0 to 9 */
+    BAG_HDF_DATASET_NOT_MAPPABLE               = 632, /*!< HDF dataset storage or file access mode does not allow memory mapping */
+    BAG_HDF_MMAP_FAILURE                       = 633, /*!< HDF dataset could not be memory mapped */
+    BAG_HDF_CHUNK_DECODE_FAILURE               = 634, /*!< HDF raw chunk could not be decoded */
+    BAG_HDF_SORT_NEEDS_RECOVERY                = 635, /*!< HDF tracking list partly written back by a sort; sort it again to recover it */
 
 };
 
@@ -53,6 +53,143 @@
 #define	META_DATA_BLOCK_SIZE           1024           /*! \brief The block size defines the allocation/allocation extension unit size */
 #define   BAG_OPEN_CREATE  3 /*! special mode for \a bagFileOpen \a access_mode */
 
+/********************************************************************/
+/*! \brief bagSetFilterPipeline
+ *
+ * Description : 
+ *   Adds the filters of the \a bagFilterSpec of \a data, with its
+ *   \a compressionLevel, to a chunked dataset creation property list;
+ *   see \a bagSetSurfaceFilters.  Used as well for the growing datasets
+ *   of a repacked BAG.
+ *
+ * \param plist_id     Dataset creation property list, already chunked
+ * \param *data        A pointer to properly initialized bagData struct
+ * \param datatype_id  Datatype of the dataset being created
+ *
+ * \return \li On success, \a bagError is set to \a BAG_SUCCESS
+ *         \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS
+ *
+ ********************************************************************/
+bagError bagSetFilterPipeline (hid_t plist_id, const bagData *data, hid_t datatype_id)
+{
+    herr_t    status;
+    unsigned  cd_values[1];
+
+    /*! scale-offset packs the values to integers first, so the codec sees the packed bits */
+    if (data->filter.scaleOffsetDigits > 0 && H5Tget_class (datatype_id) == H5T_FLOAT)
+    {
+        if ((status = H5Pset_scaleoffset (plist_id, H5Z_SO_FLOAT_DSCALE, data->filter.scaleOffsetDigits)) < 0)
+            return BAG_HDF_SET_PROPERTY_FAILURE;
+    }
+
+    if (data->filter.shuffle)
+    {
+        if ((status = H5Pset_shuffle (plist_id)) < 0)
+            return BAG_HDF_SET_PROPERTY_FAILURE;
+    }
+
+    switch (data->filter.codec)
+    {
+    case BAG_CODEC_ZSTD:
+        if (H5Zfilter_avail (BAG_FILTER_ZSTD) > 0)
+        {
+            cd_values[0] = data->compressionLevel;
+            status = H5Pset_filter (plist_id, BAG_FILTER_ZSTD, H5Z_FLAG_OPTIONAL, 1, cd_values);
+            return (status < 0) ? BAG_HDF_SET_PROPERTY_FAILURE : BAG_SUCCESS;
+        }
+        break;
+    case BAG_CODEC_LZ4:
+        if (H5Zfilter_avail (BAG_FILTER_LZ4) > 0)
+        {
+            status = H5Pset_filter (plist_id, BAG_FILTER_LZ4, H5Z_FLAG_OPTIONAL, 0, NULL);
+            return (status < 0) ? BAG_HDF_SET_PROPERTY_FAILURE : BAG_SUCCESS;
+        }
+        break;
+    case BAG_CODEC_DEFLATE:
+        break;
+    default:
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+    }
+
+    if ((status = H5Pset_deflate (plist_id, data->compressionLevel)) < 0)
+        return BAG_HDF_SET_PROPERTY_FAILURE;
+
+    return BAG_SUCCESS;
+}
+
+/********************************************************************/
+/*! \brief bagSetSurfaceFilters
+ *
+ * Description : 
+ *   Sets up the chunked layout and the filter pipeline of a surface
+ *   dataset from \a compressionLevel and the \a bagFilterSpec of \a data.
+ *   Nothing is set when \a compressionLevel is 0, unless \a sparse asks
+ *   for a chunked layout without filters, or when the layer is
+ *   empty and \a chunk_size holds a 0.  The scale-offset
+ *   filter only applies to floating point datatypes, and a Zstandard or
+ *   LZ4 codec whose HDF5 plugin is not registered falls back to deflate.
+ *
+ * \param plist_id     Dataset creation property list to set up
+ * \param *data        A pointer to properly initialized bagData struct
+ * \param datatype_id  Datatype of the dataset being created
+ * \param *chunk_size  RANK chunk dims of the dataset
+ *
+ * \return \li On success, \a bagError is set to \a BAG_SUCCESS
+ *         \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS
+ *
+ ********************************************************************/
+bagError bagSetSurfaceFilters (hid_t plist_id, const bagData *data, hid_t datatype_id, const hsize_t *chunk_size)
+{
+    herr_t    status;
+
+    if (data->compressionLevel == 0 && !data->sparse)
+        return BAG_SUCCESS;
+    if (data->compressionLevel > 9)
+        return BAG_HDF_INVALID_COMPRESSION_LEVEL;
+    if (chunk_size[0] == 0 || chunk_size[1] == 0)
+        return BAG_SUCCESS;
+
+    if ((status = H5Pset_layout (plist_id, H5D_CHUNKED)) < 0 ||
+        (status = H5Pset_chunk (plist_id, RANK, chunk_size)) < 0)
+        return BAG_HDF_SET_PROPERTY_FAILURE;
+
+    /*! a contiguous surface is allocated whole at its first write, chunks one by one */
+    if (data->sparse)
+    {
+        if ((status = H5Pset_alloc_time (plist_id, H5D_ALLOC_TIME_INCR)) < 0)
+            return BAG_HDF_SET_PROPERTY_FAILURE;
+        if (data->compressionLevel == 0)
+            return BAG_SUCCESS;
+    }
+
+    return bagSetFilterPipeline (plist_id, data, datatype_id);
+}
+
+/********************************************************************/
+/*! \brief bagSetSurfaceFillTime
+ *
+ * Description : 
+ *   Sets when the null value given as fill value of a surface dataset
+ *   is written.  Normally every chunk is filled as it is allocated.  A
+ *   \a sparse BAG fills only if a fill value is set, which also marks
+ *   the layer as sparse for \a bagFileOpen; chunks that are never
+ *   written are then never allocated, and read back as the fill value.
+ *
+ * \param plist_id     Dataset creation property list to set up
+ * \param  sparse      True for the layers of a sparse BAG
+ *
+ * \return \li On success, \a bagError is set to \a BAG_SUCCESS
+ *         \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS
+ *
+ ********************************************************************/
+bagError bagSetSurfaceFillTime (hid_t plist_id, Bool sparse)
+{
+    if (H5Pset_fill_time (plist_id, sparse ? H5D_FILL_TIME_IFSET : H5D_FILL_TIME_ALLOC) < 0)
+        return BAG_HDF_SET_PROPERTY_FAILURE;
+
+    return BAG_SUCCESS;
+}
+
 /********************************************************************/
 /*! \brief bagFileCreate
  *
@@ -138,6 +275,8 @@ bagError bagFileCreate(const u8 *file_name, bagData *data, bagHandle *bag_handle
     (* bag_handle)->mta_cparms_id    = 
     (* bag_handle)->elv_datatype_id  = -1;
 
+    bagInitMemspaceCache (* bag_handle);
+
     for (i=0; i < BAG_OPT_SURFACE_LIMIT; i++)
     {
         (* bag_handle)->opt_memspace_id[i]  = 
@@ -264,8 +403,12 @@ bagError bagFileCreate(const u8 *file_name, bagData *data, bagHandle *bag_handle
         return (BAG_HDF_CREATE_PROPERTY_CLASS_FAILURE);        
     }
     
-    /*! tracking_list will access chunks of items at a time for faster performance (hopefully) */
-    chunk_dims[0] = TRACKING_LIST_BLOCK_SIZE;
+    /*! tracking_list is appended to and swept in order, so plan chunks of many items */
+    if ((status = bagPlanChunks (1, dim_init, sizeof (bagTrackingItem), BAG_ACCESS_ROWS, data->chunkBytes, chunk_dims)) != BAG_SUCCESS)
+    {
+        H5Fclose (file_id);
+        return status;
+    }
     if ((status = H5Pset_chunk (cparms, 1, chunk_dims)) < 0)
     {
         status = H5Fclose (file_id);
@@ -319,24 +462,10 @@ bagError bagFileCreate(const u8 *file_name, bagData *data, bagHandle *bag_handle
     dims[0] = data->def.nrows;
     dims[1] = data->def.ncols;
 
-    if (data->chunkSize > 0)
-    {
-        chunk_size[0] = chunk_size[1] = data->chunkSize;
-    }
-    else
+    if ((status = bagPlanSurfaceChunks (data, dims, sizeof (f32), chunk_size)) != BAG_SUCCESS)
     {
-        if (dims[0] > 100 && dims[1] > 100)
-        {
-            chunk_size[0] = chunk_size[1] = 100;
-        }        
-        else if (dims[0] > 10 && dims[1] > 10)
-        {
-            chunk_size[0] = chunk_size[1] = 10;
-        }
-        else
-        {
-            data->compressionLevel = 0;
-        }
+        H5Fclose (file_id);
+        return status;
     }
 
     /*! Create the mandatory \a elevation dataset */
@@ -364,25 +493,19 @@ bagError bagFileCreate(const u8 *file_name, bagData *data, bagHandle *bag_handle
         return (BAG_HDF_CREATE_PROPERTY_CLASS_FAILURE);
     }
 
-    status = H5Pset_fill_time  (plist_id, H5D_FILL_TIME_ALLOC);
+    if ((status = bagSetSurfaceFillTime (plist_id, data->sparse ? True : False)) != BAG_SUCCESS)
+    {
+        H5Fclose (file_id);
+        return status;
+    }
     status = H5Pset_fill_value (plist_id, datatype_id, &null_elv);
     check_hdf_status();
 
 
-    if (data->compressionLevel > 0 && data->compressionLevel <= 9)
-    {
-        status = H5Pset_layout (plist_id, H5D_CHUNKED);
-        status = H5Pset_chunk(plist_id, RANK, chunk_size);
-        
-        if ((status = H5Pset_deflate (plist_id, data->compressionLevel)) < 0)
-        {
-            status = H5Fclose (file_id);
-            return (BAG_HDF_SET_PROPERTY_FAILURE);
-        }
-    }
-    else if (data->compressionLevel) /* if anything other than zero */
+    if ((status = bagSetSurfaceFilters (plist_id, data, datatype_id, chunk_size)) != BAG_SUCCESS)
     {
-        return (BAG_HDF_INVALID_COMPRESSION_LEVEL);
+        H5Fclose (file_id);
+        return status;
     }
 
     if ((dataset_id = H5Dcreate(file_id, ELEVATION_PATH, datatype_id, dataspace_id, plist_id)) < 0)
@@ -444,25 +567,19 @@ bagError bagFileCreate(const u8 *file_name, bagData *data, bagHandle *bag_handle
         return (BAG_HDF_CREATE_PROPERTY_CLASS_FAILURE);
     }
 
-    status = H5Pset_fill_time  (plist_id, H5D_FILL_TIME_ALLOC);
+    if ((status = bagSetSurfaceFillTime (plist_id, data->sparse ? True : False)) != BAG_SUCCESS)
+    {
+        H5Fclose (file_id);
+        return status;
+    }
     status = H5Pset_fill_value (plist_id, datatype_id, &null_unc);
     check_hdf_status();
 
 
-    if (data->compressionLevel > 0 && data->compressionLevel <= 9)
+    if ((status = bagSetSurfaceFilters (plist_id, data, datatype_id, chunk_size)) != BAG_SUCCESS)
     {
-        status = H5Pset_layout (plist_id, H5D_CHUNKED);
-        status = H5Pset_chunk(plist_id, RANK, chunk_size);
-        
-        if ((status = H5Pset_deflate (plist_id, data->compressionLevel)) < 0)
-        {
-            status = H5Fclose (file_id);
-            return (BAG_HDF_SET_PROPERTY_FAILURE);
-        }
-    }
-    else if (data->compressionLevel) /* if anything other than zero */
-    {
-        return (BAG_HDF_INVALID_COMPRESSION_LEVEL);
+        H5Fclose (file_id);
+        return status;
     }
 
     if ((dataset_id = H5Dcreate(file_id, UNCERTAINTY_PATH, datatype_id, dataspace_id, plist_id)) < 0)
@@ -510,6 +627,41 @@ bagError bagFileCreate(const u8 *file_name, bagData *data, bagHandle *bag_handle
         return status;
     }
 
+    /*! the file does not record how its chunks were planned, so the caller's request carries on to what is made next */
+    (*bag_handle)->bag.accessHint = data->accessHint;
+    (*bag_handle)->bag.chunkBytes = data->chunkBytes;
+    (*bag_handle)->bag.filter     = data->filter;
+
+    /*! the new surfaces hold only nulls, so their ranges can be kept up as they are written */
+    bagResetSurfaceStats (*bag_handle, Elevation, True);
+    bagResetSurfaceStats (*bag_handle, Uncertainty, True);
+
+    if (data->overviewLevels > 0)
+    {
+        bagLockHDF ();
+        status = bagCreateOverviews (*bag_handle, data->overviewLevels, data->overviewAggregator);
+        bagUnlockHDF ();
+        if (status != BAG_SUCCESS)
+        {
+            bagFileClose (*bag_handle);
+            *bag_handle = NULL;
+            return status;
+        }
+    }
+
+    if (data->chunkIndex)
+    {
+        bagLockHDF ();
+        status = bagCreateChunkIndex (*bag_handle);
+        bagUnlockHDF ();
+        if (status != BAG_SUCCESS)
+        {
+            bagFileClose (*bag_handle);
+            *bag_handle = NULL;
+            return status;
+        }
+    }
+
     length = (u32)strlen((char *)data->metadata);
     if (length < XML_METADATA_MIN_LENGTH)
     {
@@ -654,6 +806,88 @@ bagError bagCheckVariableResolution(bagHandle handle, Bool * const is_var_res, B
 
 /********************************************************************/
 /*! \brief bagFileOpen
+ *
+ * Description : 
+ *     This function opens a BAG file stored in HDF5, with the default HDF caches.
+ *     See \a bagFileOpenEx.
+ *
+ ********************************************************************/
+bagError bagFileOpen(bagHandle *bag_handle, s32 access_mode, const u8 *file_name)
+{
+    return bagFileOpenEx (bag_handle, access_mode, file_name, NULL);
+}
+
+/********************************************************************/
+/*! \brief bagOpenDataset opens a dataset of the BAG with the chunk cache asked for its layer
+ *
+ * \param hnd    The private \a bagHandle, with \a open_opts set
+ * \param path   Full HDF path of the dataset
+ * \param type   The \a BAG_SURFACE_PARAMS layer the dataset holds, selects the cache settings
+ *
+ * \return The dataset identifier, negative on failure as with \a H5Dopen
+ *
+ ********************************************************************/
+hid_t bagOpenDataset (bagHandle hnd, const char *path, s32 type)
+{
+    bagChunkCacheOptions *cache;
+    hid_t                 dataset_id, dapl_id = H5P_DEFAULT;
+    size_t                nslots, nbytes;
+    double                w0;
+
+    if (type >= 0 && type < BAG_OPT_SURFACE_LIMIT)
+    {
+        cache = &hnd->open_opts.chunkCache[type];
+        if (cache->nslots > 0 || cache->nbytes > 0 || cache->w0 != 0.0)
+        {
+            /*! start from the defaults so unset fields keep them */
+            if ((dapl_id = H5Pcreate (H5P_DATASET_ACCESS)) < 0)
+                return dapl_id;
+            H5Pget_chunk_cache (dapl_id, &nslots, &nbytes, &w0);
+            if (cache->nslots > 0)
+                nslots = cache->nslots;
+            if (cache->nbytes > 0)
+                nbytes = cache->nbytes;
+            if (cache->w0 > 0.0 && cache->w0 <= 1.0)
+                w0 = cache->w0;
+            else if (cache->w0 == BAG_CHUNK_CACHE_W0_NONE)
+                w0 = 0.0;
+            H5Pset_chunk_cache (dapl_id, nslots, nbytes, w0);
+        }
+    }
+
+    dataset_id = H5Dopen2 (hnd->file_id, path, dapl_id);
+
+    if (dapl_id != H5P_DEFAULT)
+        H5Pclose (dapl_id);
+
+    return dataset_id;
+}
+
+/*! \brief bagFileOpenPaged opens a file with page buffering if it allows it, else without
+ *
+ *  Only the page buffer is dropped from \a fapl_id for the second try; \a opts receives the
+ *  page buffer in effect.
+ */
+static hid_t bagFileOpenPaged (const u8 *file_name, unsigned flags, hid_t fapl_id, bagOpenOptions *opts)
+{
+    hid_t file_id;
+
+    opts->pageBufferUsed = 0;
+    file_id = H5Fopen ((char *) file_name, flags, fapl_id);
+#if H5_VERSION_GE(1,10,1)
+    if (opts->pageBufferSize > 0)
+    {
+        if (file_id >= 0)
+            opts->pageBufferUsed = opts->pageBufferSize;
+        else if (H5Pset_page_buffer_size (fapl_id, 0, 0, 0) >= 0)
+            file_id = H5Fopen ((char *) file_name, flags, fapl_id);
+    }
+#endif
+    return file_id;
+}
+
+/********************************************************************/
+/*! \brief bagFileOpenEx
  *
  * Description : 
  *     This function opens a BAG file stored in HDF5.  The library supports 
@@ -664,18 +898,22 @@ bagError bagCheckVariableResolution(bagHandle handle, Bool * const is_var_res, B
  *                      by the caller.
  * \param  access_mode  Entity \a BAG_OPEN_MODE
  * \param *file_name    A string provides the filesystem name of the BAG
+ * \param *options      Chunk cache and page buffer settings, may be NULL for the defaults;
+ *                      its \a pageBufferUsed is set to the page buffer in effect
  *
  * \return \li On success, \a bagError is set to \a BAG_SUCCESS
  *         \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS
  *
  ********************************************************************/
-bagError bagFileOpen(bagHandle *bag_handle, s32 access_mode, const u8 *file_name)
+static bagError bagFileOpenExUnlocked (bagHandle *bag_handle, s32 access_mode, const u8 *file_name,
+                                       bagOpenOptions *options)
 {
     bagError     status;
     u8           version[BAG_VERSION_LENGTH+16];
     hsize_t      max_dims[RANK];
     hsize_t      chunk_size[RANK] = { 0, 0 };
-    hid_t        plist_id;
+    H5D_fill_time_t fill_time;
+    hid_t        plist_id, fapl_id;
 
     /*! chunking data block */
     hsize_t     chunk_dimsr[1];
@@ -692,6 +930,17 @@ bagError bagFileOpen(bagHandle *bag_handle, s32 access_mode, const u8 *file_name
     (* bag_handle)->cryptoBlock = NULL;
     strncpy ((char *)(* bag_handle)->filename, (char *)file_name, MAX_STR-1);
 
+    if (options != NULL)
+        memcpy (&(* bag_handle)->open_opts, options, sizeof (bagOpenOptions));
+
+    /*! page buffering only applies to files written with the paged file space strategy */
+    if ((fapl_id = H5Pcreate (H5P_FILE_ACCESS)) < 0)
+        return BAG_HDF_CREATE_PROPERTY_CLASS_FAILURE;
+#if H5_VERSION_GE(1,10,1)
+    if ((* bag_handle)->open_opts.pageBufferSize > 0)
+        H5Pset_page_buffer_size (fapl_id, (* bag_handle)->open_opts.pageBufferSize, 0, 0);
+#endif
+
     /*! \brief open the BAG */
     if (BAG_OPEN_READ_WRITE == access_mode ||
         BAG_OPEN_CREATE == access_mode)
@@ -718,18 +967,25 @@ bagError bagFileOpen(bagHandle *bag_handle, s32 access_mode, const u8 *file_name
         }
 
 
-        if (((* bag_handle)->file_id = H5Fopen((char *)file_name, H5F_ACC_RDWR, H5P_DEFAULT)) < 0)
+        (* bag_handle)->file_id = bagFileOpenPaged (file_name, H5F_ACC_RDWR, fapl_id, &(* bag_handle)->open_opts);
+        if ((* bag_handle)->file_id < 0)
         {
+           H5Pclose (fapl_id);
            return (BAG_HDF_FILE_OPEN_FAILURE);
         }
     }
     else
     {
-      if (((* bag_handle)->file_id = H5Fopen((char *)file_name, H5F_ACC_RDONLY, H5P_DEFAULT)) < 0)
+      (* bag_handle)->file_id = bagFileOpenPaged (file_name, H5F_ACC_RDONLY, fapl_id, &(* bag_handle)->open_opts);
+      if ((* bag_handle)->file_id < 0)
         {
+           H5Pclose (fapl_id);
            return (BAG_HDF_FILE_OPEN_FAILURE);
         }
     }
+    H5Pclose (fapl_id);
+    if (options != NULL)
+        options->pageBufferUsed = (* bag_handle)->open_opts.pageBufferUsed;
     
     /*! init all the HDF structs to -1 */
     (* bag_handle)->unc_memspace_id  = 
@@ -750,6 +1006,8 @@ bagError bagFileOpen(bagHandle *bag_handle, s32 access_mode, const u8 *file_name
     (* bag_handle)->mta_cparms_id    = 
     (* bag_handle)->elv_datatype_id  = -1;
 
+    bagInitMemspaceCache (* bag_handle);
+
     for (i=0; i < BAG_OPT_SURFACE_LIMIT; i++)
     {
         (* bag_handle)->opt_memspace_id[i]  = 
@@ -785,7 +1043,7 @@ bagError bagFileOpen(bagHandle *bag_handle, s32 access_mode, const u8 *file_name
 
     /*!  Open the Elevation dataset and then the supporting HDF structures */
 
-    (* bag_handle)->elv_dataset_id = H5Dopen((* bag_handle)->file_id, ELEVATION_PATH);
+    (* bag_handle)->elv_dataset_id = bagOpenDataset((* bag_handle), ELEVATION_PATH, Elevation);
     if ((* bag_handle)->elv_dataset_id < 0)
             return BAG_HDF_DATASET_OPEN_FAILURE; 
     if ((status = bagReadAttribute ((* bag_handle), (* bag_handle)->elv_dataset_id, (u8 *)MIN_ELEVATION_NAME, &(* bag_handle)->bag.min_elevation)) != BAG_SUCCESS)
@@ -811,7 +1069,7 @@ bagError bagFileOpen(bagHandle *bag_handle, s32 access_mode, const u8 *file_name
 
     /*!  Open the Uncertainty dataset and then the supporting HDF structures */
 
-    (* bag_handle)->unc_dataset_id = H5Dopen((* bag_handle)->file_id, UNCERTAINTY_PATH);
+    (* bag_handle)->unc_dataset_id = bagOpenDataset((* bag_handle), UNCERTAINTY_PATH, Uncertainty);
     if ((* bag_handle)->unc_dataset_id < 0)
             return BAG_HDF_DATASET_OPEN_FAILURE; 
     if ((status = bagReadAttribute ((* bag_handle), (* bag_handle)->unc_dataset_id, (u8 *)MIN_UNCERTAINTY_NAME, &(* bag_handle)->bag.min_uncertainty)) != BAG_SUCCESS)
@@ -836,7 +1094,9 @@ bagError bagFileOpen(bagHandle *bag_handle, s32 access_mode, const u8 *file_name
 
     (* bag_handle)->bag.compressionLevel = 0;
     (*bag_handle)->bag.chunkSize = 0;
-    /*! Obtain the compression level and chunk size from the dataset property list if set */
+    (*bag_handle)->bag.sparse = 0;
+    memset (&(*bag_handle)->bag.filter, 0, sizeof (bagFilterSpec));
+    /*! Obtain the compression level, filters and chunk size from the dataset property list if set */
     if ((plist_id = H5Dget_create_plist((* bag_handle)->unc_dataset_id)) >= 0)
     {
         s32 nfilt = H5Pget_nfilters(plist_id);
@@ -847,13 +1107,35 @@ bagError bagFileOpen(bagHandle *bag_handle, s32 access_mode, const u8 *file_name
             u32  cd_values[10];
             char name[64];
 
-            if (H5Z_FILTER_DEFLATE == H5Pget_filter(plist_id, i, &flags, &cd_nelmts, cd_values, name_len, name ))
+            switch (H5Pget_filter(plist_id, i, &flags, &cd_nelmts, cd_values, name_len, name ))
             {
+            case H5Z_FILTER_DEFLATE:
                 if (cd_nelmts >= 1)
                 {
                     (* bag_handle)->bag.compressionLevel = cd_values[0];
                 }
                 break;
+            case BAG_FILTER_ZSTD:
+                (* bag_handle)->bag.filter.codec = BAG_CODEC_ZSTD;
+                if (cd_nelmts >= 1)
+                {
+                    (* bag_handle)->bag.compressionLevel = cd_values[0];
+                }
+                break;
+            case BAG_FILTER_LZ4:
+                (* bag_handle)->bag.filter.codec = BAG_CODEC_LZ4;
+                break;
+            case H5Z_FILTER_SHUFFLE:
+                (* bag_handle)->bag.filter.shuffle = 1;
+                break;
+            case H5Z_FILTER_SCALEOFFSET:
+                if (cd_nelmts >= 2 && cd_values[0] == H5Z_SO_FLOAT_DSCALE)
+                {
+                    (* bag_handle)->bag.filter.scaleOffsetDigits = cd_values[1];
+                }
+                break;
+            default:
+                break;
             }
         }
         
@@ -863,6 +1145,12 @@ bagError bagFileOpen(bagHandle *bag_handle, s32 access_mode, const u8 *file_name
             {
                 (*bag_handle)->bag.chunkSize = (u32) chunk_size[0];
             }
+
+            /*! a sparse BAG is told apart by its fill time, see bagSetSurfaceFillTime */
+            if (H5Pget_fill_time(plist_id, &fill_time) >= 0 && fill_time == H5D_FILL_TIME_IFSET)
+            {
+                (*bag_handle)->bag.sparse = 1;
+            }
         }
 
         H5Pclose(plist_id);
@@ -929,6 +1217,11 @@ bagError bagFileOpen(bagHandle *bag_handle, s32 access_mode, const u8 *file_name
     (* bag_handle)->bag.def.nrows = (u32)max_dims[0];
     (* bag_handle)->bag.def.ncols = (u32)max_dims[1];
 
+    if ((status = bagOpenOverviews (* bag_handle)) != BAG_SUCCESS)
+        return status;
+    if ((status = bagOpenChunkIndex (* bag_handle)) != BAG_SUCCESS)
+        return status;
+
     if (access_mode != BAG_OPEN_CREATE)
     {
         /*!
@@ -951,6 +1244,18 @@ bagError bagFileOpen(bagHandle *bag_handle, s32 access_mode, const u8 *file_name
     return (BAG_SUCCESS);
 }
 
+bagError bagFileOpenEx(bagHandle *bag_handle, s32 access_mode, const u8 *file_name,
+                       bagOpenOptions *options)
+{
+    bagError err;
+
+    bagLockHDF ();
+    err = bagFileOpenExUnlocked (bag_handle, access_mode, file_name, options);
+    bagUnlockHDF ();
+
+    return err;
+}
+
 /********************************************************************/
 /*! \brief : bagFileClose
  *
@@ -965,7 +1270,7 @@ bagError bagFileOpen(bagHandle *bag_handle, s32 access_mode, const u8 *file_name
  *
  ********************************************************************/
 
-bagError bagFileClose (bagHandle bag_handle)
+static bagError bagFileCloseUnlocked (bagHandle bag_handle)
 {
     herr_t    status;
 
@@ -992,7 +1297,15 @@ bagError bagFileClose (bagHandle bag_handle)
         return(BAG_HDF_GROUP_CLOSE_FAILURE);
     }
 
+    bagUnmapAllSurfaces (bag_handle);
+    bagFreeChunkIndex (bag_handle);
+
     /*! close the \a HDF entities */
+    if ((status = bagFreeMemspaceCache (bag_handle)) != BAG_SUCCESS)
+    {
+        return status;
+    }
+
     if (bag_handle->trk_memspace_id >= 0)
     {
         status = H5Sclose (bag_handle->trk_memspace_id);
@@ -1102,6 +1415,17 @@ bagError bagFileClose (bagHandle bag_handle)
     return (BAG_SUCCESS);   
 }
 
+bagError bagFileClose (bagHandle bag_handle)
+{
+    bagError err;
+
+    bagLockHDF ();
+    err = bagFileCloseUnlocked (bag_handle);
+    bagUnlockHDF ();
+
+    return err;
+}
+
 /********************************************************************/
 /*! \brief : bagGetDataPointer
  *
@@ -1175,6 +1499,9 @@ bagError bagGetErrorString(bagError code, u8 **error)
     case BAG_INVALID_FUNCTION_ARGUMENT:
         strncpy (str, "Invalid function argument or illegal value passed to Bag", MAX_STR-1);
         break;
+    case BAG_THREAD_FAILURE:
+        strncpy (str, "Unable to set up a worker thread or its synchronization", MAX_STR-1);
+        break;
     case BAG_METADTA_NO_HOME:
         strncpy (str, "The BAG_HOME environment variable must be set to the configdata directory of the openns distribution", MAX_STR-1);
         break;
@@ -1343,6 +1670,18 @@ bagError bagGetErrorString(bagError code, u8 **error)
     case BAG_HDF_INVALID_COMPRESSION_LEVEL:
         strncpy (str, "HDF compression level not in acceptable range of 0 to 9", MAX_STR-1);
         break;
+    case BAG_HDF_DATASET_NOT_MAPPABLE:
+        strncpy (str, "HDF dataset storage or file access mode does not allow memory mapping", MAX_STR-1);
+        break;
+    case BAG_HDF_MMAP_FAILURE:
+        strncpy (str, "HDF dataset could not be memory mapped", MAX_STR-1);
+        break;
+    case BAG_HDF_CHUNK_DECODE_FAILURE:
+        strncpy (str, "HDF raw chunk could not be decoded", MAX_STR-1);
+        break;
+    case BAG_HDF_SORT_NEEDS_RECOVERY:
+        strncpy (str, "HDF tracking list was partly written back by a sort; sort it again to recover it", MAX_STR-1);
+        break;
     case BAG_CRYPTO_SIGNATURE_OK:
         strncpy (str, "Crypto Signature is OK", MAX_STR-1);
         break;
@@ -1364,6 +1703,9 @@ bagError bagGetErrorString(bagError code, u8 **error)
     case BAG_CRYPTO_INTERNAL_ERROR:
         strncpy (str, "Crypto Internal error was detected", MAX_STR-1);
         break;
+    case BAG_CRYPTO_SIGNATURE_DROPPED:
+        strncpy (str, "Crypto Signature of the source was not carried into the modified copy", MAX_STR-1);
+        break;
     case BAG_INVALID_ERROR_CODE:
     default:
         strncpy (str, "An undefined bagError code was encountered", MAX_STR-1);
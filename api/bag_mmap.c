@@ -0,0 +1,244 @@
+/*! \file bag_mmap.c
+ * \brief This module contains the memory-mapped read path for uncompressed surfaces.
+ ********************************************************************
+ *
+ * Module Name : bag_mmap.c
+ *
+ * Author/Date : ONSWG, October 2026
+ *
+ * Description :
+ *               A BAG created with compressionLevel 0 stores its surfaces
+ *               contiguously and unfiltered, so the raw f32 grid sits in the
+ *               file exactly as it would in memory.  For such layers the file
+ *               region can be mapped read-only and handed to the caller as a
+ *               const f32 view, backed by the OS page cache, instead of being
+ *               copied out through H5Dread.
+ *
+ * Restrictions/Limitations :
+ *               Only single valued f32 layers in native byte order, stored
+ *               contiguously without filters, whose storage has been
+ *               allocated, can be mapped.  The handle must have been opened
+ *               read-only, since HDF writes would not be coherent with
+ *               the mapping.  Views stay valid until bagUnmapSurface or
+ *               bagFileClose.
+ *
+ * Change Descriptions :
+ * who  when      what
+ * ---  ----      ----
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ ********************************************************************/
+
+#include "bag_private.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+/****************************************************************************************/
+/*! \brief bagMapRegion maps \a length bytes of the file from \a offset, read-only
+ *
+ *  The mapping starts at the enclosing page boundary; \a *base and \a *base_length
+ *  receive what has to be unmapped later, and the return value points at \a offset.
+ *
+ ****************************************************************************************/
+static const u8 *bagMapRegion (const char *file_name, haddr_t offset, size_t length,
+                               void **base, size_t *base_length)
+{
+    haddr_t  aligned;
+    size_t   page;
+    u8      *addr;
+
+#ifdef _WIN32
+    SYSTEM_INFO  info;
+    HANDLE       file, mapping;
+
+    GetSystemInfo (&info);
+    page = info.dwAllocationGranularity;
+    aligned = offset - (offset % page);
+
+    file = CreateFileA (file_name, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    mapping = CreateFileMappingA (file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL)
+    {
+        CloseHandle (file);
+        return NULL;
+    }
+
+    /*! the view keeps the file and mapping alive on its own */
+    addr = (u8 *) MapViewOfFile (mapping, FILE_MAP_READ, (DWORD) (aligned >> 32),
+                                 (DWORD) (aligned & 0xFFFFFFFF), (SIZE_T) (length + (offset - aligned)));
+    CloseHandle (mapping);
+    CloseHandle (file);
+    if (addr == NULL)
+        return NULL;
+#else
+    int      fd;
+
+    page = (size_t) sysconf (_SC_PAGESIZE);
+    aligned = offset - (offset % page);
+
+    if ((fd = open (file_name, O_RDONLY)) < 0)
+        return NULL;
+
+    /*! the mapping keeps the file referenced on its own */
+    addr = (u8 *) mmap (NULL, length + (size_t) (offset - aligned), PROT_READ, MAP_SHARED, fd, (off_t) aligned);
+    close (fd);
+    if (addr == (u8 *) MAP_FAILED)
+        return NULL;
+#endif
+
+    *base        = addr;
+    *base_length = length + (size_t) (offset - aligned);
+
+    return addr + (offset - aligned);
+}
+
+/****************************************************************************************/
+/*! \brief bagUnmapRegion releases a mapping made by \a bagMapRegion
+ *
+ ****************************************************************************************/
+static void bagUnmapRegion (void *base, size_t base_length)
+{
+#ifdef _WIN32
+    (void) base_length;
+    UnmapViewOfFile (base);
+#else
+    munmap (base, base_length);
+#endif
+}
+
+/****************************************************************************************/
+/*! \brief bagMapSurface maps an uncompressed surface of a read-only BAG into memory
+ *
+ *  The view is row major, \a *row_stride f32 values per row, and is shared by every
+ *  caller of this function for the same layer until it is unmapped.
+ *
+ *  \param  hnd          External reference to the private \a bagHandle object
+ *  \param  type         Indicates which data surface type to access, element of \a BAG_SURFACE_PARAMS
+ *  \param **data        Receives the read-only view of the whole surface
+ *  \param *row_stride   Receives the distance between rows of \a **data, in values
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li When the layer's storage or the handle's access mode does not allow
+ *                mapping, \a BAG_HDF_DATASET_NOT_MAPPABLE, so callers can fall back
+ *                to \a bagReadRegionInto.
+ *            \li On other failures, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ********************************************************************/
+static bagError bagMapSurfaceUnlocked (bagHandle hnd, s32 type, const f32 **data, u32 *row_stride)
+{
+    bagError    err;
+    u32         srow, scol;
+    unsigned    intent;
+    size_t      length;
+    haddr_t     offset;
+    hid_t       dataset_id, datatype_id, filespace_id, plist_id;
+    Bool        mappable;
+    const u8   *view;
+
+    if (hnd == NULL)
+        return BAG_INVALID_BAG_HANDLE;
+    if (data == NULL || row_stride == NULL)
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+
+    if ((err = bagGetSurfaceIds (hnd, type, &dataset_id, &datatype_id, &filespace_id, &srow, &scol)) != BAG_SUCCESS)
+        return err;
+
+    if (hnd->map_base[type] == NULL)
+    {
+        /*! writes through HDF would not be seen coherently through the mapping */
+        if (H5Fget_intent (hnd->file_id, &intent) < 0)
+            return BAG_HDF_INTERNAL_ERROR;
+        if (intent & H5F_ACC_RDWR)
+            return BAG_HDF_DATASET_NOT_MAPPABLE;
+
+        if (H5Tget_class (datatype_id) != H5T_FLOAT ||
+            H5Tget_size (datatype_id) != sizeof (f32) ||
+            H5Tget_order (datatype_id) != H5Tget_order (H5T_NATIVE_FLOAT))
+            return BAG_HDF_DATASET_NOT_MAPPABLE;
+
+        if ((plist_id = H5Dget_create_plist (dataset_id)) < 0)
+            return BAG_HDF_CREATE_PROPERTY_CLASS_FAILURE;
+        mappable = (H5Pget_layout (plist_id) == H5D_CONTIGUOUS && H5Pget_nfilters (plist_id) == 0) ? True : False;
+        H5Pclose (plist_id);
+
+        length = (size_t) srow * (size_t) scol * sizeof (f32);
+        offset = H5Dget_offset (dataset_id);
+        if (!mappable || offset == HADDR_UNDEF || H5Dget_storage_size (dataset_id) < length)
+            return BAG_HDF_DATASET_NOT_MAPPABLE;
+
+        view = bagMapRegion ((char *) hnd->filename, offset, length,
+                             &hnd->map_base[type], &hnd->map_length[type]);
+        if (view == NULL)
+            return BAG_HDF_MMAP_FAILURE;
+        hnd->map_view[type] = (const f32 *) view;
+    }
+
+    *data       = hnd->map_view[type];
+    *row_stride = scol;
+
+    return BAG_SUCCESS;
+}
+
+bagError bagMapSurface (bagHandle hnd, s32 type, const f32 **data, u32 *row_stride)
+{
+    bagError err;
+
+    bagLockHDF ();
+    err = bagMapSurfaceUnlocked (hnd, type, data, row_stride);
+    bagUnlockHDF ();
+
+    return err;
+}
+
+/****************************************************************************************/
+/*! \brief bagUnmapSurface releases the view made by \a bagMapSurface for one layer
+ *
+ *  \param  hnd    External reference to the private \a bagHandle object
+ *  \param  type   Indicates which data surface type to access, element of \a BAG_SURFACE_PARAMS
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ********************************************************************/
+bagError bagUnmapSurface (bagHandle hnd, s32 type)
+{
+    if (hnd == NULL)
+        return BAG_INVALID_BAG_HANDLE;
+    if (type < 0 || type >= BAG_OPT_SURFACE_LIMIT)
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+
+    if (hnd->map_base[type] != NULL)
+    {
+        bagUnmapRegion (hnd->map_base[type], hnd->map_length[type]);
+        hnd->map_base[type]   = NULL;
+        hnd->map_length[type] = 0;
+        hnd->map_view[type]   = NULL;
+    }
+
+    return BAG_SUCCESS;
+}
+
+/****************************************************************************************/
+/*! \brief bagUnmapAllSurfaces releases every view still mapped on the handle
+ *
+ ****************************************************************************************/
+void bagUnmapAllSurfaces (bagHandle hnd)
+{
+    s32 i;
+
+    for (i = 0; i < BAG_OPT_SURFACE_LIMIT; i++)
+        bagUnmapSurface (hnd, i);
+}
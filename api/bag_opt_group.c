@@ -201,7 +201,10 @@ bagError bagCreateVarResTrackingList(bagHandle hnd, bagData *data)
         status = H5Fclose(hnd->file_id);
         return BAG_HDF_CREATE_PROPERTY_CLASS_FAILURE;
     }
-    chunk_dims[0] = VARRES_TRACKING_LIST_BLOCK_SIZE;
+    if ((status = bagPlanChunks(1, dim_init, sizeof(bagVarResTrackingItem), BAG_ACCESS_ROWS, data->chunkBytes, chunk_dims)) != BAG_SUCCESS) {
+        H5Fclose(hnd->file_id);
+        return status;
+    }
     if ((status = H5Pset_chunk(cparams, 1, chunk_dims)) < 0) {
         status = H5Fclose(hnd->file_id);
         return BAG_HDF_SET_PROPERTY_FAILURE;
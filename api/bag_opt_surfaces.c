@@ -96,20 +96,6 @@ static void InitVarResNodeGroup(bagVarResNodeGroup *g)
         return BAG_HDF_CREATE_ATTRIBUTE_FAILURE;\
     }
 
-hsize_t estimate_chunk_size(hsize_t const dimension_size)
-{
-    hsize_t rc;
-    
-    if (dimension_size > 100) {
-        rc = 100;
-    } else if (dimension_size > 10) {
-        rc = 10;
-    } else {
-        rc = 0;
-    }
-    return rc;
-}
-
 /****************************************************************************************/
 /*! \brief bagCreateOptionalDataset creates a dataset for an optional bag surface
  *
@@ -133,6 +119,7 @@ bagError bagCreateOptionalDataset (bagHandle bag_hnd, bagData *data, s32 type)
     hid_t        plist_id;
 	herr_t		 status;
     u8           typer;
+    bagData      layout;
 
 	f32                             null = BAG_NULL_ELEVATION;
     bagVerticalCorrector            nullVdat;
@@ -158,35 +145,6 @@ bagError bagCreateOptionalDataset (bagHandle bag_hnd, bagData *data, s32 type)
     bag_hnd->bag.opt[type].nrows = (u32)dims[0];
     bag_hnd->bag.opt[type].ncols = (u32)dims[1];
 
-    /* We need to handle chunk sizes a little more carefully for optional datasets, because they can be
-     * of different size/shape than the standard arrays used in the mandatory layers.  Because we only have
-     * a single chunkSize, therefore, it can be inappropriate for the layer being created.  Therefore, we
-     * use the chunkSize if it's supportable by the layer dimensions, but otherwise reset the internals to
-     * something more appropriate.
-     */
-    if (data->chunkSize > 0)
-    {
-        if (data->chunkSize >= dims[0] || data->chunkSize >= dims[1]) {
-            /* We need to re-estimate the local chunk size for this layer */
-            chunk_size[0] = estimate_chunk_size(dims[0]);
-            chunk_size[1] = estimate_chunk_size(dims[1]);
-            /* Check that there is compression to be done, so that chunk sizes are important */
-            if (chunk_size[0] == 0 || chunk_size[1] == 0)
-                data->compressionLevel = 0;
-        } else {
-            chunk_size[0] = chunk_size[1] = data->chunkSize;
-        }
-    }
-    else
-    {
-        /* We need to re-estimate the local chunk size for this layer */
-        chunk_size[0] = estimate_chunk_size(dims[0]);
-        chunk_size[1] = estimate_chunk_size(dims[1]);
-        /* Check that there is compression to be done, so that chunk sizes are important */
-        if (chunk_size[0] == 0 || chunk_size[1] == 0)
-            data->compressionLevel = 0;
-    }
-
     if ((dataspace_id = H5Screate_simple(RANK, dims, NULL)) < 0)
     {
         status = H5Fclose (file_id);
@@ -214,26 +172,30 @@ bagError bagCreateOptionalDataset (bagHandle bag_hnd, bagData *data, s32 type)
         return (BAG_HDF_CREATE_PROPERTY_CLASS_FAILURE);
     }
 
-    if (data->compressionLevel > 0 && data->compressionLevel <= 9)
+    /* Optional layers can be of a different size and shape than the mandatory layers, such as
+     * the 1 x n variable resolution refinements, so the chunk shape is planned for this layer
+     * and its own value size; the global chunkSize is only used where the layer can hold it.
+     */
+    if ((status = bagPlanSurfaceChunks (data, dims, H5Tget_size (datatype_id), chunk_size)) != BAG_SUCCESS)
     {
-        status = H5Pset_layout (plist_id, H5D_CHUNKED);
-        status = H5Pset_chunk(plist_id, RANK, chunk_size);
-        
-        if ((status = H5Pset_deflate (plist_id, data->compressionLevel)) < 0)
-        {
-            status = H5Fclose (file_id);
-            return (BAG_HDF_SET_PROPERTY_FAILURE);
-        }
+        H5Fclose (file_id);
+        return status;
     }
-    else if (data->compressionLevel) /* if anything other than zero */
+
+    /*! optional layers are allocated as the BAG they are added to was created */
+    layout        = *data;
+    layout.sparse = bag_hnd->bag.sparse;
+
+    if ((status = bagSetSurfaceFilters (plist_id, &layout, datatype_id, chunk_size)) != BAG_SUCCESS)
     {
-        return (BAG_HDF_INVALID_COMPRESSION_LEVEL);
+        H5Fclose (file_id);
+        return status;
     }
 
     switch (type)
 	{
 		case Nominal_Elevation:
-            status = H5Pset_fill_time  (plist_id, H5D_FILL_TIME_ALLOC);
+            status = bagSetSurfaceFillTime (plist_id, bag_hnd->bag.sparse ? True : False);
             status = H5Pset_fill_value (plist_id, datatype_id, &null);
             check_hdf_status();
 
@@ -248,7 +210,7 @@ bagError bagCreateOptionalDataset (bagHandle bag_hnd, bagData *data, s32 type)
 		
 		case Surface_Correction:
             typer = bag_hnd->bag.def.surfaceCorrectionTopography;
-            status = H5Pset_fill_time  (plist_id, H5D_FILL_TIME_ALLOC);
+            status = bagSetSurfaceFillTime (plist_id, bag_hnd->bag.sparse ? True : False);
             if (BAG_SURFACE_GRID_EXTENTS == typer) {
                 memset (&nullVdatNode, 0, sizeof (bagVerticalCorrectorNode));
                 status = H5Pset_fill_value (plist_id, datatype_id, &nullVdatNode);
@@ -285,7 +247,7 @@ bagError bagCreateOptionalDataset (bagHandle bag_hnd, bagData *data, s32 type)
             nullNodeGroup.hyp_strength   = BAG_NULL_GENERIC;
 			nullNodeGroup.num_hypotheses = (u32) BAG_NULL_GENERIC;
 
-            status = H5Pset_fill_time  (plist_id, H5D_FILL_TIME_ALLOC);
+            status = bagSetSurfaceFillTime (plist_id, bag_hnd->bag.sparse ? True : False);
             status = H5Pset_fill_value (plist_id, datatype_id, &nullNodeGroup);
             check_hdf_status();
 
@@ -306,7 +268,7 @@ bagError bagCreateOptionalDataset (bagHandle bag_hnd, bagData *data, s32 type)
             nullElevationSolutionGroup.stddev        = BAG_NULL_GENERIC;
             nullElevationSolutionGroup.num_soundings = (u32) BAG_NULL_GENERIC;
 
-            status = H5Pset_fill_time  (plist_id, H5D_FILL_TIME_ALLOC);
+            status = bagSetSurfaceFillTime (plist_id, bag_hnd->bag.sparse ? True : False);
             status = H5Pset_fill_value (plist_id, datatype_id, &nullElevationSolutionGroup);
             check_hdf_status();
 
@@ -325,7 +287,7 @@ bagError bagCreateOptionalDataset (bagHandle bag_hnd, bagData *data, s32 type)
             
         case VarRes_Metadata_Group:
             InitVarResMetadataGroup(&nullVarResMetadataGroup);
-            status = H5Pset_fill_time(plist_id, H5D_FILL_TIME_ALLOC);
+            status = bagSetSurfaceFillTime (plist_id, bag_hnd->bag.sparse ? True : False);
             status = H5Pset_fill_value(plist_id, datatype_id, &nullVarResMetadataGroup);
             check_hdf_status();
             
@@ -345,7 +307,7 @@ bagError bagCreateOptionalDataset (bagHandle bag_hnd, bagData *data, s32 type)
             
         case VarRes_Refinement_Group:
             InitVarResRefinementGroup(&nullVarResRefinementGroup);
-            status = H5Pset_fill_time(plist_id, H5D_FILL_TIME_ALLOC);
+            status = bagSetSurfaceFillTime (plist_id, bag_hnd->bag.sparse ? True : False);
             status = H5Pset_fill_value(plist_id, datatype_id, (void*)&nullVarResRefinementGroup);
             check_hdf_status();
             
@@ -361,7 +323,7 @@ bagError bagCreateOptionalDataset (bagHandle bag_hnd, bagData *data, s32 type)
             
         case VarRes_Node_Group:
             InitVarResNodeGroup(&nullVarResNodeGroup);
-            status = H5Pset_fill_time(plist_id, H5D_FILL_TIME_ALLOC);
+            status = bagSetSurfaceFillTime (plist_id, bag_hnd->bag.sparse ? True : False);
             status = H5Pset_fill_value(plist_id, datatype_id, (void*)&nullVarResNodeGroup);
             if ((dataset_id = H5Dcreate(file_id, VARRES_NODE_GROUP_PATH, datatype_id, dataspace_id, plist_id)) < 0) {
                 status = H5Fclose(file_id);
@@ -621,8 +583,11 @@ bagError bagReadOptSurfaceDims (bagHandle hnd, s32 type)
         rank = H5Sget_simple_extent_ndims(dataspace_id);
         rank = H5Sget_simple_extent_dims(dataspace_id, max_dims, NULL);
 
+        /*! the variable resolution tracking list is a 1-D list of items */
+        if (type == VarRes_Tracking_List && rank == 1)
+            max_dims[1] = 1;
         /*! seems like a reasonable requirement for BAG compatibility now? */
-        if (rank != RANK)
+        else if (rank != RANK)
         {
             fprintf(stderr, "Error - The BAG is corrupted.  The rank of this dataset is said to be = %d, when it should be = %d. \n",
                     rank, RANK);
@@ -657,7 +622,7 @@ bagError bagReadOptSurfaceDims (bagHandle hnd, s32 type)
  *         \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS
  *
  ********************************************************************/
-bagError bagGetOptDatasetInfo(bagHandle *bag_handle_opt, s32 type)
+static bagError bagGetOptDatasetInfoUnlocked (bagHandle *bag_handle_opt, s32 type)
 {
     bagError     status;
     
@@ -670,7 +635,7 @@ bagError bagGetOptDatasetInfo(bagHandle *bag_handle_opt, s32 type)
         case Nominal_Elevation:
             /*!  Open the Nominal Elevation dataset and then the supporting HDF structures */
             
-            (* bag_handle_opt)->opt_dataset_id[type] = H5Dopen((* bag_handle_opt)->file_id, NOMINAL_ELEVATION_PATH);
+            (*bag_handle_opt)->opt_dataset_id[type] = bagOpenDataset(*bag_handle_opt, NOMINAL_ELEVATION_PATH, type);
             if ((* bag_handle_opt)->opt_dataset_id[type] < 0)
                 return BAG_HDF_DATASET_OPEN_FAILURE;
             if ((status = bagReadAttribute ((bagHandle)(* bag_handle_opt), (*bag_handle_opt)->opt_dataset_id[type], (u8 *)"min_value", &(* bag_handle_opt)->bag.opt[type].min)) != BAG_SUCCESS)
@@ -705,7 +670,7 @@ bagError bagGetOptDatasetInfo(bagHandle *bag_handle_opt, s32 type)
         case Surface_Correction:
             /*!  Open the SEP dataset and then the supporting HDF structures */
             
-            (*bag_handle_opt)->opt_dataset_id[type] = H5Dopen((* bag_handle_opt)->file_id, VERT_DATUM_CORR_PATH);
+            (*bag_handle_opt)->opt_dataset_id[type] = bagOpenDataset(*bag_handle_opt, VERT_DATUM_CORR_PATH, type);
             if ((*bag_handle_opt)->opt_dataset_id[type] < 0)
                 return BAG_HDF_DATASET_OPEN_FAILURE;
             if ((status = bagReadAttribute ((bagHandle)(* bag_handle_opt), (*bag_handle_opt)->opt_dataset_id[type], (u8 *)"surface_type", &(* bag_handle_opt)->bag.def.surfaceCorrectionTopography)) != BAG_SUCCESS)
@@ -736,7 +701,7 @@ bagError bagGetOptDatasetInfo(bagHandle *bag_handle_opt, s32 type)
         case Elevation_Solution_Group:
             /*!  Open the Elevation Solution dataset and then the supporting HDF structures */
             
-            (*bag_handle_opt)->opt_dataset_id[type] = H5Dopen((* bag_handle_opt)->file_id, ELEVATION_SOLUTION_GROUP_PATH);
+            (*bag_handle_opt)->opt_dataset_id[type] = bagOpenDataset(*bag_handle_opt, ELEVATION_SOLUTION_GROUP_PATH, type);
             if ((*bag_handle_opt)->opt_dataset_id[type] < 0)
                 return BAG_HDF_DATASET_OPEN_FAILURE;
             
@@ -762,7 +727,7 @@ bagError bagGetOptDatasetInfo(bagHandle *bag_handle_opt, s32 type)
         case Node_Group:
             /*!  Open the NODE GROUP dataset and then the supporting HDF structures */
             
-            (*bag_handle_opt)->opt_dataset_id[type] = H5Dopen((* bag_handle_opt)->file_id, NODE_GROUP_PATH);
+            (*bag_handle_opt)->opt_dataset_id[type] = bagOpenDataset(*bag_handle_opt, NODE_GROUP_PATH, type);
             if ((*bag_handle_opt)->opt_dataset_id[type] < 0)
                 return BAG_HDF_DATASET_OPEN_FAILURE;
             
@@ -788,7 +753,7 @@ bagError bagGetOptDatasetInfo(bagHandle *bag_handle_opt, s32 type)
         case Num_Hypotheses:
             /*!  Open the number of hypotheses dataset and then the supporting HDF structures */
             
-            (*bag_handle_opt)->opt_dataset_id[type] = H5Dopen((* bag_handle_opt)->file_id, NUM_HYPOTHESES_PATH);
+            (*bag_handle_opt)->opt_dataset_id[type] = bagOpenDataset(*bag_handle_opt, NUM_HYPOTHESES_PATH, type);
             if ((*bag_handle_opt)->opt_dataset_id[type] < 0)
                 return BAG_HDF_DATASET_OPEN_FAILURE;
             if ((status = bagReadAttribute ((bagHandle)(* bag_handle_opt), (*bag_handle_opt)->opt_dataset_id[type], (u8 *)"min_value", &(* bag_handle_opt)->bag.opt[type].min)) != BAG_SUCCESS)
@@ -822,7 +787,7 @@ bagError bagGetOptDatasetInfo(bagHandle *bag_handle_opt, s32 type)
         case Average:
             /*!  Open the number of hypotheses dataset and then the supporting HDF structures */
             
-            (*bag_handle_opt)->opt_dataset_id[type] = H5Dopen((* bag_handle_opt)->file_id, AVERAGE_PATH);
+            (*bag_handle_opt)->opt_dataset_id[type] = bagOpenDataset(*bag_handle_opt, AVERAGE_PATH, type);
             if ((*bag_handle_opt)->opt_dataset_id[type] < 0)
                 return BAG_HDF_DATASET_OPEN_FAILURE;
             if ((status = bagReadAttribute ((bagHandle)(* bag_handle_opt), (*bag_handle_opt)->opt_dataset_id[type], (u8 *)"min_value", &(* bag_handle_opt)->bag.opt[type].min)) != BAG_SUCCESS)
@@ -855,7 +820,7 @@ bagError bagGetOptDatasetInfo(bagHandle *bag_handle_opt, s32 type)
         case Standard_Dev: 
             /*!  Open the number of hypotheses dataset and then the supporting HDF structures */
             
-            (*bag_handle_opt)->opt_dataset_id[type] = H5Dopen((* bag_handle_opt)->file_id, STANDARD_DEV_PATH);
+            (*bag_handle_opt)->opt_dataset_id[type] = bagOpenDataset(*bag_handle_opt, STANDARD_DEV_PATH, type);
             if ((*bag_handle_opt)->opt_dataset_id[type] < 0)
                 return BAG_HDF_DATASET_OPEN_FAILURE; 
             if ((status = bagReadAttribute ((bagHandle)(* bag_handle_opt), (*bag_handle_opt)->opt_dataset_id[type],
@@ -888,7 +853,7 @@ bagError bagGetOptDatasetInfo(bagHandle *bag_handle_opt, s32 type)
             break;
             
         case VarRes_Metadata_Group:
-            (*bag_handle_opt)->opt_dataset_id[type] = H5Dopen((*bag_handle_opt)->file_id, VARRES_METADATA_GROUP_PATH);
+            (*bag_handle_opt)->opt_dataset_id[type] = bagOpenDataset(*bag_handle_opt, VARRES_METADATA_GROUP_PATH, type);
             if ((*bag_handle_opt)->opt_dataset_id[type] < 0)
                 return BAG_HDF_DATASET_OPEN_FAILURE;
             if (((*bag_handle_opt)->opt_datatype_id[type] = H5Dget_type((*bag_handle_opt)->opt_dataset_id[type])) < 0)
@@ -900,7 +865,7 @@ bagError bagGetOptDatasetInfo(bagHandle *bag_handle_opt, s32 type)
             break;
             
         case VarRes_Refinement_Group:
-            (*bag_handle_opt)->opt_dataset_id[type] = H5Dopen((*bag_handle_opt)->file_id, VARRES_REFINEMENT_GROUP_PATH);
+            (*bag_handle_opt)->opt_dataset_id[type] = bagOpenDataset(*bag_handle_opt, VARRES_REFINEMENT_GROUP_PATH, type);
             if ((*bag_handle_opt)->opt_dataset_id[type] < 0)
                 return BAG_HDF_DATASET_OPEN_FAILURE;
             if (((*bag_handle_opt)->opt_datatype_id[type] = H5Dget_type((*bag_handle_opt)->opt_dataset_id[type])) < 0)
@@ -912,7 +877,7 @@ bagError bagGetOptDatasetInfo(bagHandle *bag_handle_opt, s32 type)
             break;
             
         case VarRes_Node_Group:
-            (*bag_handle_opt)->opt_dataset_id[type] = H5Dopen((*bag_handle_opt)->file_id, VARRES_NODE_GROUP_PATH);
+            (*bag_handle_opt)->opt_dataset_id[type] = bagOpenDataset(*bag_handle_opt, VARRES_NODE_GROUP_PATH, type);
             if ((*bag_handle_opt)->opt_dataset_id[type] < 0)
                 return BAG_HDF_DATASET_OPEN_FAILURE;
             if (((*bag_handle_opt)->opt_datatype_id[type] = H5Dget_type((*bag_handle_opt)->opt_dataset_id[type])) < 0)
@@ -924,7 +889,7 @@ bagError bagGetOptDatasetInfo(bagHandle *bag_handle_opt, s32 type)
             break;
             
         case VarRes_Tracking_List:
-            (*bag_handle_opt)->opt_dataset_id[type] = H5Dopen((*bag_handle_opt)->file_id, VARRES_TRACKING_LIST_PATH);
+            (*bag_handle_opt)->opt_dataset_id[type] = bagOpenDataset(*bag_handle_opt, VARRES_TRACKING_LIST_PATH, type);
             if ((*bag_handle_opt)->opt_dataset_id[type] < 0)
                 return BAG_HDF_DATASET_OPEN_FAILURE;
             if (((*bag_handle_opt)->opt_datatype_id[type] = H5Dget_type((*bag_handle_opt)->opt_dataset_id[type])) < 0)
@@ -944,6 +909,17 @@ bagError bagGetOptDatasetInfo(bagHandle *bag_handle_opt, s32 type)
     return (BAG_SUCCESS);
 }
 
+bagError bagGetOptDatasetInfo(bagHandle *bag_handle_opt, s32 type)
+{
+    bagError err;
+
+    bagLockHDF ();
+    err = bagGetOptDatasetInfoUnlocked (bag_handle_opt, type);
+    bagUnlockHDF ();
+
+    return err;
+}
+
 static bagError ProcessVarResMetadataMinMax(bagHandle hnd, hid_t dataset_id)
 {
     bagVarResMetadataGroup minGroup, maxGroup, *d;
@@ -1030,8 +1006,9 @@ static bagError ProcessVarResMetadataMinMax(bagHandle hnd, hid_t dataset_id)
 static bagError ProcessVarResRefinementMinMax(bagHandle hnd, hid_t dataset_id)
 {
     bagVarResRefinementGroup minGroup, maxGroup, *d;
+    bagReduction depth, uncrt;
     u32 n_windows, start_col, end_col;
-    u32 window, col;
+    u32 window;
     herr_t status;
     
     /* We can't read the whole row at once, because it could be enormous; instead we compute how
@@ -1044,6 +1021,9 @@ static bagError ProcessVarResRefinementMinMax(bagHandle hnd, hid_t dataset_id)
     maxGroup.depth = -FLT_MAX;
     maxGroup.depth_uncrt = -1.0f;
     
+    bagReduceInit(&depth);
+    bagReduceInit(&uncrt);
+    
     d = (bagVarResRefinementGroup*)calloc(window_size, sizeof(bagVarResRefinementGroup));
     if (d == NULL) return BAG_MEMORY_ALLOCATION_FAILED;
     
@@ -1054,19 +1034,22 @@ static bagError ProcessVarResRefinementMinMax(bagHandle hnd, hid_t dataset_id)
         if (end_col > hnd->bag.opt[VarRes_Refinement_Group].ncols-1)
             end_col = hnd->bag.opt[VarRes_Refinement_Group].ncols-1;
         bagReadRow(hnd, 0, start_col, end_col, VarRes_Refinement_Group, (void*)d);
-        for (col = 0; col < end_col - start_col + 1; ++col) {
-            if (d[col].depth != BAG_NULL_ELEVATION) {
-                minGroup.depth = (d[col].depth < minGroup.depth) ? d[col].depth : minGroup.depth;
-                maxGroup.depth = (d[col].depth > maxGroup.depth) ? d[col].depth : maxGroup.depth;
-            }
-            if (d[col].depth_uncrt != BAG_NULL_UNCERTAINTY) {
-                minGroup.depth_uncrt = (d[col].depth_uncrt < minGroup.depth_uncrt) ? d[col].depth_uncrt : minGroup.depth_uncrt;
-                maxGroup.depth_uncrt = (d[col].depth_uncrt > maxGroup.depth_uncrt) ? d[col].depth_uncrt : maxGroup.depth_uncrt;
-            }
-        }
+        bagReduceF32(&depth, &d[0].depth, end_col - start_col + 1,
+                     sizeof(bagVarResRefinementGroup)/sizeof(f32), BAG_NULL_ELEVATION);
+        bagReduceF32(&uncrt, &d[0].depth_uncrt, end_col - start_col + 1,
+                     sizeof(bagVarResRefinementGroup)/sizeof(f32), BAG_NULL_UNCERTAINTY);
     }
     free(d);
     
+    if (depth.count > 0) {
+        minGroup.depth = depth.min;
+        maxGroup.depth = depth.max;
+    }
+    if (uncrt.count > 0) {
+        minGroup.depth_uncrt = uncrt.min;
+        maxGroup.depth_uncrt = uncrt.max;
+    }
+    
     if (minGroup.depth < FLT_MAX) {
         status = bagWriteAttribute(hnd, dataset_id, (u8*)"min_depth", &minGroup.depth);
         check_hdf_status();
@@ -1090,6 +1073,7 @@ static bagError ProcessVarResRefinementMinMax(bagHandle hnd, hid_t dataset_id)
 static bagError ProcessVarResNodeMinMax(bagHandle hnd, hid_t dataset_id)
 {
     bagVarResNodeGroup minGroup, maxGroup, *d;
+    bagReduction strength;
     u32 n_windows, start_col, end_col;
     u32 window, col;
     herr_t status;
@@ -1106,6 +1090,8 @@ static bagError ProcessVarResNodeMinMax(bagHandle hnd, hid_t dataset_id)
     maxGroup.n_samples = 0;
     maxGroup.num_hypotheses = 0;
     
+    bagReduceInit(&strength);
+    
     d = (bagVarResNodeGroup*)calloc(window_size, sizeof(bagVarResNodeGroup));
     if (d == NULL) return BAG_MEMORY_ALLOCATION_FAILED;
     
@@ -1116,11 +1102,9 @@ static bagError ProcessVarResNodeMinMax(bagHandle hnd, hid_t dataset_id)
         if (end_col > hnd->bag.opt[VarRes_Node_Group].ncols-1)
             end_col = hnd->bag.opt[VarRes_Node_Group].ncols-1;
         bagReadRow(hnd, 0, start_col, end_col, VarRes_Node_Group, (void*)d);
+        bagReduceF32(&strength, &d[0].hyp_strength, end_col - start_col + 1,
+                     sizeof(bagVarResNodeGroup)/sizeof(f32), BAG_NULL_GENERIC);
         for (col = 0; col < end_col - start_col + 1; ++col) {
-            if (d[col].hyp_strength != BAG_NULL_GENERIC) {
-                minGroup.hyp_strength = (d[col].hyp_strength < minGroup.hyp_strength) ? d[col].hyp_strength : minGroup.hyp_strength;
-                maxGroup.hyp_strength = (d[col].hyp_strength > maxGroup.hyp_strength) ? d[col].hyp_strength : maxGroup.hyp_strength;
-            }
             if (d[col].n_samples != 0) {
                 minGroup.n_samples = (d[col].n_samples < minGroup.n_samples) ? d[col].n_samples : minGroup.n_samples;
                 maxGroup.n_samples = (d[col].n_samples > maxGroup.n_samples) ? d[col].n_samples : maxGroup.n_samples;
@@ -1133,6 +1117,11 @@ static bagError ProcessVarResNodeMinMax(bagHandle hnd, hid_t dataset_id)
     }
     free(d);
     
+    if (strength.count > 0) {
+        minGroup.hyp_strength = strength.min;
+        maxGroup.hyp_strength = strength.max;
+    }
+    
     if (minGroup.hyp_strength < FLT_MAX) {
         status = bagWriteAttribute(hnd, dataset_id, (u8*)"min_hyp_strength", &minGroup.hyp_strength);
         check_hdf_status();
@@ -1181,6 +1170,7 @@ bagError bagUpdateOptMinMax (bagHandle hnd, u32 type)
     u8    *max_name, *min_name;
     hid_t  dataset_id;
     f32   *min_tmp, *max_tmp, **surface_array, *omax, *omin, null_val;
+    bagReduction r, r2;
     bagOptNodeGroup                 minNode,                maxNode,                *nodeSurf;
     bagOptElevationSolutionGroup    minElevationSolution,   maxElevationSolution,   *elevationSolutionSurf;
 
@@ -1211,23 +1201,15 @@ bagError bagUpdateOptMinMax (bagHandle hnd, u32 type)
 
         fprintf(stdout, "Computing mins and maxes for the Node Group Surface\n");
 
+        bagReduceInit (&r);
         for (i=0; i < hnd->bag.opt[type].nrows; i++)
         {
             bagReadRow (hnd, i, 0, hnd->bag.opt[type].ncols-1, type, (void *)nodeSurf);
-			
-            for (j=0; j < hnd->bag.opt[type].ncols-1; j++)
+
+            bagReduceF32 (&r, &nodeSurf[0].hyp_strength, hnd->bag.opt[type].ncols,
+                          sizeof (bagOptNodeGroup) / sizeof (f32), null_val);
+            for (j=0; j < hnd->bag.opt[type].ncols; j++)
             {
-                if (nodeSurf[j].hyp_strength != null_val)
-                {
-                    if (maxNode.hyp_strength == null_val)
-                        maxNode.hyp_strength = nodeSurf[j].hyp_strength;
-                    if (minNode.hyp_strength == null_val)
-                        minNode.hyp_strength = nodeSurf[j].hyp_strength;
-                    if (nodeSurf[j].hyp_strength > maxNode.hyp_strength)
-                        maxNode.hyp_strength = nodeSurf[j].hyp_strength;
-                    if (nodeSurf[j].hyp_strength < minNode.hyp_strength)
-                        minNode.hyp_strength = nodeSurf[j].hyp_strength;
-                }
                 if (nodeSurf[j].num_hypotheses != null_val)
                 {
                     if (maxNode.num_hypotheses == null_val)
@@ -1241,6 +1223,11 @@ bagError bagUpdateOptMinMax (bagHandle hnd, u32 type)
                 }
             }
         }
+        if (r.count > 0)
+        {
+            minNode.hyp_strength = r.min;
+            maxNode.hyp_strength = r.max;
+        }
     
         if (maxNode.hyp_strength != null_val)
         {
@@ -1280,23 +1267,18 @@ bagError bagUpdateOptMinMax (bagHandle hnd, u32 type)
         fprintf(stdout, "Computing mins and maxes for the Elevation Solution Group Surface\n");
 
 
+        bagReduceInit (&r);
+        bagReduceInit (&r2);
         for (i=0; i < hnd->bag.opt[type].nrows; i++)
         {
             bagReadRow (hnd, i, 0, hnd->bag.opt[type].ncols-1, type, (void *)elevationSolutionSurf);
-			
-            for (j=0; j < hnd->bag.opt[type].ncols-1; j++)
+
+            bagReduceF32 (&r, &elevationSolutionSurf[0].shoal_elevation, hnd->bag.opt[type].ncols,
+                          sizeof (bagOptElevationSolutionGroup) / sizeof (f32), null_val);
+            bagReduceF32 (&r2, &elevationSolutionSurf[0].stddev, hnd->bag.opt[type].ncols,
+                          sizeof (bagOptElevationSolutionGroup) / sizeof (f32), null_val);
+            for (j=0; j < hnd->bag.opt[type].ncols; j++)
             {
-                if (elevationSolutionSurf[j].shoal_elevation != null_val)
-                {
-                    if (maxElevationSolution.shoal_elevation == null_val)
-                        maxElevationSolution.shoal_elevation = elevationSolutionSurf[j].shoal_elevation;
-                    if (minElevationSolution.shoal_elevation == null_val)
-                        minElevationSolution.shoal_elevation = elevationSolutionSurf[j].shoal_elevation;
-                    if (elevationSolutionSurf[j].shoal_elevation > maxElevationSolution.shoal_elevation)
-                        maxElevationSolution.shoal_elevation = elevationSolutionSurf[j].shoal_elevation;
-                    if (elevationSolutionSurf[j].shoal_elevation < minElevationSolution.shoal_elevation)
-                        minElevationSolution.shoal_elevation = elevationSolutionSurf[j].shoal_elevation;
-                }
                 if (elevationSolutionSurf[j].num_soundings != null_val)
                 {
                     if (maxElevationSolution.num_soundings == null_val)
@@ -1308,19 +1290,18 @@ bagError bagUpdateOptMinMax (bagHandle hnd, u32 type)
                     if (elevationSolutionSurf[j].num_soundings < minElevationSolution.num_soundings)
                         minElevationSolution.num_soundings = elevationSolutionSurf[j].num_soundings;
                 }
-                if (elevationSolutionSurf[j].stddev != null_val)
-                {
-                    if (maxElevationSolution.stddev == null_val)
-                        maxElevationSolution.stddev = elevationSolutionSurf[j].stddev;
-                    if (minElevationSolution.stddev == null_val)
-                        minElevationSolution.stddev = elevationSolutionSurf[j].stddev;
-                    if (elevationSolutionSurf[j].stddev > maxElevationSolution.stddev)
-                        maxElevationSolution.stddev = elevationSolutionSurf[j].stddev;
-                    if (elevationSolutionSurf[j].stddev < minElevationSolution.stddev)
-                        minElevationSolution.stddev = elevationSolutionSurf[j].stddev;
-                }
             }
         }
+        if (r.count > 0)
+        {
+            minElevationSolution.shoal_elevation = r.min;
+            maxElevationSolution.shoal_elevation = r.max;
+        }
+        if (r2.count > 0)
+        {
+            minElevationSolution.stddev = r2.min;
+            maxElevationSolution.stddev = r2.max;
+        }
 
         if (maxElevationSolution.stddev != null_val)
         {
@@ -1395,24 +1376,16 @@ bagError bagUpdateOptMinMax (bagHandle hnd, u32 type)
         surface_array = &hnd->dataArray[type];
       
 
+        bagReduceInit (&r);
         for (i=0; i < hnd->bag.opt[type].nrows; i++)
         {
             bagReadRegion (hnd, i, 0, i, hnd->bag.opt[type].ncols-1, type);
-			
-            for (j=0; j < hnd->bag.opt[type].ncols-1; j++)
-            {
-                if ((* surface_array)[j] != null_val)
-                {
-                    if (*max_tmp == null_val)
-                        *max_tmp = (* surface_array)[j];
-                    if (*min_tmp == null_val)
-                        *min_tmp = (* surface_array)[j];
-                    if ((* surface_array)[j] > *max_tmp)
-                        *max_tmp = (* surface_array)[j];
-                    if ((* surface_array)[j] < *min_tmp)
-                        *min_tmp = (* surface_array)[j];
-                }
-            }
+            bagReduceF32 (&r, *surface_array, hnd->bag.opt[type].ncols, 1, null_val);
+        }
+        if (r.count > 0)
+        {
+            *min_tmp = r.min;
+            *max_tmp = r.max;
         }
     
         /*! update the original bagData values */
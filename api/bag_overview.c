@@ -0,0 +1,670 @@
+/*! \file bag_overview.c
+ * \brief This module contains the overview pyramid of the mandatory surfaces.
+ ********************************************************************
+ *
+ * Module Name : bag_overview.c
+ *
+ * Author/Date : ONSWG, October 2026
+ *
+ * Description :
+ *               An overview level k holds Elevation and Uncertainty reduced
+ *               2^k times in each direction, under /BAG_root/overviews as
+ *               elevation_<k> and uncertainty_<k>.  Each node of level k
+ *               summarizes 2x2 nodes of level k-1 with the aggregator chosen
+ *               when the pyramid was made: the shoalest node, the mean, or
+ *               the node of largest uncertainty.
+ *
+ *               The levels are made in one pass over the base rows: two rows
+ *               of a level make one row of the next, so only a pair of rows
+ *               per level is held.  Writes to the surfaces mark the rows they
+ *               touch; bagUpdateSurface then runs the same pass over just
+ *               those rows, rounded out to whole blocks of the top level.
+ *
+ * Restrictions/Limitations :
+ *               Nodes whose elevation is null are left out of every
+ *               aggregate.  The mean of a level is the mean of the means
+ *               below it, not weighted by their counts.
+ *
+ * Change Descriptions :
+ * who  when      what
+ * ---  ----      ----
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ ********************************************************************/
+
+#include "bag_private.h"
+
+#define OVERVIEW_LEVELS_NAME      "levels"
+#define OVERVIEW_AGGREGATOR_NAME  "aggregator"
+#define OVERVIEW_MIN_SIDE         256   /*!< BAG_OVERVIEW_AUTO stops at the first level this small */
+#define OVERVIEW_BAND_ROWS        64    /*!< Base rows read at once from an unchunked surface */
+
+/*! \brief One level of the pyramid while it is being refreshed */
+typedef struct _t_bagOverviewLevel {
+    u32     nrows, ncols;           /*!< Extents of this level */
+    u32     src_ncols;              /*!< Width of the level below */
+    hid_t   elv_id, unc_id;
+    f32    *in_elv[2], *in_unc[2];  /*!< Row pair of the level below */
+    u32     have;                   /*!< Rows of the pair received */
+    u32     next_row;               /*!< Row of this level the pair makes */
+    f32    *out_elv, *out_unc;
+} bagOverviewLevel;
+
+typedef struct _t_bagOverviewPass {
+    u8               aggregator;
+    u32              nlevels;
+    bagOverviewLevel level[BAG_OVERVIEW_MAX_LEVELS + 1];    /*!< level[0] is unused */
+} bagOverviewPass;
+
+/*! \brief bagOverviewDims gives the extents of \a level of a \a nrows x \a ncols grid */
+static void bagOverviewDims (u32 nrows, u32 ncols, u32 level, u32 *lrows, u32 *lcols)
+{
+    u32 k;
+
+    for (k = 0; k < level; k++)
+    {
+        nrows = (nrows + 1) / 2;
+        ncols = (ncols + 1) / 2;
+    }
+    *lrows = nrows;
+    *lcols = ncols;
+}
+
+/*! \brief bagOverviewPath builds the path of the \a type dataset of \a level */
+static char *bagOverviewPath (char *path, s32 type, u32 level)
+{
+    sprintf (path, "%s/%s_%u", OVERVIEW_GROUP_PATH, (type == Uncertainty) ? "uncertainty" : "elevation", level);
+    return path;
+}
+
+/*! \brief bagOverviewCombine reduces a row pair (or a last single row) of the level below */
+static void bagOverviewCombine (u8 aggregator, bagOverviewLevel *lv)
+{
+    u32 c, r, cc, ne, nu;
+    f32 e, u, best_e, best_u, key, best_key;
+    f64 se, su;
+
+    for (c = 0; c < lv->ncols; c++)
+    {
+        ne = nu = 0;
+        se = su = 0.0;
+        best_e = BAG_NULL_ELEVATION;
+        best_u = BAG_NULL_UNCERTAINTY;
+        best_key = -FLT_MAX;
+
+        for (r = 0; r < lv->have; r++)
+        {
+            for (cc = 2 * c; cc <= 2 * c + 1 && cc < lv->src_ncols; cc++)
+            {
+                e = lv->in_elv[r][cc];
+                u = lv->in_unc[r][cc];
+                if (e == BAG_NULL_ELEVATION || e != e)
+                    continue;
+
+                switch (aggregator)
+                {
+                case BAG_OVERVIEW_MEAN:
+                    se += e;
+                    ne++;
+                    if (u != BAG_NULL_UNCERTAINTY && u == u)
+                    {
+                        su += u;
+                        nu++;
+                    }
+                    break;
+                case BAG_OVERVIEW_MAX_UNCERTAINTY:
+                    key = (u == BAG_NULL_UNCERTAINTY || u != u) ? -FLT_MAX : u;
+                    if (ne++ == 0 || key > best_key)
+                    {
+                        best_key = key;
+                        best_e   = e;
+                        best_u   = u;
+                    }
+                    break;
+                default:
+                    /*! shoalest: elevations are positive up */
+                    if (ne++ == 0 || e > best_e)
+                    {
+                        best_e = e;
+                        best_u = u;
+                    }
+                    break;
+                }
+            }
+        }
+
+        if (aggregator == BAG_OVERVIEW_MEAN)
+        {
+            best_e = (ne > 0) ? (f32) (se / ne) : BAG_NULL_ELEVATION;
+            best_u = (nu > 0) ? (f32) (su / nu) : BAG_NULL_UNCERTAINTY;
+        }
+        lv->out_elv[c] = best_e;
+        lv->out_unc[c] = best_u;
+    }
+}
+
+/*! \brief bagOverviewWriteRow writes one row of a level dataset */
+static bagError bagOverviewWriteRow (hid_t dataset_id, u32 row, u32 ncols, const f32 *data)
+{
+    hsize_t  offset[RANK], count[RANK];
+    hid_t    filespace_id, memspace_id;
+    herr_t   status;
+
+    offset[0] = row;
+    offset[1] = 0;
+    count[0]  = 1;
+    count[1]  = ncols;
+
+    if ((filespace_id = H5Dget_space (dataset_id)) < 0)
+        return BAG_HDF_DATASPACE_CORRUPTED;
+    if ((memspace_id = H5Screate_simple (1, &count[1], NULL)) < 0)
+    {
+        H5Sclose (filespace_id);
+        return BAG_HDF_CREATE_DATASPACE_FAILURE;
+    }
+
+    status = H5Sselect_hyperslab (filespace_id, H5S_SELECT_SET, offset, NULL, count, NULL);
+    if (status >= 0)
+        status = H5Dwrite (dataset_id, H5T_NATIVE_FLOAT, memspace_id, filespace_id, H5P_DEFAULT, data);
+
+    H5Sclose (memspace_id);
+    H5Sclose (filespace_id);
+    check_hdf_status();
+
+    return BAG_SUCCESS;
+}
+
+static bagError bagOverviewPush (bagOverviewPass *pass, u32 k, const f32 *elv, const f32 *unc);
+
+/*! \brief bagOverviewEmit makes the next row of level \a k from its pending rows and passes it up */
+static bagError bagOverviewEmit (bagOverviewPass *pass, u32 k)
+{
+    bagOverviewLevel *lv = &pass->level[k];
+    bagError          err;
+
+    bagOverviewCombine (pass->aggregator, lv);
+    if ((err = bagOverviewWriteRow (lv->elv_id, lv->next_row, lv->ncols, lv->out_elv)) != BAG_SUCCESS)
+        return err;
+    if ((err = bagOverviewWriteRow (lv->unc_id, lv->next_row, lv->ncols, lv->out_unc)) != BAG_SUCCESS)
+        return err;
+    lv->next_row++;
+    lv->have = 0;
+
+    if (k < pass->nlevels)
+        return bagOverviewPush (pass, k + 1, lv->out_elv, lv->out_unc);
+    return BAG_SUCCESS;
+}
+
+/*! \brief bagOverviewPush hands level \a k one row of the level below */
+static bagError bagOverviewPush (bagOverviewPass *pass, u32 k, const f32 *elv, const f32 *unc)
+{
+    bagOverviewLevel *lv = &pass->level[k];
+
+    memcpy (lv->in_elv[lv->have], elv, lv->src_ncols * sizeof (f32));
+    memcpy (lv->in_unc[lv->have], unc, lv->src_ncols * sizeof (f32));
+    if (++lv->have == 2)
+        return bagOverviewEmit (pass, k);
+    return BAG_SUCCESS;
+}
+
+/*! \brief bagOverviewPassFree releases the buffers and datasets of a pass */
+static void bagOverviewPassFree (bagOverviewPass *pass)
+{
+    u32 k;
+
+    for (k = 1; k <= pass->nlevels; k++)
+    {
+        bagOverviewLevel *lv = &pass->level[k];
+
+        free (lv->in_elv[0]);
+        if (lv->elv_id >= 0)
+            H5Dclose (lv->elv_id);
+        if (lv->unc_id >= 0)
+            H5Dclose (lv->unc_id);
+    }
+}
+
+/*! \brief bagOverviewPassInit opens the level datasets and allocates the row pairs */
+static bagError bagOverviewPassInit (bagHandle hnd, bagOverviewPass *pass)
+{
+    u32   k, src_ncols = hnd->bag.def.ncols;
+    char  path[128];
+    f32  *buf;
+
+    memset (pass, 0, sizeof (*pass));
+    pass->aggregator = hnd->bag.overviewAggregator;
+    pass->nlevels    = hnd->bag.overviewLevels;
+
+    for (k = 1; k <= pass->nlevels; k++)
+        pass->level[k].elv_id = pass->level[k].unc_id = -1;
+
+    for (k = 1; k <= pass->nlevels; k++)
+    {
+        bagOverviewLevel *lv = &pass->level[k];
+
+        bagOverviewDims (hnd->bag.def.nrows, hnd->bag.def.ncols, k, &lv->nrows, &lv->ncols);
+        lv->src_ncols = src_ncols;
+        src_ncols     = lv->ncols;
+
+        /*! one block per level: two input rows and one output row of each layer */
+        if ((buf = malloc ((4 * (size_t) lv->src_ncols + 2 * (size_t) lv->ncols) * sizeof (f32))) == NULL)
+        {
+            bagOverviewPassFree (pass);
+            return BAG_MEMORY_ALLOCATION_FAILED;
+        }
+        lv->in_elv[0] = buf;
+        lv->in_elv[1] = lv->in_elv[0] + lv->src_ncols;
+        lv->in_unc[0] = lv->in_elv[1] + lv->src_ncols;
+        lv->in_unc[1] = lv->in_unc[0] + lv->src_ncols;
+        lv->out_elv   = lv->in_unc[1] + lv->src_ncols;
+        lv->out_unc   = lv->out_elv + lv->ncols;
+
+        lv->elv_id = H5Dopen (hnd->file_id, bagOverviewPath (path, Elevation, k));
+        lv->unc_id = H5Dopen (hnd->file_id, bagOverviewPath (path, Uncertainty, k));
+        if (lv->elv_id < 0 || lv->unc_id < 0)
+        {
+            bagOverviewPassFree (pass);
+            return BAG_HDF_DATASET_OPEN_FAILURE;
+        }
+    }
+
+    return BAG_SUCCESS;
+}
+
+/*! \brief bagOverviewRefreshRows remakes the levels over base rows [first, last] */
+static bagError bagOverviewRefreshRows (bagHandle hnd, u32 first, u32 last)
+{
+    bagOverviewPass  pass;
+    bagError         err;
+    hsize_t          chunk_dims[RANK];
+    Bool             chunked;
+    s32              types[2] = { Elevation, Uncertainty };
+    void            *bufs[2];
+    f32             *band;
+    u32              k, r, r0, r1, band_rows, ncols = hnd->bag.def.ncols, block;
+
+    if ((err = bagOverviewPassInit (hnd, &pass)) != BAG_SUCCESS)
+        return err;
+
+    /*! start and end on whole blocks of the top level, so every pair lines up */
+    block = 1u << pass.nlevels;
+    first = first & ~(block - 1);
+    last  = (last | (block - 1)) < hnd->bag.def.nrows - 1 ? (last | (block - 1)) : hnd->bag.def.nrows - 1;
+    for (k = 1; k <= pass.nlevels; k++)
+        pass.level[k].next_row = first >> k;
+
+    /*! read whole rows of chunks at a time, so no chunk is decompressed twice */
+    band_rows = OVERVIEW_BAND_ROWS;
+    if (bagGetSurfaceChunkDims (hnd, Elevation, chunk_dims, &chunked) == BAG_SUCCESS && chunked)
+        band_rows = (u32) chunk_dims[0];
+    if ((band = malloc (2 * (size_t) band_rows * ncols * sizeof (f32))) == NULL)
+    {
+        bagOverviewPassFree (&pass);
+        return BAG_MEMORY_ALLOCATION_FAILED;
+    }
+    bufs[0] = band;
+    bufs[1] = band + (size_t) band_rows * ncols;
+
+    /*! a band starting mid-chunk is cut short so the next one is aligned */
+    for (r0 = first; r0 <= last && err == BAG_SUCCESS; r0 = r1 + 1)
+    {
+        r1 = r0 - r0 % band_rows + band_rows - 1;
+        if (r1 > last)
+            r1 = last;
+        if ((err = bagReadRegionLayers (hnd, r0, 0, r1, ncols - 1, 2, types, bufs, ncols)) != BAG_SUCCESS)
+            break;
+        for (r = 0; r <= r1 - r0 && err == BAG_SUCCESS; r++)
+            err = bagOverviewPush (&pass, 1, (f32 *) bufs[0] + (size_t) r * ncols, (f32 *) bufs[1] + (size_t) r * ncols);
+    }
+
+    /*! an odd row at the bottom of a level stands alone */
+    if (err == BAG_SUCCESS && last == hnd->bag.def.nrows - 1)
+        for (k = 1; k <= pass.nlevels && err == BAG_SUCCESS; k++)
+            if (pass.level[k].have == 1)
+                err = bagOverviewEmit (&pass, k);
+
+    free (band);
+    bagOverviewPassFree (&pass);
+
+    return err;
+}
+
+/****************************************************************************************/
+/*! \brief  bagMarkOverviews
+ *
+ * Description:
+ *     Notes that base rows [first_row, last_row] of the surface \a type were written,
+ *     so that \a bagRefreshOverviews remakes the overview rows above them.  Called with
+ *     the HDF lock held by every write path of the mandatory surfaces.
+ *
+ ****************************************************************************************/
+void bagMarkOverviews (bagHandle hnd, s32 type, u32 first_row, u32 last_row)
+{
+    if (hnd->bag.overviewLevels == 0 || (type != Elevation && type != Uncertainty))
+        return;
+
+    if (!hnd->ovr_dirty)
+    {
+        hnd->ovr_dirty_first = first_row;
+        hnd->ovr_dirty_last  = last_row;
+        hnd->ovr_dirty       = True;
+        return;
+    }
+    if (first_row < hnd->ovr_dirty_first)
+        hnd->ovr_dirty_first = first_row;
+    if (last_row > hnd->ovr_dirty_last)
+        hnd->ovr_dirty_last = last_row;
+}
+
+/****************************************************************************************/
+/*! \brief  bagRefreshOverviews remakes the overview rows over the base rows marked as written
+ *
+ *  Called with the HDF lock held, by \a bagUpdateSurface.
+ *
+ ****************************************************************************************/
+bagError bagRefreshOverviews (bagHandle hnd)
+{
+    bagError err;
+
+    if (hnd->bag.overviewLevels == 0 || !hnd->ovr_dirty)
+        return BAG_SUCCESS;
+
+    err = bagOverviewRefreshRows (hnd, hnd->ovr_dirty_first, hnd->ovr_dirty_last);
+    if (err == BAG_SUCCESS)
+        hnd->ovr_dirty = False;
+
+    return err;
+}
+
+/****************************************************************************************/
+/*! \brief  bagOpenOverviews reads the layout of an existing pyramid into \a hnd->bag
+ *
+ *  Called by \a bagFileOpen; a BAG without overviews gets \a overviewLevels 0.
+ *
+ ****************************************************************************************/
+bagError bagOpenOverviews (bagHandle hnd)
+{
+    hid_t  group_id;
+    u32    levels = 0, aggregator = BAG_OVERVIEW_SHOALEST;
+
+    hnd->bag.overviewLevels     = 0;
+    hnd->bag.overviewAggregator = BAG_OVERVIEW_SHOALEST;
+    hnd->ovr_dirty              = False;
+
+    if (H5Lexists (hnd->file_id, OVERVIEW_GROUP_PATH, H5P_DEFAULT) <= 0)
+        return BAG_SUCCESS;
+    if ((group_id = H5Gopen (hnd->file_id, OVERVIEW_GROUP_PATH)) < 0)
+        return BAG_HDF_GROUP_OPEN_FAILURE;
+
+    if (bagReadAttribute (hnd, group_id, (u8 *) OVERVIEW_LEVELS_NAME, &levels) == BAG_SUCCESS &&
+        bagReadAttribute (hnd, group_id, (u8 *) OVERVIEW_AGGREGATOR_NAME, &aggregator) == BAG_SUCCESS &&
+        levels <= BAG_OVERVIEW_MAX_LEVELS)
+    {
+        hnd->bag.overviewLevels     = (u8) levels;
+        hnd->bag.overviewAggregator = (u8) aggregator;
+    }
+    H5Gclose (group_id);
+
+    return BAG_SUCCESS;
+}
+
+/****************************************************************************************/
+/*! \brief  bagCreateOverviews makes an empty pyramid of \a levels levels
+ *
+ *  Any existing pyramid is removed first; \a levels 0 just removes it, and
+ *  \a BAG_OVERVIEW_AUTO reduces until both extents are at most OVERVIEW_MIN_SIDE.
+ *  The levels hold nulls until refreshed.  Called with the HDF lock held.
+ *
+ ****************************************************************************************/
+bagError bagCreateOverviews (bagHandle hnd, u32 levels, u8 aggregator)
+{
+    hid_t    group_id, dataspace_id, plist_id, dataset_id;
+    hsize_t  dims[RANK], chunk[RANK];
+    bagError err = BAG_SUCCESS;
+    u32      k, t, lrows, lcols;
+    char     path[128];
+    f32      null_val;
+
+    if (aggregator > BAG_OVERVIEW_MAX_UNCERTAINTY)
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+
+    if (levels == BAG_OVERVIEW_AUTO)
+    {
+        levels = 0;
+        do
+            bagOverviewDims (hnd->bag.def.nrows, hnd->bag.def.ncols, ++levels, &lrows, &lcols);
+        while ((lrows > OVERVIEW_MIN_SIDE || lcols > OVERVIEW_MIN_SIDE) && levels < BAG_OVERVIEW_MAX_LEVELS);
+    }
+    if (levels > BAG_OVERVIEW_MAX_LEVELS)
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+
+    if (H5Lexists (hnd->file_id, OVERVIEW_GROUP_PATH, H5P_DEFAULT) > 0 &&
+        H5Ldelete (hnd->file_id, OVERVIEW_GROUP_PATH, H5P_DEFAULT) < 0)
+        return BAG_HDF_INTERNAL_ERROR;
+    hnd->bag.overviewLevels = 0;
+    hnd->ovr_dirty          = False;
+    if (levels == 0)
+        return BAG_SUCCESS;
+
+    if ((group_id = H5Gcreate (hnd->file_id, OVERVIEW_GROUP_PATH, 0)) < 0)
+        return BAG_HDF_CREATE_GROUP_FAILURE;
+    if ((err = bagCreateAttribute (hnd, group_id, (u8 *) OVERVIEW_LEVELS_NAME, 0, BAG_ATTR_U32)) == BAG_SUCCESS &&
+        (err = bagWriteAttribute (hnd, group_id, (u8 *) OVERVIEW_LEVELS_NAME, &levels)) == BAG_SUCCESS &&
+        (err = bagCreateAttribute (hnd, group_id, (u8 *) OVERVIEW_AGGREGATOR_NAME, 0, BAG_ATTR_U32)) == BAG_SUCCESS)
+    {
+        t   = aggregator;
+        err = bagWriteAttribute (hnd, group_id, (u8 *) OVERVIEW_AGGREGATOR_NAME, &t);
+    }
+    H5Gclose (group_id);
+    if (err != BAG_SUCCESS)
+        return err;
+
+    /*! the levels are written a row at a time, so their chunks are bands of whole rows */
+    for (k = 1; k <= levels && err == BAG_SUCCESS; k++)
+    {
+        bagOverviewDims (hnd->bag.def.nrows, hnd->bag.def.ncols, k, &lrows, &lcols);
+        dims[0] = lrows;
+        dims[1] = lcols;
+
+        for (t = Elevation; t <= Uncertainty && err == BAG_SUCCESS; t++)
+        {
+            null_val = (t == Elevation) ? BAG_NULL_ELEVATION : BAG_NULL_UNCERTAINTY;
+
+            if ((dataspace_id = H5Screate_simple (RANK, dims, NULL)) < 0)
+                return BAG_HDF_CREATE_DATASPACE_FAILURE;
+            if ((plist_id = H5Pcreate (H5P_DATASET_CREATE)) < 0)
+            {
+                H5Sclose (dataspace_id);
+                return BAG_HDF_CREATE_PROPERTY_CLASS_FAILURE;
+            }
+
+            H5Pset_fill_value (plist_id, H5T_NATIVE_FLOAT, &null_val);
+            err = bagPlanChunks (RANK, dims, sizeof (f32), BAG_ACCESS_ROWS, hnd->bag.chunkBytes, chunk);
+            if (err == BAG_SUCCESS)
+                err = bagSetSurfaceFilters (plist_id, &hnd->bag, H5T_NATIVE_FLOAT, chunk);
+
+            if (err == BAG_SUCCESS)
+            {
+                dataset_id = H5Dcreate (hnd->file_id, bagOverviewPath (path, (s32) t, k), H5T_NATIVE_FLOAT, dataspace_id, plist_id);
+                if (dataset_id < 0)
+                    err = BAG_HDF_CREATE_DATASET_FAILURE;
+                else
+                    H5Dclose (dataset_id);
+            }
+            H5Pclose (plist_id);
+            H5Sclose (dataspace_id);
+        }
+    }
+
+    if (err == BAG_SUCCESS)
+    {
+        hnd->bag.overviewLevels     = (u8) levels;
+        hnd->bag.overviewAggregator = aggregator;
+    }
+    return err;
+}
+
+static bagError bagBuildOverviewsUnlocked (bagHandle hnd, u32 levels, u8 aggregator)
+{
+    bagError err;
+
+    if ((err = bagCreateOverviews (hnd, levels, aggregator)) != BAG_SUCCESS)
+        return err;
+    if (hnd->bag.overviewLevels == 0)
+        return BAG_SUCCESS;
+
+    return bagOverviewRefreshRows (hnd, 0, hnd->bag.def.nrows - 1);
+}
+
+/****************************************************************************************/
+/*! \brief bagBuildOverviews makes the overview pyramid of a BAG from its surfaces
+ *
+ *  \param  hnd         External reference to the private \a bagHandle object, opened for write
+ *  \param  levels      Number of levels, \a BAG_OVERVIEW_AUTO to choose, 0 to remove the pyramid
+ *  \param  aggregator  Element of \a BAG_OVERVIEW_AGGREGATORS
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ****************************************************************************************/
+bagError bagBuildOverviews (bagHandle hnd, u32 levels, u8 aggregator)
+{
+    bagError err;
+
+    if (hnd == NULL)
+        return BAG_INVALID_BAG_HANDLE;
+
+    bagLockHDF ();
+    err = bagBuildOverviewsUnlocked (hnd, levels, aggregator);
+    bagUnlockHDF ();
+
+    return err;
+}
+
+/****************************************************************************************/
+/*! \brief bagSelectOverviewLevel picks the coarsest level at least as fine as \a resolution
+ *
+ *  \param  hnd         External reference to the private \a bagHandle object
+ *  \param  resolution  Node spacing wanted, in the units of the BAG's node spacing
+ *  \param *level       Receives the level; 0 is the full resolution surface
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ****************************************************************************************/
+bagError bagSelectOverviewLevel (bagHandle hnd, f64 resolution, u32 *level)
+{
+    f64 spacing;
+
+    if (hnd == NULL)
+        return BAG_INVALID_BAG_HANDLE;
+    if (level == NULL)
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+
+    /*! the coarser axis decides, so the level never undersamples */
+    spacing = hnd->bag.def.nodeSpacingX;
+    if (hnd->bag.def.nodeSpacingY > spacing)
+        spacing = hnd->bag.def.nodeSpacingY;
+
+    *level = 0;
+    if (spacing <= 0.0)
+        return BAG_SUCCESS;
+    while (*level < hnd->bag.overviewLevels && spacing * 2.0 <= resolution)
+    {
+        spacing *= 2.0;
+        (*level)++;
+    }
+
+    return BAG_SUCCESS;
+}
+
+static bagError bagReadOverviewRegionUnlocked (bagHandle hnd, s32 type, u32 level, u32 start_row, u32 start_col,
+                                               u32 end_row, u32 end_col, f32 *data, u32 *nrows, u32 *ncols)
+{
+    hsize_t  offset[RANK], count[RANK];
+    hid_t    dataset_id, filespace_id, memspace_id;
+    herr_t   status;
+    char     path[128];
+
+    if (type != Elevation && type != Uncertainty)
+        return BAG_HDF_TYPE_NOT_FOUND;
+    if (data == NULL || level > hnd->bag.overviewLevels || start_row > end_row || start_col > end_col ||
+        end_row >= hnd->bag.def.nrows || end_col >= hnd->bag.def.ncols)
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+
+    offset[0] = start_row >> level;
+    offset[1] = start_col >> level;
+    count[0]  = (end_row >> level) - offset[0] + 1;
+    count[1]  = (end_col >> level) - offset[1] + 1;
+    if (nrows != NULL)
+        *nrows = (u32) count[0];
+    if (ncols != NULL)
+        *ncols = (u32) count[1];
+
+    if (level == 0)
+        return bagReadRegionInto (hnd, start_row, start_col, end_row, end_col, type, data, 0);
+
+    if ((dataset_id = H5Dopen (hnd->file_id, bagOverviewPath (path, type, level))) < 0)
+        return BAG_HDF_DATASET_OPEN_FAILURE;
+    if ((filespace_id = H5Dget_space (dataset_id)) < 0)
+    {
+        H5Dclose (dataset_id);
+        return BAG_HDF_DATASPACE_CORRUPTED;
+    }
+    if ((memspace_id = H5Screate_simple (RANK, count, NULL)) < 0)
+    {
+        H5Sclose (filespace_id);
+        H5Dclose (dataset_id);
+        return BAG_HDF_CREATE_DATASPACE_FAILURE;
+    }
+
+    status = H5Sselect_hyperslab (filespace_id, H5S_SELECT_SET, offset, NULL, count, NULL);
+    if (status >= 0)
+        status = H5Dread (dataset_id, H5T_NATIVE_FLOAT, memspace_id, filespace_id, H5P_DEFAULT, data);
+
+    H5Sclose (memspace_id);
+    H5Sclose (filespace_id);
+    H5Dclose (dataset_id);
+    check_hdf_status();
+
+    return BAG_SUCCESS;
+}
+
+/****************************************************************************************/
+/*! \brief bagReadOverviewRegion reads a region of the surfaces from an overview level
+ *
+ *  The region is given in rows and columns of the full resolution grid; level \a level
+ *  node (r, c) covers base nodes (r << level, c << level) onwards.
+ *
+ *  \param  hnd         External reference to the private \a bagHandle object
+ *  \param  type        Elevation or Uncertainty
+ *  \param  level       Overview level, 0 for the surface itself
+ *  \param  start_row   First base row of the region
+ *  \param  start_col   First base column of the region
+ *  \param  end_row     Last base row of the region
+ *  \param  end_col     Last base column of the region
+ *  \param *data        Receives the packed rows of the level covering the region
+ *  \param *nrows       Receives the number of rows read, may be NULL
+ *  \param *ncols       Receives the number of columns read, may be NULL
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ****************************************************************************************/
+bagError bagReadOverviewRegion (bagHandle hnd, s32 type, u32 level, u32 start_row, u32 start_col,
+                                u32 end_row, u32 end_col, f32 *data, u32 *nrows, u32 *ncols)
+{
+    bagError err;
+
+    if (hnd == NULL)
+        return BAG_INVALID_BAG_HANDLE;
+
+    bagLockHDF ();
+    err = bagReadOverviewRegionUnlocked (hnd, type, level, start_row, start_col, end_row, end_col, data, nrows, ncols);
+    bagUnlockHDF ();
+
+    return err;
+}
@@ -0,0 +1,284 @@
+/*! \file bag_prefetch.c
+ * \brief This module contains the asynchronous prefetching region reader.
+ ********************************************************************
+ *
+ * Module Name : bag_prefetch.c
+ *
+ * Author/Date : ONSWG, October 2026
+ *
+ * Description :
+ *               Reads a caller supplied plan of windows (rows are windows
+ *               one row high) for a list of layers on a background thread,
+ *               up to a fixed number of windows ahead of the caller.  The
+ *               finished windows are handed back, in plan order, from a
+ *               ring of buffers owned by the reader, so that I/O and
+ *               decompression overlap with the caller's processing.
+ *
+ * Restrictions/Limitations :
+ *               HDF5 is not thread safe, so each read of the reader thread
+ *               holds the library HDF lock.  The application must not do
+ *               other I/O on the same handle while the reader is open, but
+ *               may read through a view of it, see bagReaderViewOpen.
+ *               A buffer handed out by bagPrefetchNext is valid until the
+ *               next call to bagPrefetchNext or bagPrefetchClose.
+ *
+ * Change Descriptions :
+ * who  when      what
+ * ---  ----      ----
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ ********************************************************************/
+
+#include <string.h>
+
+#include "bag_private.h"
+
+/****************************************************************************************/
+/*! \brief bagPrefetchWorker is the body of the reader thread
+ *
+ *  Loads plan window \a filled into ring slot \a filled % \a depth as soon as the
+ *  caller has released the window that used that slot before.
+ *
+ ****************************************************************************************/
+static void bagPrefetchWorker (void *arg)
+{
+    bagPrefetcher  pf = (bagPrefetcher) arg;
+    bagError       err;
+    bagWindow     *w;
+    u32            index;
+
+    bagMutexLock (pf->lock);
+    while (!pf->stop && pf->filled < pf->nwindows)
+    {
+        if (pf->filled - pf->released >= pf->depth)
+        {
+            bagCondWait (pf->cond, pf->lock);
+            continue;
+        }
+        index = pf->filled;
+        bagMutexUnlock (pf->lock);
+
+        w = &pf->plan[index];
+        err = bagAlignRegionLayers (pf->hnd, w->start_row, w->start_col, w->end_row, w->end_col,
+                                    pf->nlayers, pf->types, READ_BAG,
+                                    &pf->slot_data[(index % pf->depth) * pf->nlayers], 0, H5P_DEFAULT);
+
+        bagMutexLock (pf->lock);
+        if (err != BAG_SUCCESS)
+        {
+            pf->error = err;
+            pf->stop  = True;
+        }
+        else
+            pf->filled++;
+        bagCondBroadcast (pf->cond);
+    }
+    bagMutexUnlock (pf->lock);
+}
+
+/****************************************************************************************/
+/*! \brief bagPrefetchOpen starts a background reader over a plan of windows
+ *
+ *  \param  hnd       External reference to the private \a bagHandle object
+ *  \param *plan      \a nwindows windows to read, in the order they will be handed back
+ *  \param  nwindows  Number of windows in \a *plan
+ *  \param *types     \a nlayers surface types read for every window, elements of \a BAG_SURFACE_PARAMS
+ *  \param  nlayers   Number of entries in \a *types, at most \a BAG_REGION_MAX_LAYERS
+ *  \param  depth     Number of windows buffered ahead of the caller, at least 2 for double buffering
+ *  \param *pf        Will be set to the allocated \a bagPrefetcher.
+ *                    Must be released with \a bagPrefetchClose.
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ********************************************************************/
+bagError bagPrefetchOpen (bagHandle hnd, const bagWindow *plan, u32 nwindows,
+                          const s32 *types, u32 nlayers, u32 depth, bagPrefetcher *pf)
+{
+    bagError       err;
+    bagPrefetcher  p;
+    u32            i, k, srow, scol;
+    size_t         max_nodes = 0, nodes;
+    hid_t          dataset_id, datatype_id, filespace_id;
+
+    if (hnd == NULL)
+        return BAG_INVALID_BAG_HANDLE;
+    if (pf == NULL || plan == NULL || nwindows == 0 || types == NULL || nlayers == 0 || nlayers > BAG_REGION_MAX_LAYERS || depth == 0)
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+
+    *pf = NULL;
+
+    /*! validate the whole plan up front, so errors are not deferred to the worker */
+    for (k = 0; k < nlayers; k++)
+    {
+        if (types[k] >= BAG_OPT_SURFACE_LIMIT)
+            return BAG_INVALID_FUNCTION_ARGUMENT;
+        if ((err = bagGetSurfaceIds (hnd, types[k], &dataset_id, &datatype_id, &filespace_id, &srow, &scol)) != BAG_SUCCESS)
+            return err;
+        for (i = 0; i < nwindows; i++)
+        {
+            if (plan[i].end_row >= srow || plan[i].end_col >= scol ||
+                plan[i].start_row > plan[i].end_row || plan[i].start_col > plan[i].end_col)
+                return BAG_HDF_ACCESS_EXTENTS_ERROR;
+        }
+    }
+    for (i = 0; i < nwindows; i++)
+    {
+        nodes = (size_t) (plan[i].end_row - plan[i].start_row + 1) * (size_t) (plan[i].end_col - plan[i].start_col + 1);
+        if (nodes > max_nodes)
+            max_nodes = nodes;
+    }
+
+    if ((p = (bagPrefetcher) calloc (1, sizeof (struct _t_bagPrefetcher))) == NULL)
+        return BAG_MEMORY_ALLOCATION_FAILED;
+
+    p->hnd      = hnd;
+    p->nwindows = nwindows;
+    p->nlayers  = nlayers;
+    p->depth    = (depth < nwindows) ? depth : nwindows;
+    p->plan      = (bagWindow *) malloc (nwindows * sizeof (bagWindow));
+    p->types     = (s32 *) malloc (nlayers * sizeof (s32));
+    p->slot_data = (void **) calloc ((size_t) p->depth * nlayers, sizeof (void *));
+    p->out_data  = (void **) calloc (nlayers, sizeof (void *));
+    if (p->plan == NULL || p->types == NULL || p->slot_data == NULL || p->out_data == NULL)
+    {
+        bagPrefetchClose (p);
+        return BAG_MEMORY_ALLOCATION_FAILED;
+    }
+    memcpy (p->plan, plan, nwindows * sizeof (bagWindow));
+    memcpy (p->types, types, nlayers * sizeof (s32));
+
+    /*! every slot holds the largest window of the plan, in each layer's own element size */
+    for (k = 0; k < nlayers; k++)
+    {
+        bagGetSurfaceIds (hnd, types[k], &dataset_id, &datatype_id, &filespace_id, &srow, &scol);
+        for (i = 0; i < p->depth; i++)
+        {
+            p->slot_data[i * nlayers + k] = malloc (max_nodes * H5Tget_size (datatype_id));
+            if (p->slot_data[i * nlayers + k] == NULL)
+            {
+                bagPrefetchClose (p);
+                return BAG_MEMORY_ALLOCATION_FAILED;
+            }
+        }
+    }
+
+    if ((err = bagMutexCreate (&p->lock)) != BAG_SUCCESS ||
+        (err = bagCondCreate (&p->cond)) != BAG_SUCCESS ||
+        (err = bagThreadCreate (&p->thread, bagPrefetchWorker, p)) != BAG_SUCCESS)
+    {
+        bagPrefetchClose (p);
+        return err;
+    }
+
+    *pf = p;
+    return BAG_SUCCESS;
+}
+
+/****************************************************************************************/
+/*! \brief bagPrefetchNext hands back the next window of the plan, waiting for it if needed
+ *
+ *  The window handed out by the previous call is released back to the reader first.
+ *
+ *  \param  pf     Reader returned by \a bagPrefetchOpen
+ *  \param *buf    Populated with the window, its plan index and one buffer per layer,
+ *                 each packed row major with a row stride of \a buf->ncols
+ *  \param *done   Set to \a True, with \a *buf untouched, once the whole plan has been handed out
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, the error the reader thread hit, from \a BAG_ERRORS.
+ *
+ ********************************************************************/
+bagError bagPrefetchNext (bagPrefetcher pf, bagPrefetchBuffer *buf, Bool *done)
+{
+    u32 k, slot;
+
+    if (pf == NULL || buf == NULL || done == NULL)
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+
+    bagMutexLock (pf->lock);
+
+    if (pf->taken > pf->released)
+    {
+        pf->released++;
+        bagCondBroadcast (pf->cond);
+    }
+
+    if (pf->taken >= pf->nwindows)
+    {
+        bagMutexUnlock (pf->lock);
+        *done = True;
+        return BAG_SUCCESS;
+    }
+
+    while (pf->filled <= pf->taken && pf->error == BAG_SUCCESS)
+        bagCondWait (pf->cond, pf->lock);
+
+    if (pf->filled <= pf->taken)
+    {
+        bagMutexUnlock (pf->lock);
+        return pf->error;
+    }
+
+    slot = pf->taken % pf->depth;
+    for (k = 0; k < pf->nlayers; k++)
+        pf->out_data[k] = pf->slot_data[slot * pf->nlayers + k];
+
+    buf->index  = pf->taken;
+    buf->window = pf->plan[pf->taken];
+    buf->nrows  = buf->window.end_row - buf->window.start_row + 1;
+    buf->ncols  = buf->window.end_col - buf->window.start_col + 1;
+    buf->data   = pf->out_data;
+    pf->taken++;
+
+    bagMutexUnlock (pf->lock);
+
+    *done = False;
+    return BAG_SUCCESS;
+}
+
+/****************************************************************************************/
+/*! \brief bagPrefetchClose stops the reader thread and releases its buffers
+ *
+ *  May be called before the plan has been consumed completely.
+ *
+ *  \param  pf     Reader returned by \a bagPrefetchOpen
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ********************************************************************/
+bagError bagPrefetchClose (bagPrefetcher pf)
+{
+    u32 i;
+
+    if (pf == NULL)
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+
+    if (pf->thread != NULL)
+    {
+        bagMutexLock (pf->lock);
+        pf->stop = True;
+        bagCondBroadcast (pf->cond);
+        bagMutexUnlock (pf->lock);
+        bagThreadJoin (pf->thread);
+    }
+    bagCondDestroy (pf->cond);
+    bagMutexDestroy (pf->lock);
+
+    if (pf->slot_data != NULL)
+    {
+        for (i = 0; i < pf->depth * pf->nlayers; i++)
+            free (pf->slot_data[i]);
+    }
+    free (pf->slot_data);
+    free (pf->out_data);
+    free (pf->plan);
+    free (pf->types);
+    free (pf);
+
+    return BAG_SUCCESS;
+}
@@ -48,6 +48,15 @@
 #define RANK 2
 #define TRACKING_LIST_BLOCK_SIZE        10
 #define VARRES_TRACKING_LIST_BLOCK_SIZE 1024 /*!< Quantum for reads from the variable-resolution tracking list */
+#define TRACKING_LIST_APPEND_ITEMS      16384 /*!< Default batch of a bagTrackingAppender */
+#define TRACKING_LIST_SORT_BYTES        (64 << 20) /*!< Default memory bound of the tracking list sorts */
+#define NODE_BATCH_SIZE                 8192 /*!< Maximum points in one multi-point selection of bagReadNodes/bagWriteNodes */
+#define MEMSPACE_CACHE_SIZE             8    /*!< Number of memspace shapes kept open per handle, see bagGetMemspace */
+#define BAG_FILTER_LZ4                  32004 /*!< HDF5 registered filter id of the LZ4 plugin */
+#define BAG_FILTER_ZSTD                 32015 /*!< HDF5 registered filter id of the Zstandard plugin */
+#define BAG_DEFAULT_CHUNK_BYTES         (256*1024) /*!< Target size of a planned chunk when bagData.chunkBytes is 0 */
+#define REPACK_BAND_BYTES               (8*1024*1024) /*!< Target size of a band of rows streamed by bagRepack */
+#define TILE_BAND_BYTES                 (1024*1024) /*!< Target size of a tile when a surface is stored contiguously */
 
 /*! Path names for mandatory BAG entities */
 #define ROOT_PATH          "/BAG_root"
@@ -69,6 +78,11 @@
 #define VARRES_REFINEMENT_GROUP_PATH    ROOT_PATH"/varres_refinements"
 #define VARRES_NODE_GROUP_PATH          ROOT_PATH"/varres_nodes"
 #define VARRES_TRACKING_LIST_PATH       ROOT_PATH"/varres_tracking_list"
+#define OVERVIEW_GROUP_PATH             ROOT_PATH"/overviews"
+#define ELEVATION_CHUNK_INDEX_PATH      ROOT_PATH"/elevation_chunk_index"
+#define UNCERTAINTY_CHUNK_INDEX_PATH    ROOT_PATH"/uncertainty_chunk_index"
+#define TRACKING_LIST_INDEX_PATH        ROOT_PATH"/tracking_list_index"
+#define VARRES_TRACKING_LIST_INDEX_PATH ROOT_PATH"/varres_tracking_list_index"
 
 /*! Names for BAG Attributes */
 #define BAG_VERSION_NAME     "Bag Version"                /*!< Name for version attribute, value set in bag.h */
@@ -95,6 +109,60 @@
  * in READ_BAG mode, and internal  memory structures for communication between
  * the user and the actual HDF BAG.
  */
+/*! \brief One open memspace in the per-handle LRU cache, keyed by layer and shape */
+typedef struct _t_bagMemspaceCacheEntry {
+    hid_t   memspace_id;        /*!< -1 when the slot is empty */
+    s32     type;
+    hsize_t dims[RANK];
+    u32     last_used;          /*!< value of the cache clock at the last hit */
+} bagMemspaceCacheEntry;
+
+/*! \brief Running range of the values written to a mandatory surface, see bagFoldSurfaceStats()
+ *
+ * min and max hold the surface's null value until a non-null value is written.
+ */
+typedef struct _t_bagRunningStats {
+    f32     min, max;       /*!< Range of the non-null values written so far */
+    Bool    valid;          /*!< False when the range must be rescanned from the file */
+} bagRunningStats;
+
+/*! \brief Levels of the instruction set used by bagReduceF32(), see bagSetReduceLevel() */
+enum BAG_REDUCE_LEVELS {
+    BAG_REDUCE_SCALAR = 0,
+    BAG_REDUCE_SSE2   = 1,
+    BAG_REDUCE_AVX2   = 2,
+    BAG_REDUCE_AVX512 = 3
+};
+
+/*! \brief Summary of the non-null values of a run of f32 values, see bagReduceF32()
+ *
+ * min and max are FLT_MAX and -FLT_MAX while count is 0.
+ */
+typedef struct _t_bagReduction {
+    f32     min, max;
+    hsize_t count;          /*!< Values that were neither the null value nor NaN */
+    f64     sum, sumsq;     /*!< Sum and sum of squares of the counted values */
+} bagReduction;
+
+/*! \brief Non-null values of one chunk of a surface, see bag_chunk_index.c
+ *
+ * count is BAG_CHUNK_COUNT_UNKNOWN after a write until the chunk is rescanned;
+ * min and max hold the null value while count is 0.
+ */
+typedef struct _t_bagChunkStats {
+    f32     min, max;
+    u32     count;
+} bagChunkStats;
+
+/*! \brief In-memory chunk index of a mandatory surface */
+typedef struct _t_bagChunkIndex {
+    bagChunkStats *tiles;           /*!< nrows * ncols chunks, row major */
+    u32     tile_rows, tile_cols;   /*!< Nodes of the surface per chunk */
+    u32     nrows, ncols;           /*!< Chunks of the surface */
+    Bool    stale;                  /*!< True when some chunk is unknown */
+    Bool    stored;                 /*!< True while the index stored in the file is marked valid */
+} bagChunkIndex;
+
 typedef struct _t_bagHandle {
 
     bagData bag;
@@ -136,8 +204,104 @@ typedef struct _t_bagHandle {
             mta_datatype_id,
             elv_datatype_id,
             mta_cparms_id;
+
+    /*! cache tuning applied as datasets are opened, see bagOpenDataset() */
+    bagOpenOptions open_opts;
+
+    /*! read-only views of uncompressed surfaces, see bagMapSurface() */
+    void       *map_base[BAG_OPT_SURFACE_LIMIT];
+    size_t      map_length[BAG_OPT_SURFACE_LIMIT];
+    const f32  *map_view[BAG_OPT_SURFACE_LIMIT];
+
+    /*! memspaces reused across node, row and region I/O, see bagGetMemspace() */
+    bagMemspaceCacheEntry memspace_cache[MEMSPACE_CACHE_SIZE];
+    u32     memspace_clock;
+    u32     memspace_hits,
+            memspace_misses;
+
+    /*! ranges of the values written to Elevation and Uncertainty, see bagUpdateSurface() */
+    bagRunningStats running[Uncertainty + 1];
+
+    /*! base rows written since the overviews were last refreshed, see bagRefreshOverviews() */
+    Bool    ovr_dirty;
+    u32     ovr_dirty_first,
+            ovr_dirty_last;
+
+    /*! chunk indexes of Elevation and Uncertainty, NULL when absent, see bag_chunk_index.c */
+    bagChunkIndex *chunk_index[Uncertainty + 1];
+
+    /*! whether the tracking list indexes match their lists, main then variable resolution,
+     *  see bagLookupTrackIndex() */
+    u8      track_index_state[2];
 } BagHandle;
 
+/*! Opaque threading primitives, see bag_threads.c */
+typedef struct _t_bagMutex  *bagMutex;
+typedef struct _t_bagCond   *bagCond;
+typedef struct _t_bagThread *bagThread;
+
+/*! One task of a bagParallelFor loop, run by worker \a worker */
+typedef bagError (*bagTaskFunc) (void *ctx, u32 task, u32 worker);
+
+/*! \brief The internal tile iterator state behind the public \a bagTileIterator
+ *
+ * Walks the mandatory surfaces one chunk at a time, see bag_tiles.c.
+ */
+typedef struct _t_bagTileIterator {
+    bagHandle hnd;                  /*!< Bag being walked */
+    hsize_t   tile_dims[RANK];      /*!< Full tile shape, the Elevation chunk shape */
+    u32       next_row, next_col;   /*!< Offset of the next tile to be read */
+    f32      *elevation;            /*!< Tile buffer for Elevation */
+    f32      *uncertainty;          /*!< Tile buffer for Uncertainty */
+    hid_t     memspace_id;          /*!< Memspace sized to the current tile */
+} BagTileIterator;
+
+/*! \brief The internal state of the asynchronous reader behind the public \a bagPrefetcher
+ *
+ * Window i of the plan is loaded into ring slot i % depth.  The counters only grow:
+ * the worker may fill a window once it is less than \a depth ahead of \a released.
+ */
+typedef struct _t_bagPrefetcher {
+    bagHandle   hnd;
+    bagWindow  *plan;
+    u32         nwindows;
+    s32        *types;
+    u32         nlayers;
+    u32         depth;
+    void      **slot_data;      /*!< depth * nlayers buffers, slot major */
+    void      **out_data;       /*!< the per-layer pointers handed to the caller */
+    u32         filled,         /*!< windows completely read by the worker */
+                taken,          /*!< windows handed to the caller */
+                released;       /*!< windows given back by the caller */
+    Bool        stop;
+    bagError    error;
+    bagMutex    lock;
+    bagCond     cond;
+    bagThread   thread;
+} BagPrefetcher;
+
+/*! \brief The internal state of the public \a bagTrackingAppender, see bag_tracking_list.c */
+typedef struct _t_bagTrackingAppender {
+    bagHandle   hnd;
+    Bool        varres;         /*!< appending to the variable resolution tracking list */
+    size_t      item_size;
+    u8         *items;          /*!< capacity items, the first count of them buffered */
+    u32         count;
+    u32         capacity;
+} BagTrackingAppender;
+
+/*! \brief One item of a tracking list while its index is built, see bag_track_index.c
+ *
+ *  Sorted by key, in memory or through a temporary file, by bagSortTrackIndexEntries().
+ */
+typedef struct _t_bagTrackIndexEntry {
+    u32         key[4];         /*!< row, col, sub_row and sub_col; or the code or series first */
+    u32         pos;            /*!< position of the item in the list */
+} bagTrackIndexEntry;
+
+#define TRACK_SORT_NAME_LEN     (2 * MAX_STR)   /*!< Bytes of the name of a temporary sort file */
+#define TRACK_SORT_MIN_RUN      4096            /*!< Fewest items of a run, whatever the memory bound */
+
 /*! \brief bagAttrTypes define the available attribute datatypes
  *
  *  The attributes are created along with the datasets in bagFileCreate().
@@ -164,7 +328,8 @@ enum READ_TRACK_MODE {
     READ_TRACK_RC       = 0, /*!< Row-Column mode */
     READ_TRACK_SERIES   = 1, /*!< List-Series mode */
     READ_TRACK_CODE     = 2,  /*!< Track-Code mode */
-    READ_TRACK_SUBRC    = 3 /*!< Sub-Row/Sub-Column mode for variable-resolution surfaces */
+    READ_TRACK_SUBRC    = 3, /*!< Sub-Row/Sub-Column mode for variable-resolution surfaces */
+    READ_TRACK_ALL      = 4  /*!< Every item, in list order */
 };
 
 /*! private function prototypes */
@@ -178,15 +343,75 @@ bagError bagAlignXMLStream  (bagHandle hnd, s32 read_or_write);
 bagError bagAlignRow        (bagHandle hnd, u32 row, u32 start_col,u32 end_col, s32 type, s32 read_or_write, void *data);
 bagError bagAlignRegion     (bagHandle hnd, u32 start_row, u32 start_col, u32 end_row, u32 end_col, s32 type, s32 read_or_write, hid_t xfer);
 bagError bagAlignNode       (bagHandle hnd, u32 row, u32 col, s32 type, void *data, s32 read_or_write);
+bagError bagAlignNodes      (bagHandle hnd, u32 nnodes, const u32 *rows, const u32 *cols, s32 type, void *data, Bool *valid, s32 read_or_write);
+bagError bagAlignRegionBuffer (bagHandle hnd, u32 start_row, u32 start_col, u32 end_row, u32 end_col, s32 type, s32 read_or_write, void *data, u32 row_stride, hid_t xfer);
+bagError bagAlignRegionLayers (bagHandle hnd, u32 start_row, u32 start_col, u32 end_row, u32 end_col, u32 nlayers, const s32 *types, s32 read_or_write, void **data, u32 row_stride, hid_t xfer);
+hid_t    bagOpenDataset     (bagHandle hnd, const char *path, s32 type);
+bagError bagGetMemspace     (bagHandle hnd, s32 type, const hsize_t *dims, hid_t *memspace_id);
+void     bagInitMemspaceCache (bagHandle hnd);
+bagError bagFreeMemspaceCache (bagHandle hnd);
+bagError bagSetSurfaceFilters (hid_t plist_id, const bagData *data, hid_t datatype_id, const hsize_t *chunk_size);
+bagError bagSetFilterPipeline (hid_t plist_id, const bagData *data, hid_t datatype_id);
+bagError bagSetSurfaceFillTime (hid_t plist_id, Bool sparse);
+bagError bagPlanChunks (u32 rank, const hsize_t *dims, size_t elem_size, u8 hint, u32 target_bytes, hsize_t *chunk);
+bagError bagPlanSurfaceChunks (const bagData *data, const hsize_t *dims, size_t elem_size, hsize_t *chunk);
+bagError bagGetSurfaceIds   (bagHandle hnd, s32 type, hid_t *dataset_id, hid_t *datatype_id, hid_t *filespace_id, u32 *srow, u32 *scol);
 bagError bagAlignOptRow     (bagHandle hnd, u32 row, u32 start_col,u32 end_col, s32 type, s32 read_or_write, void *data);
 bagError bagAlignOptRegion  (bagHandle hnd, u32 start_row, u32 start_col, u32 end_row, u32 end_col, s32 type, s32 read_or_write, hid_t xfer);
 bagError bagAlignOptNode    (bagHandle hnd, u32 row, u32 col, s32 type, void *data, s32 read_or_write);
 bagError bagUpdateMinMax    (bagHandle hnd, u32 type);
+void     bagResetSurfaceStats (bagHandle hnd, s32 type, Bool valid);
+void     bagFoldSurfaceStats  (bagHandle hnd, s32 type, const f32 *data, u32 nrows, u32 ncols, u32 row_stride);
+void     bagMarkOverviews   (bagHandle hnd, s32 type, u32 first_row, u32 last_row);
+bagError bagRefreshOverviews (bagHandle hnd);
+bagError bagOpenOverviews   (bagHandle hnd);
+bagError bagCreateOverviews (bagHandle hnd, u32 levels, u8 aggregator);
+void     bagMarkSurfaceRows (bagHandle hnd, s32 type, u32 first_row, u32 last_row);
+bagError bagOpenChunkIndex  (bagHandle hnd);
+bagError bagCreateChunkIndex (bagHandle hnd);
+void     bagFreeChunkIndex  (bagHandle hnd);
+void     bagMarkChunkIndex  (bagHandle hnd, s32 type, u32 first_row, u32 last_row);
+bagError bagRefreshChunkIndex (bagHandle hnd, s32 type);
+Bool     bagChunkIndexRange (bagHandle hnd, s32 type, f32 *min, f32 *max);
+bagError bagReadSparseRegion (bagHandle hnd, s32 type, u32 start_row, u32 start_col, u32 end_row, u32 end_col, f32 *data, u32 row_stride, Bool *done);
+bagError bagBuildTrackIndex (bagHandle hnd, Bool varres, u32 max_bytes);
+Bool     bagHasTrackIndex   (bagHandle hnd, Bool varres);
+bagError bagLookupTrackIndex (bagHandle hnd, Bool varres, u16 mode, const u32 *key, u32 **positions, u32 *npositions, u32 *indexed_len);
+bagError bagGetTrackingList (bagHandle hnd, Bool varres, hid_t *dataset_id, hid_t *datatype_id, u32 *list_len);
+void     bagTrackingItemKey (Bool varres, u16 mode, const void *item, u32 *key);
+bagError bagReadTrackingItems (hid_t dataset_id, hid_t datatype_id, const u32 *positions, u32 npositions, void *items);
+s32      bagTrackIndexCompareEntries (const void *a, const void *b);
+hid_t    bagSortCreateTemp  (bagHandle hnd, char *name);
+bagError bagSortIO          (hid_t dataset_id, hid_t type_id, hsize_t offset, u32 n, void *buf, Bool write);
+bagError bagSortTrackIndexEntries (bagHandle hnd, u32 nkeys, hid_t entries_id, hid_t type_id, u32 n, u8 *mem, u32 run_items);
+void     bagUnmapAllSurfaces (bagHandle hnd);
+void     bagReduceInit      (bagReduction *r);
+void     bagReduceF32       (bagReduction *r, const f32 *data, size_t n, size_t stride, f32 null_val);
+u32      bagSetReduceLevel  (u32 level);
+bagError bagMutexCreate     (bagMutex *mutex);
+void     bagMutexLock       (bagMutex mutex);
+void     bagMutexUnlock     (bagMutex mutex);
+void     bagMutexDestroy    (bagMutex mutex);
+bagError bagCondCreate      (bagCond *cond);
+void     bagCondWait        (bagCond cond, bagMutex mutex);
+void     bagCondBroadcast   (bagCond cond);
+void     bagCondDestroy     (bagCond cond);
+bagError bagThreadCreate    (bagThread *thread, void (*func) (void *), void *arg);
+void     bagThreadJoin      (bagThread thread);
+u32      bagGetNumProcessors (void);
+bagError bagParallelFor     (u32 nworkers, u32 ntasks, bagTaskFunc func, void *ctx);
+void     bagLockHDF         (void);
+void     bagUnlockHDF       (void);
+bagError bagGetSurfaceChunkDims (bagHandle hnd, s32 type, hsize_t *chunk_dims, Bool *chunked);
 bagError bagReadTrackingList(bagHandle hnd, u16 mode, u32 inp1, u32 inp2, bagTrackingItem **items, u32 *rtn_len);
 bagError bagFillPos         (bagHandle hnd, u32 r1, u32 c1 , u32 r2, u32 c2, f64 **x, f64 **y);
 bagError bagSortTrackingList(bagHandle hnd, u16 mode);
 s32 bagCompareTrackIndices  (const void *a, const void *b);
 s32 bagCompareTrackNodes    (const void *a, const void *b);
 s32 bagCompareTrackCodes    (const void *a, const void *b);
+s32 bagCompareVarResTrackIndices  (const void *a, const void *b);
+s32 bagCompareVarResTrackNodes    (const void *a, const void *b);
+s32 bagCompareVarResTrackCodes    (const void *a, const void *b);
+s32 bagCompareVarResTrackSubNodes (const void *a, const void *b);
 
 #endif
@@ -0,0 +1,339 @@
+/*! \file bag_reduce.c
+ * \brief This module contains the null-aware reductions over f32 surface values.
+ ********************************************************************
+ *
+ * Module Name : bag_reduce.c
+ *
+ * Author/Date : ONSWG, October 2026
+ *
+ * Description :
+ *               bagReduceF32 folds a run of f32 values into a bagReduction:
+ *               minimum, maximum, count, sum and sum of squares of the values
+ *               that are neither the layer's null value nor NaN.  The values
+ *               may be packed, or one field of an array of compound records
+ *               read with a stride.  The work is done by SSE2, AVX2 or
+ *               AVX-512 code chosen once, under a once guard at the first
+ *               call, from what the processor supports, with a scalar loop
+ *               elsewhere.  Sums are
+ *               accumulated in f64 in every path.
+ *
+ * Restrictions/Limitations :
+ *               The vector paths are built with GCC compatible compilers on
+ *               x86; other builds use the scalar loop only.  The order of the
+ *               additions differs between paths, so sums may differ in the
+ *               last bits; minimum, maximum and count do not.
+ *
+ * Change Descriptions :
+ * who  when      what
+ * ---  ----      ----
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ ********************************************************************/
+
+#include "bag_private.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BAG_REDUCE_X86 1
+#include <immintrin.h>
+#endif
+
+typedef void (*bagReduceKernel) (bagReduction *r, const f32 *data, size_t n, size_t stride, f32 null_val);
+
+static bagReduceKernel reduce_kernel = NULL;
+static u32             reduce_level  = BAG_REDUCE_SCALAR;
+
+/*! \brief bagReduceMerge folds a partial result into \a r */
+static void bagReduceMerge (bagReduction *r, f32 min, f32 max, hsize_t count, f64 sum, f64 sumsq)
+{
+    if (count == 0)
+        return;
+    if (min < r->min)
+        r->min = min;
+    if (max > r->max)
+        r->max = max;
+    r->count += count;
+    r->sum   += sum;
+    r->sumsq += sumsq;
+}
+
+static void reduce_scalar (bagReduction *r, const f32 *data, size_t n, size_t stride, f32 null_val)
+{
+    f32      v, min = FLT_MAX, max = -FLT_MAX;
+    f64      sum = 0.0, sumsq = 0.0;
+    hsize_t  count = 0;
+    size_t   i;
+
+    for (i = 0; i < n; i++)
+    {
+        v = data[i * stride];
+        if (v == null_val || v != v)
+            continue;
+        if (v < min)
+            min = v;
+        if (v > max)
+            max = v;
+        count++;
+        sum   += v;
+        sumsq += (f64) v * v;
+    }
+
+    bagReduceMerge (r, min, max, count, sum, sumsq);
+}
+
+#ifdef BAG_REDUCE_X86
+
+__attribute__((target("sse2")))
+static void reduce_sse2 (bagReduction *r, const f32 *data, size_t n, size_t stride, f32 null_val)
+{
+    __m128   v, m, vnull = _mm_set1_ps (null_val);
+    __m128   vmin = _mm_set1_ps (FLT_MAX), vmax = _mm_set1_ps (-FLT_MAX);
+    __m128   pinf = _mm_set1_ps (FLT_MAX), ninf = _mm_set1_ps (-FLT_MAX);
+    __m128d  lo, hi, s = _mm_setzero_pd (), q = _mm_setzero_pd ();
+    f32      lane[4];
+    f64      dl[2];
+    hsize_t  count = 0;
+    size_t   i;
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        if (stride == 1)
+            v = _mm_loadu_ps (data + i);
+        else
+            v = _mm_set_ps (data[(i + 3) * stride], data[(i + 2) * stride], data[(i + 1) * stride], data[i * stride]);
+
+        /*! cmpneq is true for NaN, so the ordered test drops those */
+        m = _mm_and_ps (_mm_cmpneq_ps (v, vnull), _mm_cmpord_ps (v, v));
+        vmin = _mm_min_ps (vmin, _mm_or_ps (_mm_and_ps (m, v), _mm_andnot_ps (m, pinf)));
+        vmax = _mm_max_ps (vmax, _mm_or_ps (_mm_and_ps (m, v), _mm_andnot_ps (m, ninf)));
+        count += __builtin_popcount (_mm_movemask_ps (m));
+
+        v  = _mm_and_ps (m, v);
+        lo = _mm_cvtps_pd (v);
+        hi = _mm_cvtps_pd (_mm_movehl_ps (v, v));
+        s  = _mm_add_pd (s, _mm_add_pd (lo, hi));
+        q  = _mm_add_pd (q, _mm_add_pd (_mm_mul_pd (lo, lo), _mm_mul_pd (hi, hi)));
+    }
+
+    if (count > 0)
+    {
+        f32 min = FLT_MAX, max = -FLT_MAX;
+        f64 sum, sumsq;
+        u32 k;
+
+        _mm_storeu_ps (lane, vmin);
+        for (k = 0; k < 4; k++)
+            min = (lane[k] < min) ? lane[k] : min;
+        _mm_storeu_ps (lane, vmax);
+        for (k = 0; k < 4; k++)
+            max = (lane[k] > max) ? lane[k] : max;
+        _mm_storeu_pd (dl, s);
+        sum = dl[0] + dl[1];
+        _mm_storeu_pd (dl, q);
+        sumsq = dl[0] + dl[1];
+        bagReduceMerge (r, min, max, count, sum, sumsq);
+    }
+
+    reduce_scalar (r, data + i * stride, n - i, stride, null_val);
+}
+
+__attribute__((target("avx2")))
+static void reduce_avx2 (bagReduction *r, const f32 *data, size_t n, size_t stride, f32 null_val)
+{
+    __m256   v, m, vnull = _mm256_set1_ps (null_val);
+    __m256   vmin = _mm256_set1_ps (FLT_MAX), vmax = _mm256_set1_ps (-FLT_MAX);
+    __m256   pinf = _mm256_set1_ps (FLT_MAX), ninf = _mm256_set1_ps (-FLT_MAX);
+    __m256d  lo, hi, s = _mm256_setzero_pd (), q = _mm256_setzero_pd ();
+    __m256i  vidx = _mm256_mullo_epi32 (_mm256_setr_epi32 (0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32 ((int) stride));
+    f32      lane[8];
+    f64      dl[4];
+    hsize_t  count = 0;
+    size_t   i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        if (stride == 1)
+            v = _mm256_loadu_ps (data + i);
+        else
+            v = _mm256_i32gather_ps (data + i * stride, vidx, 4);
+
+        /*! the ordered not-equal is false for NaN as well as for the null value */
+        m = _mm256_cmp_ps (v, vnull, _CMP_NEQ_OQ);
+        vmin = _mm256_min_ps (vmin, _mm256_blendv_ps (pinf, v, m));
+        vmax = _mm256_max_ps (vmax, _mm256_blendv_ps (ninf, v, m));
+        count += __builtin_popcount (_mm256_movemask_ps (m));
+
+        v  = _mm256_and_ps (m, v);
+        lo = _mm256_cvtps_pd (_mm256_castps256_ps128 (v));
+        hi = _mm256_cvtps_pd (_mm256_extractf128_ps (v, 1));
+        s  = _mm256_add_pd (s, _mm256_add_pd (lo, hi));
+        q  = _mm256_add_pd (q, _mm256_add_pd (_mm256_mul_pd (lo, lo), _mm256_mul_pd (hi, hi)));
+    }
+
+    if (count > 0)
+    {
+        f32 min = FLT_MAX, max = -FLT_MAX;
+        f64 sum, sumsq;
+        u32 k;
+
+        _mm256_storeu_ps (lane, vmin);
+        for (k = 0; k < 8; k++)
+            min = (lane[k] < min) ? lane[k] : min;
+        _mm256_storeu_ps (lane, vmax);
+        for (k = 0; k < 8; k++)
+            max = (lane[k] > max) ? lane[k] : max;
+        _mm256_storeu_pd (dl, s);
+        sum = (dl[0] + dl[1]) + (dl[2] + dl[3]);
+        _mm256_storeu_pd (dl, q);
+        sumsq = (dl[0] + dl[1]) + (dl[2] + dl[3]);
+        bagReduceMerge (r, min, max, count, sum, sumsq);
+    }
+
+    reduce_scalar (r, data + i * stride, n - i, stride, null_val);
+}
+
+__attribute__((target("avx512f")))
+static void reduce_avx512 (bagReduction *r, const f32 *data, size_t n, size_t stride, f32 null_val)
+{
+    __m512    v, vnull = _mm512_set1_ps (null_val);
+    __m512    vmin = _mm512_set1_ps (FLT_MAX), vmax = _mm512_set1_ps (-FLT_MAX);
+    __m512d   lo, hi, s = _mm512_setzero_pd (), q = _mm512_setzero_pd ();
+    __m512i   vidx = _mm512_mullo_epi32 (_mm512_setr_epi32 (0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+                                         _mm512_set1_epi32 ((int) stride));
+    __mmask16 m;
+    hsize_t   count = 0;
+    size_t    i;
+
+    for (i = 0; i + 16 <= n; i += 16)
+    {
+        if (stride == 1)
+            v = _mm512_loadu_ps (data + i);
+        else
+            v = _mm512_i32gather_ps (vidx, data + i * stride, 4);
+
+        m = _mm512_cmp_ps_mask (v, vnull, _CMP_NEQ_OQ);
+        vmin = _mm512_mask_min_ps (vmin, m, vmin, v);
+        vmax = _mm512_mask_max_ps (vmax, m, vmax, v);
+        count += __builtin_popcount ((unsigned) m);
+
+        v  = _mm512_maskz_mov_ps (m, v);
+        lo = _mm512_cvtps_pd (_mm512_castps512_ps256 (v));
+        hi = _mm512_cvtps_pd (_mm256_castpd_ps (_mm512_extractf64x4_pd (_mm512_castps_pd (v), 1)));
+        s  = _mm512_add_pd (s, _mm512_add_pd (lo, hi));
+        q  = _mm512_add_pd (q, _mm512_add_pd (_mm512_mul_pd (lo, lo), _mm512_mul_pd (hi, hi)));
+    }
+
+    if (count > 0)
+        bagReduceMerge (r, _mm512_reduce_min_ps (vmin), _mm512_reduce_max_ps (vmax), count,
+                        _mm512_reduce_add_pd (s), _mm512_reduce_add_pd (q));
+
+    reduce_scalar (r, data + i * stride, n - i, stride, null_val);
+}
+
+#endif /* BAG_REDUCE_X86 */
+
+/*! \brief bagSelectReduceKernel sets the kernel of the best supported level up to \a level */
+static u32 bagSelectReduceKernel (u32 level)
+{
+    bagReduceKernel kernel = reduce_scalar;
+    u32             chosen = BAG_REDUCE_SCALAR;
+
+#ifdef BAG_REDUCE_X86
+    __builtin_cpu_init ();
+    if (level >= BAG_REDUCE_AVX512 && __builtin_cpu_supports ("avx512f"))
+    {
+        kernel = reduce_avx512;
+        chosen = BAG_REDUCE_AVX512;
+    }
+    else if (level >= BAG_REDUCE_AVX2 && __builtin_cpu_supports ("avx2"))
+    {
+        kernel = reduce_avx2;
+        chosen = BAG_REDUCE_AVX2;
+    }
+    else if (level >= BAG_REDUCE_SSE2 && __builtin_cpu_supports ("sse2"))
+    {
+        kernel = reduce_sse2;
+        chosen = BAG_REDUCE_SSE2;
+    }
+#endif
+
+    reduce_kernel = kernel;
+    reduce_level  = chosen;
+    return chosen;
+}
+
+/*! the first reduction, from whichever thread, selects the kernel exactly once */
+#ifdef _WIN32
+static INIT_ONCE reduce_once = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK bagInitReduceKernel (PINIT_ONCE once, PVOID param, PVOID *context)
+{
+    (void) once; (void) param; (void) context;
+    bagSelectReduceKernel (BAG_REDUCE_AVX512);
+    return TRUE;
+}
+#define bagReduceOnce() InitOnceExecuteOnce (&reduce_once, bagInitReduceKernel, NULL, NULL)
+#else
+static pthread_once_t reduce_once = PTHREAD_ONCE_INIT;
+
+static void bagInitReduceKernel (void)
+{
+    bagSelectReduceKernel (BAG_REDUCE_AVX512);
+}
+#define bagReduceOnce() pthread_once (&reduce_once, bagInitReduceKernel)
+#endif
+
+/****************************************************************************************/
+/*! \brief bagSetReduceLevel selects the instruction set used by \a bagReduceF32
+ *
+ *  Levels the processor does not support fall back to the best one below it.  The
+ *  first reduction selects the highest level by itself; this is for testing the paths
+ *  against each other, and must not run while other threads are reducing.
+ *
+ *  \param  level   Element of \a BAG_REDUCE_LEVELS
+ *
+ *  \return The level actually selected
+ *
+ ****************************************************************************************/
+u32 bagSetReduceLevel (u32 level)
+{
+    /*! done first, so that the selection at the first reduction does not undo this one */
+    bagReduceOnce ();
+    return bagSelectReduceKernel (level);
+}
+
+/*! \brief bagReduceInit empties \a r, ready for \a bagReduceF32 */
+void bagReduceInit (bagReduction *r)
+{
+    r->min   = FLT_MAX;
+    r->max   = -FLT_MAX;
+    r->count = 0;
+    r->sum   = 0.0;
+    r->sumsq = 0.0;
+}
+
+/****************************************************************************************/
+/*! \brief bagReduceF32 folds \a n values into a reduction
+ *
+ *  \param *r         Reduction to add to, from \a bagReduceInit
+ *  \param *data      First value
+ *  \param  n         Number of values
+ *  \param  stride    Distance between values in f32 units: 1 for packed values, or the
+ *                    record size over sizeof (f32) for a field of compound records
+ *  \param  null_val  Values equal to this, and NaNs, are not counted
+ *
+ ****************************************************************************************/
+void bagReduceF32 (bagReduction *r, const f32 *data, size_t n, size_t stride, f32 null_val)
+{
+    bagReduceOnce ();
+
+    reduce_kernel (r, data, n, stride, null_val);
+}
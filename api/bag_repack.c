@@ -0,0 +1,509 @@
+/*! \file bag_repack.c
+ * \brief This module contains the copying of a BAG into a new chunk and filter layout.
+ ********************************************************************
+ *
+ * Module Name : bag_repack.c
+ *
+ * Author/Date : ONSWG, October 2026
+ *
+ * Description :
+ *               bagRepack walks every group, dataset, attribute and link
+ *               of a BAG and writes them into a new file.  Datasets of rank
+ *               one and two get their chunk shape from the chunk planner
+ *               and the compression asked for in the options; the values
+ *               are streamed through in bands of whole chunks, so memory
+ *               use is bounded by REPACK_BAND_BYTES rather than by the
+ *               size of the surfaces.  The XML metadata is a dataset and
+ *               is carried like any other.  A digital signature block at
+ *               the end of the source is not copied, since it would not
+ *               verify against the repacked bytes; the new file is signed
+ *               again with the same signature ID when a secret key is given.
+ *
+ * Restrictions/Limitations :
+ *               The destination must not exist.  External links are not
+ *               carried.  Without a secret key a signed source gives an
+ *               unsigned copy and BAG_CRYPTO_SIGNATURE_DROPPED.
+ *
+ * Change Descriptions :
+ * who  when      what
+ * ---  ----      ----
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ ********************************************************************/
+
+#include "bag_private.h"
+#include "onscrypto.h"
+
+typedef struct _t_bag_repack_group
+{
+    hid_t          dst_id;   /*!< Group of the new file receiving the links */
+    const bagData *layout;   /*!< Chunk and filter settings of the new file */
+    bagError       err;      /*!< First failure met while iterating */
+} bagRepackGroup;
+
+static bagError bagRepackGroupLinks (hid_t src_id, hid_t dst_id, const bagData *layout);
+
+/*! \brief bagRepackReclaim frees what HDF allocated for variable length values read into \a buf */
+static void bagRepackReclaim (hid_t type_id, hid_t space_id, void *buf)
+{
+    if (H5Tdetect_class (type_id, H5T_VLEN) > 0 || H5Tis_variable_str (type_id) > 0)
+        H5Dvlen_reclaim (type_id, space_id, H5P_DEFAULT, buf);
+}
+
+/****************************************************************************************/
+/*! \brief bagRepackAttributes copies every attribute of \a src_id onto \a dst_id
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ****************************************************************************************/
+static bagError bagRepackAttributes (hid_t src_id, hid_t dst_id)
+{
+    hid_t     attr_id, new_id, type_id, space_id;
+    hssize_t  npoints;
+    char      name[MAX_STR];
+    void     *buf;
+    s32       i, nattrs;
+    bagError  err = BAG_SUCCESS;
+
+    if ((nattrs = H5Aget_num_attrs (src_id)) < 0)
+        return BAG_HDF_ATTRIBUTE_OPEN_FAILURE;
+
+    for (i = 0; i < nattrs && err == BAG_SUCCESS; i++)
+    {
+        if ((attr_id = H5Aopen_idx (src_id, (unsigned) i)) < 0)
+            return BAG_HDF_ATTRIBUTE_OPEN_FAILURE;
+
+        H5Aget_name (attr_id, sizeof (name), name);
+        type_id  = H5Aget_type (attr_id);
+        space_id = H5Aget_space (attr_id);
+        npoints  = H5Sget_simple_extent_npoints (space_id);
+
+        buf = calloc ((size_t) (npoints > 0 ? npoints : 1), H5Tget_size (type_id));
+        if (buf == NULL)
+            err = BAG_MEMORY_ALLOCATION_FAILED;
+        else if (H5Aread (attr_id, type_id, buf) < 0)
+            err = BAG_HDF_READ_FAILURE;
+        else
+        {
+            if ((new_id = H5Acreate (dst_id, name, type_id, space_id, H5P_DEFAULT)) < 0)
+                err = BAG_HDF_CREATE_ATTRIBUTE_FAILURE;
+            else
+            {
+                if (H5Awrite (new_id, type_id, buf) < 0)
+                    err = BAG_HDF_WRITE_FAILURE;
+                H5Aclose (new_id);
+            }
+            bagRepackReclaim (type_id, space_id, buf);
+        }
+
+        free (buf);
+        H5Sclose (space_id);
+        H5Tclose (type_id);
+        H5Aclose (attr_id);
+    }
+
+    return err;
+}
+
+/****************************************************************************************/
+/*! \brief bagRepackCreatePlist builds the creation properties of a repacked dataset
+ *
+ *  The source properties are kept, fill value included, and the layout and filters of
+ *  rank one and two datasets are replaced: growing datasets such as the tracking lists
+ *  and the metadata are rechunked by the planner and deflated, fixed surfaces are set
+ *  up as \a bagFileCreate would, and other fixed datasets are stored contiguously.
+ *
+ ****************************************************************************************/
+static bagError bagRepackCreatePlist (hid_t src_plist, hid_t type_id, s32 rank, const hsize_t *dims,
+                                      const hsize_t *maxdims, const bagData *layout, hid_t *plist_id)
+{
+    hsize_t   plan_dims[RANK], chunk[RANK];
+    bagData   sparse_layout;
+    H5D_fill_time_t fill_time;
+    Bool      growing = False;
+    s32       i;
+    bagError  err;
+
+    if ((*plist_id = H5Pcopy (src_plist)) < 0)
+        return BAG_HDF_CREATE_PROPERTY_CLASS_FAILURE;
+
+    /*! datasets the BAG does not define are copied with their own layout */
+    if (rank < 1 || rank > RANK)
+        return BAG_SUCCESS;
+
+    if (H5Pget_nfilters (*plist_id) > 0 && H5Premove_filter (*plist_id, H5Z_FILTER_ALL) < 0)
+        return BAG_HDF_SET_PROPERTY_FAILURE;
+
+    for (i = 0; i < rank; i++)
+    {
+        plan_dims[i] = (maxdims[i] == H5S_UNLIMITED) ? 0 : dims[i];
+        if (maxdims[i] == H5S_UNLIMITED)
+            growing = True;
+    }
+
+    if (growing)
+    {
+        err = bagPlanChunks ((u32) rank, plan_dims, H5Tget_size (type_id), BAG_ACCESS_ROWS, layout->chunkBytes, chunk);
+        if (err != BAG_SUCCESS)
+            return err;
+        if (H5Pset_chunk (*plist_id, rank, chunk) < 0)
+            return BAG_HDF_SET_PROPERTY_FAILURE;
+        if (layout->compressionLevel > 9)
+            return BAG_HDF_INVALID_COMPRESSION_LEVEL;
+        if (layout->compressionLevel > 0)
+            return bagSetFilterPipeline (*plist_id, layout, type_id);
+        return BAG_SUCCESS;
+    }
+
+    if (H5Pset_layout (*plist_id, H5D_CONTIGUOUS) < 0)
+        return BAG_HDF_SET_PROPERTY_FAILURE;
+    if (rank != RANK)
+        return BAG_SUCCESS;
+
+    if ((err = bagPlanSurfaceChunks (layout, dims, H5Tget_size (type_id), chunk)) != BAG_SUCCESS)
+        return err;
+
+    /*! the surfaces of a sparse BAG stay sparse, see bagSetSurfaceFillTime */
+    sparse_layout = *layout;
+    if (H5Pget_fill_time (src_plist, &fill_time) >= 0 && fill_time == H5D_FILL_TIME_IFSET)
+        sparse_layout.sparse = 1;
+
+    return bagSetSurfaceFilters (*plist_id, &sparse_layout, type_id, chunk);
+}
+
+/****************************************************************************************/
+/*! \brief bagRepackSparseBand writes a band of a 2D dataset chunk by chunk
+ *
+ *  New chunks holding only the fill value are not written, so that they are never
+ *  allocated; they read back as the fill value all the same.  \a offset and \a count
+ *  give the band, whose first row starts a row of new chunks.
+ *
+ ****************************************************************************************/
+static bagError bagRepackSparseBand (hid_t dst_id, hid_t type_id, hid_t memspace_id, hid_t dst_space_id,
+                                     const u8 *buf, const hsize_t *offset, const hsize_t *count,
+                                     const hsize_t *chunk, size_t elem_size, const u8 *fill)
+{
+    hsize_t   r, c, i, j, mem_offset[RANK], dst_offset[RANK], tile[RANK];
+    Bool      empty;
+    bagError  err = BAG_SUCCESS;
+
+    for (r = 0; r < count[0] && err == BAG_SUCCESS; r += chunk[0])
+    {
+        for (c = 0; c < count[1] && err == BAG_SUCCESS; c += chunk[1])
+        {
+            tile[0] = (count[0] - r < chunk[0]) ? count[0] - r : chunk[0];
+            tile[1] = (count[1] - c < chunk[1]) ? count[1] - c : chunk[1];
+
+            empty = True;
+            for (i = 0; i < tile[0] && empty; i++)
+                for (j = 0; j < tile[1] && empty; j++)
+                    if (memcmp (buf + ((r + i) * count[1] + c + j) * elem_size, fill, elem_size) != 0)
+                        empty = False;
+            if (empty)
+                continue;
+
+            mem_offset[0] = r;
+            mem_offset[1] = c;
+            dst_offset[0] = offset[0] + r;
+            dst_offset[1] = c;
+            H5Sselect_hyperslab (memspace_id, H5S_SELECT_SET, mem_offset, NULL, tile, NULL);
+            H5Sselect_hyperslab (dst_space_id, H5S_SELECT_SET, dst_offset, NULL, tile, NULL);
+            if (H5Dwrite (dst_id, type_id, memspace_id, dst_space_id, H5P_DEFAULT, buf) < 0)
+                err = BAG_HDF_WRITE_FAILURE;
+        }
+    }
+
+    H5Sselect_all (memspace_id);
+    return err;
+}
+
+/****************************************************************************************/
+/*! \brief bagRepackDataset copies one dataset, with its attributes, into the new layout
+ *
+ *  The values move in bands of whole rows of chunks, tall enough that each source
+ *  chunk and each new chunk is read or written once, and no larger than
+ *  \a REPACK_BAND_BYTES unless a single band of chunks is larger.  The surfaces of a
+ *  sparse BAG are written without the chunks that hold only the fill value.
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ****************************************************************************************/
+static bagError bagRepackDataset (hid_t src_loc, hid_t dst_loc, const char *name, const bagData *layout)
+{
+    hid_t     src_id, dst_id = -1, type_id, space_id, dst_space_id, src_plist, plist_id = -1, memspace_id;
+    hsize_t   dims[H5S_MAX_RANK], maxdims[H5S_MAX_RANK], chunk[H5S_MAX_RANK];
+    hsize_t   offset[H5S_MAX_RANK], count[H5S_MAX_RANK];
+    hsize_t   src_rows = 1, dst_rows = 1, band, row_bytes, start;
+    size_t    elem_size;
+    void     *buf = NULL;
+    u8       *fill = NULL;
+    s32       i, rank;
+    bagError  err;
+    H5D_fill_time_t  fill_time;
+    H5D_fill_value_t fill_defined;
+
+    if ((src_id = H5Dopen (src_loc, name)) < 0)
+        return BAG_HDF_DATASET_OPEN_FAILURE;
+
+    type_id   = H5Dget_type (src_id);
+    space_id  = H5Dget_space (src_id);
+    src_plist = H5Dget_create_plist (src_id);
+    rank      = H5Sget_simple_extent_dims (space_id, dims, maxdims);
+    elem_size = H5Tget_size (type_id);
+
+    if (rank > 0 && H5Pget_layout (src_plist) == H5D_CHUNKED && H5Pget_chunk (src_plist, rank, chunk) == rank)
+        src_rows = chunk[0];
+
+    err = bagRepackCreatePlist (src_plist, type_id, rank, dims, maxdims, layout, &plist_id);
+    if (err == BAG_SUCCESS)
+    {
+        if ((dst_id = H5Dcreate (dst_loc, name, type_id, space_id, plist_id)) < 0)
+            err = BAG_HDF_CREATE_DATASET_FAILURE;
+        else
+            err = bagRepackAttributes (src_id, dst_id);
+    }
+
+    if (err == BAG_SUCCESS && rank > 0 && H5Sget_simple_extent_npoints (space_id) > 0)
+    {
+        if (H5Pget_layout (plist_id) == H5D_CHUNKED && H5Pget_chunk (plist_id, rank, chunk) == rank)
+        {
+            dst_rows = chunk[0];
+
+            /*! a sparse surface keeps its chunks of fill values unallocated */
+            if (rank == RANK && H5Pget_fill_time (plist_id, &fill_time) >= 0 && fill_time == H5D_FILL_TIME_IFSET &&
+                H5Pfill_value_defined (plist_id, &fill_defined) >= 0 && fill_defined != H5D_FILL_VALUE_UNDEFINED &&
+                (fill = malloc (elem_size)) != NULL &&
+                H5Pget_fill_value (plist_id, type_id, fill) < 0)
+            {
+                free (fill);
+                fill = NULL;
+            }
+        }
+
+        row_bytes = elem_size;
+        for (i = 1; i < rank; i++)
+            row_bytes *= dims[i];
+
+        /*! whole new chunks, covering whole source chunks, widened up to the band budget */
+        band = dst_rows * ((src_rows + dst_rows - 1) / dst_rows);
+        if (band * row_bytes < REPACK_BAND_BYTES)
+            band *= REPACK_BAND_BYTES / (band * row_bytes);
+        if (band > dims[0])
+            band = dims[0];
+
+        dst_space_id = H5Scopy (space_id);
+        if ((buf = malloc ((size_t) (band * row_bytes))) == NULL)
+            err = BAG_MEMORY_ALLOCATION_FAILED;
+
+        for (start = 0; start < dims[0] && err == BAG_SUCCESS; start += band)
+        {
+            offset[0] = start;
+            count[0]  = (dims[0] - start < band) ? dims[0] - start : band;
+            for (i = 1; i < rank; i++)
+            {
+                offset[i] = 0;
+                count[i]  = dims[i];
+            }
+
+            memspace_id = H5Screate_simple (rank, count, NULL);
+            H5Sselect_hyperslab (space_id, H5S_SELECT_SET, offset, NULL, count, NULL);
+            H5Sselect_hyperslab (dst_space_id, H5S_SELECT_SET, offset, NULL, count, NULL);
+
+            if (H5Dread (src_id, type_id, memspace_id, space_id, H5P_DEFAULT, buf) < 0)
+                err = BAG_HDF_READ_FAILURE;
+            else
+            {
+                if (fill != NULL)
+                    err = bagRepackSparseBand (dst_id, type_id, memspace_id, dst_space_id, (const u8 *) buf,
+                                               offset, count, chunk, elem_size, fill);
+                else if (H5Dwrite (dst_id, type_id, memspace_id, dst_space_id, H5P_DEFAULT, buf) < 0)
+                    err = BAG_HDF_WRITE_FAILURE;
+                bagRepackReclaim (type_id, memspace_id, buf);
+            }
+            H5Sclose (memspace_id);
+        }
+
+        free (buf);
+        free (fill);
+        H5Sclose (dst_space_id);
+    }
+    else if (err == BAG_SUCCESS && rank == 0)
+    {
+        /*! a scalar dataset is a single value */
+        if ((buf = calloc (1, elem_size)) == NULL)
+            err = BAG_MEMORY_ALLOCATION_FAILED;
+        else if (H5Dread (src_id, type_id, H5S_ALL, H5S_ALL, H5P_DEFAULT, buf) < 0)
+            err = BAG_HDF_READ_FAILURE;
+        else
+        {
+            if (H5Dwrite (dst_id, type_id, H5S_ALL, H5S_ALL, H5P_DEFAULT, buf) < 0)
+                err = BAG_HDF_WRITE_FAILURE;
+            bagRepackReclaim (type_id, space_id, buf);
+        }
+        free (buf);
+    }
+
+    if (dst_id >= 0)
+        H5Dclose (dst_id);
+    if (plist_id >= 0)
+        H5Pclose (plist_id);
+    H5Pclose (src_plist);
+    H5Sclose (space_id);
+    H5Tclose (type_id);
+    H5Dclose (src_id);
+
+    return err;
+}
+
+/*! \brief bagRepackLink copies one link of a group, and what it leads to, for H5Literate */
+static herr_t bagRepackLink (hid_t src_id, const char *name, const H5L_info_t *info, void *op_data)
+{
+    bagRepackGroup *grp = (bagRepackGroup *) op_data;
+    hid_t           obj_id, new_id;
+    char            target[MAX_STR];
+
+    if (info->type == H5L_TYPE_SOFT)
+    {
+        if (H5Lget_val (src_id, name, target, sizeof (target), H5P_DEFAULT) < 0 ||
+            H5Lcreate_soft (target, grp->dst_id, name, H5P_DEFAULT, H5P_DEFAULT) < 0)
+            grp->err = BAG_HDF_CREATE_GROUP_FAILURE;
+        return (grp->err == BAG_SUCCESS) ? 0 : -1;
+    }
+    if (info->type != H5L_TYPE_HARD)
+        return 0;
+
+    if ((obj_id = H5Oopen (src_id, name, H5P_DEFAULT)) < 0)
+    {
+        grp->err = BAG_HDF_INTERNAL_ERROR;
+        return -1;
+    }
+
+    switch (H5Iget_type (obj_id))
+    {
+    case H5I_GROUP:
+        if ((new_id = H5Gcreate (grp->dst_id, name, 0)) < 0)
+        {
+            grp->err = BAG_HDF_CREATE_GROUP_FAILURE;
+            break;
+        }
+        if ((grp->err = bagRepackAttributes (obj_id, new_id)) == BAG_SUCCESS)
+            grp->err = bagRepackGroupLinks (obj_id, new_id, grp->layout);
+        H5Gclose (new_id);
+        break;
+    case H5I_DATASET:
+        grp->err = bagRepackDataset (src_id, grp->dst_id, name, grp->layout);
+        break;
+    default:
+        /*! named datatypes and anything else are copied as they are */
+        if (H5Ocopy (src_id, name, grp->dst_id, name, H5P_DEFAULT, H5P_DEFAULT) < 0)
+            grp->err = BAG_HDF_TYPE_COPY_FAILURE;
+        break;
+    }
+
+    H5Oclose (obj_id);
+    return (grp->err == BAG_SUCCESS) ? 0 : -1;
+}
+
+/*! \brief bagRepackGroupLinks copies every link of the group \a src_id into \a dst_id */
+static bagError bagRepackGroupLinks (hid_t src_id, hid_t dst_id, const bagData *layout)
+{
+    bagRepackGroup grp;
+
+    grp.dst_id = dst_id;
+    grp.layout = layout;
+    grp.err    = BAG_SUCCESS;
+
+    if (H5Literate (src_id, H5_INDEX_NAME, H5_ITER_INC, NULL, bagRepackLink, &grp) < 0 && grp.err == BAG_SUCCESS)
+        grp.err = BAG_HDF_INTERNAL_ERROR;
+
+    return grp.err;
+}
+
+static bagError bagRepackUnlocked (const u8 *src_name, const u8 *dst_name, const bagData *layout)
+{
+    hid_t     src_id, dst_id, fcpl_id, src_root, dst_root;
+    bagError  err;
+
+    if ((src_id = H5Fopen ((char *) src_name, H5F_ACC_RDONLY, H5P_DEFAULT)) < 0)
+        return BAG_HDF_FILE_OPEN_FAILURE;
+
+    /*! the creation properties, user block included, are those of the source */
+    fcpl_id = H5Fget_create_plist (src_id);
+    dst_id  = H5Fcreate ((char *) dst_name, H5F_ACC_EXCL, fcpl_id, H5P_DEFAULT);
+    H5Pclose (fcpl_id);
+    if (dst_id < 0)
+    {
+        H5Fclose (src_id);
+        return BAG_HDF_CREATE_FILE_FAILURE;
+    }
+
+    src_root = H5Gopen (src_id, "/");
+    dst_root = H5Gopen (dst_id, "/");
+
+    if ((err = bagRepackAttributes (src_root, dst_root)) == BAG_SUCCESS)
+        err = bagRepackGroupLinks (src_root, dst_root, layout);
+
+    H5Gclose (dst_root);
+    H5Gclose (src_root);
+    if (H5Fclose (dst_id) < 0 && err == BAG_SUCCESS)
+        err = BAG_HDF_FILE_CLOSE_FAILURE;
+    H5Fclose (src_id);
+
+    return err;
+}
+
+/****************************************************************************************/
+/*! \brief bagRepack copies a BAG into a new file with new chunking and compression
+ *
+ *  \param *src_name   Path of the BAG to copy
+ *  \param *dst_name   Path of the new BAG, which must not exist
+ *  \param *opts       Chunk and filter layout of the new file, and the key to re-sign with
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li If the source is signed and no key was given, the copy is complete
+ *                but unsigned, and \a bagError is set to \a BAG_CRYPTO_SIGNATURE_DROPPED.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ********************************************************************/
+bagError bagRepack (const u8 *src_name, const u8 *dst_name, const bagRepackOptions *opts)
+{
+    bagData   layout;
+    u8        sig[ONS_CRYPTO_MAX_SIG_LEN];
+    u32       sigID;
+    bagError  err;
+
+    if (src_name == NULL || dst_name == NULL || opts == NULL)
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+
+    memset (&layout, 0, sizeof (layout));
+    layout.compressionLevel = opts->compressionLevel;
+    layout.filter           = opts->filter;
+    layout.accessHint       = opts->accessHint;
+    layout.chunkSize        = opts->chunkSize;
+    layout.chunkBytes       = opts->chunkBytes;
+
+    bagLockHDF ();
+    err = bagRepackUnlocked (src_name, dst_name, &layout);
+    bagUnlockHDF ();
+
+    if (err != BAG_SUCCESS)
+        return err;
+
+    /*! the signature block sits past the end of the HDF data, outside the copy */
+    err = bagReadCertification ((char *) src_name, sig, sizeof (sig), &sigID);
+    if (err == BAG_CRYPTO_NO_SIGNATURE_FOUND)
+        return BAG_SUCCESS;
+    if (err != BAG_SUCCESS && err != BAG_CRYPTO_SIGNATURE_OK)
+        return err;
+
+    /*! the old signature is over the old bytes, so it is never copied */
+    if (opts->secKey == NULL)
+        return BAG_CRYPTO_SIGNATURE_DROPPED;
+
+    return bagSignFile ((char *) dst_name, opts->secKey, sigID) ? BAG_SUCCESS : BAG_CRYPTO_GENERAL_ERROR;
+}
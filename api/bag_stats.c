@@ -0,0 +1,429 @@
+/*! \file bag_stats.c
+ * \brief This module contains the per-layer statistics stored as attributes of the surfaces.
+ ********************************************************************
+ *
+ * Module Name : bag_stats.c
+ *
+ * Author/Date : ONSWG, October 2026
+ *
+ * Description :
+ *               bagComputeLayerStats reads a layer once, row by row, and
+ *               stores, for each of its f32 fields, the number of values,
+ *               the number of null nodes, the mean, the variance and a
+ *               histogram of BAG_STATS_BINS bins as attributes of the
+ *               layer's dataset.  bagReadLayerStats reads them back without
+ *               touching the data.
+ *
+ *               The histogram range is not known until the pass ends, so it
+ *               starts at the range of the first values and is doubled, bins
+ *               merged pairwise, whenever later values fall outside it.  The
+ *               bins therefore cover the values found with some margin.
+ *               Each window's mean comes from the sums of \a bagReduceF32 and
+ *               its squared deviations from a second look at the values, made
+ *               in the histogram pass; the windows are then merged (Chan et
+ *               al.).  The variance stored is the population variance.
+ *
+ * Restrictions/Limitations :
+ *               Only f32 fields are summarized: the u32 counts of the
+ *               compound layers and the VarRes metadata are not.  Optional
+ *               layers must have been opened with bagGetOptDatasetInfo.
+ *
+ * Change Descriptions :
+ * who  when      what
+ * ---  ----      ----
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *               Chan, Golub and LeVeque, "Updating formulae and a pairwise
+ *               algorithm for computing sample variances", 1979.
+ *
+ ********************************************************************/
+
+#include "bag_private.h"
+
+#define STATS_WINDOW   (1024*1024)     /*!< Most values read at once; VarRes layers are one long row */
+#define STATS_MAX_FIELDS 2
+
+/*! \brief An f32 field of a layer summarized by bagComputeLayerStats */
+typedef struct _t_bagStatsField {
+    s32         type;
+    const char *name;           /*!< Suffix of the attribute names */
+    size_t      record;         /*!< Bytes of one node of the layer */
+    size_t      offset;         /*!< Byte offset of the field in a node */
+    f32         null_val;
+} bagStatsField;
+
+static const bagStatsField stats_fields[] = {
+    { Elevation,                "elevation",       sizeof (f32), 0, BAG_NULL_ELEVATION },
+    { Uncertainty,              "uncertainty",     sizeof (f32), 0, BAG_NULL_UNCERTAINTY },
+    { Num_Hypotheses,           "value",           sizeof (f32), 0, BAG_NULL_GENERIC },
+    { Average,                  "value",           sizeof (f32), 0, BAG_NULL_GENERIC },
+    { Standard_Dev,             "value",           sizeof (f32), 0, BAG_NULL_GENERIC },
+    { Nominal_Elevation,        "value",           sizeof (f32), 0, BAG_NULL_GENERIC },
+    { Node_Group,               "hyp_strength",    sizeof (bagOptNodeGroup), HOFFSET (bagOptNodeGroup, hyp_strength), BAG_NULL_GENERIC },
+    { Elevation_Solution_Group, "shoal_elevation", sizeof (bagOptElevationSolutionGroup), HOFFSET (bagOptElevationSolutionGroup, shoal_elevation), BAG_NULL_GENERIC },
+    { Elevation_Solution_Group, "stddev",          sizeof (bagOptElevationSolutionGroup), HOFFSET (bagOptElevationSolutionGroup, stddev), BAG_NULL_GENERIC },
+    { VarRes_Refinement_Group,  "depth",           sizeof (bagVarResRefinementGroup), HOFFSET (bagVarResRefinementGroup, depth), BAG_NULL_ELEVATION },
+    { VarRes_Refinement_Group,  "depth_uncrt",     sizeof (bagVarResRefinementGroup), HOFFSET (bagVarResRefinementGroup, depth_uncrt), BAG_NULL_UNCERTAINTY },
+    { VarRes_Node_Group,        "hyp_strength",    sizeof (bagVarResNodeGroup), HOFFSET (bagVarResNodeGroup, hyp_strength), BAG_NULL_GENERIC }
+};
+
+#define STATS_NFIELDS (sizeof (stats_fields) / sizeof (stats_fields[0]))
+
+/*! \brief Running summary of one field during the pass */
+typedef struct _t_bagStatsAccum {
+    const bagStatsField *field;
+    f64     count, mean, m2;
+    f64     lo, width;              /*!< Histogram bin i covers [lo + i*width, lo + (i+1)*width) */
+    Bool    ranged;                 /*!< False until the first value sets lo */
+    f64     bins[BAG_STATS_BINS];
+} bagStatsAccum;
+
+/*! \brief bagStatsLayerFields collects the fields of \a type, returning how many there are */
+static u32 bagStatsLayerFields (s32 type, const bagStatsField **fields)
+{
+    u32 i, n = 0;
+
+    for (i = 0; i < STATS_NFIELDS && n < STATS_MAX_FIELDS; i++)
+        if (stats_fields[i].type == type)
+            fields[n++] = &stats_fields[i];
+    return n;
+}
+
+/*! \brief bagStatsLayerIds gives the dataset and grid extents of an open layer */
+static bagError bagStatsLayerIds (bagHandle hnd, s32 type, hid_t *dataset_id, u32 *nrows, u32 *ncols)
+{
+    if (type == Elevation || type == Uncertainty)
+    {
+        *dataset_id = (type == Elevation) ? hnd->elv_dataset_id : hnd->unc_dataset_id;
+        *nrows      = hnd->bag.def.nrows;
+        *ncols      = hnd->bag.def.ncols;
+    }
+    else
+    {
+        *dataset_id = hnd->opt_dataset_id[type];
+        *nrows      = hnd->bag.opt[type].nrows;
+        *ncols      = hnd->bag.opt[type].ncols;
+    }
+
+    if (*dataset_id < 0)
+        return BAG_HDF_DATASET_OPEN_FAILURE;
+    return BAG_SUCCESS;
+}
+
+/*! \brief bagStatsWiden doubles the histogram range of \a a until it holds [min, max] */
+static void bagStatsWiden (bagStatsAccum *a, f64 min, f64 max)
+{
+    u32 i, k;
+
+    if (!a->ranged)
+    {
+        a->lo     = min;
+        a->width  = (max - min) / BAG_STATS_BINS;
+        a->ranged = True;
+        return;
+    }
+
+    /*! every value so far was a->lo; spread the range and move their bin */
+    if (a->width == 0.0)
+    {
+        f64 lo = (min < a->lo) ? min : a->lo;
+        f64 hi = (max > a->lo) ? max : a->lo;
+
+        if (hi == lo)
+            return;
+        a->width = (hi - lo) / BAG_STATS_BINS;
+        k = (u32) ((a->lo - lo) / a->width);
+        if (k >= BAG_STATS_BINS)
+            k = BAG_STATS_BINS - 1;
+        if (k != 0)
+        {
+            a->bins[k] = a->bins[0];
+            a->bins[0] = 0.0;
+        }
+        a->lo = lo;
+        return;
+    }
+
+    while (max > a->lo + BAG_STATS_BINS * a->width)
+    {
+        for (i = 0; i < BAG_STATS_BINS / 2; i++)
+            a->bins[i] = a->bins[2 * i] + a->bins[2 * i + 1];
+        for (; i < BAG_STATS_BINS; i++)
+            a->bins[i] = 0.0;
+        a->width *= 2.0;
+    }
+    while (min < a->lo)
+    {
+        for (i = BAG_STATS_BINS; i-- > BAG_STATS_BINS / 2; )
+            a->bins[i] = a->bins[2 * i - BAG_STATS_BINS] + a->bins[2 * i - BAG_STATS_BINS + 1];
+        for (i = 0; i < BAG_STATS_BINS / 2; i++)
+            a->bins[i] = 0.0;
+        a->lo    -= BAG_STATS_BINS * a->width;
+        a->width *= 2.0;
+    }
+}
+
+/*! \brief bagStatsFold adds \a n nodes starting at \a buf to the summary of one field */
+static void bagStatsFold (bagStatsAccum *a, const u8 *buf, size_t n)
+{
+    const bagStatsField *f = a->field;
+    const f32           *v = (const f32 *) (buf + f->offset);
+    size_t               stride = f->record / sizeof (f32), i;
+    bagReduction         r;
+    f64                  mean, m2, delta, total;
+    s32                  k;
+
+    bagReduceInit (&r);
+    bagReduceF32 (&r, v, n, stride, f->null_val);
+    if (r.count == 0)
+        return;
+
+    /*! the window's squared deviations are taken about its own mean, in the histogram
+     *  pass, since sumsq - sum * mean cancels when the spread is small against the mean */
+    mean = r.sum / (f64) r.count;
+    m2   = 0.0;
+
+    bagStatsWiden (a, r.min, r.max);
+    for (i = 0; i < n; i++)
+    {
+        f32 x = v[i * stride];
+
+        if (x == f->null_val || x != x)
+            continue;
+        m2 += ((f64) x - mean) * ((f64) x - mean);
+        k = (a->width > 0.0) ? (s32) ((x - a->lo) / a->width) : 0;
+        if (k >= BAG_STATS_BINS)
+            k = BAG_STATS_BINS - 1;
+        else if (k < 0)
+            k = 0;
+        a->bins[k] += 1.0;
+    }
+
+    /*! merge the window's moments into the running ones */
+    total = a->count + (f64) r.count;
+    delta = mean - a->mean;
+    a->mean += delta * (f64) r.count / total;
+    a->m2   += m2 + delta * delta * a->count * (f64) r.count / total;
+    a->count = total;
+}
+
+/*! \brief bagStatsAttrName builds "<what>_<field>" into \a name */
+static char *bagStatsAttrName (char *name, const char *what, const char *field)
+{
+    sprintf (name, "%s_%s", what, field);
+    return name;
+}
+
+/*! \brief bagStatsWriteAttr writes \a n f64 values to an attribute, creating it if needed */
+static bagError bagStatsWriteAttr (hid_t loc_id, const char *name, const f64 *values, hsize_t n)
+{
+    hid_t   attribute_id, dataspace_id;
+    herr_t  status;
+
+    if (H5Aexists (loc_id, name) > 0)
+        attribute_id = H5Aopen_name (loc_id, name);
+    else
+    {
+        if (n == 1)
+            dataspace_id = H5Screate (H5S_SCALAR);
+        else
+            dataspace_id = H5Screate_simple (1, &n, NULL);
+        if (dataspace_id < 0)
+            return BAG_HDF_DATASPACE_CORRUPTED;
+        attribute_id = H5Acreate (loc_id, name, H5T_NATIVE_DOUBLE, dataspace_id, H5P_DEFAULT);
+        H5Sclose (dataspace_id);
+        if (attribute_id < 0)
+            return BAG_HDF_CREATE_ATTRIBUTE_FAILURE;
+    }
+    if (attribute_id < 0)
+        return BAG_HDF_ATTRIBUTE_OPEN_FAILURE;
+
+    status = H5Awrite (attribute_id, H5T_NATIVE_DOUBLE, values);
+    H5Aclose (attribute_id);
+    check_hdf_status();
+
+    return BAG_SUCCESS;
+}
+
+/*! \brief bagStatsReadAttr reads an f64 attribute written by bagStatsWriteAttr */
+static bagError bagStatsReadAttr (hid_t loc_id, const char *name, f64 *values)
+{
+    hid_t   attribute_id;
+    herr_t  status;
+
+    if (H5Aexists (loc_id, name) <= 0)
+        return BAG_HDF_ATTRIBUTE_OPEN_FAILURE;
+    if ((attribute_id = H5Aopen_name (loc_id, name)) < 0)
+        return BAG_HDF_ATTRIBUTE_OPEN_FAILURE;
+
+    status = H5Aread (attribute_id, H5T_NATIVE_DOUBLE, values);
+    H5Aclose (attribute_id);
+    check_hdf_status();
+
+    return BAG_SUCCESS;
+}
+
+static bagError bagComputeLayerStatsUnlocked (bagHandle hnd, s32 type)
+{
+    const bagStatsField *fields[STATS_MAX_FIELDS];
+    bagStatsAccum        acc[STATS_MAX_FIELDS];
+    bagError             err = BAG_SUCCESS;
+    hid_t                dataset_id;
+    u32                  nfields, nrows, ncols, row, col, end_col, f;
+    size_t               window;
+    u8                  *buf;
+    char                 name[64];
+    f64                  value, range[2];
+
+    if ((nfields = bagStatsLayerFields (type, fields)) == 0)
+        return BAG_HDF_TYPE_NOT_FOUND;
+    if ((err = bagStatsLayerIds (hnd, type, &dataset_id, &nrows, &ncols)) != BAG_SUCCESS)
+        return err;
+
+    memset (acc, 0, sizeof (acc));
+    for (f = 0; f < nfields; f++)
+        acc[f].field = fields[f];
+
+    window = (ncols < STATS_WINDOW) ? ncols : STATS_WINDOW;
+    if (window > 0 && (buf = malloc (window * fields[0]->record)) == NULL)
+        return BAG_MEMORY_ALLOCATION_FAILED;
+
+    /*! one pass over the layer; every field of a node comes with the same read */
+    for (row = 0; row < nrows && window > 0; row++)
+    {
+        for (col = 0; col < ncols; col = end_col + 1)
+        {
+            end_col = (ncols - col > window) ? col + (u32) window - 1 : ncols - 1;
+            if ((err = bagReadRow (hnd, row, col, end_col, type, buf)) != BAG_SUCCESS)
+            {
+                free (buf);
+                return err;
+            }
+            for (f = 0; f < nfields; f++)
+                bagStatsFold (&acc[f], buf, end_col - col + 1);
+        }
+    }
+    if (window > 0)
+        free (buf);
+
+    for (f = 0; f < nfields && err == BAG_SUCCESS; f++)
+    {
+        range[0] = acc[f].lo;
+        range[1] = acc[f].lo + BAG_STATS_BINS * acc[f].width;
+
+        err = bagStatsWriteAttr (dataset_id, bagStatsAttrName (name, "count", fields[f]->name), &acc[f].count, 1);
+        if (err == BAG_SUCCESS)
+        {
+            value = (f64) nrows * ncols - acc[f].count;
+            err = bagStatsWriteAttr (dataset_id, bagStatsAttrName (name, "null_count", fields[f]->name), &value, 1);
+        }
+        if (err == BAG_SUCCESS)
+            err = bagStatsWriteAttr (dataset_id, bagStatsAttrName (name, "mean", fields[f]->name), &acc[f].mean, 1);
+        if (err == BAG_SUCCESS)
+        {
+            value = (acc[f].count > 0.0) ? acc[f].m2 / acc[f].count : 0.0;
+            err = bagStatsWriteAttr (dataset_id, bagStatsAttrName (name, "variance", fields[f]->name), &value, 1);
+        }
+        if (err == BAG_SUCCESS)
+            err = bagStatsWriteAttr (dataset_id, bagStatsAttrName (name, "histogram_range", fields[f]->name), range, 2);
+        if (err == BAG_SUCCESS)
+            err = bagStatsWriteAttr (dataset_id, bagStatsAttrName (name, "histogram", fields[f]->name), acc[f].bins, BAG_STATS_BINS);
+    }
+
+    return err;
+}
+
+/****************************************************************************************/
+/*! \brief bagComputeLayerStats summarizes every f32 field of a layer in one pass
+ *
+ *  \param  hnd    External reference to the private \a bagHandle object, opened for write
+ *  \param  type   Layer to summarize, element of \a BAG_SURFACE_PARAMS
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ****************************************************************************************/
+bagError bagComputeLayerStats (bagHandle hnd, s32 type)
+{
+    bagError err;
+
+    if (hnd == NULL)
+        return BAG_INVALID_BAG_HANDLE;
+
+    bagLockHDF ();
+    err = bagComputeLayerStatsUnlocked (hnd, type);
+    bagUnlockHDF ();
+
+    return err;
+}
+
+static bagError bagReadLayerStatsUnlocked (bagHandle hnd, s32 type, const char *field, bagLayerStats *stats)
+{
+    const bagStatsField *fields[STATS_MAX_FIELDS];
+    bagError             err;
+    hid_t                dataset_id;
+    u32                  nfields, nrows, ncols, f;
+    char                 name[64];
+    f64                  range[2];
+
+    if ((nfields = bagStatsLayerFields (type, fields)) == 0)
+        return BAG_HDF_TYPE_NOT_FOUND;
+    for (f = 0; f < nfields; f++)
+        if (field == NULL || strcmp (field, fields[f]->name) == 0)
+            break;
+    if (f == nfields)
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+    if ((err = bagStatsLayerIds (hnd, type, &dataset_id, &nrows, &ncols)) != BAG_SUCCESS)
+        return err;
+
+    field = fields[f]->name;
+    err = bagStatsReadAttr (dataset_id, bagStatsAttrName (name, "count", field), &stats->count);
+    if (err == BAG_SUCCESS)
+        err = bagStatsReadAttr (dataset_id, bagStatsAttrName (name, "null_count", field), &stats->null_count);
+    if (err == BAG_SUCCESS)
+        err = bagStatsReadAttr (dataset_id, bagStatsAttrName (name, "mean", field), &stats->mean);
+    if (err == BAG_SUCCESS)
+        err = bagStatsReadAttr (dataset_id, bagStatsAttrName (name, "variance", field), &stats->variance);
+    if (err == BAG_SUCCESS)
+        err = bagStatsReadAttr (dataset_id, bagStatsAttrName (name, "histogram_range", field), range);
+    if (err == BAG_SUCCESS)
+        err = bagStatsReadAttr (dataset_id, bagStatsAttrName (name, "histogram", field), stats->histogram);
+    if (err == BAG_SUCCESS)
+    {
+        stats->histogram_min = range[0];
+        stats->histogram_max = range[1];
+    }
+
+    return err;
+}
+
+/****************************************************************************************/
+/*! \brief bagReadLayerStats reads the summary stored by \a bagComputeLayerStats
+ *
+ *  \param  hnd      External reference to the private \a bagHandle object
+ *  \param  type     Layer, element of \a BAG_SURFACE_PARAMS
+ *  \param *field    Field of a compound layer, such as "hyp_strength"; NULL for the first
+ *  \param *stats    Receives the summary
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS;
+ *                \a BAG_HDF_ATTRIBUTE_OPEN_FAILURE when the layer was never summarized.
+ *
+ ****************************************************************************************/
+bagError bagReadLayerStats (bagHandle hnd, s32 type, const char *field, bagLayerStats *stats)
+{
+    bagError err;
+
+    if (hnd == NULL)
+        return BAG_INVALID_BAG_HANDLE;
+    if (stats == NULL)
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+
+    bagLockHDF ();
+    err = bagReadLayerStatsUnlocked (hnd, type, field, stats);
+    bagUnlockHDF ();
+
+    return err;
+}
@@ -134,8 +134,9 @@ bagError bagReadNodePos (bagHandle bag, u32 row, u32 col, s32 type, void *data,
  *  -Uses element select(prone to memory leaks though), instead of hyperslab 
  *
  ****************************************************************************************/
-bagError bagAlignNode (bagHandle bagHandle, u32 row, u32 col, s32 type, void *data, s32 read_or_write)
+static bagError bagAlignNodeUnlocked (bagHandle bagHandle, u32 row, u32 col, s32 type, void *data, s32 read_or_write)
 {
+    bagError       err;
     u32            srow, scol;
     herr_t         status;
     hsize_t        snode[2] = {1,1};
@@ -181,126 +182,279 @@ bagError bagAlignNode (bagHandle bagHandle, u32 row, u32 col, s32 type, void *da
     offset[0][0] = row;
     offset[0][1] = col;
     
-    /*!
-     * Depending on the type: 
-     *       set the memspace_id to the correct unit for 
-     *       this kind of surface and snode
-     */
-    switch (type)
+    /*! the single node memspace comes from the handle's cache */
+    if ((err = bagGetSurfaceIds (bagHandle, type, &dataset_id, &datatype_id, &filespace_id, &srow, &scol)) != BAG_SUCCESS)
+        return err;
+    if ((err = bagGetMemspace (bagHandle, type, snode, &memspace_id)) != BAG_SUCCESS)
+        return err;
+
+    /*! Select grid cell within dataset file space. */
+    status = H5Sselect_elements (filespace_id, H5S_SELECT_SET, 1, (const hsize_t *)offset);
+    check_hdf_status();
+    
+    /*!  perform read_or_write on element */
+    if (read_or_write == READ_BAG)
+        status = H5Dread (dataset_id, datatype_id, memspace_id, filespace_id, 
+                          H5P_DEFAULT, data);
+    else if (read_or_write == WRITE_BAG)
+        status = H5Dwrite (dataset_id, datatype_id, memspace_id, filespace_id, 
+                           H5P_DEFAULT, data);
+    check_hdf_status();
+
+    if (read_or_write == WRITE_BAG)
     {
-        u32 nct=0;
-    case Elevation:
-        
-        if (bagHandle->elv_memspace_id >= 0)
-        {
-            nct = (u32)H5Sget_select_npoints (bagHandle->elv_memspace_id);
-        }
+        bagFoldSurfaceStats (bagHandle, type, (const f32 *) data, 1, 1, 1);
+        bagMarkSurfaceRows (bagHandle, type, row, row);
+    }
 
-        if (bagHandle->elv_memspace_id < 0 || nct != snode[1])
-        {
-            if (bagHandle->elv_memspace_id >= 0)
-            {
-                 status = H5Sclose (bagHandle->elv_memspace_id);
-                 check_hdf_status();
-            }
+    return BAG_SUCCESS;
+}
 
-            /*! Create space in memory */
-            bagHandle->elv_memspace_id = H5Screate_simple(RANK, snode, NULL);
-            if (bagHandle->elv_memspace_id < 0)
-            {
-                return BAG_HDF_DATASPACE_CORRUPTED;
-            }
-        }
+bagError bagAlignNode (bagHandle bagHandle, u32 row, u32 col, s32 type, void *data, s32 read_or_write)
+{
+    bagError err;
 
-        datatype_id  = bagHandle->elv_datatype_id;
-        memspace_id  = bagHandle->elv_memspace_id;
-        filespace_id = bagHandle->elv_filespace_id;
-        dataset_id   = bagHandle->elv_dataset_id;
-        break;
-    case Uncertainty:
+    bagLockHDF ();
+    err = bagAlignNodeUnlocked (bagHandle, row, col, type, data, read_or_write);
+    bagUnlockHDF ();
 
-        if (bagHandle->unc_memspace_id >= 0)
-            nct = (u32)H5Sget_select_npoints (bagHandle->unc_memspace_id);
+    return err;
+}
 
-        if (bagHandle->unc_memspace_id < 0 || nct != snode[1])
-        {
-            if (bagHandle->unc_memspace_id >= 0)
-            {
-                 status = H5Sclose (bagHandle->unc_memspace_id);
-                 check_hdf_status();
-            }
+/****************************************************************************************/
+/*! \brief : bagWriteNodes
+ *
+ * Description : 
+ *    Write an arbitrary set of nodes of a surface in as few HDF calls as possible.
+ *    Node i is at \a rows[i], \a cols[i] and its value is element i of \a *data.
+ * 
+ *  \param  bagHandle   External reference to the private \a bagHandle object
+ *  \param  nnodes      Number of nodes in \a *rows, \a *cols and \a *data
+ *  \param *rows        Row of each node
+ *  \param *cols        Col of each node
+ *  \param  type        Indicates which data surface type to access, element of \a BAG_SURFACE_PARAMS
+ *  \param *data        \a nnodes elements of the surface's element type
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ * 
+ ****************************************************************************************/
+bagError bagWriteNodes (bagHandle bagHandle, u32 nnodes, const u32 *rows, const u32 *cols, s32 type, const void *data)
+{
+    return bagAlignNodes (bagHandle, nnodes, rows, cols, type, (void *) data, NULL, WRITE_BAG);
+}
+
+/****************************************************************************************/
+/*! \brief : bagReadNodes
+ *
+ * Description : 
+ *    Read an arbitrary set of nodes of a surface in as few HDF calls as possible.
+ *    Node i is at \a rows[i], \a cols[i] and its value lands in element i of \a *data.
+ * 
+ *  \param  bagHandle   External reference to the private \a bagHandle object
+ *  \param  nnodes      Number of nodes in \a *rows, \a *cols and \a *data
+ *  \param *rows        Row of each node
+ *  \param *cols        Col of each node
+ *  \param  type        Indicates which data surface type to access, element of \a BAG_SURFACE_PARAMS
+ *  \param *data        Room for \a nnodes elements of the surface's element type
+ *  \param *valid       Optional, may be NULL.  When given, nodes outside the surface are
+ *                      skipped rather than failing the call, and \a valid[i] is set to
+ *                      \a True only for nodes that were read and, on single valued
+ *                      layers, do not hold the null value.
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ * 
+ ****************************************************************************************/
+bagError bagReadNodes (bagHandle bagHandle, u32 nnodes, const u32 *rows, const u32 *cols, s32 type, void *data, Bool *valid)
+{
+    return bagAlignNodes (bagHandle, nnodes, rows, cols, type, data, valid, READ_BAG);
+}
+
+/*! Sort key for grouping nodes by the HDF chunk they live in */
+typedef struct _t_bagNodeKey
+{
+    hsize_t key;
+    u32 index;
+} bagNodeKey;
+
+static int bagCompareNodeKeys (const void *a, const void *b)
+{
+    const bagNodeKey *ka = (const bagNodeKey *) a;
+    const bagNodeKey *kb = (const bagNodeKey *) b;
+
+    if (ka->key != kb->key)
+        return (ka->key < kb->key) ? -1 : 1;
+    return (ka->index < kb->index) ? -1 : (ka->index > kb->index);
+}
+
+/****************************************************************************************/
+/*! \brief bagAlignNodes performs the multi-point selections for bagReadNodes/bagWriteNodes
+ *
+ *  Nodes are ordered by chunk, then by position within the chunk, and handed to HDF in
+ *  batches of up to \a NODE_BATCH_SIZE points, so each chunk is visited once per batch
+ *  rather than once per node.  The memspace is the caller's buffer itself, with the
+ *  original index of each node selected in the same order, so no staging copy is needed.
+ *
+ ****************************************************************************************/
+static bagError bagAlignNodesUnlocked (bagHandle bagHandle, u32 nnodes, const u32 *rows, const u32 *cols,
+                        s32 type, void *data, Bool *valid, s32 read_or_write)
+{
+    bagError    err;
+    u32         i, n, srow, scol, nsel, batch, chunk_cols;
+    herr_t      status = 0;
+    hsize_t     chunk_dims[RANK], mem_dims[1];
+    hsize_t    *file_coords = NULL, *mem_coords = NULL;
+    hid_t       memspace_id,
+                datatype_id,
+                dataset_id,
+                filespace_id;
+    bagNodeKey *keys;
+    f32         null_val, *fdata;
+
+    if (bagHandle == NULL)
+        return BAG_INVALID_BAG_HANDLE;
+
+    if (rows == NULL || cols == NULL || type >= BAG_OPT_SURFACE_LIMIT)
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+
+    if (data == NULL)
+        return (read_or_write == WRITE_BAG) ? BAG_HDF_CANNOT_WRITE_NULL_DATA : BAG_INVALID_FUNCTION_ARGUMENT;
+
+    if ((err = bagGetSurfaceIds (bagHandle, type, &dataset_id, &datatype_id, &filespace_id, &srow, &scol)) != BAG_SUCCESS)
+        return err;
+
+    if (nnodes == 0)
+        return BAG_SUCCESS;
+
+    if ((err = bagGetSurfaceChunkDims (bagHandle, type, chunk_dims, NULL)) != BAG_SUCCESS)
+        return err;
+    chunk_cols = (u32) ((scol + chunk_dims[1] - 1) / chunk_dims[1]);
+
+    keys = (bagNodeKey *) malloc (nnodes * sizeof (bagNodeKey));
+    if (keys == NULL)
+        return BAG_MEMORY_ALLOCATION_FAILED;
 
-            /*! Create space in memory */
-            bagHandle->unc_memspace_id = H5Screate_simple(RANK, snode, NULL);
-            if (bagHandle->unc_memspace_id < 0)
+    /*! key is the chunk number in the high word and the node within the chunk in the low word */
+    for (i = 0, n = 0; i < nnodes; i++)
+    {
+        if (rows[i] >= srow || cols[i] >= scol)
+        {
+            if (valid == NULL)
             {
-                return BAG_HDF_DATASPACE_CORRUPTED;
+                fprintf(stderr, "Internal error, bad parameters given to access surface extents! Aborting...\n");
+                fprintf(stderr, "\tCannot access node %d/%d, with surface extents 0-%d / 0-%d\n",
+                        rows[i], cols[i], srow, scol);
+                fflush(stderr);
+                free (keys);
+                return BAG_HDF_ACCESS_EXTENTS_ERROR;
             }
+            valid[i] = False;
+            continue;
         }
-            
-        datatype_id  = bagHandle->unc_datatype_id;
-        memspace_id  = bagHandle->unc_memspace_id;
-        filespace_id = bagHandle->unc_filespace_id;
-        dataset_id   = bagHandle->unc_dataset_id;
-        break;
-	case Nominal_Elevation:
-	case Surface_Correction:
-	case Node_Group:
-	case Elevation_Solution_Group:
-    case VarRes_Metadata_Group:
-    case VarRes_Refinement_Group:
-    case VarRes_Node_Group:
-        if (bagHandle->opt_memspace_id[type] >= 0)
+        keys[n].key   = ((hsize_t) ((rows[i] / chunk_dims[0]) * chunk_cols + cols[i] / chunk_dims[1]) << 32) |
+                        (hsize_t) ((rows[i] % chunk_dims[0]) * chunk_dims[1] + cols[i] % chunk_dims[1]);
+        keys[n].index = i;
+        n++;
+    }
+    qsort (keys, n, sizeof (bagNodeKey), bagCompareNodeKeys);
+
+    batch = (n < NODE_BATCH_SIZE) ? n : NODE_BATCH_SIZE;
+    file_coords = (hsize_t *) malloc ((size_t) batch * RANK * sizeof (hsize_t));
+    mem_coords  = (hsize_t *) malloc ((size_t) batch * sizeof (hsize_t));
+    if (batch > 0 && (file_coords == NULL || mem_coords == NULL))
+    {
+        free (keys);
+        free (file_coords);
+        free (mem_coords);
+        return BAG_MEMORY_ALLOCATION_FAILED;
+    }
+
+    /*! the memspace spans the caller's whole buffer, each batch selects its own nodes in it */
+    mem_dims[0] = nnodes;
+    if ((memspace_id = H5Screate_simple (1, mem_dims, NULL)) < 0)
+    {
+        free (keys);
+        free (file_coords);
+        free (mem_coords);
+        return BAG_HDF_CREATE_DATASPACE_FAILURE;
+    }
+
+    for (i = 0; i < n && status >= 0; i += nsel)
+    {
+        u32 k;
+
+        nsel = (n - i < batch) ? n - i : batch;
+        for (k = 0; k < nsel; k++)
         {
-            nct = (u32)H5Sget_select_npoints (bagHandle->opt_memspace_id[type]);
+            u32 idx = keys[i + k].index;
+            file_coords[k * RANK]     = rows[idx];
+            file_coords[k * RANK + 1] = cols[idx];
+            mem_coords[k]             = idx;
         }
 
-        if (bagHandle->opt_memspace_id[type] < 0 || nct != snode[1])
-        {
-            if (bagHandle->opt_memspace_id[type] >= 0)
-            {
-                 status = H5Sclose (bagHandle->opt_memspace_id[type]);
-                 check_hdf_status();
-            }
+        status = H5Sselect_elements (filespace_id, H5S_SELECT_SET, nsel, (const hsize_t *) file_coords);
+        if (status < 0)
+            break;
 
-            /*! Create space in memory */
-            bagHandle->opt_memspace_id[type] = H5Screate_simple(RANK, snode, NULL);
-            if (bagHandle->opt_memspace_id < 0)
-            {
-                return BAG_HDF_DATASPACE_CORRUPTED;
-            }
+        status = H5Sselect_elements (memspace_id, H5S_SELECT_SET, nsel, (const hsize_t *) mem_coords);
+        if (status < 0)
+            break;
+
+        if (read_or_write == READ_BAG)
+            status = H5Dread (dataset_id, datatype_id, memspace_id, filespace_id, H5P_DEFAULT, data);
+        else
+            status = H5Dwrite (dataset_id, datatype_id, memspace_id, filespace_id, H5P_DEFAULT, data);
+    }
+
+    H5Sclose (memspace_id);
+    free (file_coords);
+    free (mem_coords);
+
+    if (status >= 0 && valid != NULL)
+    {
+        /*! single valued layers can also report nulls, compound layers only report extents */
+        null_val = (type == Uncertainty) ? BAG_NULL_UNCERTAINTY : BAG_NULL_ELEVATION;
+        fdata    = (H5Tget_class (datatype_id) == H5T_FLOAT) ? (f32 *) data : NULL;
+        for (i = 0; i < n; i++)
+        {
+            u32 idx = keys[i].index;
+            valid[idx] = (fdata == NULL || fdata[idx] != null_val) ? True : False;
         }
+    }
+    else if (status >= 0 && read_or_write == WRITE_BAG)
+    {
+        u32 min_row = srow, max_row = 0;
 
-        datatype_id  = bagHandle->opt_datatype_id[type];
-        memspace_id  = bagHandle->opt_memspace_id[type];
-        filespace_id = bagHandle->opt_filespace_id[type];
-        dataset_id   = bagHandle->opt_dataset_id[type];
-        break;
-    case VarRes_Tracking_List:
-        fprintf(stderr, "error: cannot write variable resolution tracking list through generic interface!\n");
-        return BAG_INVALID_FUNCTION_ARGUMENT;
-    default:
-        return BAG_HDF_TYPE_NOT_FOUND;
-        break;
+        bagFoldSurfaceStats (bagHandle, type, (const f32 *) data, 1, nnodes, nnodes);
+        for (i = 0; i < n; i++)
+        {
+            u32 row = rows[keys[i].index];
+            if (row < min_row)
+                min_row = row;
+            if (row > max_row)
+                max_row = row;
+        }
+        if (n > 0)
+            bagMarkSurfaceRows (bagHandle, type, min_row, max_row);
     }
 
-    /*! Select grid cell within dataset file space. */
-    status = H5Sselect_elements (filespace_id, H5S_SELECT_SET, 1, (const hsize_t *)offset);
-    check_hdf_status();
-    
-    /*!  perform read_or_write on element */
-    if (read_or_write == READ_BAG)
-        status = H5Dread (dataset_id, datatype_id, memspace_id, filespace_id, 
-                          H5P_DEFAULT, data);
-    else if (read_or_write == WRITE_BAG)
-        status = H5Dwrite (dataset_id, datatype_id, memspace_id, filespace_id, 
-                           H5P_DEFAULT, data);
+    free (keys);
     check_hdf_status();
 
-    if (status < 0)
-        return BAG_HDF_INTERNAL_ERROR;
-    else
-        return BAG_SUCCESS;
+    return BAG_SUCCESS;
+}
+
+bagError bagAlignNodes (bagHandle bagHandle, u32 nnodes, const u32 *rows, const u32 *cols,
+                        s32 type, void *data, Bool *valid, s32 read_or_write)
+{
+    bagError err;
+
+    bagLockHDF ();
+    err = bagAlignNodesUnlocked (bagHandle, nnodes, rows, cols, type, data, valid, read_or_write);
+    bagUnlockHDF ();
+
+    return err;
 }
 
 /****************************************************************************************/
@@ -391,9 +545,10 @@ bagError bagReadRowPos (bagHandle bag, u32 row, u32 start_col, u32 end_col, s32
 }
 
 /****************************************************************************************/
-bagError bagAlignRow (bagHandle bagHandle, u32 row, u32 start_col, 
+static bagError bagAlignRowUnlocked (bagHandle bagHandle, u32 row, u32 start_col, 
                       u32 end_col, s32 type, s32 read_or_write, void *data)
 {
+    bagError    err;
     u32         srow, scol;
     herr_t      status = 0;
 
@@ -441,106 +596,11 @@ bagError bagAlignRow (bagHandle bagHandle, u32 row, u32 start_col,
     offset[1] = start_col;
     
 
-    /*!
-     * Depending on the type: 
-     *       set the memspace_id to the correct unit for 
-     *       this kind of surface and snode
-     */
-    switch (type)
-    {
-        u32 nct=0;
-    case Elevation:
-        
-        if (bagHandle->elv_memspace_id >= 0)
-        {
-            nct = (u32) H5Sget_select_npoints (bagHandle->elv_memspace_id);
-        }
-        
-        if (bagHandle->elv_memspace_id < 0 || nct != count[1])
-        {
-            if (bagHandle->elv_memspace_id >= 0)
-            {
-                status = H5Sclose (bagHandle->elv_memspace_id);
-                check_hdf_status();
-            }
-            
-            /*! Create space in memory */
-            bagHandle->elv_memspace_id = H5Screate_simple(RANK, count, NULL);
-            if (bagHandle->elv_memspace_id < 0)
-                return BAG_HDF_DATASPACE_CORRUPTED;
-        }
-        
-        datatype_id  = bagHandle->elv_datatype_id;
-        memspace_id  = bagHandle->elv_memspace_id;
-        filespace_id = bagHandle->elv_filespace_id;
-        dataset_id   = bagHandle->elv_dataset_id;
-        break;
-    case Uncertainty:
-
-        if (bagHandle->unc_memspace_id >= 0)
-            nct = (u32) H5Sget_select_npoints (bagHandle->unc_memspace_id);
-        
-        if (bagHandle->unc_memspace_id < 0 || nct != count[1])
-        {
-            if (bagHandle->unc_memspace_id >= 0)
-            {
-                status = H5Sclose (bagHandle->unc_memspace_id);
-                check_hdf_status();
-            }
-            
-            /*! Create space in memory */
-            bagHandle->unc_memspace_id = H5Screate_simple(RANK, count, NULL);
-            if (bagHandle->unc_memspace_id < 0)
-                return BAG_HDF_DATASPACE_CORRUPTED;
-        }
-        
-        datatype_id  = bagHandle->unc_datatype_id;
-        memspace_id  = bagHandle->unc_memspace_id;
-        filespace_id = bagHandle->unc_filespace_id;
-        dataset_id   = bagHandle->unc_dataset_id;
-        break;
-	
-	case Nominal_Elevation: 
-	case Surface_Correction: 
-	case Node_Group:
-	case Elevation_Solution_Group:
-    case VarRes_Metadata_Group:
-    case VarRes_Refinement_Group:
-    case VarRes_Node_Group:
-        if (bagHandle->opt_memspace_id[type] >= 0)
-        {
-            nct = (u32) H5Sget_select_npoints (bagHandle->opt_memspace_id[type]);
-        }
-        
-        if (bagHandle->opt_memspace_id[type] < 0 || nct != count[1])
-        {
-            if (bagHandle->opt_memspace_id[type] >= 0)
-            {
-                status = H5Sclose (bagHandle->opt_memspace_id[type]);
-                check_hdf_status();
-            }
-            
-            /*! Create space in memory */
-            bagHandle->opt_memspace_id[type] = H5Screate_simple(RANK, count, NULL);
-            if (bagHandle->opt_memspace_id[type] < 0)
-                return BAG_HDF_DATASPACE_CORRUPTED;
-        }
-        
-        datatype_id  = bagHandle->opt_datatype_id[type];
-        memspace_id  = bagHandle->opt_memspace_id[type];
-        filespace_id = bagHandle->opt_filespace_id[type];
-        dataset_id   = bagHandle->opt_dataset_id[type];
-        break;
-            
-    case VarRes_Tracking_List:
-        fprintf(stderr, "error: cannot access variable-resolution tracking list through generic interface!\n");
-        return BAG_INVALID_FUNCTION_ARGUMENT;
-        break;
-        
-    default:
-        return BAG_HDF_TYPE_NOT_FOUND;
-        break;
-    }
+    /*! the memspace for a row of this width comes from the handle's cache */
+    if ((err = bagGetSurfaceIds (bagHandle, type, &dataset_id, &datatype_id, &filespace_id, &srow, &scol)) != BAG_SUCCESS)
+        return err;
+    if ((err = bagGetMemspace (bagHandle, type, count, &memspace_id)) != BAG_SUCCESS)
+        return err;
 
     if (data == NULL)
         return  BAG_INVALID_FUNCTION_ARGUMENT;
@@ -556,10 +616,25 @@ bagError bagAlignRow (bagHandle bagHandle, u32 row, u32 start_col,
                            H5P_DEFAULT, data);
     check_hdf_status();
 
-    if (status < 0)
-        return BAG_HDF_INTERNAL_ERROR;
-    else
-        return BAG_SUCCESS;
+    if (read_or_write == WRITE_BAG)
+    {
+        bagFoldSurfaceStats (bagHandle, type, (const f32 *) data, 1, (u32) count[1], (u32) count[1]);
+        bagMarkSurfaceRows (bagHandle, type, row, row);
+    }
+
+    return BAG_SUCCESS;
+}
+
+bagError bagAlignRow (bagHandle bagHandle, u32 row, u32 start_col, 
+                      u32 end_col, s32 type, s32 read_or_write, void *data)
+{
+    bagError err;
+
+    bagLockHDF ();
+    err = bagAlignRowUnlocked (bagHandle, row, start_col, end_col, type, read_or_write, data);
+    bagUnlockHDF ();
+
+    return err;
 }
 
 /****************************************************************************************/
@@ -590,8 +665,28 @@ bagError bagWriteDataset (bagHandle bagHandle, s32 type)
  ********************************************************************/
 bagError bagReadDataset (bagHandle bagHandle, s32 type)
 {
-    return bagAlignRegion (bagHandle, 0, 0, bagHandle->bag.def.nrows - 1, 
-                           bagHandle->bag.def.ncols - 1, type, READ_BAG, DISABLE_STRIP_MINING);
+    bagError  status;
+    void     *data;
+
+    if (bagHandle == NULL)
+        return BAG_INVALID_BAG_HANDLE;
+    if (type >= BAG_OPT_SURFACE_LIMIT)
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+
+    if ((status = bagAllocArray (bagHandle, 0, 0, bagHandle->bag.def.nrows - 1,
+                                 bagHandle->bag.def.ncols - 1, type)) != BAG_SUCCESS)
+        return status;
+
+    if (type == Elevation)
+        data = bagHandle->elevationArray;
+    else if (type == Uncertainty)
+        data = bagHandle->uncertaintyArray;
+    else
+        data = bagHandle->dataArray[type];
+
+    /*! whole surfaces are the case worth decompressing on every core */
+    return bagReadRegionParallel (bagHandle, 0, 0, bagHandle->bag.def.nrows - 1,
+                                  bagHandle->bag.def.ncols - 1, type, data, 0, 0);
 }
 
 /****************************************************************************************/
@@ -708,233 +803,603 @@ bagError bagReadRegionPos (bagHandle bag, u32 start_row, u32 start_col,
 }
 
 /****************************************************************************************/
-/*! I made a choice so far in this function - notice that void \a *data is just a temporary
- *  memory is either already allocated to the arrays in \a bagHandle bagHandle,
- *  or gets allocated here for a read.  It is up to the caller to free this memory later!
- *  This is achieved through the \a bagFreeArray function!
+/*! I made a choice so far in this function - notice that void \a *data is just a temporary
+ *  memory is either already allocated to the arrays in \a bagHandle bagHandle,
+ *  or gets allocated here for a read.  It is up to the caller to free this memory later!
+ *  This is achieved through the \a bagFreeArray function!
+ *
+ ****************************************************************************************/
+static bagError bagAlignRegionUnlocked (bagHandle bagHandle, u32 start_row, u32 start_col, 
+                    u32 end_row, u32 end_col, s32 type, s32 read_or_write, hid_t xfer)
+{
+    bagError    err;
+    u32         srow, scol;
+    herr_t      status = 0;
+
+    /* hyperslab selection parameters */
+    hsize_t	  count[RANK];
+    hssize_t	  offset[RANK];
+    hid_t       memspace_id, 
+                datatype_id,
+                dataset_id,
+                filespace_id;
+
+    /* xfer params */
+    hssize_t    size;               /* Temp buffer size */
+    hid_t       xfer_plist = -1;
+    size_t      type_size;
+
+    void       *data;
+
+
+    if (bagHandle == NULL)
+        return BAG_INVALID_BAG_HANDLE;
+
+    if (type > Uncertainty)
+    {
+        srow=bagHandle->bag.opt[type].nrows;
+        scol=bagHandle->bag.opt[type].ncols;
+    }
+    else
+    {
+        srow=bagHandle->bag.def.nrows;
+        scol=bagHandle->bag.def.ncols;
+    }
+
+    if (end_col >= scol ||
+        end_row >= srow ||
+        start_row > end_row || 
+        start_col > end_col)
+    {
+        fprintf(stderr, "Internal error, bad parameters given to access surface extents! Aborting...\n");
+        fprintf(stderr, "\tCannot access region, %d-%d / %d-%d, with surface extents 0-%d / 0-%d\n",
+                start_row, start_col, end_row, end_col, srow, scol);
+        fflush(stderr);
+        return BAG_HDF_ACCESS_EXTENTS_ERROR;
+    }
+
+
+    /*! define the hyperslab parameters */
+    count[0] = (end_row - start_row) + 1;
+    count[1] = (end_col - start_col) + 1;
+    offset[0] = start_row;
+    offset[1] = start_col;
+    
+    if ((err = bagGetSurfaceIds (bagHandle, type, &dataset_id, &datatype_id, &filespace_id, &srow, &scol)) != BAG_SUCCESS)
+        return err;
+
+    /*!
+     * Depending on the type, alloc the buffers with bagallocarray
+     * and point data to the correct surface within the BagDef structure
+     */
+    if (read_or_write == READ_BAG &&
+        bagAllocArray (bagHandle, start_row, start_col, end_row, end_col, type) != BAG_SUCCESS)
+        data = NULL;
+    else if (type == Elevation)
+        data = bagHandle->elevationArray;
+    else if (type == Uncertainty)
+        data = bagHandle->uncertaintyArray;
+    else
+        data = bagHandle->dataArray[type];
+
+    if (data == NULL)
+        return BAG_MEMORY_ALLOCATION_FAILED;
+
+    /*! chunks known to be empty are filled rather than read */
+    if (read_or_write == READ_BAG && (type == Elevation || type == Uncertainty))
+    {
+        Bool done;
+
+        if ((err = bagReadSparseRegion (bagHandle, type, start_row, start_col, end_row, end_col,
+                                        (f32 *) data, (u32) count[1], &done)) != BAG_SUCCESS)
+            return err;
+        if (done)
+            return BAG_SUCCESS;
+    }
+
+    /*! the memspace for a region of this shape comes from the handle's cache */
+    if ((err = bagGetMemspace (bagHandle, type, count, &memspace_id)) != BAG_SUCCESS)
+        return err;
+
+
+    H5Sselect_hyperslab (filespace_id, H5S_SELECT_SET, (hsize_t *) offset, NULL, count, NULL);
+
+    /*! xfer params */
+    if (xfer == DISABLE_STRIP_MINING)
+    {
+        type_size = H5Tget_size(datatype_id);
+        size = H5Sget_simple_extent_npoints(filespace_id) * type_size;
+        xfer_plist = H5Pcreate (H5P_DATASET_XFER);
+        H5Pset_buffer(xfer_plist, size, NULL, NULL);
+        xfer = xfer_plist;
+    }
+
+    /*! perform read_or_write on hyperslab */
+    if (read_or_write == READ_BAG)
+        status = H5Dread (dataset_id, datatype_id, memspace_id, filespace_id, 
+                          xfer, data);
+    else if (read_or_write == WRITE_BAG)
+        status = H5Dwrite (dataset_id, datatype_id, memspace_id, filespace_id, 
+                           xfer, data);
+
+    check_hdf_status();
+
+    if (read_or_write == WRITE_BAG)
+    {
+        bagFoldSurfaceStats (bagHandle, type, (const f32 *) data, (u32) count[0], (u32) count[1], (u32) count[1]);
+        bagMarkSurfaceRows (bagHandle, type, start_row, end_row);
+    }
+
+    /*! did what we came to do, now close up */
+    if (xfer_plist >= 0)
+    {
+        status = H5Pclose (xfer_plist);
+        check_hdf_status();
+    }
+
+    if (status < 0)
+        return BAG_HDF_INTERNAL_ERROR;
+    else
+        return BAG_SUCCESS;
+}
+
+bagError bagAlignRegion (bagHandle bagHandle, u32 start_row, u32 start_col, 
+                    u32 end_row, u32 end_col, s32 type, s32 read_or_write, hid_t xfer)
+{
+    bagError err;
+
+    bagLockHDF ();
+    err = bagAlignRegionUnlocked (bagHandle, start_row, start_col, end_row, end_col, type, read_or_write, xfer);
+    bagUnlockHDF ();
+
+    return err;
+}
+
+/****************************************************************************************/
+/*! \brief bagReadRegionInto reads a region of a bag surface straight into caller memory
+ *
+ *  Unlike \a bagReadRegion, no handle-private array is allocated; the values land
+ *  directly in \a *data, one row of the region every \a row_stride elements.
+ *  This allows the caller to read into a window of a larger buffer, and to reuse
+ *  the same buffer across any number of reads.
+ *
+ *  \param  bagHandle   External reference to the private \a bagHandle object
+ *  \param  start_row   Starting Row offset within \a bag to access
+ *  \param  start_col   Starting Col offset within \a bag to access
+ *  \param  end_row     Ending row offset within \a bag to access
+ *  \param  end_col     Ending col offset within \a bag to access
+ *  \param  type        Indicates which data surface type to access, element of \a BAG_SURFACE_PARAMS
+ *  \param *data        Caller memory of at least \a row_stride * rows elements of the
+ *                      surface's element type (f32, or the compound struct of the layer)
+ *  \param  row_stride  Distance between rows of \a *data in elements.  Zero means the
+ *                      rows are packed, ie. a stride of \a end_col - \a start_col + 1.
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ * 
+ ********************************************************************/
+bagError bagReadRegionInto (bagHandle bagHandle, u32 start_row, u32 start_col, u32 end_row, u32 end_col,
+                            s32 type, void *data, u32 row_stride)
+{
+    return bagAlignRegionBuffer (bagHandle, start_row, start_col, end_row, end_col, type,
+                                 READ_BAG, data, row_stride, H5P_DEFAULT);
+}
+
+/****************************************************************************************/
+/*! \brief bagWriteRegionFrom writes a region of a bag surface straight from caller memory
+ *
+ *  The counterpart of \a bagReadRegionInto, see its description for \a *data and \a row_stride.
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ * 
+ ********************************************************************/
+bagError bagWriteRegionFrom (bagHandle bagHandle, u32 start_row, u32 start_col, u32 end_row, u32 end_col,
+                             s32 type, const void *data, u32 row_stride)
+{
+    return bagAlignRegionBuffer (bagHandle, start_row, start_col, end_row, end_col, type,
+                                 WRITE_BAG, (void *) data, row_stride, H5P_DEFAULT);
+}
+
+/****************************************************************************************/
+/*! \brief bagGetSurfaceIds looks up the HDF identifiers and extents of a surface
+ *
+ *  \param  hnd           External reference to the private \a bagHandle object
+ *  \param  type          Indicates which data surface type to access, element of \a BAG_SURFACE_PARAMS
+ *  \param *dataset_id    Receives the dataset of the surface
+ *  \param *datatype_id   Receives the datatype of the surface
+ *  \param *filespace_id  Receives the filespace of the surface
+ *  \param *srow          Receives the number of rows of the surface
+ *  \param *scol          Receives the number of cols of the surface
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ * 
+ ********************************************************************/
+bagError bagGetSurfaceIds (bagHandle hnd, s32 type, hid_t *dataset_id, hid_t *datatype_id,
+                           hid_t *filespace_id, u32 *srow, u32 *scol)
+{
+    if (hnd == NULL)
+        return BAG_INVALID_BAG_HANDLE;
+
+    switch (type)
+    {
+    case Elevation:
+        *dataset_id   = hnd->elv_dataset_id;
+        *datatype_id  = hnd->elv_datatype_id;
+        *filespace_id = hnd->elv_filespace_id;
+        *srow         = hnd->bag.def.nrows;
+        *scol         = hnd->bag.def.ncols;
+        break;
+    case Uncertainty:
+        *dataset_id   = hnd->unc_dataset_id;
+        *datatype_id  = hnd->unc_datatype_id;
+        *filespace_id = hnd->unc_filespace_id;
+        *srow         = hnd->bag.def.nrows;
+        *scol         = hnd->bag.def.ncols;
+        break;
+    case Num_Hypotheses:
+    case Average:
+    case Standard_Dev:
+    case Nominal_Elevation:
+    case Surface_Correction:
+    case Node_Group:
+    case Elevation_Solution_Group:
+    case VarRes_Metadata_Group:
+    case VarRes_Refinement_Group:
+    case VarRes_Node_Group:
+        *dataset_id   = hnd->opt_dataset_id[type];
+        *datatype_id  = hnd->opt_datatype_id[type];
+        *filespace_id = hnd->opt_filespace_id[type];
+        *srow         = hnd->bag.opt[type].nrows;
+        *scol         = hnd->bag.opt[type].ncols;
+        break;
+    case VarRes_Tracking_List:
+        fprintf(stderr, "error: cannot access variable-resolution tracking list through generic interface!\n");
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+    default:
+        return BAG_HDF_TYPE_NOT_FOUND;
+    }
+
+    if (*dataset_id < 0 || *datatype_id < 0 || *filespace_id < 0)
+        return BAG_HDF_DATASET_OPEN_FAILURE;
+
+    return BAG_SUCCESS;
+}
+
+/****************************************************************************************/
+/*! \brief bagGetMemspace returns a memspace of the given shape from the handle's LRU cache
+ *
+ *  Alternating between node, row and region access used to close and recreate the
+ *  single memspace kept per surface on nearly every call.  The cache keeps the last
+ *  \a MEMSPACE_CACHE_SIZE shapes open instead, evicting the least recently used.
+ *  Cached memspaces always have their whole extent selected; a caller that narrows
+ *  the selection must select all again before returning.
+ *
+ *  \param  hnd           External reference to the private \a bagHandle object
+ *  \param  type          Surface type the memspace is used with, element of \a BAG_SURFACE_PARAMS
+ *  \param *dims          \a RANK dimensions of the memspace
+ *  \param *memspace_id   Receives the memspace, owned by the cache
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ * 
+ ********************************************************************/
+bagError bagGetMemspace (bagHandle hnd, s32 type, const hsize_t *dims, hid_t *memspace_id)
+{
+    u32                     i;
+    bagMemspaceCacheEntry  *entry, *victim = NULL;
+
+    if (hnd == NULL)
+        return BAG_INVALID_BAG_HANDLE;
+
+    hnd->memspace_clock++;
+
+    for (i = 0; i < MEMSPACE_CACHE_SIZE; i++)
+    {
+        entry = &hnd->memspace_cache[i];
+        if (entry->memspace_id >= 0 && entry->type == type &&
+            entry->dims[0] == dims[0] && entry->dims[1] == dims[1])
+        {
+            entry->last_used = hnd->memspace_clock;
+            hnd->memspace_hits++;
+            *memspace_id = entry->memspace_id;
+            return BAG_SUCCESS;
+        }
+
+        /*! an empty slot wins, otherwise the oldest */
+        if (victim == NULL || (victim->memspace_id >= 0 &&
+            (entry->memspace_id < 0 || entry->last_used < victim->last_used)))
+            victim = entry;
+    }
+
+    hnd->memspace_misses++;
+
+    if (victim->memspace_id >= 0)
+    {
+        H5Sclose (victim->memspace_id);
+        victim->memspace_id = -1;
+    }
+
+    if ((victim->memspace_id = H5Screate_simple (RANK, dims, NULL)) < 0)
+        return BAG_HDF_DATASPACE_CORRUPTED;
+
+    victim->type      = type;
+    victim->dims[0]   = dims[0];
+    victim->dims[1]   = dims[1];
+    victim->last_used = hnd->memspace_clock;
+
+    *memspace_id = victim->memspace_id;
+    return BAG_SUCCESS;
+}
+
+/****************************************************************************************/
+/*! \brief bagInitMemspaceCache empties the memspace cache of a new handle
+ *
+ ****************************************************************************************/
+void bagInitMemspaceCache (bagHandle hnd)
+{
+    u32 i;
+
+    for (i = 0; i < MEMSPACE_CACHE_SIZE; i++)
+    {
+        hnd->memspace_cache[i].memspace_id = -1;
+        hnd->memspace_cache[i].last_used   = 0;
+    }
+    hnd->memspace_clock  = 0;
+    hnd->memspace_hits   = 0;
+    hnd->memspace_misses = 0;
+}
+
+/****************************************************************************************/
+/*! \brief bagFreeMemspaceCache closes every memspace held in the cache
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ * 
+ ****************************************************************************************/
+bagError bagFreeMemspaceCache (bagHandle hnd)
+{
+    u32     i;
+    herr_t  status = 0;
+
+    for (i = 0; i < MEMSPACE_CACHE_SIZE; i++)
+    {
+        if (hnd->memspace_cache[i].memspace_id >= 0)
+        {
+            if (H5Sclose (hnd->memspace_cache[i].memspace_id) < 0)
+                status = -1;
+            hnd->memspace_cache[i].memspace_id = -1;
+        }
+    }
+    check_hdf_status();
+
+    return BAG_SUCCESS;
+}
+
+/****************************************************************************************/
+/*! \brief bagGetMemspaceCacheStats reports the hit and miss counts of the memspace cache
+ *
+ *  \param  bagHandle   External reference to the private \a bagHandle object
+ *  \param *hits        Receives the number of lookups served from the cache, may be NULL
+ *  \param *misses      Receives the number of lookups that created a memspace, may be NULL
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ * 
+ ****************************************************************************************/
+bagError bagGetMemspaceCacheStats (bagHandle bagHandle, u32 *hits, u32 *misses)
+{
+    if (bagHandle == NULL)
+        return BAG_INVALID_BAG_HANDLE;
+
+    if (hits != NULL)
+        *hits = bagHandle->memspace_hits;
+    if (misses != NULL)
+        *misses = bagHandle->memspace_misses;
+
+    return BAG_SUCCESS;
+}
+
+/****************************************************************************************/
+/*! \brief bagReadRegionLayers reads the same region of several bag surfaces in one call
+ *
+ *  Each layer is read straight into its own caller buffer, as with \a bagReadRegionInto.
+ *  The bounds checks, the memspace and the transfer property list are set up once and
+ *  shared by every layer, rather than once per layer as separate region reads would.
+ *
+ *  \param  bagHandle   External reference to the private \a bagHandle object
+ *  \param  start_row   Starting Row offset within \a bag to access
+ *  \param  start_col   Starting Col offset within \a bag to access
+ *  \param  end_row     Ending row offset within \a bag to access
+ *  \param  end_col     Ending col offset within \a bag to access
+ *  \param  nlayers     Number of entries in \a *types and \a **data
+ *  \param *types       Surface types to read, elements of \a BAG_SURFACE_PARAMS
+ *  \param **data       One caller buffer per layer, each of at least \a row_stride * rows
+ *                      elements of that layer's element type
+ *  \param  row_stride  Distance between rows of every buffer in elements, zero for packed rows
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ * 
+ ********************************************************************/
+bagError bagReadRegionLayers (bagHandle bagHandle, u32 start_row, u32 start_col, u32 end_row, u32 end_col,
+                              u32 nlayers, const s32 *types, void **data, u32 row_stride)
+{
+    return bagAlignRegionLayers (bagHandle, start_row, start_col, end_row, end_col, nlayers, types,
+                                 READ_BAG, data, row_stride, H5P_DEFAULT);
+}
+
+/****************************************************************************************/
+/*! \brief bagAlignRegionBuffer is \a bagAlignRegion against caller memory with a row stride
  *
  ****************************************************************************************/
-bagError bagAlignRegion (bagHandle bagHandle, u32 start_row, u32 start_col, 
-                    u32 end_row, u32 end_col, s32 type, s32 read_or_write, hid_t xfer)
+bagError bagAlignRegionBuffer (bagHandle bagHandle, u32 start_row, u32 start_col, u32 end_row, u32 end_col,
+                               s32 type, s32 read_or_write, void *data, u32 row_stride, hid_t xfer)
 {
-    u32         srow, scol;
-    herr_t      status = 0;
+    return bagAlignRegionLayers (bagHandle, start_row, start_col, end_row, end_col, 1, &type,
+                                 read_or_write, &data, row_stride, xfer);
+}
 
-    /* hyperslab selection parameters */
-    hsize_t	  count[RANK];
-    hssize_t	  offset[RANK];
-    hid_t       memspace_id, 
+/****************************************************************************************/
+/*! \brief bagAlignRegionLayers moves one region of several surfaces to or from caller memory
+ *
+ *  The memspace describes a caller buffer \a row_stride elements wide, with the region
+ *  selected in its leading columns, so HDF scatters/gathers the rows in place.  All
+ *  layers share the one memspace and transfer property list; only the filespace
+ *  selection is per dataset.  Every layer is validated before any data is moved.
+ *
+ ****************************************************************************************/
+static bagError bagAlignRegionLayersUnlocked (bagHandle bagHandle, u32 start_row, u32 start_col, u32 end_row, u32 end_col,
+                               u32 nlayers, const s32 *types, s32 read_or_write, void **data,
+                               u32 row_stride, hid_t xfer)
+{
+    bagError    err;
+    u32         i, srow, scol, sparse = 0;
+    herr_t      status;
+    size_t      type_size, max_type_size = 0;
+    hsize_t     count[RANK], mem_dims[RANK];
+    hssize_t    offset[RANK];
+    hsize_t     mem_offset[RANK] = {0, 0};
+    hid_t       memspace_id,
                 datatype_id,
                 dataset_id,
-                filespace_id;
-
-    /* xfer params */
-    hssize_t    size;               /* Temp buffer size */
-    hid_t       xfer_plist = -1;
-    size_t      type_size;
-
-    void       *data;
-
+                filespace_id,
+                xfer_plist = -1;
 
     if (bagHandle == NULL)
         return BAG_INVALID_BAG_HANDLE;
 
-    if (type > Uncertainty)
-    {
-        srow=bagHandle->bag.opt[type].nrows;
-        scol=bagHandle->bag.opt[type].ncols;
-    }
-    else
-    {
-        srow=bagHandle->bag.def.nrows;
-        scol=bagHandle->bag.def.ncols;
-    }
+    /*! one bit per layer marks those read around empty chunks */
+    if (nlayers == 0 || nlayers > BAG_REGION_MAX_LAYERS || types == NULL || data == NULL)
+        return BAG_INVALID_FUNCTION_ARGUMENT;
 
-    if (end_col >= scol ||
-        end_row >= srow ||
-        start_row > end_row || 
-        start_col > end_col)
+    for (i = 0; i < nlayers; i++)
     {
-        fprintf(stderr, "Internal error, bad parameters given to access surface extents! Aborting...\n");
-        fprintf(stderr, "\tCannot access region, %d-%d / %d-%d, with surface extents 0-%d / 0-%d\n",
-                start_row, start_col, end_row, end_col, srow, scol);
-        fflush(stderr);
-        return BAG_HDF_ACCESS_EXTENTS_ERROR;
-    }
+        if (types[i] >= BAG_OPT_SURFACE_LIMIT)
+            return  BAG_INVALID_FUNCTION_ARGUMENT;
 
+        if ((err = bagGetSurfaceIds (bagHandle, types[i], &dataset_id, &datatype_id, &filespace_id, &srow, &scol)) != BAG_SUCCESS)
+            return err;
 
-    /*! define the hyperslab parameters */
-    count[0] = (end_row - start_row) + 1;
-    count[1] = (end_col - start_col) + 1;
+        if (end_col >= scol ||
+            end_row >= srow ||
+            start_row > end_row || 
+            start_col > end_col)
+        {
+            fprintf(stderr, "Internal error, bad parameters given to access surface extents! Aborting...\n");
+            fprintf(stderr, "\tCannot access region, %d-%d / %d-%d, with surface extents 0-%d / 0-%d\n",
+                    start_row, start_col, end_row, end_col, srow, scol);
+            fflush(stderr);
+            return BAG_HDF_ACCESS_EXTENTS_ERROR;
+        }
+
+        if (data[i] == NULL && read_or_write == WRITE_BAG)
+            return BAG_HDF_CANNOT_WRITE_NULL_DATA;
+        if (data[i] == NULL)
+            return BAG_INVALID_FUNCTION_ARGUMENT;
+
+        if ((type_size = H5Tget_size (datatype_id)) > max_type_size)
+            max_type_size = type_size;
+    }
+
+    count[0]  = (end_row - start_row) + 1;
+    count[1]  = (end_col - start_col) + 1;
     offset[0] = start_row;
     offset[1] = start_col;
-    
+
+    if (row_stride == 0)
+        row_stride = (u32) count[1];
+    if (row_stride < count[1])
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+
     /*!
-     * Depending on the type:
-     *    1) alloc the buffers with bagallocarray
-     *    2) point memspace to the correct
-     *       surface within the BagDef structure
+     * Layers meeting chunks known to be empty are read around them first, before the
+     * shared memspace is taken from the cache
      */
-    switch (type)
+    if (read_or_write == READ_BAG)
     {
-        u32 nct = 0;
-    case Elevation:
+        Bool done;
 
-        if (read_or_write == READ_BAG)
+        for (i = 0; i < nlayers; i++)
         {
-            if (bagAllocArray ( bagHandle,  start_row,  start_col, 
-                                end_row,  end_col,  type) != BAG_SUCCESS)
-                data = NULL;
-            else
-                data = bagHandle->elevationArray;
+            if ((err = bagReadSparseRegion (bagHandle, types[i], start_row, start_col, end_row, end_col,
+                                            (f32 *) data[i], row_stride, &done)) != BAG_SUCCESS)
+                return err;
+            if (done)
+                sparse |= 1u << i;
         }
-        else
-            data = bagHandle->elevationArray;
+        if (sparse == (u32) ((1ull << nlayers) - 1))
+            return BAG_SUCCESS;
+    }
 
-        if (bagHandle->elv_memspace_id >= 0)
-            nct = (u32) H5Sget_select_npoints (bagHandle->elv_memspace_id);
+    /*! the memspace is the caller's buffer, only the leading count[1] cols of each row are touched */
+    mem_dims[0] = count[0];
+    mem_dims[1] = row_stride;
+    if ((err = bagGetMemspace (bagHandle, types[0], mem_dims, &memspace_id)) != BAG_SUCCESS)
+        return err;
 
-        if (bagHandle->elv_memspace_id < 0 || nct != (count[0] * count[1]))
-        {
-            if (bagHandle->elv_memspace_id >= 0)
-            {
-                status = H5Sclose (bagHandle->elv_memspace_id);
-                check_hdf_status();
-            }
-            
-            /*! Prepare the dataspaces */
-            bagHandle->elv_memspace_id = H5Screate_simple(RANK, count, NULL);
-            if (bagHandle->elv_memspace_id < 0)
-                return BAG_HDF_DATASPACE_CORRUPTED;
-        }
+    if (row_stride != count[1])
+    {
+        status = H5Sselect_hyperslab (memspace_id, H5S_SELECT_SET, mem_offset, NULL, count, NULL);
+        check_hdf_status();
+    }
 
-        datatype_id  = bagHandle->elv_datatype_id;
-        memspace_id  = bagHandle->elv_memspace_id;
-        filespace_id = bagHandle->elv_filespace_id;
-        dataset_id   = bagHandle->elv_dataset_id;
-        break;
-    case Uncertainty:
+    /*! xfer params, as bagAlignRegion sets them, sized for the largest layer */
+    status = 0;
+    if (xfer == DISABLE_STRIP_MINING)
+    {
+        if ((xfer_plist = H5Pcreate (H5P_DATASET_XFER)) < 0 ||
+            H5Pset_buffer (xfer_plist, (size_t) (count[0] * row_stride) * max_type_size, NULL, NULL) < 0)
+            status = -1;
+        xfer = xfer_plist;
+    }
 
-        if (read_or_write == READ_BAG)
-        {
-            if (bagAllocArray ( bagHandle,  start_row,  start_col, 
-                                end_row,  end_col,  type) != BAG_SUCCESS)
-                data = NULL;
-            else
-                data = bagHandle->uncertaintyArray;
-        }
-        else
-            data = bagHandle->uncertaintyArray;
+    for (i = 0; i < nlayers && status >= 0; i++)
+    {
+        if (sparse & (1u << i))
+            continue;
 
-        if (bagHandle->unc_memspace_id >= 0)
-            nct = (u32) H5Sget_select_npoints (bagHandle->unc_memspace_id);
+        bagGetSurfaceIds (bagHandle, types[i], &dataset_id, &datatype_id, &filespace_id, &srow, &scol);
 
-        if (bagHandle->unc_memspace_id < 0 || nct != (count[0] * count[1]))
-        {
-            if (bagHandle->unc_memspace_id >= 0)
-            {
-                status = H5Sclose (bagHandle->unc_memspace_id);
-                check_hdf_status();
-            }
-            
-            /*! Prepare the dataspaces */
-            bagHandle->unc_memspace_id = H5Screate_simple(RANK, count, NULL);
-            if (bagHandle->unc_memspace_id < 0)
-                return BAG_HDF_DATASPACE_CORRUPTED;
-        }
+        status = H5Sselect_hyperslab (filespace_id, H5S_SELECT_SET, (hsize_t *) offset, NULL, count, NULL);
+        if (status < 0)
+            break;
 
-        datatype_id  = bagHandle->unc_datatype_id;
-        memspace_id  = bagHandle->unc_memspace_id;
-        filespace_id = bagHandle->unc_filespace_id;
-        dataset_id   = bagHandle->unc_dataset_id;
-        break;
-	
-    case Nominal_Elevation:
-	case Surface_Correction:
-	case Node_Group:
-	case Elevation_Solution_Group:
-    case VarRes_Metadata_Group:
-    case VarRes_Refinement_Group:
-    case VarRes_Node_Group:
         if (read_or_write == READ_BAG)
-        {
-            if (bagAllocArray (bagHandle,  start_row,  start_col, 
-                               end_row,  end_col, type) != BAG_SUCCESS)
-                data = NULL;
-            else
-                data = bagHandle->dataArray[type];
-        }
+            status = H5Dread (dataset_id, datatype_id, memspace_id, filespace_id, xfer, data[i]);
         else
-            data = bagHandle->dataArray[type];
-
-        if (bagHandle->opt_memspace_id[type] >= 0)
-            nct = (u32) H5Sget_select_npoints (bagHandle->opt_memspace_id[type]);
-
-        if (bagHandle->opt_memspace_id[type] < 0 || nct != (count[0] * count[1]))
         {
-            if (bagHandle->opt_memspace_id[type] >= 0)
+            status = H5Dwrite (dataset_id, datatype_id, memspace_id, filespace_id, xfer, data[i]);
+            if (status >= 0)
             {
-                status = H5Sclose (bagHandle->opt_memspace_id[type]);
-                check_hdf_status();
+                bagFoldSurfaceStats (bagHandle, types[i], (const f32 *) data[i], (u32) count[0], (u32) count[1], row_stride);
+                bagMarkSurfaceRows (bagHandle, types[i], start_row, end_row);
             }
-            
-            /*! Prepare the dataspaces */
-            bagHandle->opt_memspace_id[type] = H5Screate_simple(RANK, count, NULL);
-            if (bagHandle->opt_memspace_id[type] < 0)
-                return BAG_HDF_DATASPACE_CORRUPTED;
         }
-
-        datatype_id  = bagHandle->opt_datatype_id[type];
-        memspace_id  = bagHandle->opt_memspace_id[type];
-        filespace_id = bagHandle->opt_filespace_id[type];
-        dataset_id   = bagHandle->opt_dataset_id[type];
-        break;
-    case VarRes_Tracking_List:
-        fprintf(stderr, "error: cannot access variable-resolution tracking list through generic interface!\n");
-        return BAG_INVALID_FUNCTION_ARGUMENT;
-        break;
-            
-    default:
-        return BAG_HDF_TYPE_NOT_FOUND;
-        break;
     }
 
-    if (data == NULL)
-        return BAG_MEMORY_ALLOCATION_FAILED;
-
-    H5Sselect_hyperslab (filespace_id, H5S_SELECT_SET, (hsize_t *) offset, NULL, count, NULL);
-
-    /*! xfer params */
-    if (xfer == DISABLE_STRIP_MINING)
-    {
-        type_size = H5Tget_size(datatype_id);
-        size = H5Sget_simple_extent_npoints(filespace_id) * type_size;
-        xfer_plist = H5Pcreate (H5P_DATASET_XFER);
-        H5Pset_buffer(xfer_plist, size, NULL, NULL);
-        xfer = xfer_plist;
-    }
+    /*! hand the cached memspace back with its whole extent selected */
+    if (row_stride != count[1])
+        H5Sselect_all (memspace_id);
+    if (xfer_plist >= 0)
+        H5Pclose (xfer_plist);
+    check_hdf_status();
 
-    /*! perform read_or_write on hyperslab */
-    if (read_or_write == READ_BAG)
-        status = H5Dread (dataset_id, datatype_id, memspace_id, filespace_id, 
-                          xfer, data);
-    else if (read_or_write == WRITE_BAG)
-        status = H5Dwrite (dataset_id, datatype_id, memspace_id, filespace_id, 
-                           xfer, data);
+    return BAG_SUCCESS;
+}
 
-    check_hdf_status();
+bagError bagAlignRegionLayers (bagHandle bagHandle, u32 start_row, u32 start_col, u32 end_row, u32 end_col,
+                               u32 nlayers, const s32 *types, s32 read_or_write, void **data,
+                               u32 row_stride, hid_t xfer)
+{
+    bagError err;
 
-    /*! did what we came to do, now close up */
-    if (xfer_plist >= 0)
-    {
-        status = H5Pclose (xfer_plist);
-        check_hdf_status();
-    }
+    bagLockHDF ();
+    err = bagAlignRegionLayersUnlocked (bagHandle, start_row, start_col, end_row, end_col, nlayers, types, read_or_write, data, row_stride, xfer);
+    bagUnlockHDF ();
 
-    if (status < 0)
-        return BAG_HDF_INTERNAL_ERROR;
-    else
-        return BAG_SUCCESS;
+    return err;
 }
 
 /****************************************************************************************/
@@ -1512,16 +1977,170 @@ bagError bagGetGridDimensions(bagHandle hnd, u32 *rows, u32 *cols)
 }
 
 
+/****************************************************************************************/
+/*! \brief  bagResetSurfaceStats
+ *
+ * Description:
+ *     Empties the running range of a mandatory surface.  With \a valid, the surface is
+ *     known to hold only nulls, as after \a bagFileCreate, and writes build the range
+ *     from there; otherwise the next \a bagUpdateSurface rescans the surface.
+ *
+ ****************************************************************************************/
+void bagResetSurfaceStats (bagHandle hnd, s32 type, Bool valid)
+{
+    f32 null_val = (type == Uncertainty) ? BAG_NULL_UNCERTAINTY : BAG_NULL_ELEVATION;
+
+    if (type != Elevation && type != Uncertainty)
+        return;
+
+    hnd->running[type].min   = null_val;
+    hnd->running[type].max   = null_val;
+    hnd->running[type].valid = valid;
+}
+
+/****************************************************************************************/
+/*! \brief  bagFoldSurfaceStats
+ *
+ * Description:
+ *     Widens the running range of a mandatory surface with values just written to it,
+ *     \a nrows rows of \a ncols values, one row every \a row_stride values.  Nulls and
+ *     NaNs are not counted.  Other layers, and ranges already invalid, are left alone.
+ *     Called with the HDF lock held, by every write path of the mandatory surfaces.
+ *
+ ****************************************************************************************/
+void bagFoldSurfaceStats (bagHandle hnd, s32 type, const f32 *data, u32 nrows, u32 ncols, u32 row_stride)
+{
+    bagRunningStats *run;
+    bagReduction     r;
+    f32              null_val;
+    u32              i;
+
+    if ((type != Elevation && type != Uncertainty) || !hnd->running[type].valid)
+        return;
+
+    run      = &hnd->running[type];
+    null_val = (type == Uncertainty) ? BAG_NULL_UNCERTAINTY : BAG_NULL_ELEVATION;
+
+    bagReduceInit (&r);
+    if (row_stride == ncols)
+        bagReduceF32 (&r, data, (size_t) nrows * ncols, 1, null_val);
+    else
+        for (i = 0; i < nrows; i++)
+            bagReduceF32 (&r, data + (size_t) i * row_stride, ncols, 1, null_val);
+
+    if (r.count == 0)
+        return;
+    if (run->min == null_val || r.min < run->min)
+        run->min = r.min;
+    if (run->max == null_val || r.max > run->max)
+        run->max = r.max;
+}
+
+/****************************************************************************************/
+/*! \brief  bagMarkSurfaceRows
+ *
+ * Description:
+ *     Records that base rows [\a first_row, \a last_row] of a surface were written, for
+ *     the overviews and the chunk index to catch up at the next \a bagUpdateSurface.
+ *     Called with the HDF lock held, by every write path of the mandatory surfaces.
+ *
+ ****************************************************************************************/
+void bagMarkSurfaceRows (bagHandle hnd, s32 type, u32 first_row, u32 last_row)
+{
+    bagMarkOverviews (hnd, type, first_row, last_row);
+    bagMarkChunkIndex (hnd, type, first_row, last_row);
+}
+
+/****************************************************************************************/
+/*! \brief  bagInvalidateSurfaceStats
+ *
+ * Description:
+ *     Marks the running range of a mandatory surface as unknown, so the next
+ *     \a bagUpdateSurface rescans the whole surface.  Writes only ever widen the
+ *     running range; call this after overwriting values that may have been the
+ *     minimum or maximum of the surface.
+ *
+ *  \param    hnd    - pointer to the structure which ultimately contains the bag
+ *  \param    type   - Elevation or Uncertainty
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ****************************************************************************************/
+bagError bagInvalidateSurfaceStats (bagHandle hnd, s32 type)
+{
+    if (hnd == NULL)
+        return BAG_INVALID_BAG_HANDLE;
+    if (type != Elevation && type != Uncertainty)
+        return BAG_HDF_TYPE_NOT_FOUND;
+
+    bagLockHDF ();
+    bagResetSurfaceStats (hnd, type, False);
+    bagUnlockHDF ();
+
+    return BAG_SUCCESS;
+}
+
+/****************************************************************************************/
+/*! \brief  bagFlushSurfaceStats writes the running range of a surface to its min/max attributes
+ ****************************************************************************************/
+static bagError bagFlushSurfaceStats (bagHandle hnd, s32 type)
+{
+    bagRunningStats *run = &hnd->running[type];
+    bagError         err = BAG_SUCCESS;
+    f32              null_val;
+    hid_t            dataset_id;
+
+    if (type == Elevation)
+    {
+        null_val   = BAG_NULL_ELEVATION;
+        dataset_id = hnd->elv_dataset_id;
+    }
+    else
+    {
+        null_val   = BAG_NULL_UNCERTAINTY;
+        dataset_id = hnd->unc_dataset_id;
+    }
+
+    if (dataset_id < 0)
+        return BAG_HDF_DATASET_OPEN_FAILURE;
+
+    /*! as with a rescan, a surface holding only nulls keeps its attributes */
+    if (run->max != null_val)
+    {
+        if (type == Elevation)
+            hnd->bag.max_elevation = run->max;
+        else
+            hnd->bag.max_uncertainty = run->max;
+        err = bagWriteAttribute (hnd, dataset_id, (u8 *) (type == Elevation ? MAX_ELEVATION_NAME : MAX_UNCERTAINTY_NAME), &run->max);
+    }
+    if (err == BAG_SUCCESS && run->min != null_val)
+    {
+        if (type == Elevation)
+            hnd->bag.min_elevation = run->min;
+        else
+            hnd->bag.min_uncertainty = run->min;
+        err = bagWriteAttribute (hnd, dataset_id, (u8 *) (type == Elevation ? MIN_ELEVATION_NAME : MIN_UNCERTAINTY_NAME), &run->min);
+    }
+
+    return err;
+}
+
 /****************************************************************************************/
 /*! \brief  bagUpdateSurface
  *
  * Description:
- *     So far this function just calls bagUpdateMinMax on the surface indicated by \a type
- * 
+ *     Brings the min and max attributes of the surface indicated by \a type up to date.
+ *     While every write since the BAG was created has been tracked, this only writes
+ *     the running range kept by the write calls; otherwise, as after \a bagFileOpen or
+ *     \a bagInvalidateSurfaceStats, it calls bagUpdateMinMax to rescan the surface.
+ *     The chunks of the chunk index and the overview levels over the rows written
+ *     since the last call are remade.
+ *
  *  \param    hnd    - pointer to the structure which ultimately contains the bag
  *  \param    type   - Indicates which data surface type to access, element of \a BAG_SURFACE_PARAMS
  *
- * \return On success, a value of zero is returned.  On failure a value of -1 is returned.  
+ * \return On success, a value of zero is returned.  On failure a value of -1 is returned.
  *
  ****************************************************************************************/
 bagError bagUpdateSurface (bagHandle hnd, u32 type)
@@ -1531,8 +2150,38 @@ bagError bagUpdateSurface (bagHandle hnd, u32 type)
     if (hnd == NULL)
         return BAG_INVALID_BAG_HANDLE;
 
-    status = bagUpdateMinMax (hnd, type);
-    check_hdf_status();
+    /*! the chunk index comes first, a rescan of the range is then answered from it */
+    if (type == Elevation || type == Uncertainty)
+    {
+        bagLockHDF ();
+        status = bagRefreshChunkIndex (hnd, (s32) type);
+        bagUnlockHDF ();
+        if (status != BAG_SUCCESS)
+            return status;
+    }
+
+    if ((type == Elevation || type == Uncertainty) && hnd->running[type].valid)
+    {
+        bagLockHDF ();
+        status = bagFlushSurfaceStats (hnd, (s32) type);
+        bagUnlockHDF ();
+        if (status != BAG_SUCCESS)
+            return status;
+    }
+    else
+    {
+        status = bagUpdateMinMax (hnd, type);
+        check_hdf_status();
+    }
+
+    /*! both layers feed every overview node, so either one refreshes them */
+    if (type == Elevation || type == Uncertainty)
+    {
+        bagLockHDF ();
+        status = bagRefreshOverviews (hnd);
+        bagUnlockHDF ();
+        return status;
+    }
 
     return BAG_SUCCESS;
 }
@@ -1553,10 +2202,11 @@ bagError bagUpdateSurface (bagHandle hnd, u32 type)
 bagError bagUpdateMinMax (bagHandle hnd, u32 type)
 {
     herr_t status;
-    u32    i, j;
+    u32    i;
     u8    *max_name, *min_name;
     hid_t  dataset_id;
     f32   *min_tmp, *max_tmp, **surface_array, *omax, *omin, null_val;
+    bagReduction r;
 
 
     if (hnd == NULL)
@@ -1600,31 +2250,19 @@ bagError bagUpdateMinMax (bagHandle hnd, u32 type)
     *max_tmp = null_val;
     *min_tmp = null_val;
 
-    for (i=0; i < hnd->bag.def.nrows; i++)
+    /*! a complete chunk index knows the range without reading the surface */
+    if (!bagChunkIndexRange (hnd, (s32) type, min_tmp, max_tmp))
     {
-		
-		bagReadRegion (hnd, i, 0, i, hnd->bag.def.ncols-1, type);
-			
-		for (j=0; j < hnd->bag.def.ncols; j++)
+        bagReduceInit (&r);
+        for (i=0; i < hnd->bag.def.nrows; i++)
         {
-            if ((* surface_array)[j] != null_val)
-            {
-                if (*max_tmp == null_val)
-                    *max_tmp = (* surface_array)[j];
-                if (*min_tmp == null_val)
-                    *min_tmp = (* surface_array)[j];
-                if ((* surface_array)[j] > *max_tmp)
-                {
-                    *max_tmp = (* surface_array)[j];
-                    /* fprintf(stdout, "ex: %f\n", (* surface_array)[j]); */
-
-                }
-                if ((* surface_array)[j] < *min_tmp)
-                {
-                    /* fprintf(stdout, "ex: %f\n", (* surface_array)[j]); */
-                    *min_tmp = (* surface_array)[j];
-                }
-            }
+            bagReadRegion (hnd, i, 0, i, hnd->bag.def.ncols-1, type);
+            bagReduceF32 (&r, *surface_array, hnd->bag.def.ncols, 1, null_val);
+        }
+        if (r.count > 0)
+        {
+            *min_tmp = r.min;
+            *max_tmp = r.max;
         }
     }
 
@@ -1641,6 +2279,14 @@ bagError bagUpdateMinMax (bagHandle hnd, u32 type)
 		check_hdf_status();
 	}
 	
+    /*! the rescan is now the running range, widened by later writes */
+    if (type == Elevation || type == Uncertainty)
+    {
+        hnd->running[type].min   = *min_tmp;
+        hnd->running[type].max   = *max_tmp;
+        hnd->running[type].valid = True;
+    }
+
     free (min_tmp);
     free (max_tmp);
 
@@ -0,0 +1,427 @@
+/*! \file bag_threads.c
+ * \brief This module contains the portable threading primitives used inside the library.
+ ********************************************************************
+ *
+ * Module Name : bag_threads.c
+ *
+ * Author/Date : ONSWG, October 2026
+ *
+ * Description :
+ *               Thin wrappers over POSIX threads, or the Win32 equivalents,
+ *               for the few places the library does work in the background:
+ *               mutexes, condition variables and joinable threads, a
+ *               parallel loop over a set of tasks, plus the library wide
+ *               HDF lock.  HDF5 is normally built without its
+ *               thread-safe option, so every HDF call made off the caller's
+ *               thread has to hold bagLockHDF.
+ *
+ * Restrictions/Limitations :
+ *               The objects are heap allocated and opaque, so that system
+ *               headers stay out of bag_private.h.
+ *
+ * Change Descriptions :
+ * who  when      what
+ * ---  ----      ----
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ ********************************************************************/
+
+#include "bag_private.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+struct _t_bagMutex
+{
+#ifdef _WIN32
+    CRITICAL_SECTION    cs;
+#else
+    pthread_mutex_t     mutex;
+#endif
+};
+
+struct _t_bagCond
+{
+#ifdef _WIN32
+    CONDITION_VARIABLE  cv;
+#else
+    pthread_cond_t      cond;
+#endif
+};
+
+struct _t_bagThread
+{
+#ifdef _WIN32
+    HANDLE              thread;
+#else
+    pthread_t           thread;
+#endif
+    void              (*func) (void *);
+    void               *arg;
+};
+
+/****************************************************************************************/
+/*! \brief bagMutexCreate allocates a recursive mutex
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ****************************************************************************************/
+bagError bagMutexCreate (bagMutex *mutex)
+{
+    bagMutex m;
+#ifndef _WIN32
+    pthread_mutexattr_t attr;
+#endif
+
+    if ((m = (bagMutex) calloc (1, sizeof (struct _t_bagMutex))) == NULL)
+        return BAG_MEMORY_ALLOCATION_FAILED;
+
+#ifdef _WIN32
+    InitializeCriticalSection (&m->cs);
+#else
+    pthread_mutexattr_init (&attr);
+    pthread_mutexattr_settype (&attr, PTHREAD_MUTEX_RECURSIVE);
+    if (pthread_mutex_init (&m->mutex, &attr) != 0)
+    {
+        pthread_mutexattr_destroy (&attr);
+        free (m);
+        return BAG_THREAD_FAILURE;
+    }
+    pthread_mutexattr_destroy (&attr);
+#endif
+
+    *mutex = m;
+    return BAG_SUCCESS;
+}
+
+void bagMutexLock (bagMutex mutex)
+{
+#ifdef _WIN32
+    EnterCriticalSection (&mutex->cs);
+#else
+    pthread_mutex_lock (&mutex->mutex);
+#endif
+}
+
+void bagMutexUnlock (bagMutex mutex)
+{
+#ifdef _WIN32
+    LeaveCriticalSection (&mutex->cs);
+#else
+    pthread_mutex_unlock (&mutex->mutex);
+#endif
+}
+
+void bagMutexDestroy (bagMutex mutex)
+{
+    if (mutex == NULL)
+        return;
+#ifdef _WIN32
+    DeleteCriticalSection (&mutex->cs);
+#else
+    pthread_mutex_destroy (&mutex->mutex);
+#endif
+    free (mutex);
+}
+
+/****************************************************************************************/
+/*! \brief bagCondCreate allocates a condition variable
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ****************************************************************************************/
+bagError bagCondCreate (bagCond *cond)
+{
+    bagCond c;
+
+    if ((c = (bagCond) calloc (1, sizeof (struct _t_bagCond))) == NULL)
+        return BAG_MEMORY_ALLOCATION_FAILED;
+
+#ifdef _WIN32
+    InitializeConditionVariable (&c->cv);
+#else
+    if (pthread_cond_init (&c->cond, NULL) != 0)
+    {
+        free (c);
+        return BAG_THREAD_FAILURE;
+    }
+#endif
+
+    *cond = c;
+    return BAG_SUCCESS;
+}
+
+/*! \brief bagCondWait waits on \a cond; \a mutex must be held exactly once by the caller */
+void bagCondWait (bagCond cond, bagMutex mutex)
+{
+#ifdef _WIN32
+    SleepConditionVariableCS (&cond->cv, &mutex->cs, INFINITE);
+#else
+    pthread_cond_wait (&cond->cond, &mutex->mutex);
+#endif
+}
+
+void bagCondBroadcast (bagCond cond)
+{
+#ifdef _WIN32
+    WakeAllConditionVariable (&cond->cv);
+#else
+    pthread_cond_broadcast (&cond->cond);
+#endif
+}
+
+void bagCondDestroy (bagCond cond)
+{
+    if (cond == NULL)
+        return;
+#ifndef _WIN32
+    pthread_cond_destroy (&cond->cond);
+#endif
+    free (cond);
+}
+
+#ifdef _WIN32
+static unsigned __stdcall bagThreadStart (void *arg)
+{
+    bagThread t = (bagThread) arg;
+    t->func (t->arg);
+    return 0;
+}
+#else
+static void *bagThreadStart (void *arg)
+{
+    bagThread t = (bagThread) arg;
+    t->func (t->arg);
+    return NULL;
+}
+#endif
+
+/****************************************************************************************/
+/*! \brief bagThreadCreate starts \a func (\a arg) on a new joinable thread
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ****************************************************************************************/
+bagError bagThreadCreate (bagThread *thread, void (*func) (void *), void *arg)
+{
+    bagThread t;
+
+    if ((t = (bagThread) calloc (1, sizeof (struct _t_bagThread))) == NULL)
+        return BAG_MEMORY_ALLOCATION_FAILED;
+
+    t->func = func;
+    t->arg  = arg;
+
+#ifdef _WIN32
+    t->thread = (HANDLE) _beginthreadex (NULL, 0, bagThreadStart, t, 0, NULL);
+    if (t->thread == 0)
+#else
+    if (pthread_create (&t->thread, NULL, bagThreadStart, t) != 0)
+#endif
+    {
+        free (t);
+        return BAG_THREAD_FAILURE;
+    }
+
+    *thread = t;
+    return BAG_SUCCESS;
+}
+
+/*! \brief bagThreadJoin waits for \a thread to finish and releases it */
+void bagThreadJoin (bagThread thread)
+{
+    if (thread == NULL)
+        return;
+#ifdef _WIN32
+    WaitForSingleObject (thread->thread, INFINITE);
+    CloseHandle (thread->thread);
+#else
+    pthread_join (thread->thread, NULL);
+#endif
+    free (thread);
+}
+
+/*! \brief bagGetNumProcessors returns the number of online processors, at least 1 */
+u32 bagGetNumProcessors (void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo (&info);
+    return (info.dwNumberOfProcessors > 0) ? (u32) info.dwNumberOfProcessors : 1;
+#else
+    long n = sysconf (_SC_NPROCESSORS_ONLN);
+    return (n > 0) ? (u32) n : 1;
+#endif
+}
+
+/****************************************************************************************
+ *
+ * The library wide HDF lock
+ *
+ ****************************************************************************************/
+
+static bagMutex hdf_lock = NULL;
+
+#ifdef _WIN32
+static INIT_ONCE hdf_lock_once = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK bagInitHDFLock (PINIT_ONCE once, PVOID param, PVOID *context)
+{
+    (void) once; (void) param; (void) context;
+    return (bagMutexCreate (&hdf_lock) == BAG_SUCCESS) ? TRUE : FALSE;
+}
+#else
+static pthread_once_t hdf_lock_once = PTHREAD_ONCE_INIT;
+
+static void bagInitHDFLock (void)
+{
+    bagMutexCreate (&hdf_lock);
+}
+#endif
+
+/*! \brief bagLockHDF takes the recursive lock serializing all HDF calls of the library */
+void bagLockHDF (void)
+{
+#ifdef _WIN32
+    InitOnceExecuteOnce (&hdf_lock_once, bagInitHDFLock, NULL, NULL);
+#else
+    pthread_once (&hdf_lock_once, bagInitHDFLock);
+#endif
+    bagMutexLock (hdf_lock);
+}
+
+/*! \brief bagUnlockHDF releases one hold of the HDF lock */
+void bagUnlockHDF (void)
+{
+    bagMutexUnlock (hdf_lock);
+}
+
+/****************************************************************************************
+ *
+ * Parallel loops
+ *
+ ****************************************************************************************/
+
+typedef struct
+{
+    bagMutex      lock;
+    bagTaskFunc   func;
+    void         *ctx;
+    u32           ntasks;
+    u32           next;
+    bagError      error;
+} bagParallelLoop;
+
+typedef struct
+{
+    bagParallelLoop  *loop;
+    u32               worker;
+} bagParallelWorker;
+
+/*! \brief bagParallelRun takes tasks off the shared counter until none, or an error, is left */
+static void bagParallelRun (void *arg)
+{
+    bagParallelWorker *w    = (bagParallelWorker *) arg;
+    bagParallelLoop   *loop = w->loop;
+    bagError           err;
+    u32                task;
+
+    for (;;)
+    {
+        bagMutexLock (loop->lock);
+        if (loop->error != BAG_SUCCESS || loop->next >= loop->ntasks)
+        {
+            bagMutexUnlock (loop->lock);
+            return;
+        }
+        task = loop->next++;
+        bagMutexUnlock (loop->lock);
+
+        if ((err = loop->func (loop->ctx, task, w->worker)) != BAG_SUCCESS)
+        {
+            bagMutexLock (loop->lock);
+            if (loop->error == BAG_SUCCESS)
+                loop->error = err;
+            bagMutexUnlock (loop->lock);
+            return;
+        }
+    }
+}
+
+/****************************************************************************************/
+/*! \brief bagParallelFor runs \a func for every task in 0 .. \a ntasks-1 on up to \a nworkers threads
+ *
+ *  Tasks are handed out one at a time, in order, to whichever worker is free; the
+ *  calling thread is worker 0.  \a func also receives the index of the worker
+ *  running it, below \a nworkers, so that it can use per-worker scratch buffers.
+ *  No new task is started once one has failed.
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, the first error returned by \a func, or a proper code from \a BAG_ERRORS.
+ *
+ ****************************************************************************************/
+bagError bagParallelFor (u32 nworkers, u32 ntasks, bagTaskFunc func, void *ctx)
+{
+    bagParallelLoop     loop;
+    bagParallelWorker  *workers;
+    bagThread          *threads;
+    bagError            err;
+    u32                 i;
+
+    if (nworkers > ntasks)
+        nworkers = ntasks;
+    if (nworkers == 0)
+        return BAG_SUCCESS;
+
+    loop.func   = func;
+    loop.ctx    = ctx;
+    loop.ntasks = ntasks;
+    loop.next   = 0;
+    loop.error  = BAG_SUCCESS;
+    if ((err = bagMutexCreate (&loop.lock)) != BAG_SUCCESS)
+        return err;
+
+    workers = (bagParallelWorker *) malloc (nworkers * sizeof (bagParallelWorker));
+    threads = (bagThread *) calloc (nworkers, sizeof (bagThread));
+    if (workers == NULL || threads == NULL)
+    {
+        free (workers);
+        free (threads);
+        bagMutexDestroy (loop.lock);
+        return BAG_MEMORY_ALLOCATION_FAILED;
+    }
+
+    for (i = 0; i < nworkers; i++)
+    {
+        workers[i].loop   = &loop;
+        workers[i].worker = i;
+    }
+
+    /*! a worker that cannot be started just leaves more tasks to the others */
+    for (i = 1; i < nworkers; i++)
+    {
+        bagThreadCreate (&threads[i], bagParallelRun, &workers[i]);
+    }
+    bagParallelRun (&workers[0]);
+
+    for (i = 1; i < nworkers; i++)
+        bagThreadJoin (threads[i]);
+
+    err = loop.error;
+    bagMutexDestroy (loop.lock);
+    free (workers);
+    free (threads);
+
+    return err;
+}
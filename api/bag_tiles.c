@@ -0,0 +1,314 @@
+/*! \file bag_tiles.c
+ * \brief This module contains the chunk-ordered tile iterator for the mandatory surfaces.
+ ********************************************************************
+ *
+ * Module Name : bag_tiles.c
+ *
+ * Author/Date : ONSWG, October 2026
+ *
+ * Description :
+ *               Walks the Elevation and Uncertainty surfaces one tile at a
+ *               time, where each tile is exactly one HDF chunk of the
+ *               Elevation dataset (as set up by bagFileCreate).  Tiles are
+ *               produced in chunk row-major order, which is the order in
+ *               which the chunks were allocated, so a full scan of the grid
+ *               decompresses each chunk exactly once.
+ *               Surfaces stored contiguously are walked in full-width
+ *               bands of rows instead.
+ *
+ * Restrictions/Limitations :
+ *               The tile buffers are owned by the iterator and are only
+ *               valid until the next call to bagTileIteratorNext or
+ *               bagTileIteratorClose.
+ *
+ * Change Descriptions :
+ * who  when      what
+ * ---  ----      ----
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ ********************************************************************/
+
+#include "bag_private.h"
+
+/****************************************************************************************/
+/*! \brief bagGetSurfaceChunkDims retrieves the storage tile shape of a surface
+ *
+ *  For chunked datasets this is the chunk shape from the dataset creation property
+ *  list.  For contiguous datasets a band of full rows of roughly \a TILE_BAND_BYTES
+ *  is returned, since row order is the storage order in that case.
+ *
+ *  \param  hnd         External reference to the private \a bagHandle object
+ *  \param  type        Indicates which data surface type to access, element of \a BAG_SURFACE_PARAMS
+ *  \param *chunk_dims  Array of \a RANK values receiving the tile rows and cols
+ *  \param *chunked     Set to \a True when the dataset uses a chunked layout, may be NULL
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ********************************************************************/
+bagError bagGetSurfaceChunkDims (bagHandle hnd, s32 type, hsize_t *chunk_dims, Bool *chunked)
+{
+    u32      srow, scol;
+    hid_t    dataset_id, datatype_id, plist_id;
+    size_t   type_size;
+    Bool     is_chunked = False;
+
+    if (hnd == NULL)
+        return BAG_INVALID_BAG_HANDLE;
+
+    if (chunk_dims == NULL || type <= Metadata || type >= VarRes_Tracking_List)
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+
+    switch (type)
+    {
+    case Elevation:
+        dataset_id  = hnd->elv_dataset_id;
+        datatype_id = hnd->elv_datatype_id;
+        srow        = hnd->bag.def.nrows;
+        scol        = hnd->bag.def.ncols;
+        break;
+    case Uncertainty:
+        dataset_id  = hnd->unc_dataset_id;
+        datatype_id = hnd->unc_datatype_id;
+        srow        = hnd->bag.def.nrows;
+        scol        = hnd->bag.def.ncols;
+        break;
+    default:
+        dataset_id  = hnd->opt_dataset_id[type];
+        datatype_id = hnd->opt_datatype_id[type];
+        srow        = hnd->bag.opt[type].nrows;
+        scol        = hnd->bag.opt[type].ncols;
+        break;
+    }
+
+    if (dataset_id < 0 || datatype_id < 0)
+        return BAG_HDF_DATASET_OPEN_FAILURE;
+    if (srow == 0 || scol == 0)
+        return BAG_HDF_ACCESS_EXTENTS_ERROR;
+
+    if ((plist_id = H5Dget_create_plist (dataset_id)) < 0)
+        return BAG_HDF_CREATE_PROPERTY_CLASS_FAILURE;
+
+    if (H5Pget_layout (plist_id) == H5D_CHUNKED &&
+        H5Pget_chunk (plist_id, RANK, chunk_dims) == RANK)
+    {
+        is_chunked = True;
+    }
+    H5Pclose (plist_id);
+
+    if (!is_chunked)
+    {
+        /*! contiguous storage is row major, so walk it in bands of whole rows */
+        type_size = H5Tget_size (datatype_id);
+        chunk_dims[0] = TILE_BAND_BYTES / ((hsize_t)scol * type_size);
+        if (chunk_dims[0] < 1)
+            chunk_dims[0] = 1;
+        chunk_dims[1] = scol;
+    }
+
+    /*! never hand out a tile larger than the surface itself */
+    if (chunk_dims[0] > srow)
+        chunk_dims[0] = srow;
+    if (chunk_dims[1] > scol)
+        chunk_dims[1] = scol;
+
+    if (chunked != NULL)
+        *chunked = is_chunked;
+
+    return BAG_SUCCESS;
+}
+
+/****************************************************************************************/
+/*! \brief bagTileIteratorOpen prepares a walk of the Elevation and Uncertainty surfaces
+ *         in HDF chunk order.
+ *
+ *  \param  hnd    External reference to the private \a bagHandle object
+ *  \param *iter   Will be set to the allocated \a bagTileIterator.
+ *                 Must be released with \a bagTileIteratorClose.
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ********************************************************************/
+static bagError bagTileIteratorOpenUnlocked (bagHandle hnd, bagTileIterator *iter)
+{
+    bagError        status;
+    bagTileIterator it;
+    size_t          nelem;
+
+    if (hnd == NULL)
+        return BAG_INVALID_BAG_HANDLE;
+    if (iter == NULL)
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+
+    *iter = NULL;
+
+    it = (bagTileIterator) calloc (1, sizeof (struct _t_bagTileIterator));
+    if (it == NULL)
+        return BAG_MEMORY_ALLOCATION_FAILED;
+
+    it->hnd         = hnd;
+    it->memspace_id = -1;
+
+    if ((status = bagGetSurfaceChunkDims (hnd, Elevation, it->tile_dims, NULL)) != BAG_SUCCESS)
+    {
+        free (it);
+        return status;
+    }
+
+    /*! one tile worth of each surface, reused for every tile */
+    nelem = (size_t)it->tile_dims[0] * (size_t)it->tile_dims[1];
+    it->elevation   = (f32 *) calloc (nelem, sizeof (f32));
+    it->uncertainty = (f32 *) calloc (nelem, sizeof (f32));
+    if (it->elevation == NULL || it->uncertainty == NULL)
+    {
+        bagTileIteratorClose (it);
+        return BAG_MEMORY_ALLOCATION_FAILED;
+    }
+
+    if ((it->memspace_id = H5Screate_simple (RANK, it->tile_dims, NULL)) < 0)
+    {
+        bagTileIteratorClose (it);
+        return BAG_HDF_CREATE_DATASPACE_FAILURE;
+    }
+
+    it->next_row = 0;
+    it->next_col = 0;
+
+    *iter = it;
+    return BAG_SUCCESS;
+}
+
+bagError bagTileIteratorOpen (bagHandle hnd, bagTileIterator *iter)
+{
+    bagError err;
+
+    bagLockHDF ();
+    err = bagTileIteratorOpenUnlocked (hnd, iter);
+    bagUnlockHDF ();
+
+    return err;
+}
+
+/****************************************************************************************/
+/*! \brief bagTileIteratorNext reads the next chunk-aligned tile of Elevation and Uncertainty
+ *
+ *  Tiles at the north and east edges of the grid may be smaller than the chunk shape.
+ *  \a tile->elevation and \a tile->uncertainty point into memory owned by the iterator,
+ *  stored row major with a row stride of \a tile->ncols.
+ *
+ *  \param  iter   Iterator returned by \a bagTileIteratorOpen
+ *  \param *tile   Populated with the offsets, extents and data of the tile
+ *  \param *done   Set to \a True, with \a *tile untouched, once every tile has been visited
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ********************************************************************/
+static bagError bagTileIteratorNextUnlocked (bagTileIterator iter, bagTile *tile, Bool *done)
+{
+    herr_t      status;
+    bagHandle   hnd;
+    hsize_t     count[RANK];
+    hssize_t    offset[RANK];
+
+    if (iter == NULL || tile == NULL || done == NULL)
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+
+    hnd = iter->hnd;
+
+    if (iter->next_row >= hnd->bag.def.nrows)
+    {
+        *done = True;
+        return BAG_SUCCESS;
+    }
+    *done = False;
+
+    offset[0] = iter->next_row;
+    offset[1] = iter->next_col;
+    count[0]  = iter->tile_dims[0];
+    count[1]  = iter->tile_dims[1];
+    if (offset[0] + count[0] > hnd->bag.def.nrows)
+        count[0] = hnd->bag.def.nrows - offset[0];
+    if (offset[1] + count[1] > hnd->bag.def.ncols)
+        count[1] = hnd->bag.def.ncols - offset[1];
+
+    /*! edge tiles are smaller, so resize the memspace rather than recreate it */
+    status = H5Sset_extent_simple (iter->memspace_id, RANK, count, NULL);
+    check_hdf_status();
+
+    status = H5Sselect_hyperslab (hnd->elv_filespace_id, H5S_SELECT_SET, (hsize_t *) offset, NULL, count, NULL);
+    check_hdf_status();
+    status = H5Dread (hnd->elv_dataset_id, hnd->elv_datatype_id, iter->memspace_id,
+                      hnd->elv_filespace_id, H5P_DEFAULT, iter->elevation);
+    check_hdf_status();
+
+    status = H5Sselect_hyperslab (hnd->unc_filespace_id, H5S_SELECT_SET, (hsize_t *) offset, NULL, count, NULL);
+    check_hdf_status();
+    status = H5Dread (hnd->unc_dataset_id, hnd->unc_datatype_id, iter->memspace_id,
+                      hnd->unc_filespace_id, H5P_DEFAULT, iter->uncertainty);
+    check_hdf_status();
+
+    tile->row         = (u32) offset[0];
+    tile->col         = (u32) offset[1];
+    tile->nrows       = (u32) count[0];
+    tile->ncols       = (u32) count[1];
+    tile->elevation   = iter->elevation;
+    tile->uncertainty = iter->uncertainty;
+
+    /*! advance along the chunk row, then on to the next chunk row */
+    iter->next_col += (u32) iter->tile_dims[1];
+    if (iter->next_col >= hnd->bag.def.ncols)
+    {
+        iter->next_col  = 0;
+        iter->next_row += (u32) iter->tile_dims[0];
+    }
+
+    return BAG_SUCCESS;
+}
+
+bagError bagTileIteratorNext (bagTileIterator iter, bagTile *tile, Bool *done)
+{
+    bagError err;
+
+    bagLockHDF ();
+    err = bagTileIteratorNextUnlocked (iter, tile, done);
+    bagUnlockHDF ();
+
+    return err;
+}
+
+/****************************************************************************************/
+/*! \brief bagTileIteratorClose releases the tile iterator and its buffers
+ *
+ *  \param  iter   Iterator returned by \a bagTileIteratorOpen
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ********************************************************************/
+bagError bagTileIteratorClose (bagTileIterator iter)
+{
+    herr_t status = 0;
+
+    if (iter == NULL)
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+
+    if (iter->memspace_id >= 0)
+    {
+        bagLockHDF ();
+        status = H5Sclose (iter->memspace_id);
+        bagUnlockHDF ();
+    }
+
+    free (iter->elevation);
+    free (iter->uncertainty);
+    free (iter);
+
+    check_hdf_status();
+
+    return BAG_SUCCESS;
+}
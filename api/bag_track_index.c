@@ -0,0 +1,818 @@
+/*! \file bag_track_index.c
+ * \brief This module contains the secondary indexes of the tracking lists.
+ ********************************************************************
+ *
+ * Module Name : bag_track_index.c
+ *
+ * Author/Date : ONSWG, October 2026
+ *
+ * Description :
+ *               A tracking list index answers the by-node, by-code and
+ *               by-series queries of bag_tracking_list.c without reading the
+ *               whole list.  For each kind of key, the index holds two
+ *               datasets in a group next to the list:
+ *
+ *                 <kind>_ranges  one record per distinct key, in key order,
+ *                                with the first and the number of its
+ *                                entries in <kind>_items
+ *                 <kind>_items   the positions in the list of the items of
+ *                                every key, grouped by key, in list order
+ *
+ *               A query is a binary search of the ranges and one read of the
+ *               items, O(log n + k).  The group carries the length of the list
+ *               when it was indexed; items appended since are found by a scan
+ *               of that tail only.  Sorting a list moves its items, so the
+ *               sort routines rebuild the index of a list that has one.
+ *
+ *               The group also carries a CRC32 of TRACK_INDEX_SAMPLES items
+ *               spread evenly over the indexed part of the list.  The first
+ *               lookup through a handle checks it, so an index whose list was
+ *               rewritten or sorted again by other software, even at the same
+ *               length, is not used: the queries scan the list instead.
+ *
+ *               The main list is indexed by node, code and series; the
+ *               variable resolution list also by sub-node.
+ *
+ * Restrictions/Limitations :
+ *               The index is built within a memory bound, 64 MiB or the one
+ *               given to the sort that rebuilds it.  Each kind of key is made
+ *               as (key, position) entries of 20 bytes, sorted by the radix
+ *               sort of bag_tracking_sort.c, and streamed out to the ranges
+ *               and items.  A list of more entries than half the bound holds
+ *               keeps them in a temporary file, sorted in runs and merged
+ *               there as a list is.  The checksum samples the list, so an edit
+ *               in place of items between the samples goes unnoticed; build
+ *               the index again after editing a list with other software.
+ *
+ * Change Descriptions :
+ * who  when      what
+ * ---  ----      ----
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ ********************************************************************/
+
+#include "bag_private.h"
+#include "crc32.h"
+
+#define TRACK_INDEX_LENGTH_NAME   "list_length"
+#define TRACK_INDEX_CHECKSUM_NAME "list_checksum"
+#define TRACK_INDEX_SAMPLES       256     /*!< Items of the list covered by the checksum */
+
+/*! \brief Whether the index of a list was found to match it, see \a bagLookupTrackIndex */
+enum TRACK_INDEX_STATES {
+    TRACK_INDEX_UNCHECKED = 0,
+    TRACK_INDEX_MATCHES   = 1,
+    TRACK_INDEX_STALE     = 2
+};
+
+/*! \brief The kinds of key a tracking list is indexed by */
+enum TRACK_INDEX_KINDS {
+    TRACK_INDEX_NODE    = 0,
+    TRACK_INDEX_CODE    = 1,
+    TRACK_INDEX_SERIES  = 2,
+    TRACK_INDEX_SUBNODE = 3,
+    TRACK_INDEX_KIND_COUNT
+};
+
+static const char *track_index_names[TRACK_INDEX_KIND_COUNT] = { "node", "code", "series", "subnode" };
+
+/*! \brief One distinct key of an index, stored in <kind>_ranges */
+typedef struct _t_bagTrackIndexRange {
+    u32     key[4];
+    u32     start;      /*!< First entry of the key in <kind>_items */
+    u32     count;      /*!< Entries of the key */
+} bagTrackIndexRange;
+
+/*! \brief The memory and temporary storage of one index build */
+typedef struct _t_bagTrackIndexBuild {
+    hid_t     list_id;
+    hid_t     list_type;
+    u32       list_len;
+    Bool      varres;
+    size_t    item_size;
+    hid_t     entry_type;   /*!< HDF type of a bagTrackIndexEntry */
+    u8       *mem;          /*!< 2 * run_items entries */
+    u32       run_items;
+    hid_t     entries_id;   /*!< Entries of a list longer than run_items, in a temporary file */
+} bagTrackIndexBuild;
+
+/*! \brief bagTrackIndexKind gives the kind of index serving a query of \a mode */
+static s32 bagTrackIndexKind (u16 mode)
+{
+    switch (mode)
+    {
+    case READ_TRACK_RC:     return TRACK_INDEX_NODE;
+    case READ_TRACK_CODE:   return TRACK_INDEX_CODE;
+    case READ_TRACK_SERIES: return TRACK_INDEX_SERIES;
+    case READ_TRACK_SUBRC:  return TRACK_INDEX_SUBNODE;
+    default:                return -1;
+    }
+}
+
+/*! \brief bagTrackIndexKey extracts the key of \a kind from one item of the list */
+static void bagTrackIndexKey (Bool varres, s32 kind, const void *item, u32 *key)
+{
+    key[0] = key[1] = key[2] = key[3] = 0;
+
+    if (varres)
+    {
+        const bagVarResTrackingItem *it = (const bagVarResTrackingItem *) item;
+
+        switch (kind)
+        {
+        case TRACK_INDEX_SUBNODE:
+            key[2] = it->sub_row;
+            key[3] = it->sub_col;
+            /* fall through */
+        case TRACK_INDEX_NODE:
+            key[0] = it->row;
+            key[1] = it->col;
+            break;
+        case TRACK_INDEX_CODE:
+            key[0] = it->track_code;
+            break;
+        default:
+            key[0] = it->list_series;
+            break;
+        }
+    }
+    else
+    {
+        const bagTrackingItem *it = (const bagTrackingItem *) item;
+
+        switch (kind)
+        {
+        case TRACK_INDEX_NODE:
+            key[0] = it->row;
+            key[1] = it->col;
+            break;
+        case TRACK_INDEX_CODE:
+            key[0] = it->track_code;
+            break;
+        default:
+            key[0] = it->list_series;
+            break;
+        }
+    }
+}
+
+/*! \brief bagTrackIndexCompareKeys orders two keys */
+static s32 bagTrackIndexCompareKeys (const u32 *a, const u32 *b)
+{
+    u32 i;
+
+    for (i = 0; i < 4; i++)
+    {
+        if (a[i] != b[i])
+            return (a[i] < b[i]) ? -1 : 1;
+    }
+    return 0;
+}
+
+/*! \brief bagTrackIndexCompareEntries orders entries by key, then position */
+s32 bagTrackIndexCompareEntries (const void *a, const void *b)
+{
+    const bagTrackIndexEntry *ea = (const bagTrackIndexEntry *) a;
+    const bagTrackIndexEntry *eb = (const bagTrackIndexEntry *) b;
+    s32 c = bagTrackIndexCompareKeys (ea->key, eb->key);
+
+    if (c != 0)
+        return c;
+    return (ea->pos < eb->pos) ? -1 : (ea->pos > eb->pos);
+}
+
+/*! \brief bagTrackIndexRangeType builds the HDF compound type of a bagTrackIndexRange */
+static hid_t bagTrackIndexRangeType (void)
+{
+    hid_t datatype_id;
+
+    if ((datatype_id = H5Tcreate (H5T_COMPOUND, sizeof (bagTrackIndexRange))) < 0)
+        return -1;
+    if (H5Tinsert (datatype_id, "key0", HOFFSET (bagTrackIndexRange, key[0]), H5T_NATIVE_UINT) < 0 ||
+        H5Tinsert (datatype_id, "key1", HOFFSET (bagTrackIndexRange, key[1]), H5T_NATIVE_UINT) < 0 ||
+        H5Tinsert (datatype_id, "key2", HOFFSET (bagTrackIndexRange, key[2]), H5T_NATIVE_UINT) < 0 ||
+        H5Tinsert (datatype_id, "key3", HOFFSET (bagTrackIndexRange, key[3]), H5T_NATIVE_UINT) < 0 ||
+        H5Tinsert (datatype_id, "start", HOFFSET (bagTrackIndexRange, start), H5T_NATIVE_UINT) < 0 ||
+        H5Tinsert (datatype_id, "count", HOFFSET (bagTrackIndexRange, count), H5T_NATIVE_UINT) < 0)
+    {
+        H5Tclose (datatype_id);
+        return -1;
+    }
+    return datatype_id;
+}
+
+/****************************************************************************************/
+/*! \brief  bagTrackingItemKey extracts the key a query of \a mode compares, as the index
+ *          stores it, from one item of a tracking list
+ ****************************************************************************************/
+void bagTrackingItemKey (Bool varres, u16 mode, const void *item, u32 *key)
+{
+    bagTrackIndexKey (varres, bagTrackIndexKind (mode), item, key);
+}
+
+/****************************************************************************************/
+/*! \brief  bagReadTrackingItems reads the items at ascending positions of a tracking list
+ *
+ *  A run of consecutive positions, as in a list sorted by the key looked up, is read as
+ *  one hyperslab; other positions as one point selection.  Called with the HDF lock held.
+ *
+ ****************************************************************************************/
+bagError bagReadTrackingItems (hid_t dataset_id, hid_t datatype_id, const u32 *positions, u32 npositions, void *items)
+{
+    hid_t     filespace_id, memspace_id;
+    hsize_t   count[1], offset[1], *coords;
+    herr_t    status;
+    u32       i;
+
+    if (npositions == 0)
+        return BAG_SUCCESS;
+
+    if ((filespace_id = H5Dget_space (dataset_id)) < 0)
+        return BAG_HDF_DATASPACE_CORRUPTED;
+
+    count[0] = npositions;
+    if (positions[npositions - 1] - positions[0] == npositions - 1)
+    {
+        offset[0] = positions[0];
+        status = H5Sselect_hyperslab (filespace_id, H5S_SELECT_SET, offset, NULL, count, NULL);
+    }
+    else
+    {
+        if ((coords = malloc ((size_t) npositions * sizeof (hsize_t))) == NULL)
+        {
+            H5Sclose (filespace_id);
+            return BAG_MEMORY_ALLOCATION_FAILED;
+        }
+        for (i = 0; i < npositions; i++)
+            coords[i] = positions[i];
+        status = H5Sselect_elements (filespace_id, H5S_SELECT_SET, (size_t) npositions, (const hsize_t *) coords);
+        free (coords);
+    }
+
+    if (status < 0 || (memspace_id = H5Screate_simple (1, count, NULL)) < 0)
+    {
+        H5Sclose (filespace_id);
+        return BAG_HDF_CREATE_DATASPACE_FAILURE;
+    }
+
+    status = H5Dread (dataset_id, datatype_id, memspace_id, filespace_id, H5P_DEFAULT, items);
+    H5Sclose (memspace_id);
+    H5Sclose (filespace_id);
+
+    return (status < 0) ? BAG_HDF_READ_FAILURE : BAG_SUCCESS;
+}
+
+/*! \brief bagTrackIndexEntryType builds the HDF compound type of a bagTrackIndexEntry */
+static hid_t bagTrackIndexEntryType (void)
+{
+    hid_t datatype_id;
+
+    if ((datatype_id = H5Tcreate (H5T_COMPOUND, sizeof (bagTrackIndexEntry))) < 0)
+        return -1;
+    if (H5Tinsert (datatype_id, "key0", HOFFSET (bagTrackIndexEntry, key[0]), H5T_NATIVE_UINT) < 0 ||
+        H5Tinsert (datatype_id, "key1", HOFFSET (bagTrackIndexEntry, key[1]), H5T_NATIVE_UINT) < 0 ||
+        H5Tinsert (datatype_id, "key2", HOFFSET (bagTrackIndexEntry, key[2]), H5T_NATIVE_UINT) < 0 ||
+        H5Tinsert (datatype_id, "key3", HOFFSET (bagTrackIndexEntry, key[3]), H5T_NATIVE_UINT) < 0 ||
+        H5Tinsert (datatype_id, "pos", HOFFSET (bagTrackIndexEntry, pos), H5T_NATIVE_UINT) < 0)
+    {
+        H5Tclose (datatype_id);
+        return -1;
+    }
+    return datatype_id;
+}
+
+/*! \brief bagTrackIndexCreate makes a 1-D dataset of \a n elements, in \a group_id or a temporary file */
+static hid_t bagTrackIndexCreate (hid_t loc_id, const char *name, hid_t datatype_id, u32 n)
+{
+    hid_t     dataspace_id, dataset_id;
+    hsize_t   dims[1];
+
+    dims[0] = n;
+    if ((dataspace_id = H5Screate_simple (1, dims, NULL)) < 0)
+        return -1;
+    dataset_id = H5Dcreate (loc_id, name, datatype_id, dataspace_id, H5P_DEFAULT);
+    H5Sclose (dataspace_id);
+
+    return dataset_id;
+}
+
+/****************************************************************************************/
+/*! \brief bagTrackIndexFill makes the entries of one kind of key, in list order
+ *
+ *  The list is read into the second half of the memory a block at a time.  A list of
+ *  no more than run_items items has its entries made in the first half; a longer one
+ *  has them written a block at a time to the temporary dataset.
+ *
+ ****************************************************************************************/
+static bagError bagTrackIndexFill (bagTrackIndexBuild *b, s32 kind)
+{
+    bagTrackIndexEntry *entries = (bagTrackIndexEntry *) b->mem;
+    bagError  err = BAG_SUCCESS;
+    u8       *block = b->mem + (size_t) b->run_items * sizeof (bagTrackIndexEntry);
+    u32       per, i, j, n, first;
+
+    per = (u32) ((size_t) b->run_items * sizeof (bagTrackIndexEntry) / b->item_size);
+    for (i = 0; i < b->list_len && err == BAG_SUCCESS; i += n)
+    {
+        n = (b->list_len - i < per) ? b->list_len - i : per;
+        if ((err = bagSortIO (b->list_id, b->list_type, i, n, block, False)) != BAG_SUCCESS)
+            break;
+
+        first = (b->entries_id < 0) ? i : 0;
+        for (j = 0; j < n; j++)
+        {
+            bagTrackIndexKey (b->varres, kind, block + (size_t) j * b->item_size, entries[first + j].key);
+            entries[first + j].pos = i + j;
+        }
+        if (b->entries_id >= 0)
+            err = bagSortIO (b->entries_id, b->entry_type, i, n, entries, True);
+    }
+    return err;
+}
+
+/****************************************************************************************/
+/*! \brief bagTrackIndexEmit writes <kind>_items and <kind>_ranges from the sorted entries
+ *
+ *  Two passes over the entries, a block at a time: the first counts the distinct keys,
+ *  the second writes the positions and the ranges.  Sorted entries still in memory take
+ *  its first half and the blocks written the second; entries in the temporary dataset
+ *  are read into the memory too.
+ *
+ ****************************************************************************************/
+static bagError bagTrackIndexEmit (bagTrackIndexBuild *b, hid_t group_id, s32 kind)
+{
+    const bagTrackIndexEntry *in;
+    bagTrackIndexRange *ranges, cur = { { 0, 0, 0, 0 }, 0, 0 };
+    hid_t     items_id, ranges_id, range_type;
+    bagError  err = BAG_SUCCESS;
+    size_t    room;
+    u32      *items, per, pass, i, j, n, nranges = 0, pushed, nout = 0;
+    u8       *out;
+    char      name[32];
+
+    /*! the blocks share what the entries held in memory leave free */
+    if (b->entries_id < 0)
+    {
+        out  = b->mem + (size_t) b->run_items * sizeof (bagTrackIndexEntry);
+        room = (size_t) b->run_items * sizeof (bagTrackIndexEntry);
+        per  = (u32) (room / (sizeof (u32) + sizeof (bagTrackIndexRange)));
+    }
+    else
+    {
+        room = 2 * (size_t) b->run_items * sizeof (bagTrackIndexEntry);
+        per  = (u32) (room / (sizeof (bagTrackIndexEntry) + sizeof (u32) + sizeof (bagTrackIndexRange)));
+        out  = b->mem + (size_t) per * sizeof (bagTrackIndexEntry);
+    }
+    items  = (u32 *) out;
+    ranges = (bagTrackIndexRange *) (out + (size_t) per * sizeof (u32));
+
+    if ((range_type = bagTrackIndexRangeType ()) < 0)
+        return BAG_HDF_TYPE_CREATE_FAILURE;
+    items_id = ranges_id = -1;
+
+    for (pass = 0; pass < 2 && err == BAG_SUCCESS; pass++)
+    {
+        if (pass == 1)
+        {
+            sprintf (name, "%s_ranges", track_index_names[kind]);
+            ranges_id = bagTrackIndexCreate (group_id, name, range_type, nranges);
+            sprintf (name, "%s_items", track_index_names[kind]);
+            items_id  = bagTrackIndexCreate (group_id, name, H5T_NATIVE_UINT, b->list_len);
+            if (ranges_id < 0 || items_id < 0)
+            {
+                err = BAG_HDF_CREATE_DATASET_FAILURE;
+                break;
+            }
+            nranges = 0;
+        }
+
+        for (i = 0; i < b->list_len && err == BAG_SUCCESS; i += n)
+        {
+            n = (b->list_len - i < per) ? b->list_len - i : per;
+            if (b->entries_id < 0)
+                in = (const bagTrackIndexEntry *) b->mem + i;
+            else if ((err = bagSortIO (b->entries_id, b->entry_type, i, n, b->mem, False)) != BAG_SUCCESS)
+                break;
+            else
+                in = (const bagTrackIndexEntry *) b->mem;
+
+            /*! a range is pushed once the next key shows it complete */
+            for (j = 0, pushed = 0; j < n; j++)
+            {
+                if (i + j > 0 && bagTrackIndexCompareKeys (cur.key, in[j].key) == 0)
+                {
+                    cur.count++;
+                    continue;
+                }
+                if (i + j > 0 && pass == 1)
+                    ranges[pushed++] = cur;
+                memcpy (cur.key, in[j].key, sizeof (cur.key));
+                cur.start = i + j;
+                cur.count = 1;
+                nranges++;
+            }
+            if (pass == 0)
+                continue;
+
+            for (j = 0; j < n; j++)
+                items[j] = in[j].pos;
+            if ((err = bagSortIO (items_id, H5T_NATIVE_UINT, i, n, items, True)) == BAG_SUCCESS)
+                err = bagSortIO (ranges_id, range_type, nout, pushed, ranges, True);
+            nout += pushed;
+        }
+        if (err == BAG_SUCCESS && pass == 1 && b->list_len > 0)
+            err = bagSortIO (ranges_id, range_type, nout, 1, &cur, True);
+    }
+
+    if (items_id >= 0)
+        H5Dclose (items_id);
+    if (ranges_id >= 0)
+        H5Dclose (ranges_id);
+    H5Tclose (range_type);
+    return err;
+}
+
+/****************************************************************************************/
+/*! \brief  bagTrackIndexChecksum computes the CRC32 of the sampled items of a list
+ *
+ *  The first and last of \a list_len items and others evenly between, each packed field
+ *  by field so that the padding of the structures does not count.
+ *
+ ****************************************************************************************/
+static bagError bagTrackIndexChecksum (hid_t list_id, hid_t list_type, Bool varres, u32 list_len, u32 *crc)
+{
+    size_t    item_size = varres ? sizeof (bagVarResTrackingItem) : sizeof (bagTrackingItem);
+    u32       positions[TRACK_INDEX_SAMPLES], nsamples, i;
+    u8       *items, *packed, *p;
+    bagError  err;
+
+    *crc = 0;
+    if (list_len == 0)
+        return BAG_SUCCESS;
+
+    nsamples = (list_len < TRACK_INDEX_SAMPLES) ? list_len : TRACK_INDEX_SAMPLES;
+    for (i = 0; i < nsamples; i++)
+        positions[i] = (nsamples > 1) ? (u32) ((HDF_size_t) i * (list_len - 1) / (nsamples - 1)) : 0;
+
+    items  = malloc (nsamples * item_size);
+    packed = malloc (nsamples * item_size);
+    if (items == NULL || packed == NULL)
+    {
+        free (items);
+        free (packed);
+        return BAG_MEMORY_ALLOCATION_FAILED;
+    }
+
+    if ((err = bagReadTrackingItems (list_id, list_type, positions, nsamples, items)) == BAG_SUCCESS)
+    {
+        for (i = 0, p = packed; i < nsamples; i++)
+        {
+            if (varres)
+            {
+                const bagVarResTrackingItem *it = (const bagVarResTrackingItem *) items + i;
+
+                memcpy (p, &it->row, 4);          p += 4;
+                memcpy (p, &it->col, 4);          p += 4;
+                memcpy (p, &it->sub_row, 4);      p += 4;
+                memcpy (p, &it->sub_col, 4);      p += 4;
+                memcpy (p, &it->depth, 4);        p += 4;
+                memcpy (p, &it->uncertainty, 4);  p += 4;
+                memcpy (p, &it->track_code, 1);   p += 1;
+                memcpy (p, &it->list_series, 2);  p += 2;
+            }
+            else
+            {
+                const bagTrackingItem *it = (const bagTrackingItem *) items + i;
+
+                memcpy (p, &it->row, 4);          p += 4;
+                memcpy (p, &it->col, 4);          p += 4;
+                memcpy (p, &it->depth, 4);        p += 4;
+                memcpy (p, &it->uncertainty, 4);  p += 4;
+                memcpy (p, &it->track_code, 1);   p += 1;
+                memcpy (p, &it->list_series, 2);  p += 2;
+            }
+        }
+        *crc = crc32_calc_buffer ((const char *) packed, (u32) (p - packed));
+    }
+
+    free (items);
+    free (packed);
+    return err;
+}
+
+/****************************************************************************************/
+/*! \brief  bagBuildTrackIndex (re)makes the index of a tracking list within \a max_bytes
+ *
+ *  Each kind of key is made as (key, position) entries, sorted by the radix sort and
+ *  merge of bag_tracking_sort.c, and written out in two streaming passes.  A list of
+ *  more than \a max_bytes / 40 items keeps its entries in a temporary file.  Called
+ *  with the HDF lock held, by \a bagBuildTrackingListIndex and by the sorts.
+ *
+ *  \param  max_bytes  Memory the build may use, 0 for TRACKING_LIST_SORT_BYTES
+ *
+ ****************************************************************************************/
+bagError bagBuildTrackIndex (bagHandle hnd, Bool varres, u32 max_bytes)
+{
+    static const u32 nkeys[TRACK_INDEX_KIND_COUNT] = { 2, 1, 1, 4 };
+    const char *path = varres ? VARRES_TRACKING_LIST_INDEX_PATH : TRACKING_LIST_INDEX_PATH;
+    bagTrackIndexBuild b;
+    hid_t     group_id, file_id = -1;
+    bagError  err;
+    u32       crc;
+    s32       kind;
+    char      name[TRACK_SORT_NAME_LEN];
+
+    if ((err = bagGetTrackingList (hnd, varres, &b.list_id, &b.list_type, &b.list_len)) != BAG_SUCCESS)
+        return err;
+    b.varres     = varres;
+    b.item_size  = varres ? sizeof (bagVarResTrackingItem) : sizeof (bagTrackingItem);
+    b.entries_id = -1;
+    b.run_items  = ((max_bytes > 0) ? max_bytes : TRACKING_LIST_SORT_BYTES) / (u32) (2 * sizeof (bagTrackIndexEntry));
+    if (b.run_items < TRACK_SORT_MIN_RUN)
+        b.run_items = TRACK_SORT_MIN_RUN;
+    if (b.run_items > b.list_len && b.list_len > TRACK_SORT_MIN_RUN)
+        b.run_items = b.list_len;
+
+    if (H5Lexists (hnd->file_id, path, H5P_DEFAULT) > 0 && H5Ldelete (hnd->file_id, path, H5P_DEFAULT) < 0)
+        return BAG_HDF_GROUP_CLOSE_FAILURE;
+    if ((b.entry_type = bagTrackIndexEntryType ()) < 0)
+        return BAG_HDF_TYPE_CREATE_FAILURE;
+    if ((b.mem = malloc (2 * (size_t) b.run_items * sizeof (bagTrackIndexEntry))) == NULL)
+    {
+        H5Tclose (b.entry_type);
+        return BAG_MEMORY_ALLOCATION_FAILED;
+    }
+    if ((group_id = H5Gcreate (hnd->file_id, path, 0)) < 0)
+    {
+        free (b.mem);
+        H5Tclose (b.entry_type);
+        return BAG_HDF_CREATE_GROUP_FAILURE;
+    }
+
+    /*! the entries of a long list are spilled, one dataset reused by every kind */
+    err = BAG_SUCCESS;
+    if (b.list_len > b.run_items)
+    {
+        if ((file_id = bagSortCreateTemp (hnd, name)) < 0)
+            err = BAG_HDF_CREATE_FILE_FAILURE;
+        else if ((b.entries_id = bagTrackIndexCreate (file_id, "entries", b.entry_type, b.list_len)) < 0)
+            err = BAG_HDF_CREATE_DATASET_FAILURE;
+    }
+
+    for (kind = 0; kind < TRACK_INDEX_KIND_COUNT && err == BAG_SUCCESS; kind++)
+    {
+        if (kind == TRACK_INDEX_SUBNODE && !varres)
+            continue;
+        if ((err = bagTrackIndexFill (&b, kind)) == BAG_SUCCESS &&
+            (err = bagSortTrackIndexEntries (hnd, nkeys[kind], b.entries_id, b.entry_type, b.list_len, b.mem, b.run_items)) == BAG_SUCCESS)
+            err = bagTrackIndexEmit (&b, group_id, kind);
+    }
+
+    if (b.entries_id >= 0)
+        H5Dclose (b.entries_id);
+    if (file_id >= 0)
+    {
+        H5Fclose (file_id);
+        remove (name);
+    }
+    free (b.mem);
+    H5Tclose (b.entry_type);
+
+    if (err == BAG_SUCCESS &&
+        (err = bagTrackIndexChecksum (b.list_id, b.list_type, varres, b.list_len, &crc)) == BAG_SUCCESS &&
+        (err = bagCreateAttribute (hnd, group_id, (u8 *) TRACK_INDEX_CHECKSUM_NAME, 0, BAG_ATTR_U32)) == BAG_SUCCESS)
+        err = bagWriteAttribute (hnd, group_id, (u8 *) TRACK_INDEX_CHECKSUM_NAME, &crc);
+
+    /*! the length is stamped last, an index cut short is never used */
+    if (err == BAG_SUCCESS &&
+        (err = bagCreateAttribute (hnd, group_id, (u8 *) TRACK_INDEX_LENGTH_NAME, 0, BAG_ATTR_U32)) == BAG_SUCCESS)
+        err = bagWriteAttribute (hnd, group_id, (u8 *) TRACK_INDEX_LENGTH_NAME, &b.list_len);
+    H5Gclose (group_id);
+
+    if (err != BAG_SUCCESS)
+        H5Ldelete (hnd->file_id, path, H5P_DEFAULT);
+    hnd->track_index_state[varres ? 1 : 0] = (err == BAG_SUCCESS) ? TRACK_INDEX_MATCHES : TRACK_INDEX_UNCHECKED;
+    return err;
+}
+
+/****************************************************************************************/
+/*! \brief  bagHasTrackIndex tells whether a tracking list has an index
+ ****************************************************************************************/
+Bool bagHasTrackIndex (bagHandle hnd, Bool varres)
+{
+    return (H5Lexists (hnd->file_id, varres ? VARRES_TRACKING_LIST_INDEX_PATH : TRACKING_LIST_INDEX_PATH, H5P_DEFAULT) > 0) ? True : False;
+}
+
+/****************************************************************************************/
+/*! \brief  bagLookupTrackIndex finds the positions of the items of one key
+ *
+ *  \param  hnd          External reference to the private \a bagHandle object
+ *  \param  varres       True for the variable resolution tracking list
+ *  \param  mode         One of \a READ_TRACK_MODE, the kind of key looked up
+ *  \param *key          The row, col, sub_row and sub_col; or the code or series first
+ *  \param **positions   Receives the ascending positions found, to be freed by the
+ *                       caller, or NULL when there are none
+ *  \param *npositions   Receives the number of positions
+ *  \param *indexed_len  Receives the length of the list covered by the index; the
+ *                       items after it must be scanned
+ *
+ *  The checksum of the index is compared with the list at the first lookup through
+ *  \a hnd; the outcome holds until the index is rebuilt.
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li \a BAG_HDF_GROUP_OPEN_FAILURE when the list has no usable index.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ *  Called with the HDF lock held.
+ *
+ ****************************************************************************************/
+bagError bagLookupTrackIndex (bagHandle hnd, Bool varres, u16 mode, const u32 *key,
+                              u32 **positions, u32 *npositions, u32 *indexed_len)
+{
+    bagTrackIndexRange range;
+    hid_t     group_id, ranges_id, items_id, range_type, filespace_id, memspace_id;
+    hsize_t   count[1], offset[1], nranges;
+    bagError  err = BAG_SUCCESS;
+    u32       list_len, lo, hi, mid, crc, stamped;
+    u8       *state = &hnd->track_index_state[varres ? 1 : 0];
+    s32       kind, c;
+    char      name[32];
+    Bool      found = False;
+
+    *positions  = NULL;
+    *npositions = 0;
+
+    if ((kind = bagTrackIndexKind (mode)) < 0 || (kind == TRACK_INDEX_SUBNODE && !varres))
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+    if (!bagHasTrackIndex (hnd, varres))
+        return BAG_HDF_GROUP_OPEN_FAILURE;
+    if ((group_id = H5Gopen (hnd->file_id, varres ? VARRES_TRACKING_LIST_INDEX_PATH : TRACKING_LIST_INDEX_PATH)) < 0)
+        return BAG_HDF_GROUP_OPEN_FAILURE;
+
+    if (bagReadAttribute (hnd, group_id, (u8 *) TRACK_INDEX_LENGTH_NAME, indexed_len) != BAG_SUCCESS)
+    {
+        H5Gclose (group_id);
+        return BAG_HDF_GROUP_OPEN_FAILURE;
+    }
+
+    /*! an index of a list since shortened, or rewritten elsewhere, is of no use */
+    {
+        hid_t list_id, list_type;
+
+        if ((err = bagGetTrackingList (hnd, varres, &list_id, &list_type, &list_len)) != BAG_SUCCESS ||
+            list_len < *indexed_len)
+        {
+            H5Gclose (group_id);
+            return (err != BAG_SUCCESS) ? err : BAG_HDF_GROUP_OPEN_FAILURE;
+        }
+
+        /*! an index stamped before checksums were kept is treated as stale */
+        if (*state == TRACK_INDEX_UNCHECKED)
+        {
+            if (H5Aexists (group_id, TRACK_INDEX_CHECKSUM_NAME) <= 0 ||
+                bagReadAttribute (hnd, group_id, (u8 *) TRACK_INDEX_CHECKSUM_NAME, &stamped) != BAG_SUCCESS)
+                *state = TRACK_INDEX_STALE;
+            else if ((err = bagTrackIndexChecksum (list_id, list_type, varres, *indexed_len, &crc)) != BAG_SUCCESS)
+            {
+                H5Gclose (group_id);
+                return err;
+            }
+            else
+                *state = (crc == stamped) ? TRACK_INDEX_MATCHES : TRACK_INDEX_STALE;
+        }
+        if (*state == TRACK_INDEX_STALE)
+        {
+            H5Gclose (group_id);
+            return BAG_HDF_GROUP_OPEN_FAILURE;
+        }
+    }
+
+    sprintf (name, "%s_ranges", track_index_names[kind]);
+    ranges_id = H5Dopen (group_id, name);
+    sprintf (name, "%s_items", track_index_names[kind]);
+    items_id  = H5Dopen (group_id, name);
+    H5Gclose (group_id);
+    if (ranges_id < 0 || items_id < 0)
+    {
+        if (ranges_id >= 0)
+            H5Dclose (ranges_id);
+        if (items_id >= 0)
+            H5Dclose (items_id);
+        return BAG_HDF_GROUP_OPEN_FAILURE;
+    }
+
+    range_type   = bagTrackIndexRangeType ();
+    filespace_id = H5Dget_space (ranges_id);
+    H5Sget_simple_extent_dims (filespace_id, &nranges, NULL);
+    count[0]     = 1;
+    memspace_id  = H5Screate_simple (1, count, NULL);
+
+    /*! binary search of the distinct keys */
+    lo = 0;
+    hi = (u32) nranges;
+    while (lo < hi && err == BAG_SUCCESS)
+    {
+        mid       = lo + (hi - lo) / 2;
+        offset[0] = mid;
+        if (H5Sselect_hyperslab (filespace_id, H5S_SELECT_SET, offset, NULL, count, NULL) < 0 ||
+            H5Dread (ranges_id, range_type, memspace_id, filespace_id, H5P_DEFAULT, &range) < 0)
+        {
+            err = BAG_HDF_READ_FAILURE;
+            break;
+        }
+        c = bagTrackIndexCompareKeys (range.key, key);
+        if (c == 0)
+        {
+            found = True;
+            break;
+        }
+        if (c < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    H5Sclose (memspace_id);
+    H5Sclose (filespace_id);
+    H5Tclose (range_type);
+    H5Dclose (ranges_id);
+
+    /*! the positions of the key are one run of <kind>_items */
+    if (err == BAG_SUCCESS && found && range.count > 0)
+    {
+        if ((*positions = malloc ((size_t) range.count * sizeof (u32))) == NULL)
+            err = BAG_MEMORY_ALLOCATION_FAILED;
+        else
+        {
+            filespace_id = H5Dget_space (items_id);
+            offset[0]    = range.start;
+            count[0]     = range.count;
+            memspace_id  = H5Screate_simple (1, count, NULL);
+            if (H5Sselect_hyperslab (filespace_id, H5S_SELECT_SET, offset, NULL, count, NULL) < 0 ||
+                H5Dread (items_id, H5T_NATIVE_UINT, memspace_id, filespace_id, H5P_DEFAULT, *positions) < 0)
+                err = BAG_HDF_READ_FAILURE;
+            else
+                *npositions = range.count;
+            H5Sclose (memspace_id);
+            H5Sclose (filespace_id);
+        }
+    }
+    H5Dclose (items_id);
+
+    if (err != BAG_SUCCESS)
+    {
+        free (*positions);
+        *positions  = NULL;
+        *npositions = 0;
+    }
+    return err;
+}
+
+/****************************************************************************************/
+/*! \brief bagBuildTrackingListIndex indexes the tracking list by node, code and series
+ *
+ *  \param  hnd    External reference to the private \a bagHandle object, opened for write
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ****************************************************************************************/
+bagError bagBuildTrackingListIndex (bagHandle hnd)
+{
+    bagError err;
+
+    if (hnd == NULL)
+        return BAG_INVALID_BAG_HANDLE;
+
+    bagLockHDF ();
+    err = bagBuildTrackIndex (hnd, False, 0);
+    bagUnlockHDF ();
+
+    return err;
+}
+
+/****************************************************************************************/
+/*! \brief bagBuildVarResTrackingListIndex indexes the variable resolution tracking list
+ *         by node, sub-node, code and series
+ *
+ *  \param  hnd    External reference to the private \a bagHandle object, opened for write
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ****************************************************************************************/
+bagError bagBuildVarResTrackingListIndex (bagHandle hnd)
+{
+    bagError err;
+
+    if (hnd == NULL)
+        return BAG_INVALID_BAG_HANDLE;
+
+    bagLockHDF ();
+    err = bagBuildTrackIndex (hnd, True, 0);
+    bagUnlockHDF ();
+
+    return err;
+}
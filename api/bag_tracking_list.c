@@ -49,7 +49,7 @@ static bagError bagReadVarResTrackingList(bagHandle bagHandle, u16 mode, u32 inp
  *           \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS
  *
  ****************************************************************************************/
-bagError bagReadTrackingListIndex (bagHandle bagHandle, u16 index, bagTrackingItem *item)
+static bagError bagReadTrackingListIndexUnlocked (bagHandle bagHandle, u16 index, bagTrackingItem *item)
 {
     herr_t      status;
     u32         list_len, nct=0;
@@ -98,7 +98,18 @@ bagError bagReadTrackingListIndex (bagHandle bagHandle, u16 index, bagTrackingIt
     return BAG_SUCCESS;
 }
 
-bagError bagReadVarResTrackingListIndex(bagHandle bagHandle, u16 index, bagVarResTrackingItem *item)
+bagError bagReadTrackingListIndex (bagHandle bagHandle, u16 index, bagTrackingItem *item)
+{
+    bagError err;
+
+    bagLockHDF ();
+    err = bagReadTrackingListIndexUnlocked (bagHandle, index, item);
+    bagUnlockHDF ();
+
+    return err;
+}
+
+static bagError bagReadVarResTrackingListIndexUnlocked (bagHandle bagHandle, u16 index, bagVarResTrackingItem *item)
 {
     herr_t      status;
     u32         list_length, mem_space = 0;
@@ -146,6 +157,17 @@ bagError bagReadVarResTrackingListIndex(bagHandle bagHandle, u16 index, bagVarRe
     return BAG_SUCCESS;
 }
 
+bagError bagReadVarResTrackingListIndex(bagHandle bagHandle, u16 index, bagVarResTrackingItem *item)
+{
+    bagError err;
+
+    bagLockHDF ();
+    err = bagReadVarResTrackingListIndexUnlocked (bagHandle, index, item);
+    bagUnlockHDF ();
+
+    return err;
+}
+
 /****************************************************************************************/
 /*! \brief :     bagReadTrackingListCode
  *
@@ -246,405 +268,752 @@ bagError bagReadVarResTrackingListNode(bagHandle bagHandle, u32 row, u32 col, ba
 
 bagError bagReadVarResTrackingListSubnode(bagHandle bagHandle, u32 row, u32 col, u32 subrow, u32 subcol, bagVarResTrackingItem **items, u32 *length)
 {
-    return bagReadVarResTrackingList(bagHandle, READ_TRACK_RC, row, col, subrow, subcol, items, length);
+    return bagReadVarResTrackingList(bagHandle, READ_TRACK_SUBRC, row, col, subrow, subcol, items, length);
 }
 
 /***************************************************************************************/
-/*! 
- * This one is the single private function that the read by node and the read by index
- * functions go thru to access the tracking list dataset.
+/*! \brief bagGetTrackingList gives the dataset, datatype and length of a tracking list
+ *
+ *  \param  bagHandle     Handle for the Bag file
+ *  \param  varres        True for the variable resolution tracking list
+ *  \param *dataset_id    Set to the dataset of the list
+ *  \param *datatype_id   Set to the memory datatype of \a bagTrackingItem or
+ *                        \a bagVarResTrackingItem
+ *  \param *list_len      Set to the length attribute of the list
+ *
+ *  \return   \li On success, \a bagError is set to \a BAG_SUCCESS
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS
  *
- * The detailed prototype comments from those functions apply here.
  ****************************************************************************************/
+bagError bagGetTrackingList (bagHandle bagHandle, Bool varres, hid_t *dataset_id, hid_t *datatype_id, u32 *list_len)
+{
+    bagError err;
 
-bagError bagReadTrackingList(bagHandle bagHandle, u16 mode, u32 inp1, u32 inp2, bagTrackingItem **items, u32 *rtn_len)
+    if (bagHandle == NULL)
+        return BAG_INVALID_BAG_HANDLE;
+
+    if (varres)
+    {
+        if ((err = bagGetOptDatasetInfo (&bagHandle, VarRes_Tracking_List)) != BAG_SUCCESS)
+            return err;
+        *dataset_id  = bagHandle->opt_dataset_id[VarRes_Tracking_List];
+        *datatype_id = bagHandle->opt_datatype_id[VarRes_Tracking_List];
+        return bagReadAttribute (bagHandle, *dataset_id, (u8 *)VARRES_TRACKING_LIST_LENGTH_NAME, list_len);
+    }
+
+    *dataset_id  = bagHandle->trk_dataset_id;
+    *datatype_id = bagHandle->trk_datatype_id;
+    return bagReadAttribute (bagHandle, *dataset_id, (u8 *)TRACKING_LIST_LENGTH_NAME, list_len);
+}
+
+/***************************************************************************************/
+/*! 
+ * The queries of both tracking lists go thru \a bagQueryTrackingList.  The list is
+ * read in blocks of whole dataset chunks, about TRACKING_LIST_READ_BYTES at a time,
+ * and the matches of each block are handed to a sink: a result array grown
+ * geometrically, a caller's arena, or a caller's callback.  An indexed list reads
+ * just the items of the key, then scans those appended since it was indexed.
+ ****************************************************************************************/
+
+#define TRACKING_LIST_READ_BYTES  (1 << 20)   /*!< Target size of one block read of a tracking list */
+
+/*! \brief Receives the matching items of a query, a block at a time */
+typedef bagError (*bagTrackingSink) (void *ctx, const u8 *items, u32 count);
+
+/*! \brief Sink state of a result array owned by the library */
+typedef struct _t_bagTrackingGrow {
+    u8     **items;
+    u32     *length;
+    u32      capacity;
+    size_t   item_size;
+} bagTrackingGrow;
+
+/*! \brief Sink state of a caller's arena */
+typedef struct _t_bagTrackingArena {
+    u8      *arena;
+    u32      capacity;
+    u32     *length;
+    size_t   item_size;
+} bagTrackingArena;
+
+/*! \brief Sink state of a caller's callback */
+typedef struct _t_bagTrackingCall {
+    bagTrackingItemFunc        func;
+    bagVarResTrackingItemFunc  varres_func;
+    void                      *user;
+} bagTrackingCall;
+
+static bagError bagTrackingGrowSink (void *ctx, const u8 *items, u32 count)
 {
-    herr_t      status;
-    u32         list_len, nct=0;
-    u32         row = inp1, col = inp2;
-    u16         code = inp1, series = inp1;
+    bagTrackingGrow *g = (bagTrackingGrow *) ctx;
+    size_t need = (size_t) *g->length + count;
 
-    /* hyperslab selection parameters */
-    hsize_t	  count[1];
-    hssize_t	  offset[1];
+    if (need > g->capacity)
+    {
+        size_t cap = (g->capacity < 16) ? 16 : (size_t) g->capacity * 2;
+        u8 *tmp;
+
+        if (cap < need)
+            cap = need;
+        if (cap > 0xFFFFFFFFu)
+            cap = 0xFFFFFFFFu;
+        if (cap < need || (tmp = realloc (*g->items, cap * g->item_size)) == NULL)
+            return BAG_MEMORY_ALLOCATION_FAILED;
+        *g->items   = tmp;
+        g->capacity = (u32) cap;
+    }
+    memcpy (*g->items + (size_t) *g->length * g->item_size, items, (size_t) count * g->item_size);
+    *g->length += count;
+
+    return BAG_SUCCESS;
+}
 
+static bagError bagTrackingArenaSink (void *ctx, const u8 *items, u32 count)
+{
+    bagTrackingArena *a = (bagTrackingArena *) ctx;
+    u32 n = 0;
 
-    /*! tracking item buffers and allocation structs */
-    bagTrackingItem readbuf[TRACKING_LIST_BLOCK_SIZE];
-    
-    if (bagHandle == NULL)
-        return BAG_INVALID_BAG_HANDLE;
+    if (*a->length < a->capacity)
+        n = (a->capacity - *a->length < count) ? a->capacity - *a->length : count;
+    if (n > 0)
+        memcpy (a->arena + (size_t) *a->length * a->item_size, items, (size_t) n * a->item_size);
+    *a->length += count;
 
-    /*! beware - \a *items must be \a NULL first~ */
-    if ((*items) != NULL)
+    return BAG_SUCCESS;
+}
+
+static bagError bagTrackingCallSink (void *ctx, const u8 *items, u32 count)
+{
+    bagTrackingCall *c = (bagTrackingCall *) ctx;
+
+    if (c->varres_func != NULL)
+        return c->varres_func ((const bagVarResTrackingItem *) items, count, c->user);
+    return c->func ((const bagTrackingItem *) items, count, c->user);
+}
+
+/*! \brief bagTrackingQueryKey gives the mode and key of a query, as the index stores them */
+static bagError bagTrackingQueryKey (const bagTrackingQuery *query, Bool varres, u16 *mode, u32 *key)
+{
+    key[0] = key[1] = key[2] = key[3] = 0;
+    *mode  = query->by;
+
+    switch (query->by)
+    {
+    case BAG_TRACK_BY_SUBNODE:
+        if (!varres)
+            return BAG_INVALID_FUNCTION_ARGUMENT;
+        key[2] = query->sub_row;
+        key[3] = query->sub_col;
+        /* fall through */
+    case BAG_TRACK_BY_NODE:
+        key[0] = query->row;
+        key[1] = query->col;
+        break;
+    case BAG_TRACK_BY_CODE:
+        key[0] = query->track_code;
+        break;
+    case BAG_TRACK_BY_SERIES:
+        key[0] = query->list_series;
+        break;
+    case BAG_TRACK_ALL:
+        break;
+    default:
         return BAG_INVALID_FUNCTION_ARGUMENT;
-    (*items) = NULL;
+    }
+    return BAG_SUCCESS;
+}
 
-    if ((status = bagReadAttribute (bagHandle, bagHandle->trk_dataset_id, (u8 *)TRACKING_LIST_LENGTH_NAME, &list_len)) != BAG_SUCCESS)
-        return (status);
+/*! \brief bagTrackingListBlock sizes the block reads of a list to whole chunks */
+static u32 bagTrackingListBlock (hid_t dataset_id, size_t item_size, u32 list_len)
+{
+    hid_t    plist_id;
+    hsize_t  chunk[1];
+    u32      per_chunk = 1, block;
 
-    *rtn_len  = 0;                         /*! nothing to read yet */
-    count[0]  = TRACKING_LIST_BLOCK_SIZE;  /* chunk size */
-    offset[0] = 0;                         /*! start at head of list */
+    if ((plist_id = H5Dget_create_plist (dataset_id)) >= 0)
+    {
+        if (H5Pget_layout (plist_id) == H5D_CHUNKED && H5Pget_chunk (plist_id, 1, chunk) == 1 && chunk[0] > 0)
+            per_chunk = (u32) chunk[0];
+        H5Pclose (plist_id);
+    }
 
+    block = (per_chunk * item_size < TRACKING_LIST_READ_BYTES) ? per_chunk * (u32) (TRACKING_LIST_READ_BYTES / (per_chunk * item_size)) : per_chunk;
+    if (block > list_len)
+        block = (list_len > 0) ? list_len : 1;
 
-    if (bagHandle->trk_memspace_id >= 0)
-        nct = (u32)H5Sget_select_npoints (bagHandle->trk_memspace_id);
-     
-    if (bagHandle->trk_memspace_id < 0 || nct != count[0])
+    return block;
+}
+
+static bagError bagQueryTrackingList (bagHandle bagHandle, Bool varres, const bagTrackingQuery *query, bagTrackingSink sink, void *ctx)
+{
+    hid_t       dataset_id, datatype_id, filespace_id, memspace_id = -1;
+    size_t      item_size = varres ? sizeof(bagVarResTrackingItem) : sizeof(bagTrackingItem);
+    bagError    err;
+    u32         list_len, block, offset = 0, nmemspace = 0, n, nmatch, i;
+    u32         key[4], item_key[4], *positions, npositions, indexed_len;
+    u16         mode;
+    u8         *buf;
+
+    /* hyperslab selection parameters */
+    hsize_t     count[1], start[1];
+
+    if (bagHandle == NULL)
+        return BAG_INVALID_BAG_HANDLE;
+    if ((err = bagTrackingQueryKey (query, varres, &mode, key)) != BAG_SUCCESS)
+        return err;
+
+    if ((err = bagGetTrackingList (bagHandle, varres, &dataset_id, &datatype_id, &list_len)) != BAG_SUCCESS)
+        return err;
+
+    block = bagTrackingListBlock (dataset_id, item_size, list_len);
+    if ((buf = malloc ((size_t) block * item_size)) == NULL)
+        return BAG_MEMORY_ALLOCATION_FAILED;
+
+    /*! an indexed list reads just the matching items, then scans those appended since */
+    if (mode != READ_TRACK_ALL &&
+        bagLookupTrackIndex (bagHandle, varres, mode, key, &positions, &npositions, &indexed_len) == BAG_SUCCESS)
     {
-        if (bagHandle->trk_memspace_id >= 0)
+        for (i = 0; i < npositions && err == BAG_SUCCESS; i += n)
         {
-            status = H5Sclose (bagHandle->trk_memspace_id);
-            check_hdf_status();
+            n = (npositions - i < block) ? npositions - i : block;
+            if ((err = bagReadTrackingItems (dataset_id, datatype_id, positions + i, n, buf)) == BAG_SUCCESS)
+                err = sink (ctx, buf, n);
         }
-         
-        /*! define the memspace */
-        if ((bagHandle->trk_memspace_id = H5Screate_simple (1, count, NULL)) < 0)
-            return BAG_HDF_CREATE_DATASPACE_FAILURE;
+        free (positions);
+        offset = indexed_len;
+    }
+
+    if ((filespace_id = H5Dget_space (dataset_id)) < 0)
+    {
+        free (buf);
+        return BAG_HDF_DATASPACE_CORRUPTED;
     }
-    
 
-    while (offset[0] < list_len)
+    /*! blocks after the first start on a block, and so a chunk, boundary */
+    for (; offset < list_len && err == BAG_SUCCESS; offset += n)
     {
-        u32 i;
+        n = block - offset % block;
+        if (n > list_len - offset)
+            n = list_len - offset;
 
-        /*! shrink the memspace if we have less than a chunk left to read from
-         * the tracking list */
-        if (list_len - offset[0] < TRACKING_LIST_BLOCK_SIZE) 
+        if (n != nmemspace)
         {
-            status = H5Sclose (bagHandle->trk_memspace_id);
-            check_hdf_status();
-            count[0] = (list_len % TRACKING_LIST_BLOCK_SIZE);
-
-            /* define the hyperslab parameters */
-            if ((bagHandle->trk_memspace_id = H5Screate_simple (1, count, NULL)) < 0)
-                return BAG_HDF_CREATE_DATASPACE_FAILURE;
+            if (memspace_id >= 0)
+                H5Sclose (memspace_id);
+            count[0] = n;
+            if ((memspace_id = H5Screate_simple (1, count, NULL)) < 0)
+            {
+                err = BAG_HDF_CREATE_DATASPACE_FAILURE;
+                break;
+            }
+            nmemspace = n;
         }
 
-        status = H5Sselect_hyperslab (bagHandle->trk_filespace_id, H5S_SELECT_SET, (hsize_t *)offset, NULL, count, NULL);
-        check_hdf_status();
-        
-        status = H5Dread (bagHandle->trk_dataset_id, bagHandle->trk_datatype_id,
-                          bagHandle->trk_memspace_id, bagHandle->trk_filespace_id, 
-                          H5P_DEFAULT, readbuf);
-        check_hdf_status();
+        start[0] = offset;
+        count[0] = n;
+        if (H5Sselect_hyperslab (filespace_id, H5S_SELECT_SET, start, NULL, count, NULL) < 0 ||
+            H5Dread (dataset_id, datatype_id, memspace_id, filespace_id, H5P_DEFAULT, buf) < 0)
+        {
+            err = BAG_HDF_READ_FAILURE;
+            break;
+        }
 
-        /*! loop thru what we just read into *readBuf */
-        for (i=0; i < count[0]; i++)
+        /*! pack the matches of the block to its front */
+        nmatch = n;
+        if (mode != READ_TRACK_ALL)
         {
-            /* found a match? */
-            if ((mode == READ_TRACK_SERIES && readbuf[i].list_series == series) ||
-                (mode == READ_TRACK_CODE && readbuf[i].track_code == code) ||
-                (mode == READ_TRACK_RC   && readbuf[i].col == col && readbuf[i].row == row))
+            for (i = 0, nmatch = 0; i < n; i++)
             {
-                /*! alloc for new list or expand plus 1 item */
-                if ((*items) == NULL)
-                {
-                    (*items) = calloc (1, sizeof(bagTrackingItem));
-                    if ((*items) == NULL)
-                    {
-                        return BAG_MEMORY_ALLOCATION_FAILED;
-                    }
-                }
-                else
+                bagTrackingItemKey (varres, mode, buf + (size_t) i * item_size, item_key);
+                if (memcmp (item_key, key, sizeof(key)) == 0)
                 {
-                    bagTrackingItem *tmp;
-                    tmp = realloc ((*items), sizeof(bagTrackingItem) * ((*rtn_len) + 1));
-                    if (tmp == NULL)
-                    {
-                        return BAG_MEMORY_ALLOCATION_FAILED;
-                    }
-                    (*items) = tmp; /*! make sure (*items) is set to the newly alloc'd mem */
+                    if (nmatch != i)
+                        memcpy (buf + (size_t) nmatch * item_size, buf + (size_t) i * item_size, item_size);
+                    nmatch++;
                 }
-
-                /*! copy into next location */
-                memcpy (&((*items)[(*rtn_len)]), &readbuf[i], sizeof(bagTrackingItem));
- 
-                (*rtn_len)++;
             }
         }
-        offset[0] += TRACKING_LIST_BLOCK_SIZE;
+        if (nmatch > 0)
+            err = sink (ctx, buf, nmatch);
     }
 
-    return BAG_SUCCESS;
+    if (memspace_id >= 0)
+        H5Sclose (memspace_id);
+    H5Sclose (filespace_id);
+    free (buf);
+
+    return err;
 }
 
-static bagError bagReadVarResTrackingList(bagHandle bagHandle, u16 mode, u32 inp1, u32 inp2, u32 inp3, u32 inp4, bagVarResTrackingItem **items, u32 *rtn_len)
+/*! \brief bagReadTrackingQuery reads the matches of a query into an array allocated here */
+static bagError bagReadTrackingQuery (bagHandle bagHandle, Bool varres, u16 mode, u32 inp1, u32 inp2, u32 inp3, u32 inp4, void **items, u32 *rtn_len)
 {
-    herr_t      status;
-    u32         list_length, mem_space = 0;
-    u32         row = inp1, col = inp2;
-    u32         subrow = inp3, subcol = inp4;
-    u16         code = inp1, series = inp1;
-    
-    bagError    errCode;
-    
-    /* hyperslab selection parameters */
-    hsize_t     count[1];
-    hssize_t    offset[1];
+    bagTrackingQuery  query;
+    bagTrackingGrow   grow;
+    bagError          err;
 
-    /*! tracking item buffers and allocation structs */
-    bagVarResTrackingItem readbuf[VARRES_TRACKING_LIST_BLOCK_SIZE];
-    
-    /* Basic checks: we have a handle, and the output doesn't already point to something */
-    if (bagHandle == NULL) return BAG_INVALID_BAG_HANDLE;
-    if (*items != NULL) return BAG_INVALID_FUNCTION_ARGUMENT;
+    if (bagHandle == NULL)
+        return BAG_INVALID_BAG_HANDLE;
 
-    if ((errCode = bagGetOptDatasetInfo(&bagHandle, VarRes_Tracking_List)) != BAG_SUCCESS) return errCode;
-    
-    /* Extract the tracking list length so that we know how many points to read */
-    if ((errCode = bagVarResTrackingListLength(bagHandle, &list_length)) != BAG_SUCCESS) return errCode;
-    
-    *rtn_len  = 0;
-    count[0]  = VARRES_TRACKING_LIST_BLOCK_SIZE;
-    offset[0] = 0;
-    
-    /*
-     * Standard read-block startup: check for having enough memory to read in a
-     * chunk of the tracking list.  We read in quantums for efficiency, and set
-     * up the handle if it doesn't exist, or isn't big enough.
-     */
-    
-    /* If the memory is already up, find out how much we have */
-    if (bagHandle->opt_memspace_id[VarRes_Tracking_List] >= 0)
-        mem_space = (u32)H5Sget_select_npoints (bagHandle->opt_memspace_id[VarRes_Tracking_List]);
-    
-    /* If no memory, or not the right size, reset */
-    if (bagHandle->opt_memspace_id[VarRes_Tracking_List] < 0 || mem_space != count[0]) {
-        if (bagHandle->opt_memspace_id[VarRes_Tracking_List] >= 0) {
-            status = H5Sclose (bagHandle->opt_memspace_id[VarRes_Tracking_List]);
-            check_hdf_status();
-        }
-        
-        /* define the memspace */
-        if ((bagHandle->opt_memspace_id[VarRes_Tracking_List] = H5Screate_simple (1, count, NULL)) < 0)
-            return BAG_HDF_CREATE_DATASPACE_FAILURE;
-    }
-    
-    /*
-     * Read chunks of data, quantum VARRES_TRACKING_LIST_BLOCK_SIZE, until done
-     *
-     */
-    while (offset[0] < list_length) {
-        u32 i;
-        
-        /*
-         * Shrink the memspace if we have less than a chunk left to read from
-         * the tracking list.
-         *
-         */
-        if (list_length - offset[0] < VARRES_TRACKING_LIST_BLOCK_SIZE) {
-            status = H5Sclose (bagHandle->opt_memspace_id[VarRes_Tracking_List]);
-            check_hdf_status();
-            count[0] = (list_length % VARRES_TRACKING_LIST_BLOCK_SIZE);
-            
-            /* define the hyperslab parameters */
-            if ((bagHandle->opt_memspace_id[VarRes_Tracking_List] = H5Screate_simple (1, count, NULL)) < 0)
-                return BAG_HDF_CREATE_DATASPACE_FAILURE;
-        }
-        
-        status = H5Sselect_hyperslab (bagHandle->opt_filespace_id[VarRes_Tracking_List], H5S_SELECT_SET, (hsize_t *)offset, NULL, count, NULL);
-        check_hdf_status();
-        
-        status = H5Dread (bagHandle->opt_dataset_id[VarRes_Tracking_List], bagHandle->opt_datatype_id[VarRes_Tracking_List],
-                          bagHandle->opt_memspace_id[VarRes_Tracking_List], bagHandle->opt_filespace_id[VarRes_Tracking_List],
-                          H5P_DEFAULT, readbuf);
-        check_hdf_status();
-        
-        /*
-         * Run through all of the chunk just read, picking out the components that
-         * match the specification that we got from the user.  Note that the interpretation
-         * of the input variables depends on the mode passed from the user, with the
-         * mapping happening when the variables are assigned at the top of the function.
-         *
-         */
-        for (i = 0; i < count[0]; i++) {
-            if ((mode == READ_TRACK_SERIES && readbuf[i].list_series == series) ||
-                (mode == READ_TRACK_CODE && readbuf[i].track_code == code) ||
-                (mode == READ_TRACK_RC   && readbuf[i].col == col && readbuf[i].row == row) ||
-                (mode == READ_TRACK_SUBRC && readbuf[i].col == col && readbuf[i].row == row && readbuf[i].sub_row == subrow && readbuf[i].sub_col == subcol)) {
-                
-                /* Increment the size of the buffer by one item */
-                if (NULL == *items) {
-                    *items = malloc(sizeof(bagVarResTrackingItem));
-                    if (NULL == *items) {
-                        return BAG_MEMORY_ALLOCATION_FAILED;
-                    }
-                } else {
-                    bagVarResTrackingItem *tmp;
-                    tmp = realloc(*items, sizeof(bagVarResTrackingItem)*(*rtn_len + 1));
-                    if (tmp == NULL) {
-                        return BAG_MEMORY_ALLOCATION_FAILED;
-                    }
-                    *items = tmp;
-                }
-                
-                /* Update output buffer and count new item available */
-                memcpy (*items + *rtn_len, readbuf + i, sizeof(bagVarResTrackingItem));
-                ++*rtn_len;
-            }
-        }
-        offset[0] += TRACKING_LIST_BLOCK_SIZE;
+    /*! beware - \a *items must be \a NULL first~ */
+    if ((*items) != NULL)
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+
+    memset (&query, 0, sizeof(query));
+    query.by          = (u8) mode;
+    query.row         = inp1;
+    query.col         = inp2;
+    query.sub_row     = inp3;
+    query.sub_col     = inp4;
+    query.track_code  = (u8) inp1;
+    query.list_series = (u16) inp1;
+
+    *rtn_len       = 0;
+    grow.items     = (u8 **) items;
+    grow.length    = rtn_len;
+    grow.capacity  = 0;
+    grow.item_size = varres ? sizeof(bagVarResTrackingItem) : sizeof(bagTrackingItem);
+
+    bagLockHDF ();
+    err = bagQueryTrackingList (bagHandle, varres, &query, bagTrackingGrowSink, &grow);
+    bagUnlockHDF ();
+
+    if (err != BAG_SUCCESS)
+    {
+        free (*items);
+        *items   = NULL;
+        *rtn_len = 0;
     }
-    return BAG_SUCCESS;
+    return err;
+}
+
+bagError bagReadTrackingList(bagHandle bagHandle, u16 mode, u32 inp1, u32 inp2, bagTrackingItem **items, u32 *rtn_len)
+{
+    return bagReadTrackingQuery (bagHandle, False, mode, inp1, inp2, 0, 0, (void **) items, rtn_len);
+}
+
+static bagError bagReadVarResTrackingList(bagHandle bagHandle, u16 mode, u32 inp1, u32 inp2, u32 inp3, u32 inp4, bagVarResTrackingItem **items, u32 *rtn_len)
+{
+    return bagReadTrackingQuery (bagHandle, True, mode, inp1, inp2, inp3, inp4, (void **) items, rtn_len);
 }
 
 /***************************************************************************************/
-/*! \brief :     bagWriteTrackingListItem
+/*! \brief :     bagReadTrackingListInto
  *
- * Purpose:     Write a single \a bagTrackingItem into the tracking_list dataset.
+ * Purpose:     Read the tracking list items matching a query into the caller's arena.
  *
- * \param       bagHandle    Handle for the \a Bag file
- * \param      *item         pointer to tracking list item
- * \return      bagError     Will be set if there is an error accessing the 
- *                           bagHandle, or if item is \a NULL
+ * Comment:     Nothing is allocated.  When there are more matches than \a capacity,
+ *              the first \a capacity of them are stored and \a *length still gives
+ *              the number of matches, so the caller can size the arena and retry.
+ *
+ * \param      bagHandle    Handle for the Bag file
+ * \param     *query        The items to read, \a query->by being one of \a BAG_TRACK_QUERY
+ * \param     *arena        Caller's array of \a capacity items
+ * \param      capacity     Number of items \a arena holds
+ * \param     *length       Set to the number of matching items
+ *
+ * \return   \li On success, \a bagError is set to \a BAG_SUCCESS
+ *           \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS
  *
  ****************************************************************************************/
-bagError bagWriteTrackingListItem(bagHandle bagHandle, bagTrackingItem *item)
+bagError bagReadTrackingListInto (bagHandle bagHandle, const bagTrackingQuery *query, bagTrackingItem *arena, u32 capacity, u32 *length)
+{
+    bagTrackingArena  a;
+    bagError          err;
+
+    if (query == NULL || length == NULL || (arena == NULL && capacity > 0))
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+
+    *length     = 0;
+    a.arena     = (u8 *) arena;
+    a.capacity  = capacity;
+    a.length    = length;
+    a.item_size = sizeof(bagTrackingItem);
+
+    bagLockHDF ();
+    err = bagQueryTrackingList (bagHandle, False, query, bagTrackingArenaSink, &a);
+    bagUnlockHDF ();
+
+    return err;
+}
+
+bagError bagReadVarResTrackingListInto (bagHandle bagHandle, const bagTrackingQuery *query, bagVarResTrackingItem *arena, u32 capacity, u32 *length)
+{
+    bagTrackingArena  a;
+    bagError          err;
+
+    if (query == NULL || length == NULL || (arena == NULL && capacity > 0))
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+
+    *length     = 0;
+    a.arena     = (u8 *) arena;
+    a.capacity  = capacity;
+    a.length    = length;
+    a.item_size = sizeof(bagVarResTrackingItem);
+
+    bagLockHDF ();
+    err = bagQueryTrackingList (bagHandle, True, query, bagTrackingArenaSink, &a);
+    bagUnlockHDF ();
+
+    return err;
+}
+
+/***************************************************************************************/
+/*! \brief :     bagScanTrackingList
+ *
+ * Purpose:     Hand the tracking list items matching a query to a callback, a block
+ *              at a time, without gathering them.
+ *
+ * Comment:     The items passed to \a func are valid only during the call.  Any
+ *              return but \a BAG_SUCCESS from \a func ends the scan and is returned.
+ *              The HDF lock is held during the scan; \a func may call the library.
+ *
+ * \param      bagHandle    Handle for the Bag file
+ * \param     *query        The items to read, \a query->by being one of \a BAG_TRACK_QUERY
+ * \param      func         Called with each block of matches, in list order
+ * \param     *user         Passed to \a func
+ *
+ * \return   \li On success, \a bagError is set to \a BAG_SUCCESS
+ *           \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS,
+ *               or to the code returned by \a func
+ *
+ ****************************************************************************************/
+bagError bagScanTrackingList (bagHandle bagHandle, const bagTrackingQuery *query, bagTrackingItemFunc func, void *user)
+{
+    bagTrackingCall  c;
+    bagError         err;
+
+    if (query == NULL || func == NULL)
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+
+    c.func        = func;
+    c.varres_func = NULL;
+    c.user        = user;
+
+    bagLockHDF ();
+    err = bagQueryTrackingList (bagHandle, False, query, bagTrackingCallSink, &c);
+    bagUnlockHDF ();
+
+    return err;
+}
+
+bagError bagScanVarResTrackingList (bagHandle bagHandle, const bagTrackingQuery *query, bagVarResTrackingItemFunc func, void *user)
+{
+    bagTrackingCall  c;
+    bagError         err;
+
+    if (query == NULL || func == NULL)
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+
+    c.func        = NULL;
+    c.varres_func = func;
+    c.user        = user;
+
+    bagLockHDF ();
+    err = bagQueryTrackingList (bagHandle, True, query, bagTrackingCallSink, &c);
+    bagUnlockHDF ();
+
+    return err;
+}
+
+/***************************************************************************************/
+/*! \brief :     bagAppendTrackingItems
+ *
+ * Purpose:     Append \a n items to a tracking list with one extend of the dataset,
+ *              one write, and one update of its length attribute.  The HDF lock
+ *              must be held.
+ *
+ ****************************************************************************************/
+static bagError bagAppendTrackingItems (bagHandle bagHandle, Bool varres, const void *items, u32 n)
 {
+    hid_t       dataset_id, datatype_id, memspace_id;
+    hid_t      *filespace_id;
     herr_t      status;
-    u32         list_len, nct=0;
+    bagError    errCode;
+    u32         list_len;
+    u8         *length_name;
 
     /* hyperslab selection parameters */
-    hsize_t	  count[1];
-    hssize_t	  offset[1];
-    hsize_t	  extend[1];
-    
+    hsize_t     count[1];
+    hsize_t     offset[1];
+    hsize_t     extend[1];
+
     if (bagHandle == NULL)
         return BAG_INVALID_BAG_HANDLE;
+    if (items == NULL && n > 0)
+        return BAG_HDF_CANNOT_WRITE_NULL_DATA;
 
-    if ((status = bagReadAttribute (bagHandle, bagHandle->trk_dataset_id, (u8 *)TRACKING_LIST_LENGTH_NAME, &list_len)) != BAG_SUCCESS)
+    if (varres)
     {
-        return (status);
+        if ((errCode = bagGetOptDatasetInfo (&bagHandle, VarRes_Tracking_List)) != BAG_SUCCESS)
+            return errCode;
+        dataset_id   = bagHandle->opt_dataset_id[VarRes_Tracking_List];
+        datatype_id  = bagHandle->opt_datatype_id[VarRes_Tracking_List];
+        filespace_id = &bagHandle->opt_filespace_id[VarRes_Tracking_List];
+        length_name  = (u8 *)VARRES_TRACKING_LIST_LENGTH_NAME;
+    }
+    else
+    {
+        dataset_id   = bagHandle->trk_dataset_id;
+        datatype_id  = bagHandle->trk_datatype_id;
+        filespace_id = &bagHandle->trk_filespace_id;
+        length_name  = (u8 *)TRACKING_LIST_LENGTH_NAME;
     }
 
-    count[0]  = 1;          /*! adding 1 item */
-    offset[0] = list_len;   /*! add it to end of list */
-    extend[0] = ++list_len; /*! increase extents by 1 */
+    if (n == 0)
+        return BAG_SUCCESS;
+
+    if ((errCode = bagReadAttribute (bagHandle, dataset_id, length_name, &list_len)) != BAG_SUCCESS)
+        return errCode;
+    if (list_len > 0xFFFFFFFFu - n)
+        return BAG_HDF_DATASET_EXTEND_FAILURE;
+
+    count[0]  = n;              /*! adding n items */
+    offset[0] = list_len;       /*! add them to end of list */
+    extend[0] = list_len + n;   /*! increase extents once for all of them */
 
     /*! let the tracking_list grow */
-    status = H5Dextend (bagHandle->trk_dataset_id, extend);
-    check_hdf_status();
+    if (H5Dextend (dataset_id, extend) < 0)
+        return BAG_HDF_DATASET_EXTEND_FAILURE;
 
     /*! must reopen the filespace after the extend */
-    if (bagHandle->trk_filespace_id >= 0)
+    if (*filespace_id >= 0)
     {
-        status = H5Sclose (bagHandle->trk_filespace_id);
+        status = H5Sclose (*filespace_id);
         check_hdf_status();
-
-        bagHandle->trk_filespace_id = H5Dget_space(bagHandle->trk_dataset_id);
-        if (bagHandle->trk_filespace_id < 0)
-            return BAG_HDF_DATASPACE_CORRUPTED;
     }
-    
-    if (bagHandle->trk_memspace_id >= 0)
-        nct = (u32)H5Sget_select_npoints (bagHandle->trk_memspace_id);
-     
-    if (bagHandle->trk_memspace_id < 0 || nct != count[0])
-    {
-        if (bagHandle->trk_memspace_id >= 0)
-        {
-            status = H5Sclose (bagHandle->trk_memspace_id);
-            check_hdf_status();
-        }
-         
-        /*! define the memspace */
-        if ((bagHandle->trk_memspace_id = H5Screate_simple (1, count, NULL)) < 0)
-            return BAG_HDF_CREATE_DATASPACE_FAILURE;
-    }
-
-    /*! define the hyperslab parameters */
-    status = H5Sselect_hyperslab (bagHandle->trk_filespace_id, H5S_SELECT_SET, (hsize_t *)offset, NULL, count, NULL);
-    check_hdf_status();
-  
-    status = H5Dwrite (bagHandle->trk_dataset_id, bagHandle->trk_datatype_id,
-                       bagHandle->trk_memspace_id, bagHandle->trk_filespace_id, 
-                       H5P_DEFAULT, item);
-    check_hdf_status();
+    if ((*filespace_id = H5Dget_space (dataset_id)) < 0)
+        return BAG_HDF_DATASPACE_CORRUPTED;
+
+    if ((memspace_id = H5Screate_simple (1, count, NULL)) < 0)
+        return BAG_HDF_CREATE_DATASPACE_FAILURE;
+
+    if (H5Sselect_hyperslab (*filespace_id, H5S_SELECT_SET, offset, NULL, count, NULL) < 0)
+        errCode = BAG_HDF_INTERNAL_ERROR;
+    else if (H5Dwrite (dataset_id, datatype_id, memspace_id, *filespace_id, H5P_DEFAULT, items) < 0)
+        errCode = BAG_HDF_WRITE_FAILURE;
+    H5Sclose (memspace_id);
+    if (errCode != BAG_SUCCESS)
+        return errCode;
 
     /*! definitely should update the list length attribute of the dataset */
-    if ((status = bagWriteAttribute (bagHandle, bagHandle->trk_dataset_id, (u8 *)TRACKING_LIST_LENGTH_NAME, &list_len)) != BAG_SUCCESS)
-    {        
-        return (status);
-    }
+    list_len += n;
+    return bagWriteAttribute (bagHandle, dataset_id, length_name, &list_len);
+}
 
-    return BAG_SUCCESS;
+/***************************************************************************************/
+/*! \brief :     bagWriteTrackingListItems
+ *
+ * Purpose:     Append \a n \a bagTrackingItems to the tracking_list dataset at once.
+ *
+ * \param       bagHandle    Handle for the \a Bag file
+ * \param      *items        array of \a n tracking list items
+ * \param       n            number of items
+ * \return      bagError     Will be set if there is an error accessing the 
+ *                           bagHandle, or if items is \a NULL
+ *
+ ****************************************************************************************/
+bagError bagWriteTrackingListItems(bagHandle bagHandle, const bagTrackingItem *items, u32 n)
+{
+    bagError err;
+
+    bagLockHDF ();
+    err = bagAppendTrackingItems (bagHandle, False, items, n);
+    bagUnlockHDF ();
+
+    return err;
+}
+
+bagError bagWriteVarResTrackingListItems(bagHandle bagHandle, const bagVarResTrackingItem *items, u32 n)
+{
+    bagError err;
+
+    bagLockHDF ();
+    err = bagAppendTrackingItems (bagHandle, True, items, n);
+    bagUnlockHDF ();
+
+    return err;
+}
+
+/***************************************************************************************/
+/*! \brief :     bagWriteTrackingListItem
+ *
+ * Purpose:     Write a single \a bagTrackingItem into the tracking_list dataset.
+ *              Many items are better written with \a bagWriteTrackingListItems,
+ *              or a \a bagTrackingAppender.
+ *
+ * \param       bagHandle    Handle for the \a Bag file
+ * \param      *item         pointer to tracking list item
+ * \return      bagError     Will be set if there is an error accessing the 
+ *                           bagHandle, or if item is \a NULL
+ *
+ ****************************************************************************************/
+bagError bagWriteTrackingListItem(bagHandle bagHandle, bagTrackingItem *item)
+{
+    return bagWriteTrackingListItems (bagHandle, item, 1);
 }
 
 bagError bagWriteVarResTrackingListItem(bagHandle bagHandle, bagVarResTrackingItem *item)
 {
-    herr_t      status;
-    u32         list_length, mem_space = 0;
-    
-    /* hyperslab selection parameters */
-    hsize_t     count[1];
-    hssize_t    offset[1];
-    hsize_t     extend[1];
-    
-    bagError    errCode;
-    
-    if (bagHandle == NULL) return BAG_INVALID_BAG_HANDLE;
-    if ((errCode = bagGetOptDatasetInfo(&bagHandle, VarRes_Tracking_List)) != BAG_SUCCESS) return errCode;
-    if ((errCode = bagVarResTrackingListLength(bagHandle, &list_length)) != BAG_SUCCESS) return errCode;
-    
-    count[0]  = 1;              /* Adding 1 item */
-    offset[0] = list_length;    /* Add it to end of list */
-    extend[0] = ++list_length;  /* Increase extents by 1 */
-    
-    /* Let the tracking_list grow */
-    status = H5Dextend (bagHandle->opt_dataset_id[VarRes_Tracking_List], extend);
-    check_hdf_status();
-    
-    /* Reopen the filespace after the extend */
-    if (bagHandle->opt_filespace_id[VarRes_Tracking_List] >= 0) {
-        status = H5Sclose (bagHandle->opt_filespace_id[VarRes_Tracking_List]);
-        check_hdf_status();
-        
-        bagHandle->opt_filespace_id[VarRes_Tracking_List] = H5Dget_space(bagHandle->opt_dataset_id[VarRes_Tracking_List]);
-        if (bagHandle->opt_filespace_id[VarRes_Tracking_List] < 0)
-            return BAG_HDF_DATASPACE_CORRUPTED;
-    }
-    
-    /*
-     * Standard read-block startup: check for having enough memory to read in a
-     * chunk of the tracking list.  We read in quantums for efficiency, and set
-     * up the handle if it doesn't exist, or isn't big enough.
-     */
-    
-    /* If the memory is already up, find out how much we have */
-    if (bagHandle->opt_memspace_id[VarRes_Tracking_List] >= 0)
-        mem_space = (u32)H5Sget_select_npoints (bagHandle->opt_memspace_id[VarRes_Tracking_List]);
-    
-    if (bagHandle->opt_memspace_id[VarRes_Tracking_List] < 0 || mem_space != count[0]) {
-        if (bagHandle->opt_memspace_id[VarRes_Tracking_List] >= 0) {
-            status = H5Sclose (bagHandle->opt_memspace_id[VarRes_Tracking_List]);
-            check_hdf_status();
-        }
-        
-        /* define the memspace */
-        if ((bagHandle->opt_memspace_id[VarRes_Tracking_List] = H5Screate_simple (1, count, NULL)) < 0)
-            return BAG_HDF_CREATE_DATASPACE_FAILURE;
-    }
-    
-    /*! define the hyperslab parameters */
-    status = H5Sselect_hyperslab (bagHandle->opt_filespace_id[VarRes_Tracking_List], H5S_SELECT_SET, (hsize_t *)offset, NULL, count, NULL);
-    check_hdf_status();
-    
-    status = H5Dwrite (bagHandle->opt_dataset_id[VarRes_Tracking_List], bagHandle->opt_datatype_id[VarRes_Tracking_List],
-                       bagHandle->opt_memspace_id[VarRes_Tracking_List], bagHandle->opt_filespace_id[VarRes_Tracking_List],
-                       H5P_DEFAULT, item);
-    check_hdf_status();
-    
-    /*! definitely should update the list length attribute of the dataset */
-    if ((errCode = bagWriteAttribute (bagHandle, bagHandle->opt_dataset_id[VarRes_Tracking_List],
-                                      (u8 *)VARRES_TRACKING_LIST_LENGTH_NAME, &list_length)) != BAG_SUCCESS) {
-        return errCode;
+    return bagWriteVarResTrackingListItems (bagHandle, item, 1);
+}
+
+/***************************************************************************************/
+/*! \brief :     bagTrackingAppenderOpen
+ *
+ * Purpose:     Start a buffered append to a tracking list.  Items added to the
+ *              appender are gathered and written by \a bagWriteTrackingListItems
+ *              a batch at a time, so the dataset is extended and its length
+ *              attribute rewritten once per batch rather than once per item.
+ *
+ * Comment:     Items still buffered are not in the list, nor seen by its queries,
+ *              until \a bagTrackingAppenderFlush or \a bagTrackingAppenderClose.
+ *
+ * \param       bagHandle    Handle for the \a Bag file, opened for write
+ * \param       batch        items per batch, 0 for TRACKING_LIST_APPEND_ITEMS
+ * \param      *appender     set to the new appender, to be released by
+ *                           \a bagTrackingAppenderClose
+ *
+ * \return   \li On success, \a bagError is set to \a BAG_SUCCESS
+ *           \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS
+ *
+ ****************************************************************************************/
+static bagError bagOpenTrackingAppender (bagHandle bagHandle, Bool varres, u32 batch, bagTrackingAppender *appender)
+{
+    bagTrackingAppender app;
+
+    if (appender == NULL)
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+    *appender = NULL;
+    if (bagHandle == NULL)
+        return BAG_INVALID_BAG_HANDLE;
+
+    if ((app = (bagTrackingAppender) calloc (1, sizeof (struct _t_bagTrackingAppender))) == NULL)
+        return BAG_MEMORY_ALLOCATION_FAILED;
+
+    app->hnd       = bagHandle;
+    app->varres    = varres;
+    app->item_size = varres ? sizeof (bagVarResTrackingItem) : sizeof (bagTrackingItem);
+    app->capacity  = (batch > 0) ? batch : TRACKING_LIST_APPEND_ITEMS;
+    if ((app->items = malloc ((size_t) app->capacity * app->item_size)) == NULL)
+    {
+        free (app);
+        return BAG_MEMORY_ALLOCATION_FAILED;
     }
-    
+
+    *appender = app;
+    return BAG_SUCCESS;
+}
+
+bagError bagTrackingAppenderOpen (bagHandle bagHandle, u32 batch, bagTrackingAppender *appender)
+{
+    return bagOpenTrackingAppender (bagHandle, False, batch, appender);
+}
+
+bagError bagVarResTrackingAppenderOpen (bagHandle bagHandle, u32 batch, bagTrackingAppender *appender)
+{
+    return bagOpenTrackingAppender (bagHandle, True, batch, appender);
+}
+
+/*! \brief bagAddTrackingAppender buffers one item, writing the batch when it is full */
+static bagError bagAddTrackingAppender (bagTrackingAppender appender, Bool varres, const void *item)
+{
+    bagError err;
+
+    if (appender == NULL || item == NULL || appender->varres != varres)
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+
+    /*! a batch left full by a failed write is written before the item is taken */
+    if (appender->count == appender->capacity &&
+        (err = bagTrackingAppenderFlush (appender)) != BAG_SUCCESS)
+        return err;
+
+    memcpy (appender->items + (size_t) appender->count * appender->item_size, item, appender->item_size);
+    if (++appender->count == appender->capacity)
+        return bagTrackingAppenderFlush (appender);
+
     return BAG_SUCCESS;
 }
 
+/***************************************************************************************/
+/*! \brief :     bagTrackingAppenderAdd
+ *
+ * Purpose:     Add one item to a buffered append; a full batch is written.
+ *
+ * \param       appender     from \a bagTrackingAppenderOpen
+ * \param      *item         the item, copied
+ *
+ * \return   \li On success, \a bagError is set to \a BAG_SUCCESS
+ *           \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS;
+ *               the batch that failed to be written stays buffered.  The next
+ *               call writes it first, and does not take \a item if that fails.
+ *
+ ****************************************************************************************/
+bagError bagTrackingAppenderAdd (bagTrackingAppender appender, const bagTrackingItem *item)
+{
+    return bagAddTrackingAppender (appender, False, item);
+}
+
+bagError bagVarResTrackingAppenderAdd (bagTrackingAppender appender, const bagVarResTrackingItem *item)
+{
+    return bagAddTrackingAppender (appender, True, item);
+}
+
+/***************************************************************************************/
+/*! \brief :     bagTrackingAppenderFlush
+ *
+ * Purpose:     Write the items buffered in an appender, extending the list once
+ *              and updating its length attribute.
+ *
+ * \param       appender     from \a bagTrackingAppenderOpen
+ *
+ * \return   \li On success, \a bagError is set to \a BAG_SUCCESS
+ *           \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS
+ *
+ ****************************************************************************************/
+bagError bagTrackingAppenderFlush (bagTrackingAppender appender)
+{
+    bagError err;
+
+    if (appender == NULL)
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+
+    bagLockHDF ();
+    err = bagAppendTrackingItems (appender->hnd, appender->varres, appender->items, appender->count);
+    bagUnlockHDF ();
+
+    if (err == BAG_SUCCESS)
+        appender->count = 0;
+    return err;
+}
+
+/***************************************************************************************/
+/*! \brief :     bagTrackingAppenderClose
+ *
+ * Purpose:     Flush and release an appender.  It is released even if the final
+ *              flush fails, in which case its buffered items are lost.
+ *
+ * \param       appender     from \a bagTrackingAppenderOpen, may be \a NULL
+ *
+ * \return   \li On success, \a bagError is set to \a BAG_SUCCESS
+ *           \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS
+ *
+ ****************************************************************************************/
+bagError bagTrackingAppenderClose (bagTrackingAppender appender)
+{
+    bagError err;
+
+    if (appender == NULL)
+        return BAG_SUCCESS;
+
+    err = bagTrackingAppenderFlush (appender);
+
+    free (appender->items);
+    free (appender);
+
+    return err;
+}
+
 /***************************************************************************************/
 /*! \brief      bagTrackingListLength
  *
@@ -676,10 +1045,10 @@ bagError bagVarResTrackingListLength(bagHandle bagHandle, u32 *len)
 
 /***************************************************************************************/
 /*! \brief :     bagSortTrackingList
- * Purpose:     Reads the entire tracking list into memory. This is the total 
- *              length for the entire list, comprising all series of edits
- *              for this bag's surfaces. Sorts either according to row/col 
- *              combination (for spatial locality) or list_series index.
+ * Purpose:     Sorts the tracking list in place, either according to row/col
+ *              combination (for spatial locality), list_series index or code.
+ *              The sort is stable and works in bounded memory, see
+ *              bag_tracking_sort.c.
  *
  * Comment:     Edits to BAG, resulting in tracking list items,
  *              could be appended somewhat in a chaotic fashion.  
@@ -696,95 +1065,7 @@ bagError bagVarResTrackingListLength(bagHandle bagHandle, u32 *len)
  ****************************************************************************************/
 bagError bagSortTrackingList(bagHandle bagHandle, u16 mode)
 {
-    herr_t      status;
-    u32         list_len, nct=0;
-
-    /*! hyperslab selection parameters */
-    hsize_t	  count[1];
-    hssize_t	  offset[1];
-
-    /*! tracking item buffers and allocation structs */
-    bagTrackingItem *readbuf;
-    
-    if (bagHandle == NULL)
-        return BAG_INVALID_BAG_HANDLE;
-
-    if ((status = bagReadAttribute (bagHandle, bagHandle->trk_dataset_id, (u8 *)TRACKING_LIST_LENGTH_NAME, &list_len)) != BAG_SUCCESS)
-    {
-        return (status);
-    }
-
-    /*!
-     * We're going to try and just read the entire list into memory here.
-     * Tested with over 40000 items and performance was... inspirational.
-     *   Right now I don't see a need to break this down any further.
-     * Webb McDonald -- Thu Jan 26 10:44:45 2006
-     */
-    readbuf = calloc (list_len, sizeof(bagTrackingItem));
-    if (readbuf == NULL)
-    {
-        return BAG_MEMORY_ALLOCATION_FAILED;
-    }
-
-    count[0]  = list_len;  /*! chunk size */
-    offset[0] = 0;         /*! start at head of list */
-
-
-    if (bagHandle->trk_memspace_id >= 0)
-        nct = (u32)H5Sget_select_npoints (bagHandle->trk_memspace_id);
-     
-    if (bagHandle->trk_memspace_id < 0 || nct != count[0])
-    {
-        if (bagHandle->trk_memspace_id >= 0)
-        {
-            status = H5Sclose (bagHandle->trk_memspace_id);
-            check_hdf_status();
-        }
-         
-        /*! define the memspace */
-        if ((bagHandle->trk_memspace_id = H5Screate_simple (1, count, NULL)) < 0)
-            return BAG_HDF_CREATE_DATASPACE_FAILURE;
-    }
-
-    /*! define the hyperslab parameters */
-    status = H5Sselect_hyperslab (bagHandle->trk_filespace_id, H5S_SELECT_SET, (hsize_t *)offset, NULL, count, NULL);
-    check_hdf_status();
-    
-    fprintf(stdout, "Reading entire tracking list dataset into memory...\n");
-    fflush(stdout);
-    status = H5Dread (bagHandle->trk_dataset_id, bagHandle->trk_datatype_id,
-                      bagHandle->trk_memspace_id, bagHandle->trk_filespace_id, 
-                      H5P_DEFAULT, readbuf);
-    check_hdf_status();
-
-    fprintf(stdout, "Starting sort of %d items of the tracking list...\n", list_len);
-    fflush(stdout);
-    /*! \a READ_TRACK_MODE, mode indicates the type of sort */
-    switch (mode)
-    {
-    case READ_TRACK_SERIES:
-        qsort (readbuf, list_len, sizeof (bagTrackingItem), &bagCompareTrackIndices);
-        break;
-    case READ_TRACK_CODE:
-        qsort (readbuf, list_len, sizeof (bagTrackingItem), &bagCompareTrackCodes);
-        break;
-    case READ_TRACK_RC:
-    default:
-        qsort (readbuf, list_len, sizeof (bagTrackingItem), &bagCompareTrackNodes);
-        break;
-    }
-
-    fprintf(stdout, "Write entire tracking list dataset from memory back into the Bag...\n");
-    fflush(stdout);
-    status = H5Dwrite (bagHandle->trk_dataset_id, bagHandle->trk_datatype_id,
-                       bagHandle->trk_memspace_id, bagHandle->trk_filespace_id,
-                       H5P_DEFAULT, readbuf);
-    check_hdf_status();
-    
-    fprintf(stdout, "Sorting process completed\n");
-    fflush(stdout);
-
-    return BAG_SUCCESS;
+    return bagSortTrackingListEx (bagHandle, (u8) mode, 0, NULL, NULL);
 }
 
 /* see comments for common function above */
@@ -807,254 +1088,164 @@ bagError bagSortTrackingListByCode (bagHandle bagHandle)
  *
  * Function Name : bagCompareTrackIndices
  *
- * Description : This is the alpha sort function for qsort.
+ * Description : This is the list_series sort function for qsort.
  *
  * Inputs : void pointers a,b
  *
  * Returns :  a's index greater than b's index, rtn  1
- *            b's index greater than or equal to a's index, rtn 0
- *
- * Error Conditions : if a or b are uninitialized
+ *            a's index less than b's index, rtn -1
+ *            equal indices, rtn 0
  *
  ********************************************************************/
 s32 bagCompareTrackIndices (const void *a, const void *b)
 {
-    bagTrackingItem *sa = (bagTrackingItem *)(a);
-    bagTrackingItem *sb = (bagTrackingItem *)(b);
+    const bagTrackingItem *sa = (const bagTrackingItem *)(a);
+    const bagTrackingItem *sb = (const bagTrackingItem *)(b);
 
-    if (sa == NULL || sb == NULL)
-        return 0;
-    else
-        return (sa->list_series > sb->list_series);
+    return (sa->list_series > sb->list_series) - (sa->list_series < sb->list_series);
 }
 
 /********************************************************************
  *
  * Function Name : bagCompareTrackNodes
  *
- * Description : This is the alpha sort function for qsort.
+ * Description : This is the row, then col, sort function for qsort.
  *
  * Inputs : void pointers a,b
  *
- * Returns : a's index greater than b's index, rtn  1
- *           b's index greater than or equal to a's index, rtn 0
- *
- * Error Conditions : if a or b are uninitialized
+ * Returns : a's node after b's node, rtn  1
+ *           a's node before b's node, rtn -1
+ *           same node, rtn 0
  *
  ********************************************************************/
 s32 bagCompareTrackNodes (const void *a, const void *b)
 {
-    bagTrackingItem *sa = (bagTrackingItem *)(a);
-    bagTrackingItem *sb = (bagTrackingItem *)(b);
+    const bagTrackingItem *sa = (const bagTrackingItem *)(a);
+    const bagTrackingItem *sb = (const bagTrackingItem *)(b);
 
-    if (sa == NULL || sb == NULL)
-        return 0;
-    else
-        return (sa->row >= sb->row && sa->col >= sb->col);
+    if (sa->row != sb->row)
+        return (sa->row > sb->row) ? 1 : -1;
+    return (sa->col > sb->col) - (sa->col < sb->col);
 }
     
 /********************************************************************
  *
  * Function Name : bagCompareTrackCodes
  *
- * Description : This is the alpha sort function for qsort.
+ * Description : This is the track_code sort function for qsort.
  *
  * Inputs : void pointers a,b
  *
- * Returns : a's index greater than b's index, rtn  1
- *           b's index greater than or equal to a's index, rtn 0
- *
- * Error Conditions : if a or b are uninitialized
+ * Returns : a's code greater than b's code, rtn  1
+ *           a's code less than b's code, rtn -1
+ *           equal codes, rtn 0
  *
  ********************************************************************/
 s32 bagCompareTrackCodes (const void *a, const void *b)
 {
-    bagTrackingItem *sa = (bagTrackingItem *)(a);
-    bagTrackingItem *sb = (bagTrackingItem *)(b);
+    const bagTrackingItem *sa = (const bagTrackingItem *)(a);
+    const bagTrackingItem *sb = (const bagTrackingItem *)(b);
 
-    if (sa == NULL || sb == NULL)
-        return 0;
-    else
-        return (sa->track_code > sb->track_code);
+    return (sa->track_code > sb->track_code) - (sa->track_code < sb->track_code);
 }
 
 /********************************************************************
  *
  * Function Name : bagCompareVarResTrackIndices
  *
- * Description : This is the alpha sort function for qsort.
+ * Description : This is the list_series sort function for qsort.
  *
  * Inputs : void pointers a,b
  *
  * Returns :  a's index greater than b's index, rtn  1
- *            b's index greater than or equal to a's index, rtn 0
- *
- * Error Conditions : if a or b are uninitialized
+ *            a's index less than b's index, rtn -1
+ *            equal indices, rtn 0
  *
  ********************************************************************/
-static s32 bagCompareVarResTrackIndices (const void *a, const void *b)
+s32 bagCompareVarResTrackIndices (const void *a, const void *b)
 {
-    bagVarResTrackingItem *sa = (bagVarResTrackingItem *)(a);
-    bagVarResTrackingItem *sb = (bagVarResTrackingItem *)(b);
+    const bagVarResTrackingItem *sa = (const bagVarResTrackingItem *)(a);
+    const bagVarResTrackingItem *sb = (const bagVarResTrackingItem *)(b);
     
-    if (sa == NULL || sb == NULL)
-        return 0;
-    else
-        return (s32)sa->list_series - (s32)sb->list_series;
+    return (sa->list_series > sb->list_series) - (sa->list_series < sb->list_series);
 }
 
 /********************************************************************
  *
  * Function Name : bagCompareVarResTrackNodes
  *
- * Description : This is the alpha sort function for qsort.
+ * Description : This is the row, then col, sort function for qsort.
  *
  * Inputs : void pointers a,b
  *
- * Returns : a's index greater than b's index, rtn  1
- *           b's index greater than or equal to a's index, rtn 0
- *
- * Error Conditions : if a or b are uninitialized
+ * Returns : a's node after b's node, rtn  1
+ *           a's node before b's node, rtn -1
+ *           same node, rtn 0
  *
  ********************************************************************/
-static s32 bagCompareVarResTrackNodes (const void *a, const void *b)
+s32 bagCompareVarResTrackNodes (const void *a, const void *b)
 {
-    bagVarResTrackingItem *sa = (bagVarResTrackingItem *)(a);
-    bagVarResTrackingItem *sb = (bagVarResTrackingItem *)(b);
+    const bagVarResTrackingItem *sa = (const bagVarResTrackingItem *)(a);
+    const bagVarResTrackingItem *sb = (const bagVarResTrackingItem *)(b);
     
-    if (sa == NULL || sb == NULL)
-        return 0;
-    else
-        return (((long long)sa->row<<32) + (long long)sa->col) - (((long long)sb->row<<32) + (long long)sb->col);
+    if (sa->row != sb->row)
+        return (sa->row > sb->row) ? 1 : -1;
+    return (sa->col > sb->col) - (sa->col < sb->col);
 }
 
 /********************************************************************
  *
  * Function Name : bagCompareVarResTrackCodes
  *
- * Description : This is the alpha sort function for qsort.
+ * Description : This is the track_code sort function for qsort.
  *
  * Inputs : void pointers a,b
  *
- * Returns : a's index greater than b's index, rtn  1
- *           b's index greater than or equal to a's index, rtn 0
- *
- * Error Conditions : if a or b are uninitialized
+ * Returns : a's code greater than b's code, rtn  1
+ *           a's code less than b's code, rtn -1
+ *           equal codes, rtn 0
  *
  ********************************************************************/
-static s32 bagCompareVarResTrackCodes (const void *a, const void *b)
+s32 bagCompareVarResTrackCodes (const void *a, const void *b)
 {
-    bagVarResTrackingItem *sa = (bagVarResTrackingItem *)(a);
-    bagVarResTrackingItem *sb = (bagVarResTrackingItem *)(b);
+    const bagVarResTrackingItem *sa = (const bagVarResTrackingItem *)(a);
+    const bagVarResTrackingItem *sb = (const bagVarResTrackingItem *)(b);
     
-    if (sa == NULL || sb == NULL)
-        return 0;
-    else
-        return (s32)sa->track_code - (s32)sb->track_code;
+    return (sa->track_code > sb->track_code) - (sa->track_code < sb->track_code);
 }
 
-static s32 bagCompareVarResTrackSubNodes(const void *a, const void *b)
+/********************************************************************
+ *
+ * Function Name : bagCompareVarResTrackSubNodes
+ *
+ * Description : This is the refined grid sort function for qsort:
+ *               row, sub_row, then col, sub_col, so that the items
+ *               come in row order of the refined nodes.
+ *
+ * Inputs : void pointers a,b
+ *
+ * Returns : a's refined node after b's, rtn  1
+ *           a's refined node before b's, rtn -1
+ *           same refined node, rtn 0
+ *
+ ********************************************************************/
+s32 bagCompareVarResTrackSubNodes(const void *a, const void *b)
 {
-    bagVarResTrackingItem *sa = (bagVarResTrackingItem*)a;
-    bagVarResTrackingItem *sb = (bagVarResTrackingItem*)b;
+    const bagVarResTrackingItem *sa = (const bagVarResTrackingItem*)a;
+    const bagVarResTrackingItem *sb = (const bagVarResTrackingItem*)b;
     
-    if (sa == NULL || sb == NULL)
-        return 0;
-    else {
-        /* Assemble composite indices with the rows information in the upper 32-bit and the
-         * column in the lower 32-bit of a 64-bit integer.  The low-resolution row/col is the
-         * upper 20 bits of each section, and the sub row/col is the lower 12 bits.  This means
-         * that the sort will probably fail if there are more than 2^20 = 1048576 rows/cols in
-         * the low-resolution grid.  That typically (for CHRT and its ilk) mean a grid that's
-         * 33,554 km wide/high.  Unlikely.
-         */
-        long long index_a = ((long long)sa->row<<12 | (sa->sub_row & 0xFFF))<<32 | (((long long)sa->col<<12 | (sa->sub_col & 0xFFF)) & 0xFFFFFFFFLL);
-        long long index_b = ((long long)sb->row<<12 | (sb->sub_row & 0xFFF))<<32 | (((long long)sb->col<<12 | (sb->sub_col & 0xFFF)) & 0xFFFFFFFFLL);
-        return (s32)(index_a - index_b);
-    }
+    if (sa->row != sb->row)
+        return (sa->row > sb->row) ? 1 : -1;
+    if (sa->sub_row != sb->sub_row)
+        return (sa->sub_row > sb->sub_row) ? 1 : -1;
+    if (sa->col != sb->col)
+        return (sa->col > sb->col) ? 1 : -1;
+    return (sa->sub_col > sb->sub_col) - (sa->sub_col < sb->sub_col);
 }
 
 static bagError bagSortVarResTrackingList(bagHandle bagHandle, u16 mode)
 {
-    herr_t      status;
-    u32         list_length, mem_space = 0;
-    
-    /* hyperslab selection parameters */
-    hsize_t     count[1];
-    hssize_t    offset[1];
-    
-    /* tracking item buffers and allocation structs */
-    bagVarResTrackingItem *readbuf;
-    
-    bagError    errCode;
-    
-    if (bagHandle == NULL) return BAG_INVALID_BAG_HANDLE;
-    if ((errCode = bagGetOptDatasetInfo(&bagHandle, VarRes_Tracking_List)) != BAG_SUCCESS) return errCode;
-    if ((errCode = bagVarResTrackingListLength(bagHandle, &list_length)) != BAG_SUCCESS) return errCode;
-    
-    if ((readbuf = malloc(list_length*sizeof(bagVarResTrackingItem))) == NULL) {
-        return BAG_MEMORY_ALLOCATION_FAILED;
-    }
-    
-    count[0]  = list_length;
-    offset[0] = 0;
-    
-    if (bagHandle->opt_memspace_id[VarRes_Tracking_List] >= 0)
-        mem_space = (u32)H5Sget_select_npoints (bagHandle->opt_memspace_id[VarRes_Tracking_List]);
-    
-    if (bagHandle->opt_memspace_id[VarRes_Tracking_List] < 0 || mem_space != count[0]) {
-        if (bagHandle->opt_memspace_id[VarRes_Tracking_List] >= 0) {
-            status = H5Sclose (bagHandle->opt_memspace_id[VarRes_Tracking_List]);
-            check_hdf_status();
-        }
-        if ((bagHandle->opt_memspace_id[VarRes_Tracking_List] = H5Screate_simple (1, count, NULL)) < 0)
-            return BAG_HDF_CREATE_DATASPACE_FAILURE;
-    }
-    
-    /* define the hyperslab parameters */
-    status = H5Sselect_hyperslab (bagHandle->opt_filespace_id[VarRes_Tracking_List], H5S_SELECT_SET, (hsize_t *)offset, NULL, count, NULL);
-    check_hdf_status();
-    
-    fprintf(stdout, "Reading entire tracking list dataset into memory...\n");
-    fflush(stdout);
-    status = H5Dread (bagHandle->opt_dataset_id[VarRes_Tracking_List], bagHandle->opt_datatype_id[VarRes_Tracking_List],
-                      bagHandle->opt_memspace_id[VarRes_Tracking_List], bagHandle->opt_filespace_id[VarRes_Tracking_List],
-                      H5P_DEFAULT, readbuf);
-    check_hdf_status();
-    
-    fprintf(stdout, "Starting sort of %d items of the tracking list...\n", list_length);
-    fflush(stdout);
-    /* \a READ_TRACK_MODE, mode indicates the type of sort */
-    switch (mode) {
-        case READ_TRACK_SERIES:
-            qsort(readbuf, list_length, sizeof (bagVarResTrackingItem), &bagCompareVarResTrackIndices);
-            break;
-        case READ_TRACK_CODE:
-            qsort(readbuf, list_length, sizeof (bagVarResTrackingItem), &bagCompareVarResTrackCodes);
-            break;
-        case READ_TRACK_RC:
-            qsort(readbuf, list_length, sizeof (bagVarResTrackingItem), &bagCompareVarResTrackNodes);
-            break;
-        case READ_TRACK_SUBRC:
-            qsort(readbuf, list_length, sizeof(bagVarResTrackingItem), &bagCompareVarResTrackSubNodes);
-            break;
-        default:
-            fprintf(stderr, "error: unknown sort mode for variable-resolution tracking list (%d)\n", (u32)mode);
-            return BAG_INVALID_FUNCTION_ARGUMENT;
-            break;
-    }
-    
-    fprintf(stdout, "Write entire tracking list dataset from memory back into the Bag...\n");
-    fflush(stdout);
-    status = H5Dwrite (bagHandle->opt_dataset_id[VarRes_Tracking_List], bagHandle->opt_datatype_id[VarRes_Tracking_List],
-                       bagHandle->opt_memspace_id[VarRes_Tracking_List], bagHandle->opt_filespace_id[VarRes_Tracking_List],
-                       H5P_DEFAULT, readbuf);
-    check_hdf_status();
-    
-    fprintf(stdout, "Sorting process completed\n");
-    fflush(stdout);
-    
-    return BAG_SUCCESS;
+    return bagSortVarResTrackingListEx (bagHandle, (u8) mode, 0, NULL, NULL);
 }
 
 /* see comments for common function above */
@@ -0,0 +1,825 @@
+/*! \file bag_tracking_sort.c
+ * \brief This module contains the bounded memory sort of the tracking lists.
+ ********************************************************************
+ *
+ * Module Name : bag_tracking_sort.c
+ *
+ * Author/Date : ONSWG, October 2026
+ *
+ * Description :
+ *               A tracking list that fits the memory bound is read, sorted
+ *               and written back.  A larger list is sorted externally: it is
+ *               read a memory load at a time, each load sorted and spilled as
+ *               a run to a temporary HDF file, then the runs are merged through
+ *               a heap, a block of each at a time, back into the list.  When
+ *               there are too many runs for one merge to give each a block,
+ *               groups of them are first merged into longer runs, between two
+ *               temporary datasets.
+ *
+ *               The temporary file gets a new name, next to the BAG or else in
+ *               the temporary directory, and is created exclusively so that no
+ *               file is overwritten.  Before the last merge starts to overwrite
+ *               the list, its input is renamed "items" in the temporary file,
+ *               and the list is given a sort_recovery attribute naming that
+ *               file.  If the merge fails, both are kept and the sort returns
+ *               BAG_HDF_SORT_NEEDS_RECOVERY; the next sort of the list first
+ *               copies the items back from that file.
+ *
+ *               The runs are sorted by a parallel LSD radix sort on the bytes of
+ *               the packed key: row and col make 64 bits for the nodes; row,
+ *               sub_row, col and sub_col 128 bits for the refined nodes; the
+ *               series 16 and the code 8.  Each byte is a counting pass over
+ *               the items, split in blocks among the workers: the workers count
+ *               the digits of their blocks, the counts are laid out block after
+ *               block, then each worker moves its items to their places.  The
+ *               merge takes the earlier run first on ties, so the sort is
+ *               stable: the items of one key keep the order they were written in.
+ *
+ * Restrictions/Limitations :
+ *               The temporary file needs up to twice the size of the list,
+ *               and is removed when the sort ends, unless the list needs it
+ *               to be recovered.
+ *
+ * Change Descriptions :
+ * who  when      what
+ * ---  ----      ----
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ ********************************************************************/
+
+#include "bag_private.h"
+
+#define TRACK_SORT_MIN_BLOCK   1024   /*!< Fewest items read from a run at a time while merging */
+#define TRACK_SORT_TASK_ITEMS  65536  /*!< Fewest items of the block of one radix worker */
+#define TRACK_SORT_MAX_DIGITS  16     /*!< Bytes of the widest key, the refined node */
+#define TRACK_SORT_TEMP_TRIES  4      /*!< Names tried for the temporary file in each directory */
+#define TRACK_SORT_RECOVERY_NAME "sort_recovery"
+#define TRACK_SORT_ITEMS_NAME  "items"
+
+typedef s32 (*bagTrackCompare) (const void *a, const void *b);
+
+/*! \brief Where one byte of the key, a radix digit, is found in an item */
+typedef struct _t_bagSortDigit {
+    u32     offset;     /*!< Offset of the field holding it */
+    u32     size;       /*!< Size of the field, 1, 2 or 4 bytes */
+    u32     shift;      /*!< Bits below it in the field */
+} bagSortDigit;
+
+/*! \brief The state of one sort */
+typedef struct _t_bagTrackSort {
+    bagTrackCompare      cmp;
+    bagSortDigit         digits[TRACK_SORT_MAX_DIGITS];  /*!< Least significant first */
+    u32                  ndigits;
+    u32                  nworkers;
+    hid_t                type_id;     /*!< Memory datatype of the items */
+    size_t               item_size;
+    bagSortProgressFunc  progress;
+    void                *user;
+    u32                  total;       /*!< Items in the list */
+} bagTrackSort;
+
+/*! \brief One run being merged */
+typedef struct _t_bagSortRun {
+    hsize_t  next;      /*!< Position of the next item to be read from the source */
+    hsize_t  end;       /*!< Position past the last item of the run */
+    u8      *buf;       /*!< A block of the run */
+    u32      n;         /*!< Items in buf */
+    u32      i;         /*!< The current item of buf */
+} bagSortRun;
+
+/*! \brief bagSortIO reads or writes \a n items at \a offset of a 1-D dataset */
+bagError bagSortIO (hid_t dataset_id, hid_t type_id, hsize_t offset, u32 n, void *buf, Bool write)
+{
+    hid_t    filespace_id, memspace_id;
+    hsize_t  count[1], start[1];
+    herr_t   status = -1;
+
+    if (n == 0)
+        return BAG_SUCCESS;
+
+    count[0] = n;
+    start[0] = offset;
+    if ((filespace_id = H5Dget_space (dataset_id)) < 0)
+        return BAG_HDF_DATASPACE_CORRUPTED;
+    if ((memspace_id = H5Screate_simple (1, count, NULL)) < 0)
+    {
+        H5Sclose (filespace_id);
+        return BAG_HDF_CREATE_DATASPACE_FAILURE;
+    }
+
+    if (H5Sselect_hyperslab (filespace_id, H5S_SELECT_SET, start, NULL, count, NULL) >= 0)
+    {
+        if (write)
+            status = H5Dwrite (dataset_id, type_id, memspace_id, filespace_id, H5P_DEFAULT, buf);
+        else
+            status = H5Dread (dataset_id, type_id, memspace_id, filespace_id, H5P_DEFAULT, buf);
+    }
+    H5Sclose (memspace_id);
+    H5Sclose (filespace_id);
+
+    if (status < 0)
+        return write ? BAG_HDF_WRITE_FAILURE : BAG_HDF_READ_FAILURE;
+    return BAG_SUCCESS;
+}
+
+/*! \brief The state of one radix pass, shared by its workers */
+typedef struct _t_bagRadixPass {
+    const bagTrackSort  *s;
+    const bagSortDigit  *digit;
+    const u8            *src;
+    u8                  *dst;
+    u32                  n;
+    u32                  ntasks;
+    u32                 *counts;    /*!< 256 per task: the digit counts, then their places in dst */
+} bagRadixPass;
+
+/*! \brief bagRadixDigit reads one digit of the key of an item */
+static u32 bagRadixDigit (const bagSortDigit *digit, const u8 *item)
+{
+    u32 v;
+
+    switch (digit->size)
+    {
+    case 4:  v = *(const u32 *) (item + digit->offset); break;
+    case 2:  v = *(const u16 *) (item + digit->offset); break;
+    default: v = item[digit->offset];                   break;
+    }
+    return (v >> digit->shift) & 0xFF;
+}
+
+/*! \brief bagRadixCountTask counts the digits of the block of one task */
+static bagError bagRadixCountTask (void *ctx, u32 task, u32 worker)
+{
+    bagRadixPass *p = (bagRadixPass *) ctx;
+    size_t        sz = p->s->item_size;
+    u32          *counts = p->counts + task * 256;
+    u32           i, lo, hi;
+
+    (void) worker;
+    lo = (u32) ((HDF_size_t) p->n * task / p->ntasks);
+    hi = (u32) ((HDF_size_t) p->n * (task + 1) / p->ntasks);
+
+    memset (counts, 0, 256 * sizeof (u32));
+    for (i = lo; i < hi; i++)
+        counts[bagRadixDigit (p->digit, p->src + i * sz)]++;
+
+    return BAG_SUCCESS;
+}
+
+/*! \brief bagRadixMoveTask moves the items of the block of one task to their places */
+static bagError bagRadixMoveTask (void *ctx, u32 task, u32 worker)
+{
+    bagRadixPass *p = (bagRadixPass *) ctx;
+    size_t        sz = p->s->item_size;
+    u32          *places = p->counts + task * 256;
+    u32           i, lo, hi;
+
+    (void) worker;
+    lo = (u32) ((HDF_size_t) p->n * task / p->ntasks);
+    hi = (u32) ((HDF_size_t) p->n * (task + 1) / p->ntasks);
+
+    for (i = lo; i < hi; i++)
+        memcpy (p->dst + (size_t) (places[bagRadixDigit (p->digit, p->src + i * sz)]++) * sz, p->src + i * sz, sz);
+
+    return BAG_SUCCESS;
+}
+
+/****************************************************************************************/
+/*! \brief bagSortItems sorts \a n items in memory, stably, using \a scratch of as many items
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ****************************************************************************************/
+static bagError bagSortItems (const bagTrackSort *s, u8 *items, u8 *scratch, u32 n)
+{
+    bagRadixPass  p;
+    bagError      err = BAG_SUCCESS;
+    u8           *tmp;
+    u32           d, t, b, place, nworkers;
+    Bool          trivial;
+
+    p.s      = s;
+    p.src    = items;
+    p.dst    = scratch;
+    p.n      = n;
+    p.ntasks = n / TRACK_SORT_TASK_ITEMS + 1;
+    if (p.ntasks > s->nworkers)
+        p.ntasks = s->nworkers;
+    nworkers = p.ntasks;
+
+    if ((p.counts = malloc (p.ntasks * 256 * sizeof (u32))) == NULL)
+        return BAG_MEMORY_ALLOCATION_FAILED;
+
+    for (d = 0; d < s->ndigits && err == BAG_SUCCESS; d++)
+    {
+        p.digit = &s->digits[d];
+        if ((err = bagParallelFor (nworkers, p.ntasks, bagRadixCountTask, &p)) != BAG_SUCCESS)
+            break;
+
+        /*! a digit shared by every item leaves the order as it is */
+        trivial = False;
+        for (b = 0; b < 256 && !trivial; b++)
+        {
+            for (t = 0, place = 0; t < p.ntasks; t++)
+                place += p.counts[t * 256 + b];
+            trivial = (place == n) ? True : False;
+        }
+        if (trivial)
+            continue;
+
+        /*! the places of a digit follow block after block, which keeps the sort stable */
+        for (b = 0, place = 0; b < 256; b++)
+        {
+            for (t = 0; t < p.ntasks; t++)
+            {
+                u32 count = p.counts[t * 256 + b];
+
+                p.counts[t * 256 + b] = place;
+                place += count;
+            }
+        }
+        if ((err = bagParallelFor (nworkers, p.ntasks, bagRadixMoveTask, &p)) != BAG_SUCCESS)
+            break;
+
+        tmp   = p.dst;
+        p.dst = (u8 *) p.src;
+        p.src = tmp;
+    }
+    free (p.counts);
+
+    if (err == BAG_SUCCESS && p.src != items)
+        memcpy (items, p.src, (size_t) n * s->item_size);
+    return err;
+}
+
+/*! \brief bagSortAddKey appends the bytes of one key field, least significant first */
+static void bagSortAddKey (bagTrackSort *s, size_t offset, u32 size)
+{
+    u32 i;
+
+    for (i = 0; i < size && s->ndigits < TRACK_SORT_MAX_DIGITS; i++, s->ndigits++)
+    {
+        s->digits[s->ndigits].offset = (u32) offset;
+        s->digits[s->ndigits].size   = size;
+        s->digits[s->ndigits].shift  = 8 * i;
+    }
+}
+
+/*! \brief bagSortRunFill reads the next block of a run, none at its end */
+static bagError bagSortRunFill (const bagTrackSort *s, hid_t src_id, bagSortRun *run, u32 block)
+{
+    run->i = 0;
+    run->n = (run->end - run->next < block) ? (u32) (run->end - run->next) : block;
+    if (run->n == 0)
+        return BAG_SUCCESS;
+    run->next += run->n;
+    return bagSortIO (src_id, s->type_id, run->next - run->n, run->n, run->buf, False);
+}
+
+/*! \brief bagSortBefore orders the current items of two runs, the earlier run first on ties */
+static Bool bagSortBefore (const bagTrackSort *s, const bagSortRun *runs, u32 a, u32 b)
+{
+    s32 c = s->cmp (runs[a].buf + runs[a].i * s->item_size, runs[b].buf + runs[b].i * s->item_size);
+
+    return (c < 0 || (c == 0 && a < b)) ? True : False;
+}
+
+/*! \brief bagSortSift moves the run at heap position \a i down to its place */
+static void bagSortSift (const bagTrackSort *s, const bagSortRun *runs, u32 *heap, u32 nheap, u32 i)
+{
+    u32 child, top = heap[i];
+
+    while ((child = 2 * i + 1) < nheap)
+    {
+        if (child + 1 < nheap && bagSortBefore (s, runs, heap[child + 1], heap[child]))
+            child++;
+        if (!bagSortBefore (s, runs, heap[child], top))
+            break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = top;
+}
+
+/****************************************************************************************/
+/*! \brief bagSortMergeGroup merges consecutive runs of \a src_id into one run of \a dst_id
+ *
+ *  Run r covers items [bound[r], bound[r+1]); the merged run covers the same span of
+ *  \a dst_id.  \a mem holds a block of \a block items for each run and for the output.
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ****************************************************************************************/
+static bagError bagSortMergeGroup (const bagTrackSort *s, hid_t src_id, hid_t dst_id, const hsize_t *bound,
+                                   u32 nruns, u8 *mem, u32 block, u32 *written)
+{
+    bagSortRun *runs;
+    bagError    err = BAG_SUCCESS;
+    size_t      sz = s->item_size;
+    hsize_t     out_pos = bound[0];
+    u32        *heap, nheap = 0, nout = 0, r, i;
+    u8         *out = mem + (size_t) nruns * block * sz;
+
+    runs = malloc (nruns * sizeof (bagSortRun));
+    heap = malloc (nruns * sizeof (u32));
+    if (runs == NULL || heap == NULL)
+    {
+        free (runs);
+        free (heap);
+        return BAG_MEMORY_ALLOCATION_FAILED;
+    }
+
+    for (r = 0; r < nruns && err == BAG_SUCCESS; r++)
+    {
+        runs[r].next = bound[r];
+        runs[r].end  = bound[r + 1];
+        runs[r].buf  = mem + (size_t) r * block * sz;
+        if ((err = bagSortRunFill (s, src_id, &runs[r], block)) == BAG_SUCCESS && runs[r].n > 0)
+            heap[nheap++] = r;
+    }
+    for (i = nheap / 2; i-- > 0; )
+        bagSortSift (s, runs, heap, nheap, i);
+
+    while (nheap > 0 && err == BAG_SUCCESS)
+    {
+        r = heap[0];
+        memcpy (out + (size_t) nout * sz, runs[r].buf + (size_t) runs[r].i * sz, sz);
+        if (++nout == block)
+        {
+            err = bagSortIO (dst_id, s->type_id, out_pos, nout, out, True);
+            out_pos += nout;
+            *written += nout;
+            nout = 0;
+            if (s->progress != NULL)
+                s->progress (BAG_SORT_MERGE, *written, s->total, s->user);
+        }
+
+        if (++runs[r].i == runs[r].n)
+        {
+            if (err == BAG_SUCCESS)
+                err = bagSortRunFill (s, src_id, &runs[r], block);
+            if (runs[r].n == 0)
+                heap[0] = heap[--nheap];
+        }
+        if (nheap > 0)
+            bagSortSift (s, runs, heap, nheap, 0);
+    }
+
+    if (err == BAG_SUCCESS && nout > 0)
+    {
+        err = bagSortIO (dst_id, s->type_id, out_pos, nout, out, True);
+        *written += nout;
+        if (s->progress != NULL)
+            s->progress (BAG_SORT_MERGE, *written, s->total, s->user);
+    }
+
+    free (runs);
+    free (heap);
+    return err;
+}
+
+/****************************************************************************************/
+/*! \brief bagSortCreateTemp creates a new temporary file for the runs of a sort
+ *
+ *  Tried first next to the BAG, for a directory that cannot be written to then in the
+ *  temporary directory.  The file is created exclusively, under a name not used yet.
+ *
+ *  \param  hnd     The BAG being sorted
+ *  \param *name    Receives the name of the file, TRACK_SORT_NAME_LEN bytes, zero padded
+ *
+ *  \return The file identifier, negative on failure
+ *
+ ****************************************************************************************/
+hid_t bagSortCreateTemp (bagHandle hnd, char *name)
+{
+    static u32  serial = 0;
+    const char *dir, *base, *sep;
+    hid_t       file_id = -1;
+    u32         tag, i;
+
+    if ((dir = getenv ("TMPDIR")) == NULL && (dir = getenv ("TEMP")) == NULL && (dir = getenv ("TMP")) == NULL)
+        dir = "/tmp";
+    base = (const char *) hnd->filename;
+    if ((sep = strrchr (base, '/')) != NULL)
+        base = sep + 1;
+    if ((sep = strrchr (base, '\\')) != NULL)
+        base = sep + 1;
+
+    tag = (u32) time (NULL) ^ (u32) (size_t) hnd;
+    for (i = 0; i < 2 * TRACK_SORT_TEMP_TRIES && file_id < 0; i++)
+    {
+        memset (name, 0, TRACK_SORT_NAME_LEN);
+        tag += ++serial * 0x9E3779B9u;
+        if (i < TRACK_SORT_TEMP_TRIES)
+            sprintf (name, "%s.sort%08x", (char *) hnd->filename, tag);
+        else if (strlen (dir) + strlen (base) + 16 < TRACK_SORT_NAME_LEN)
+            sprintf (name, "%s/%s.sort%08x", dir, base, tag);
+        else
+            break;
+        file_id = H5Fcreate (name, H5F_ACC_EXCL, H5P_DEFAULT, H5P_DEFAULT);
+    }
+    return file_id;
+}
+
+/****************************************************************************************/
+/*! \brief bagSortRecover copies back into a list the items kept by a sort cut short
+ *
+ *  The list is left as it is when it has no sort_recovery attribute.  \a mem holds
+ *  \a block items.  Called with the HDF lock held.
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li \a BAG_HDF_SORT_NEEDS_RECOVERY when the kept items cannot be read.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ****************************************************************************************/
+static bagError bagSortRecover (bagHandle hnd, const bagTrackSort *s, hid_t list_id, u8 *mem, u32 block)
+{
+    hid_t     file_id, items_id, space_id;
+    hsize_t   len = 0;
+    bagError  err = BAG_SUCCESS;
+    u32       i, n;
+    char      name[TRACK_SORT_NAME_LEN];
+
+    if (H5Aexists (list_id, TRACK_SORT_RECOVERY_NAME) <= 0)
+        return BAG_SUCCESS;
+
+    memset (name, 0, sizeof (name));
+    if (bagReadAttribute (hnd, list_id, (u8 *) TRACK_SORT_RECOVERY_NAME, name) != BAG_SUCCESS)
+        return BAG_HDF_SORT_NEEDS_RECOVERY;
+    name[TRACK_SORT_NAME_LEN - 1] = '\0';
+    if ((file_id = H5Fopen (name, H5F_ACC_RDONLY, H5P_DEFAULT)) < 0)
+        return BAG_HDF_SORT_NEEDS_RECOVERY;
+    if ((items_id = H5Dopen (file_id, TRACK_SORT_ITEMS_NAME)) < 0)
+    {
+        H5Fclose (file_id);
+        return BAG_HDF_SORT_NEEDS_RECOVERY;
+    }
+    if ((space_id = H5Dget_space (items_id)) >= 0)
+    {
+        H5Sget_simple_extent_dims (space_id, &len, NULL);
+        H5Sclose (space_id);
+    }
+    if (len != s->total)
+        err = BAG_HDF_SORT_NEEDS_RECOVERY;
+
+    for (i = 0; i < s->total && err == BAG_SUCCESS; i += n)
+    {
+        n = (s->total - i < block) ? s->total - i : block;
+        if (bagSortIO (items_id, s->type_id, i, n, mem, False) != BAG_SUCCESS)
+            err = BAG_HDF_SORT_NEEDS_RECOVERY;
+        else
+            err = bagSortIO (list_id, s->type_id, i, n, mem, True);
+    }
+    H5Dclose (items_id);
+    H5Fclose (file_id);
+
+    if (err == BAG_SUCCESS)
+    {
+        if (H5Adelete (list_id, TRACK_SORT_RECOVERY_NAME) < 0)
+            return BAG_HDF_WRITE_FAILURE;
+        remove (name);
+    }
+    return err;
+}
+
+/****************************************************************************************/
+/*! \brief bagSortMarkRecovery keeps the input of the last merge before it overwrites a list
+ *
+ *  The input, dataset \a src_name of the temporary file \a name, is renamed "items", and
+ *  the list is given a sort_recovery attribute naming the file, both flushed to disk.
+ *
+ ****************************************************************************************/
+static bagError bagSortMarkRecovery (bagHandle hnd, hid_t file_id, const char *src_name, hid_t list_id, char *name)
+{
+    bagError err;
+
+    if (H5Lmove (file_id, src_name, file_id, TRACK_SORT_ITEMS_NAME, H5P_DEFAULT, H5P_DEFAULT) < 0 ||
+        H5Fflush (file_id, H5F_SCOPE_LOCAL) < 0)
+        return BAG_HDF_WRITE_FAILURE;
+
+    if (H5Aexists (list_id, TRACK_SORT_RECOVERY_NAME) <= 0 &&
+        (err = bagCreateAttribute (hnd, list_id, (u8 *) TRACK_SORT_RECOVERY_NAME, TRACK_SORT_NAME_LEN, BAG_ATTR_CS1)) != BAG_SUCCESS)
+        return err;
+    if ((err = bagWriteAttribute (hnd, list_id, (u8 *) TRACK_SORT_RECOVERY_NAME, name)) != BAG_SUCCESS)
+        return err;
+
+    return (H5Fflush (hnd->file_id, H5F_SCOPE_LOCAL) < 0) ? BAG_HDF_WRITE_FAILURE : BAG_SUCCESS;
+}
+
+/*! \brief bagSortCreateSpill makes a temporary dataset for \a n items */
+static hid_t bagSortCreateSpill (hid_t file_id, const char *name, hid_t type_id, u32 n)
+{
+    hid_t    space_id, dataset_id;
+    hsize_t  dims[1];
+
+    dims[0] = n;
+    if ((space_id = H5Screate_simple (1, dims, NULL)) < 0)
+        return -1;
+    dataset_id = H5Dcreate (file_id, name, type_id, space_id, H5P_DEFAULT);
+    H5Sclose (space_id);
+
+    return dataset_id;
+}
+
+/****************************************************************************************/
+/*! \brief bagSortExternal sorts a list larger than memory through a temporary file
+ *
+ *  \a mem holds 2 * \a run_items items.  Only a \a recoverable list, one of the
+ *  tracking lists rather than a temporary dataset, is marked for recovery while
+ *  the last merge overwrites it.
+ *
+ ****************************************************************************************/
+static bagError bagSortExternal (bagHandle hnd, bagTrackSort *s, hid_t list_id, u8 *mem, u32 run_items, Bool recoverable)
+{
+    static const char *spill_names[2] = { "runs0", "runs1" };
+    hid_t     file_id, spill_id[2] = { -1, -1 }, src_id, dst_id;
+    hsize_t  *bound;
+    bagError  err = BAG_SUCCESS;
+    size_t    sz = s->item_size;
+    u32       len = s->total, nruns, r, n, g, group, fan_in, block, written, cur = 0;
+    char      name[TRACK_SORT_NAME_LEN];
+    Bool      final = False, overwriting = False;
+
+    nruns = len / run_items + (len % run_items != 0);
+    if ((bound = malloc ((nruns + 1) * sizeof (hsize_t))) == NULL)
+        return BAG_MEMORY_ALLOCATION_FAILED;
+
+    if ((file_id = bagSortCreateTemp (hnd, name)) < 0)
+    {
+        free (bound);
+        return BAG_HDF_CREATE_FILE_FAILURE;
+    }
+    if ((spill_id[0] = bagSortCreateSpill (file_id, spill_names[0], s->type_id, len)) < 0)
+        err = BAG_HDF_CREATE_DATASET_FAILURE;
+
+    /*! sorted runs, a memory load each */
+    for (r = 0; r < nruns && err == BAG_SUCCESS; r++)
+    {
+        bound[r] = (hsize_t) r * run_items;
+        n = (len - r * run_items < run_items) ? len - r * run_items : run_items;
+        if ((err = bagSortIO (list_id, s->type_id, bound[r], n, mem, False)) != BAG_SUCCESS)
+            break;
+        if ((err = bagSortItems (s, mem, mem + (size_t) run_items * sz, n)) == BAG_SUCCESS)
+            err = bagSortIO (spill_id[0], s->type_id, bound[r], n, mem, True);
+        if (s->progress != NULL)
+            s->progress (BAG_SORT_RUNS, (u32) bound[r] + n, len, s->user);
+    }
+    bound[nruns] = len;
+
+    /*! merge passes; the last writes back into the list */
+    while (err == BAG_SUCCESS && !final)
+    {
+        fan_in = 2 * run_items / TRACK_SORT_MIN_BLOCK - 1;
+        final  = (nruns <= fan_in) ? True : False;
+        if (final)
+        {
+            fan_in = nruns;
+            dst_id = list_id;
+
+            /*! from here the list is overwritten: keep a complete copy of it, and say where */
+            if (recoverable)
+            {
+                if ((err = bagSortMarkRecovery (hnd, file_id, spill_names[cur], list_id, name)) != BAG_SUCCESS)
+                    break;
+                overwriting = True;
+            }
+        }
+        else
+        {
+            if (spill_id[1 - cur] < 0 &&
+                (spill_id[1 - cur] = bagSortCreateSpill (file_id, spill_names[1 - cur], s->type_id, len)) < 0)
+            {
+                err = BAG_HDF_CREATE_DATASET_FAILURE;
+                break;
+            }
+            dst_id = spill_id[1 - cur];
+        }
+        src_id  = spill_id[cur];
+        block   = 2 * run_items / (fan_in + 1);
+        written = 0;
+
+        for (g = 0, group = 0; g < nruns && err == BAG_SUCCESS; g += fan_in, group++)
+        {
+            n = (nruns - g < fan_in) ? nruns - g : fan_in;
+            err = bagSortMergeGroup (s, src_id, dst_id, bound + g, n, mem, block, &written);
+            bound[group] = bound[g];
+        }
+        bound[group] = len;
+        nruns = group;
+        cur   = 1 - cur;
+    }
+
+    for (r = 0; r < 2; r++)
+    {
+        if (spill_id[r] >= 0)
+            H5Dclose (spill_id[r]);
+    }
+    H5Fclose (file_id);
+    free (bound);
+
+    /*! a list cut short keeps its marker and the file of its items */
+    if (overwriting && err != BAG_SUCCESS)
+        return BAG_HDF_SORT_NEEDS_RECOVERY;
+    if (overwriting && H5Adelete (list_id, TRACK_SORT_RECOVERY_NAME) < 0)
+        err = BAG_HDF_WRITE_FAILURE;
+    remove (name);
+
+    return err;
+}
+
+/****************************************************************************************/
+/*! \brief bagSortTrackIndexEntries sorts the entries of a tracking list index by key
+ *
+ *  \param  hnd          The BAG being indexed
+ *  \param  nkeys        Fields of the key in use, from key[0]; the others are zero
+ *  \param  entries_id   Dataset of the \a n entries, sorted externally; or negative when
+ *                       they are the first \a n of \a mem, \a n no more than \a run_items
+ *  \param  type_id      Memory datatype of a bagTrackIndexEntry
+ *  \param *mem          2 * \a run_items entries
+ *
+ *  The entries are made in list order and the sort is stable, so the positions of one
+ *  key stay ascending.  Called with the HDF lock held.
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ****************************************************************************************/
+bagError bagSortTrackIndexEntries (bagHandle hnd, u32 nkeys, hid_t entries_id, hid_t type_id, u32 n, u8 *mem, u32 run_items)
+{
+    bagTrackSort s;
+    u32          k;
+
+    s.cmp     = bagTrackIndexCompareEntries;
+    s.ndigits = 0;
+    for (k = nkeys; k-- > 0; )
+        bagSortAddKey (&s, offsetof (bagTrackIndexEntry, key) + k * sizeof (u32), 4);
+    s.nworkers  = bagGetNumProcessors ();
+    s.type_id   = type_id;
+    s.item_size = sizeof (bagTrackIndexEntry);
+    s.progress  = NULL;
+    s.user      = NULL;
+    s.total     = n;
+
+    if (entries_id < 0)
+        return bagSortItems (&s, mem, mem + (size_t) run_items * s.item_size, n);
+    return bagSortExternal (hnd, &s, entries_id, mem, run_items, False);
+}
+
+/****************************************************************************************/
+/*! \brief bagSortTrackingItems sorts a tracking list in place within \a max_bytes
+ *
+ *  Called with the HDF lock held.
+ *
+ ****************************************************************************************/
+static bagError bagSortTrackingItems (bagHandle hnd, Bool varres, u8 by, u32 max_bytes,
+                                      bagSortProgressFunc progress, void *user)
+{
+    bagTrackSort  s;
+    hid_t         list_id;
+    bagError      err;
+    u32           run_items;
+    u8           *mem;
+
+    if (hnd == NULL)
+        return BAG_INVALID_BAG_HANDLE;
+
+    /*! the comparator orders the merge, the key bytes the radix passes */
+    s.ndigits = 0;
+    switch (by)
+    {
+    case BAG_TRACK_BY_NODE:
+        if (varres)
+        {
+            s.cmp = bagCompareVarResTrackNodes;
+            bagSortAddKey (&s, offsetof (bagVarResTrackingItem, col), 4);
+            bagSortAddKey (&s, offsetof (bagVarResTrackingItem, row), 4);
+        }
+        else
+        {
+            s.cmp = bagCompareTrackNodes;
+            bagSortAddKey (&s, offsetof (bagTrackingItem, col), 4);
+            bagSortAddKey (&s, offsetof (bagTrackingItem, row), 4);
+        }
+        break;
+    case BAG_TRACK_BY_SERIES:
+        s.cmp = varres ? bagCompareVarResTrackIndices : bagCompareTrackIndices;
+        bagSortAddKey (&s, varres ? offsetof (bagVarResTrackingItem, list_series) : offsetof (bagTrackingItem, list_series), 2);
+        break;
+    case BAG_TRACK_BY_CODE:
+        s.cmp = varres ? bagCompareVarResTrackCodes : bagCompareTrackCodes;
+        bagSortAddKey (&s, varres ? offsetof (bagVarResTrackingItem, track_code) : offsetof (bagTrackingItem, track_code), 1);
+        break;
+    case BAG_TRACK_BY_SUBNODE:
+        if (varres)
+        {
+            s.cmp = bagCompareVarResTrackSubNodes;
+            bagSortAddKey (&s, offsetof (bagVarResTrackingItem, sub_col), 4);
+            bagSortAddKey (&s, offsetof (bagVarResTrackingItem, col), 4);
+            bagSortAddKey (&s, offsetof (bagVarResTrackingItem, sub_row), 4);
+            bagSortAddKey (&s, offsetof (bagVarResTrackingItem, row), 4);
+            break;
+        }
+        /* fall through */
+    default:
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+    }
+
+    if ((err = bagGetTrackingList (hnd, varres, &list_id, &s.type_id, &s.total)) != BAG_SUCCESS)
+        return err;
+    s.item_size = varres ? sizeof (bagVarResTrackingItem) : sizeof (bagTrackingItem);
+    s.progress  = progress;
+    s.user      = user;
+    s.nworkers  = bagGetNumProcessors ();
+
+    /*! half the memory holds a run, half the scratch of its sort */
+    run_items = ((max_bytes > 0) ? max_bytes : TRACKING_LIST_SORT_BYTES) / (u32) (2 * s.item_size);
+    if (run_items < TRACK_SORT_MIN_RUN)
+        run_items = TRACK_SORT_MIN_RUN;
+    if (run_items > s.total)
+        run_items = (s.total > 0) ? s.total : 1;
+
+    if ((mem = malloc ((size_t) 2 * run_items * s.item_size)) == NULL)
+        return BAG_MEMORY_ALLOCATION_FAILED;
+
+    /*! a list left half written by an earlier sort is made whole first */
+    if ((err = bagSortRecover (hnd, &s, list_id, mem, 2 * run_items)) != BAG_SUCCESS)
+    {
+        free (mem);
+        return err;
+    }
+
+    if (s.total <= run_items)
+    {
+        if ((err = bagSortIO (list_id, s.type_id, 0, s.total, mem, False)) == BAG_SUCCESS)
+        {
+            if ((err = bagSortItems (&s, mem, mem + (size_t) run_items * s.item_size, s.total)) == BAG_SUCCESS)
+                err = bagSortIO (list_id, s.type_id, 0, s.total, mem, True);
+        }
+        if (err == BAG_SUCCESS && progress != NULL)
+            progress (BAG_SORT_MERGE, s.total, s.total, user);
+    }
+    else
+        err = bagSortExternal (hnd, &s, list_id, mem, run_items, True);
+    free (mem);
+
+    /*! the items moved, so an index of the list must be remade, within the same bound */
+    if (err == BAG_SUCCESS && bagHasTrackIndex (hnd, varres))
+        err = bagBuildTrackIndex (hnd, varres, max_bytes);
+
+    return err;
+}
+
+/****************************************************************************************/
+/*! \brief bagSortTrackingListEx sorts the tracking list in place, in bounded memory
+ *
+ *  \param  hnd        External reference to the private \a bagHandle object, opened for write
+ *  \param  by         \a BAG_TRACK_BY_NODE, \a BAG_TRACK_BY_SERIES or \a BAG_TRACK_BY_CODE
+ *  \param  max_bytes  Memory the sort may use, 0 for TRACKING_LIST_SORT_BYTES
+ *  \param  progress   Called as the sort advances, or NULL
+ *  \param *user       Passed to \a progress
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ****************************************************************************************/
+bagError bagSortTrackingListEx (bagHandle hnd, u8 by, u32 max_bytes, bagSortProgressFunc progress, void *user)
+{
+    bagError err;
+
+    bagLockHDF ();
+    err = bagSortTrackingItems (hnd, False, by, max_bytes, progress, user);
+    bagUnlockHDF ();
+
+    return err;
+}
+
+/****************************************************************************************/
+/*! \brief bagSortVarResTrackingListEx sorts the variable resolution tracking list in
+ *         place, in bounded memory
+ *
+ *  \param  hnd        External reference to the private \a bagHandle object, opened for write
+ *  \param  by         \a BAG_TRACK_BY_NODE, \a BAG_TRACK_BY_SUBNODE, \a BAG_TRACK_BY_SERIES
+ *                     or \a BAG_TRACK_BY_CODE
+ *  \param  max_bytes  Memory the sort may use, 0 for TRACKING_LIST_SORT_BYTES
+ *  \param  progress   Called as the sort advances, or NULL
+ *  \param *user       Passed to \a progress
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ****************************************************************************************/
+bagError bagSortVarResTrackingListEx (bagHandle hnd, u8 by, u32 max_bytes, bagSortProgressFunc progress, void *user)
+{
+    bagError err;
+
+    bagLockHDF ();
+    err = bagSortTrackingItems (hnd, True, by, max_bytes, progress, user);
+    bagUnlockHDF ();
+
+    return err;
+}
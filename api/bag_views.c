@@ -0,0 +1,184 @@
+/*! \file bag_views.c
+ * \brief This module contains the per-thread reader views of an open BAG.
+ ********************************************************************
+ *
+ * Module Name : bag_views.c
+ *
+ * Author/Date : ONSWG, October 2026
+ *
+ * Description :
+ *               A reader view is a second bagHandle onto a BAG that is
+ *               already open.  It shares the parent's HDF file and dataset
+ *               identifiers, by reference count, but owns its dataspaces,
+ *               memspace cache, read arrays and mappings, so that every
+ *               thread can read through its own view while other threads
+ *               read through theirs.  The HDF calls of the library are
+ *               serialized by the library wide HDF lock, see bag_threads.c.
+ *
+ * Restrictions/Limitations :
+ *               A view does not carry the parent's metadata, and must be
+ *               closed with bagReaderViewClose before its parent is closed.
+ *               A view and its parent must not be used by two threads at
+ *               the same time; use one view per thread.
+ *
+ * Change Descriptions :
+ * who  when      what
+ * ---  ----      ----
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ ********************************************************************/
+
+#include <string.h>
+
+#include "bag_private.h"
+
+/****************************************************************************************/
+/*! \brief bagShareId gives a view its own reference to one of the parent's HDF identifiers
+ *
+ *  Dataspaces and property lists carry selection or mutable state and are copied;
+ *  files, groups, datasets and datatypes are shared with their reference count bumped,
+ *  so the view releases them with the usual close calls.
+ *
+ ****************************************************************************************/
+static hid_t bagShareId (hid_t id)
+{
+    if (id < 0)
+        return -1;
+
+    switch (H5Iget_type (id))
+    {
+    case H5I_DATASPACE:
+        return H5Scopy (id);
+    case H5I_GENPROP_LST:
+        return H5Pcopy (id);
+    default:
+        if (H5Iinc_ref (id) < 0)
+            return -1;
+        return id;
+    }
+}
+
+/****************************************************************************************/
+/*! \brief bagReaderViewOpen makes a lightweight reader view of an open BAG
+ *
+ *  \param  parent   External reference to the private \a bagHandle object to view
+ *  \param *view     Will be set to the allocated view, used as any other \a bagHandle
+ *                   for reads.  Must be released with \a bagReaderViewClose.
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ********************************************************************/
+static bagError bagReaderViewOpenUnlocked (bagHandle parent, bagHandle *view)
+{
+    bagHandle  v;
+    s32        i;
+
+    if ((v = (bagHandle) calloc (1, sizeof (struct _t_bagHandle))) == NULL)
+        return BAG_MEMORY_ALLOCATION_FAILED;
+    memcpy (v, parent, sizeof (struct _t_bagHandle));
+
+    /*! nothing allocated by the parent is shared */
+    v->elevationArray   = NULL;
+    v->uncertaintyArray = NULL;
+    v->cryptoBlock      = NULL;
+    v->bag.elevation    = NULL;
+    v->bag.uncertainty  = NULL;
+    v->bag.tracking_list = NULL;
+    v->bag.metadata     = NULL;
+    v->bag.metadataDef  = NULL;
+    for (i = 0; i < BAG_OPT_SURFACE_LIMIT; i++)
+    {
+        v->dataArray[i]  = NULL;
+        v->bag.opt[i].data = NULL;
+        v->map_base[i]   = NULL;
+        v->map_length[i] = 0;
+        v->map_view[i]   = NULL;
+    }
+    /*! a view reads every chunk, the index stays with its parent */
+    v->chunk_index[Elevation]   = NULL;
+    v->chunk_index[Uncertainty] = NULL;
+    bagInitMemspaceCache (v);
+
+    v->file_id          = bagShareId (parent->file_id);
+    v->bagGroupID       = bagShareId (parent->bagGroupID);
+    v->unc_memspace_id  = bagShareId (parent->unc_memspace_id);
+    v->trk_memspace_id  = bagShareId (parent->trk_memspace_id);
+    v->mta_memspace_id  = bagShareId (parent->mta_memspace_id);
+    v->elv_memspace_id  = bagShareId (parent->elv_memspace_id);
+    v->unc_dataset_id   = bagShareId (parent->unc_dataset_id);
+    v->trk_dataset_id   = bagShareId (parent->trk_dataset_id);
+    v->mta_dataset_id   = bagShareId (parent->mta_dataset_id);
+    v->elv_dataset_id   = bagShareId (parent->elv_dataset_id);
+    v->unc_filespace_id = bagShareId (parent->unc_filespace_id);
+    v->trk_filespace_id = bagShareId (parent->trk_filespace_id);
+    v->mta_filespace_id = bagShareId (parent->mta_filespace_id);
+    v->elv_filespace_id = bagShareId (parent->elv_filespace_id);
+    v->unc_datatype_id  = bagShareId (parent->unc_datatype_id);
+    v->trk_datatype_id  = bagShareId (parent->trk_datatype_id);
+    v->mta_datatype_id  = bagShareId (parent->mta_datatype_id);
+    v->elv_datatype_id  = bagShareId (parent->elv_datatype_id);
+    v->mta_cparms_id    = bagShareId (parent->mta_cparms_id);
+    for (i = 0; i < BAG_OPT_SURFACE_LIMIT; i++)
+    {
+        v->opt_memspace_id[i]  = bagShareId (parent->opt_memspace_id[i]);
+        v->opt_dataset_id[i]   = bagShareId (parent->opt_dataset_id[i]);
+        v->opt_filespace_id[i] = bagShareId (parent->opt_filespace_id[i]);
+        v->opt_datatype_id[i]  = bagShareId (parent->opt_datatype_id[i]);
+    }
+
+    if (v->file_id < 0 || v->bagGroupID < 0)
+    {
+        bagFileClose (v);
+        return BAG_HDF_INTERNAL_ERROR;
+    }
+
+    *view = v;
+    return BAG_SUCCESS;
+}
+
+bagError bagReaderViewOpen (bagHandle parent, bagHandle *view)
+{
+    bagError err;
+
+    if (parent == NULL)
+        return BAG_INVALID_BAG_HANDLE;
+    if (view == NULL)
+        return BAG_INVALID_FUNCTION_ARGUMENT;
+
+    *view = NULL;
+
+    bagLockHDF ();
+    err = bagReaderViewOpenUnlocked (parent, view);
+    bagUnlockHDF ();
+
+    return err;
+}
+
+/****************************************************************************************/
+/*! \brief bagReaderViewClose releases a view made by \a bagReaderViewOpen
+ *
+ *  The read arrays of the view are freed along with its HDF references; the parent
+ *  and its other views are not affected.
+ *
+ *  \param  view   View returned by \a bagReaderViewOpen
+ *
+ *  \return : \li On success, \a bagError is set to \a BAG_SUCCESS.
+ *            \li On failure, \a bagError is set to a proper code from \a BAG_ERRORS.
+ *
+ ********************************************************************/
+bagError bagReaderViewClose (bagHandle view)
+{
+    s32 i;
+
+    if (view == NULL)
+        return BAG_INVALID_BAG_HANDLE;
+
+    for (i = 0; i < BAG_OPT_SURFACE_LIMIT; i++)
+        bagFreeArray (view, i);
+
+    return bagFileClose (view);
+}
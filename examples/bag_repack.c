@@ -0,0 +1,132 @@
+/*
+ * File:	bag_repack.c
+ * Purpose:	Copy a BAG into a new file with new chunking and compression.
+ * Date:	2026-10-18
+ *
+ * Archived BAGs written with small chunks read slowly; this rewrites them with
+ * chunks planned for the grid and the access pattern asked for, carrying the
+ * metadata and attributes across.  A signature would not verify against the
+ * new bytes, so it is not copied; given the signer's pass-phrase, the new file
+ * is signed again with the sequence number of the old signature.
+ *
+ * This is free source code, courtesy of the OpenNavigationSurface project.  Visit
+ * the website http://www.opennavsurf.org
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bag.h"
+#include "excertlib.h"
+#include "getopt.h"
+
+static char *modname = "bag_repack";
+
+typedef enum {
+	INPUT_FILE = 1,
+	OUTPUT_FILE,
+	ARGC_EXPECTED
+} Cmd;
+
+void Syntax(void)
+{
+	printf("bag_repack [%s] - Copy a BAG with new chunking and compression.\n", __DATE__);
+	printf("Syntax: bag_repack [opt] <input><output>\n");
+	printf(" BAG file to copy -----------^       ^\n");
+	printf(" New BAG file, must not exist -------'\n");
+	printf(" Options:\n");
+	printf("  -z <level>   Deflate level 0-9 of the new file (default 6).\n");
+	printf("  -s           Byte-shuffle values before compressing.\n");
+	printf("  -c <nodes>   Square chunk of the surfaces (default: planned).\n");
+	printf("  -k <KiB>     Target size of a planned chunk (default 256).\n");
+	printf("  -a <hint>    Access to plan for: tiles, rows or nodes (default tiles).\n");
+	printf("  -p <phrase>  Re-sign the new file with the secret key unlocked by <phrase>.\n");
+	printf("  -f <seckey>  Read the secret key from XML file <seckey> rather than the HASP.\n");
+}
+
+int main(int argc, char **argv)
+{
+	int					c;
+	bagRepackOptions	opts;
+	bagError			err;
+	u8					*errstr, sig[1024];
+	u32					sig_id;
+	char				*phrase = NULL, *private_file = NULL;
+
+	memset(&opts, 0, sizeof(opts));
+	opts.compressionLevel = 6;
+
+	opterr = 0;
+	while ((c = getopt(argc, argv, "hz:sc:k:a:p:f:")) != EOF) {
+		switch(c) {
+			case 'z':
+				opts.compressionLevel = (u8)atoi(optarg);
+				break;
+			case 's':
+				opts.filter.shuffle = 1;
+				break;
+			case 'c':
+				opts.chunkSize = (u32)atoi(optarg);
+				break;
+			case 'k':
+				opts.chunkBytes = (u32)atoi(optarg) * 1024;
+				break;
+			case 'a':
+				if (strcmp(optarg, "rows") == 0)
+					opts.accessHint = BAG_ACCESS_ROWS;
+				else if (strcmp(optarg, "nodes") == 0)
+					opts.accessHint = BAG_ACCESS_NODES;
+				else
+					opts.accessHint = BAG_ACCESS_TILES;
+				break;
+			case 'p':
+				phrase = strdup(optarg);
+				break;
+			case 'f':
+				private_file = strdup(optarg);
+				break;
+			case '?':
+				printf("%s: unknown option '%c'\n", modname, optopt);
+			default:
+				Syntax();
+				return(1);
+		}
+	}
+	argc -= optind-1; argv += optind-1;
+
+	if (argc != ARGC_EXPECTED) {
+		Syntax();
+		return(1);
+	}
+
+	err = bagRepack((u8*)argv[INPUT_FILE], (u8*)argv[OUTPUT_FILE], &opts);
+	if (err != BAG_SUCCESS && err != BAG_CRYPTO_SIGNATURE_DROPPED) {
+		bagGetErrorString(err, &errstr);
+		fprintf(stderr, "%s: error: failed to repack \"%s\": %s\n", modname, argv[INPUT_FILE], (char*)errstr);
+		return(1);
+	}
+	if (err == BAG_SUCCESS) {
+		if (phrase != NULL)
+			fprintf(stderr, "%s: \"%s\" was not signed; nothing to re-sign.\n", modname, argv[INPUT_FILE]);
+		return(0);
+	}
+	if (phrase == NULL) {
+		fprintf(stderr, "%s: warning: \"%s\" is signed; \"%s\" is left unsigned (use -p to sign it).\n",
+			modname, argv[INPUT_FILE], argv[OUTPUT_FILE]);
+		return(0);
+	}
+
+	/* The old signature block gives the sequence number to sign again with */
+	err = bagReadCertification(argv[INPUT_FILE], sig, sizeof(sig), &sig_id);
+	if (err != BAG_SUCCESS && err != BAG_CRYPTO_SIGNATURE_OK) {
+		fprintf(stderr, "%s: error: failed to read the signature of \"%s\".\n", modname, argv[INPUT_FILE]);
+		return(1);
+	}
+	if (excert_sign_ons(argv[OUTPUT_FILE], phrase, sig_id, private_file == NULL ? True : False, private_file) != EXCERT_OK) {
+		fprintf(stderr, "%s: error: failed to sign output \"%s\".\n", modname, argv[OUTPUT_FILE]);
+		return(1);
+	}
+	return(0);
+}